@@ -365,6 +365,9 @@ public:
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			// GPU times of the passes are displayed in the overlay and written to the benchmark results
+			gpuProfiler.BeginFrame(drawCmdBuffers[i], i);
+
 			if (bloom) {
 				clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
 				clearValues[1].depthStencil = { 1.0f, 0 };
@@ -387,6 +390,8 @@ public:
 					First render pass: Render glow parts of the model (separate mesh) to an offscreen frame buffer
 				*/
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "Bloom glow");
+
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.scene, 0, 1, &descriptorSets.scene, 0, NULL);
@@ -399,6 +404,8 @@ public:
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
+
 				/*
 					Second render pass: Vertical blur
 					Render contents of the first pass into a second framebuffer and apply a vertical blur
@@ -407,6 +414,8 @@ public:
 
 				renderPassBeginInfo.framebuffer = offscreenPass.framebuffers[1].framebuffer;
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "Bloom vertical blur");
+
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.blur, 0, 1, &descriptorSets.blurVert, 0, NULL);
@@ -414,6 +423,8 @@ public:
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
+
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
 			}
 
 			/*
@@ -446,6 +457,8 @@ public:
 
 				VkDeviceSize offsets[1] = { 0 };
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "Scene");
+
 				// Skybox
 				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.scene, 0, 1, &descriptorSets.skyBox, 0, NULL);
 				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.skyBox);
@@ -462,11 +475,15 @@ public:
 				vkCmdBindIndexBuffer(drawCmdBuffers[i], models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 				vkCmdDrawIndexed(drawCmdBuffers[i], models.ufo.indexCount, 1, 0, 0, 0);
 
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
+
 				if (bloom)
 				{
+					gpuProfiler.BeginScope(drawCmdBuffers[i], "Bloom horizontal blur");
 					vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.blur, 0, 1, &descriptorSets.blurHorz, 0, NULL);
 					vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.blurHorz);
 					vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
+					gpuProfiler.EndScope(drawCmdBuffers[i]);
 				}
 
 				DrawUI(drawCmdBuffers[i]);
@@ -213,7 +213,10 @@ public:
 
 	void LoadAssets()
 	{
-		models.lodObject.LoadFromFile(GetAssetPath() + "models/suzanne_lods.dae", vertexLayout, 0.1f, vulkanDevice, queue);
+		// The levels of detail are generated from the full detail model at load time, each level is stored as a separate model part
+		vks::ModelCreateInfo modelCreateInfo(0.1f, 1.0f, 0.0f);
+		modelCreateInfo.lodCount = MAX_LOD_LEVEL;
+		models.lodObject.LoadFromFile(GetAssetPath() + "models/suzanne.obj", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
 	}
 
 	void SetupVertexDescriptions()
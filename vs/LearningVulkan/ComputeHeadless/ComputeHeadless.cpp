@@ -18,6 +18,7 @@
 
 #include <vulkan/vulkan.h>
 #include "VulkanTools.h"
+#include "VulkanMemoryAllocator.hpp"
 
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 android_app* androidapp;
@@ -65,46 +66,25 @@ public:
 	VkPipelineLayout pipelineLayout;
 	VkPipeline pipeline;
 	VkShaderModule shaderModule;
+	vks::MemoryAllocator memoryAllocator;
 
 	VkDebugReportCallbackEXT debugReportCallback{};
 
-	VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer* buffer, VkDeviceMemory* memory, VkDeviceSize size, void* data = nullptr)
+	VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer* buffer, vks::MemoryAllocation* allocation, VkDeviceSize size, void* data = nullptr)
 	{
 		// Create the buffer handle
 		VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo(usageFlags, size);
 		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, buffer));
 
-		// Create the memory backing up the buffer handle
-		VkPhysicalDeviceMemoryProperties deviceMemoryProperties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &deviceMemoryProperties);
-		VkMemoryRequirements memReqs;
-		VkMemoryAllocateInfo memAlloc = vks::initializers::MemoryAllocateInfo();
-		vkGetBufferMemoryRequirements(device, *buffer, &memReqs);
-		memAlloc.allocationSize = memReqs.size;
-		// Find a memory type index that fits the properties of the buffer
-		bool memTypeFound = false;
-		for (uint32_t i = 0; i < deviceMemoryProperties.memoryTypeCount; i++) {
-			if ((memReqs.memoryTypeBits & 1) == 1) {
-				if ((deviceMemoryProperties.memoryTypes[i].propertyFlags & memoryPropertyFlags) == memoryPropertyFlags) {
-					memAlloc.memoryTypeIndex = i;
-					memTypeFound = true;
-				}
-			}
-			memReqs.memoryTypeBits >>= 1;
-		}
-		assert(memTypeFound);
-		VK_CHECK_RESULT(vkAllocateMemory(device, &memAlloc, nullptr, memory));
+		// Take the memory backing up the buffer handle from the allocator and bind it
+		VK_CHECK_RESULT(memoryAllocator.AllocateBuffer(*buffer, memoryPropertyFlags, allocation));
 
 		if (data != nullptr) {
-			void* mapped;
-			VK_CHECK_RESULT(vkMapMemory(device, *memory, 0, size, 0, &mapped));
-			memcpy(mapped, data, size);
-			vkUnmapMemory(device, *memory);
+			// Host visible memory is persistently mapped by the allocator
+			memcpy(allocation->mapped, data, size);
 		}
 
-		VK_CHECK_RESULT(vkBindBufferMemory(device, *buffer, *memory, 0));
-
 		return VK_SUCCESS;
 	}
 
@@ -225,6 +205,9 @@ public:
 		deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
 		VK_CHECK_RESULT(vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device));
 
+		// Sub-allocates the memory for the buffers
+		memoryAllocator.Create(physicalDevice, device);
+
 		// Get a compute queue
 		vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
 
@@ -248,7 +231,7 @@ public:
 		const VkDeviceSize bufferSize = BUFFER_ELEMENTS * sizeof(uint32_t);
 
 		VkBuffer deviceBuffer, hostBuffer;
-		VkDeviceMemory deviceMemory, hostMemory;
+		vks::MemoryAllocation deviceAllocation, hostAllocation;
 
 		// Copy input data to VRAM using a staging buffer
 		{
@@ -256,25 +239,18 @@ public:
 				VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
 				&hostBuffer,
-				&hostMemory,
+				&hostAllocation,
 				bufferSize,
 				computeInput.data());
 
 			// Flush writes to host visible buffer
-			void* mapped;
-			vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
-			VkMappedMemoryRange mappedRange = vks::initializers::MappedMemoryRange();
-			mappedRange.memory = hostMemory;
-			mappedRange.offset = 0;
-			mappedRange.size = VK_WHOLE_SIZE;
-			vkFlushMappedMemoryRanges(device, 1, &mappedRange);
-			vkUnmapMemory(device, hostMemory);
+			memoryAllocator.Flush(hostAllocation);
 
 			createBuffer(
 				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
 				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 				&deviceBuffer,
-				&deviceMemory,
+				&deviceAllocation,
 				bufferSize);
 
 			// Copy to staging buffer
@@ -465,17 +441,10 @@ public:
 			VK_CHECK_RESULT(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX));
 
 			// Make device writes visible to the host
-			void* mapped;
-			vkMapMemory(device, hostMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
-			VkMappedMemoryRange mappedRange = vks::initializers::MappedMemoryRange();
-			mappedRange.memory = hostMemory;
-			mappedRange.offset = 0;
-			mappedRange.size = VK_WHOLE_SIZE;
-			vkInvalidateMappedMemoryRanges(device, 1, &mappedRange);
+			memoryAllocator.Invalidate(hostAllocation);
 
 			// Copy to output
-			memcpy(computeOutput.data(), mapped, bufferSize);
-			vkUnmapMemory(device, hostMemory);
+			memcpy(computeOutput.data(), hostAllocation.mapped, bufferSize);
 		}
 
 		vkQueueWaitIdle(queue);
@@ -495,9 +464,9 @@ public:
 
 		// Clean up
 		vkDestroyBuffer(device, deviceBuffer, nullptr);
-		vkFreeMemory(device, deviceMemory, nullptr);
+		memoryAllocator.Free(deviceAllocation);
 		vkDestroyBuffer(device, hostBuffer, nullptr);
-		vkFreeMemory(device, hostMemory, nullptr);
+		memoryAllocator.Free(hostAllocation);
 	}
 
 	~VulkanExampleComputeHeadless()
@@ -510,6 +479,7 @@ public:
 		vkDestroyFence(device, fence, nullptr);
 		vkDestroyCommandPool(device, commandPool, nullptr);
 		vkDestroyShaderModule(device, shaderModule, nullptr);
+		memoryAllocator.Destroy();
 		vkDestroyDevice(device, nullptr);
 #if DEBUG
 		if (debugReportCallback) {
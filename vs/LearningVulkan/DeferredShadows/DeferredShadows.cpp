@@ -907,12 +907,14 @@ public:
 		pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
 		pipelineCreateInfo.pStages = shaderStages.data();
 
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.deferred));
+		// Pipelines are compiled in parallel by the pipeline builder, which copies the create info
+		// so the state structures can be changed for the next pipeline right away
+		std::future<VkPipeline> deferredPipeline = pipelineBuilder.Submit(pipelineCreateInfo);
 
 		// Debug display pipeline
 		shaderStages[0] = LoadShader(GetShadersPath() + "deferredshadows/debug.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetShadersPath() + "deferredshadows/debug.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.debug));
+		std::future<VkPipeline> debugPipeline = pipelineBuilder.Submit(pipelineCreateInfo);
 
 		// Offscreen pipeline
 		shaderStages[0] = LoadShader(GetShadersPath() + "deferredshadows/mrt.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
@@ -937,7 +939,7 @@ public:
 		colorBlendState.attachmentCount = static_cast<uint32_t>(blendAttachmentStates.size());
 		colorBlendState.pAttachments = blendAttachmentStates.data();
 
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.offscreen));
+		std::future<VkPipeline> offscreenPipeline = pipelineBuilder.Submit(pipelineCreateInfo);
 
 		// Shadow mapping pipeline
 		// The shadow mapping pipeline uses geometry shader instancing (invocations layout modifier) to output
@@ -966,7 +968,12 @@ public:
 				0);
 		// Reset blend attachment state
 		pipelineCreateInfo.renderPass = frameBuffers.shadow->renderPass;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.shadowpass));
+		std::future<VkPipeline> shadowpassPipeline = pipelineBuilder.Submit(pipelineCreateInfo);
+
+		pipelines.deferred = deferredPipeline.get();
+		pipelines.debug = debugPipeline.get();
+		pipelines.offscreen = offscreenPipeline.get();
+		pipelines.shadowpass = shadowpassPipeline.get();
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -432,10 +432,7 @@ public:
 
 		memcpy(uniformBuffers.dynamic.mapped, uboDataDynamic.model, uniformBuffers.dynamic.size);
 		// Flush to make changes visible to host
-		VkMappedMemoryRange memoryRange = vks::initializers::MappedMemoryRange();
-		memoryRange.memory = uniformBuffers.dynamic.memory;
-		memoryRange.size = uniformBuffers.dynamic.size;
-		vkFlushMappedMemoryRanges(device, 1, &memoryRange);
+		uniformBuffers.dynamic.Flush();
 	}
 
 	void Prepare()
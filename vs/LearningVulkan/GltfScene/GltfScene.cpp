@@ -3,6 +3,9 @@
 #include <string.h>
 #include <assert.h>
 #include <vector>
+#include <algorithm>
+#include <memory>
+#include <thread>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -21,6 +24,10 @@
 #include <vulkan/vulkan.h>
 #include "VulkanBase.h"
 #include "VulkanTexture.hpp"
+#include "MeshOptimizer.hpp"
+#include "JobSystem.hpp"
+#include "PixelConversion.hpp"
+#include "Frustum.hpp"
 
 #define ENABLE_VALIDATION false
 
@@ -56,26 +63,56 @@ public:
 
 	// The following structures roughly represent the glTF scene structure 
 	// To keep things simple, they only contain those properties that are required for this sample
-	struct Node;
 
 	// A primitive contains the data for a single draw call
 	struct Primitive {
 		uint32_t firstIndex;
 		uint32_t indexCount;
 		int32_t materialIndex;
+		// Bounding sphere in the node's space
+		glm::vec3 center;
+		float radius;
 	};
 
-	// Contains the node's (optional) geometry and can be made up of an arbitrary number of primitives
-	struct Mesh {
-		std::vector<Primitive> primitives;
+	// The scene graph is flattened into arrays indexed by node, stored in topological order (parents before their children)
+	// so the world matrices can be updated in a single pass without recursion or walking up the parent chain
+	struct Nodes {
+		// Index of the parent node, -1 for the top-level nodes
+		std::vector<int32_t> parent;
+		std::vector<glm::mat4> localMatrix;
+		std::vector<glm::mat4> worldMatrix;
+		// Set if the local matrix has changed since the last update of the world matrices
+		std::vector<uint8_t> dirty;
+		// Range of the node's (optional) geometry in the primitives array
+		std::vector<uint32_t> firstPrimitive;
+		std::vector<uint32_t> primitiveCount;
+
+		uint32_t Count() const
+		{
+			return static_cast<uint32_t>(parent.size());
+		}
+	};
+
+	// A single draw of the flattened scene, resolved from the node, primitive and material once after loading
+	struct DrawItem {
+		uint32_t node;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t imageIndex;
+		uint32_t materialIndex;
+		glm::vec3 center;
+		float radius;
 	};
 
-	// A node represents an object in the glTF scene graph
-	struct Node {
-		Node* parent;
-		std::vector<Node> children;
-		Mesh mesh;
-		glm::mat4 matrix;
+	// Per draw data read by the indirect draw shaders, with the same (std430) layout as the shaders' DrawData
+	struct DrawData {
+		glm::mat4 model;
+		// Bounding sphere (xyz = center, w = radius) in the node's space
+		glm::vec4 boundingSphere;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t materialIndex;
+		uint32_t padding;
 	};
 
 	// A glTF material stores information in e.g. the exture that is attached to it and colors
@@ -104,7 +141,16 @@ public:
 	std::vector<Image> images;
 	std::vector<Texture> textures;
 	std::vector<Material> materials;
-	std::vector<Node> nodes;
+	// Encoded image files collected by DeferImageLoad while parsing, indexed like the glTF images
+	std::vector<std::vector<unsigned char>> encodedImages;
+	Nodes nodes;
+	// Primitives of all nodes, grouped by node
+	std::vector<Primitive> primitives;
+	// Draws of all primitives in node order, the same for every command buffer build
+	std::vector<DrawItem> drawList;
+
+	// Vertex cache statistics of all primitives before and after optimization
+	vks::meshopt::Result optimization;
 
 	~VulkanglTFModel()
 	{
@@ -113,11 +159,8 @@ public:
 		vkFreeMemory(vulkanDevice->logicalDevice, vertices.memory, nullptr);
 		vkDestroyBuffer(vulkanDevice->logicalDevice, indices.buffer, nullptr);
 		vkFreeMemory(vulkanDevice->logicalDevice, indices.memory, nullptr);
-		for (Image image : images) {
-			vkDestroyImageView(vulkanDevice->logicalDevice, image.texture.view, nullptr);
-			vkDestroyImage(vulkanDevice->logicalDevice, image.texture.image, nullptr);
-			vkDestroySampler(vulkanDevice->logicalDevice, image.texture.sampler, nullptr);
-			vkFreeMemory(vulkanDevice->logicalDevice, image.texture.deviceMemory, nullptr);
+		for (Image& image : images) {
+			image.texture.Destroy();
 		}
 	}
 
@@ -126,39 +169,105 @@ public:
 		The following functions take a glTF input model loaded via tinyglTF and convert all required data into our own structure
 	*/
 
-	void LoadImages(tinygltf::Model& input)
+	// Image loader callback for tinygltf that only keeps the encoded file, so the images aren't decoded one after another while parsing
+	static bool DeferImageLoad(tinygltf::Image* image, const int imageIndex, std::string* error, std::string* warning, int requiredWidth, int requiredHeight, const unsigned char* bytes, int size, void* userData)
 	{
-		// Images can be stored inside the glTF (which is the case for the sample model), so instead of directly
-		// loading them from disk, we fetch them from the glTF loader and upload the buffers
-		images.resize(input.images.size());
-		for (size_t i = 0; i < input.images.size(); i++) {
-			tinygltf::Image& glTFImage = input.images[i];
-			// Get the image data from the glTF loader
-			unsigned char* buffer = nullptr;
-			VkDeviceSize bufferSize = 0;
-			bool deleteBuffer = false;
-			// We convert RGB-only images to RGBA, as most devices don't support RGB-formats in Vulkan
-			if (glTFImage.component == 3) {
-				bufferSize = glTFImage.width * glTFImage.height * 4;
-				buffer = new unsigned char[bufferSize];
-				unsigned char* rgba = buffer;
-				unsigned char* rgb = &glTFImage.image[0];
-				for (size_t i = 0; i < glTFImage.width * glTFImage.height; ++i) {
-					for (int32_t j = 0; j < 3; ++j) {
-						rgba[j] = rgb[j];
+		std::vector<std::vector<unsigned char>>& encodedImages = *static_cast<std::vector<std::vector<unsigned char>>*>(userData);
+		if (encodedImages.size() <= static_cast<size_t>(imageIndex)) {
+			encodedImages.resize(imageIndex + 1);
+		}
+		encodedImages[imageIndex].assign(bytes, bytes + size);
+		return true;
+	}
+
+	// RGBA pixels of a decoded image, either allocated by stb_image or converted from RGB
+	struct DecodedImage {
+		unsigned char* stbPixels = nullptr;
+		std::vector<unsigned char> convertedPixels;
+		int width = 0;
+		int height = 0;
+		bool valid = false;
+
+		const unsigned char* Pixels() const
+		{
+			return stbPixels ? stbPixels : convertedPixels.data();
+		}
+	};
+
+	void DecodeImage(const tinygltf::Image& glTFImage, size_t index, DecodedImage& decoded)
+	{
+		if ((index < encodedImages.size()) && !encodedImages[index].empty()) {
+			const unsigned char* data = encodedImages[index].data();
+			const int size = static_cast<int>(encodedImages[index].size());
+			int components = 0;
+			if (stbi_info_from_memory(data, size, &decoded.width, &decoded.height, &components)) {
+				// We convert RGB-only images to RGBA, as most devices don't support RGB-formats in Vulkan
+				if (components == 3) {
+					unsigned char* rgb = stbi_load_from_memory(data, size, &decoded.width, &decoded.height, &components, 3);
+					if (rgb) {
+						decoded.convertedPixels.resize(static_cast<size_t>(decoded.width) * decoded.height * 4);
+						vks::pixels::RgbToRgba(rgb, decoded.convertedPixels.data(), static_cast<size_t>(decoded.width) * decoded.height);
+						stbi_image_free(rgb);
+						decoded.valid = true;
+						return;
+					}
+				}
+				else {
+					decoded.stbPixels = stbi_load_from_memory(data, size, &decoded.width, &decoded.height, &components, 4);
+					if (decoded.stbPixels) {
+						decoded.valid = true;
+						return;
 					}
-					rgba += 4;
-					rgb += 3;
 				}
-				deleteBuffer = true;
 			}
-			else {
-				buffer = &glTFImage.image[0];
-				bufferSize = glTFImage.image.size();
+		}
+		else if ((glTFImage.component == 4) && (glTFImage.bits == 8) && !glTFImage.image.empty()) {
+			// Already decoded by tinygltf
+			decoded.convertedPixels = glTFImage.image;
+			decoded.width = glTFImage.width;
+			decoded.height = glTFImage.height;
+			decoded.valid = true;
+			return;
+		}
+		// Keep the descriptor valid for images that can't be decoded
+		decoded.convertedPixels.assign(4, 255);
+		decoded.width = 1;
+		decoded.height = 1;
+	}
+
+	void LoadImages(tinygltf::Model& input, vks::JobSystem& jobSystem)
+	{
+		// Images can be stored inside the glTF (which is the case for the sample model), so instead of directly
+		// loading them from disk, we fetch them from the glTF loader and upload the buffers
+		// The images are decoded on all worker threads, each one is uploaded as soon as it is ready while the others are still being decoded
+		const size_t imageCount = input.images.size();
+		images.resize(imageCount);
+		std::vector<DecodedImage> decodedImages(imageCount);
+		std::unique_ptr<vks::JobCounter[]> counters(new vks::JobCounter[imageCount]);
+		for (size_t i = 0; i < imageCount; i++) {
+			jobSystem.Submit([this, &input, &decodedImages, i] {
+				DecodeImage(input.images[i], i, decodedImages[i]);
+			}, &counters[i]);
+		}
+		for (size_t i = 0; i < imageCount; i++) {
+			jobSystem.Wait(counters[i]);
+			DecodedImage& decoded = decodedImages[i];
+			if (!decoded.valid) {
+				std::cerr << "Could not decode image " << i << " \"" << input.images[i].name << "\"" << std::endl;
 			}
 			// Load texture from image buffer
-			images[i].texture.FromBuffer(buffer, bufferSize, VK_FORMAT_R8G8B8A8_UNORM, glTFImage.width, glTFImage.height, vulkanDevice, copyQueue);
+			const VkDeviceSize bufferSize = static_cast<VkDeviceSize>(decoded.width) * decoded.height * 4;
+			images[i].texture.FromBuffer(const_cast<unsigned char*>(decoded.Pixels()), bufferSize, VK_FORMAT_R8G8B8A8_UNORM, decoded.width, decoded.height, vulkanDevice, copyQueue);
+			// The data has been copied to the staging ring, so the decoded pixels can be released right away
+			if (decoded.stbPixels) {
+				stbi_image_free(decoded.stbPixels);
+			}
+			decoded = DecodedImage();
+			if (i < encodedImages.size()) {
+				std::vector<unsigned char>().swap(encodedImages[i]);
+			}
 		}
+		encodedImages.clear();
 	}
 
 	void LoadTextures(tinygltf::Model& input)
@@ -186,33 +295,41 @@ public:
 		}
 	}
 
-	void LoadNode(const tinygltf::Node& inputNode, const tinygltf::Model& input, VulkanglTFModel::Node* parent, std::vector<uint32_t>& indexBuffer, std::vector<VulkanglTFModel::Vertex>& vertexBuffer)
+	// Append a node to the flattened scene graph, its parent must have been added before
+	uint32_t AddNode(int32_t parent, const glm::mat4& matrix)
 	{
-		VulkanglTFModel::Node node{};
-		node.matrix = glm::mat4(1.0f);
+		const uint32_t index = nodes.Count();
+		nodes.parent.push_back(parent);
+		nodes.localMatrix.push_back(matrix);
+		nodes.worldMatrix.push_back(matrix);
+		nodes.dirty.push_back(1);
+		nodes.firstPrimitive.push_back(static_cast<uint32_t>(primitives.size()));
+		nodes.primitiveCount.push_back(0);
+		return index;
+	}
+
+	void LoadNode(const tinygltf::Node& inputNode, const tinygltf::Model& input, int32_t parent, std::vector<uint32_t>& indexBuffer, std::vector<VulkanglTFModel::Vertex>& vertexBuffer)
+	{
+		glm::mat4 matrix = glm::mat4(1.0f);
 
 		// Get the local node matrix
 		// It's either made up from translation, rotation, scale or a 4x4 matrix
 		if (inputNode.translation.size() == 3) {
-			node.matrix = glm::translate(node.matrix, glm::vec3(glm::make_vec3(inputNode.translation.data())));
+			matrix = glm::translate(matrix, glm::vec3(glm::make_vec3(inputNode.translation.data())));
 		}
 		if (inputNode.rotation.size() == 4) {
 			glm::quat q = glm::make_quat(inputNode.rotation.data());
-			node.matrix *= glm::mat4(q);
+			matrix *= glm::mat4(q);
 		}
 		if (inputNode.scale.size() == 3) {
-			node.matrix = glm::scale(node.matrix, glm::vec3(glm::make_vec3(inputNode.scale.data())));
+			matrix = glm::scale(matrix, glm::vec3(glm::make_vec3(inputNode.scale.data())));
 		}
 		if (inputNode.matrix.size() == 16) {
-			node.matrix = glm::make_mat4x4(inputNode.matrix.data());
+			matrix = glm::make_mat4x4(inputNode.matrix.data());
 		};
 
-		// Load node's children 
-		if (inputNode.children.size() > 0) {
-			for (size_t i = 0; i < inputNode.children.size(); i++) {
-				LoadNode(input.nodes[inputNode.children[i]], input, &node, indexBuffer, vertexBuffer);
-			}
-		}
+		// The node is added before its children, which keeps the nodes in topological order
+		const uint32_t nodeIndex = AddNode(parent, matrix);
 
 		// If the node contains mesh data, we load vertices and indices from the the buffers
 		// In glTF this is done via accessors and buffer views
@@ -301,65 +418,174 @@ public:
 						return;
 					}
 				}
+				// Reorder the primitive's triangles and vertices for the post-transform vertex cache, overdraw and vertex fetch
+				if (indexCount > 0) {
+					vks::meshopt::Result result = vks::meshopt::OptimizeMesh(vertexBuffer.data() + vertexStart, vertexBuffer.size() - vertexStart, sizeof(Vertex), offsetof(Vertex, pos),
+						indexBuffer.data() + firstIndex, indexCount, vertexStart);
+					vertexBuffer.resize(vertexStart + result.verticesAfter);
+					optimization.Add(result);
+				}
 				Primitive primitive{};
 				primitive.firstIndex = firstIndex;
 				primitive.indexCount = indexCount;
 				primitive.materialIndex = glTFPrimitive.material;
-				node.mesh.primitives.push_back(primitive);
+				// Sphere around the center of the primitive's bounding box, used for culling
+				if (vertexBuffer.size() > vertexStart) {
+					glm::vec3 minPos = vertexBuffer[vertexStart].pos;
+					glm::vec3 maxPos = minPos;
+					for (size_t v = vertexStart; v < vertexBuffer.size(); v++) {
+						minPos = glm::min(minPos, vertexBuffer[v].pos);
+						maxPos = glm::max(maxPos, vertexBuffer[v].pos);
+					}
+					primitive.center = (minPos + maxPos) * 0.5f;
+					for (size_t v = vertexStart; v < vertexBuffer.size(); v++) {
+						primitive.radius = (std::max)(primitive.radius, glm::length(vertexBuffer[v].pos - primitive.center));
+					}
+				}
+				primitives.push_back(primitive);
+				nodes.primitiveCount[nodeIndex]++;
 			}
 		}
 
-		if (parent) {
-			parent->children.push_back(node);
-		}
-		else {
-			nodes.push_back(node);
+		// Load node's children 
+		for (size_t i = 0; i < inputNode.children.size(); i++) {
+			LoadNode(input.nodes[inputNode.children[i]], input, static_cast<int32_t>(nodeIndex), indexBuffer, vertexBuffer);
 		}
 	}
 
 	/*
-		glTF rendering functions
+		Scene graph functions
 	*/
 
-	// Draw a single node including child nodes (if present)
-	void DrawNode(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VulkanglTFModel::Node node)
-	{
-		if (node.mesh.primitives.size() > 0) {
-			// Pass the node's matrix via push constanst
-			// Traverse the node hierarchy to the top-most parent to get the final matrix of the current node
-			glm::mat4 nodeMatrix = node.matrix;
-			VulkanglTFModel::Node* currentParent = node.parent;
-			while (currentParent) {
-				nodeMatrix = currentParent->matrix * nodeMatrix;
-				currentParent = currentParent->parent;
+	// Change the local matrix of a node, the world matrices of it and its descendants are updated by the next UpdateWorldMatrices
+	void SetLocalMatrix(uint32_t node, const glm::mat4& matrix)
+	{
+		nodes.localMatrix[node] = matrix;
+		nodes.dirty[node] = 1;
+	}
+
+	// Recompute the world matrices of all nodes whose local matrix or one of whose ancestors' has changed
+	// Returns true if any world matrix has changed
+	bool UpdateWorldMatrices()
+	{
+		bool updated = false;
+		const uint32_t nodeCount = nodes.Count();
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			const int32_t parent = nodes.parent[i];
+			// Parents come first, so their flag is final and can be passed on to the children
+			if ((parent >= 0) && nodes.dirty[parent]) {
+				nodes.dirty[i] = 1;
+			}
+			if (nodes.dirty[i]) {
+				nodes.worldMatrix[i] = (parent >= 0) ? nodes.worldMatrix[parent] * nodes.localMatrix[i] : nodes.localMatrix[i];
+				updated = true;
 			}
-			// Pass the final matrix to the vertex shader using push constants
-			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &nodeMatrix);
-			for (VulkanglTFModel::Primitive& primitive : node.mesh.primitives) {
-				if (primitive.indexCount > 0) {
-					// Get the texture index for this primitive
-					VulkanglTFModel::Texture texture = textures[materials[primitive.materialIndex].baseColorTextureIndex];
-					// Bind the descriptor for the current primitive's texture
-					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &images[texture.imageIndex].descriptorSet, 0, nullptr);
-					vkCmdDrawIndexed(commandBuffer, primitive.indexCount, 1, primitive.firstIndex, 0, 0);
+		}
+		std::fill(nodes.dirty.begin(), nodes.dirty.end(), uint8_t(0));
+		return updated;
+	}
+
+	// Resolve the material and texture of every primitive once, so building the command buffers only walks a flat array
+	void BuildDrawList()
+	{
+		drawList.clear();
+		drawList.reserve(primitives.size());
+		const uint32_t nodeCount = nodes.Count();
+		for (uint32_t i = 0; i < nodeCount; i++) {
+			for (uint32_t p = nodes.firstPrimitive[i]; p < nodes.firstPrimitive[i] + nodes.primitiveCount[i]; p++) {
+				const Primitive& primitive = primitives[p];
+				// This sample has no default material, primitives without one are skipped
+				if ((primitive.indexCount == 0) || (primitive.materialIndex < 0)) {
+					continue;
 				}
+				DrawItem item{};
+				item.node = i;
+				item.firstIndex = primitive.firstIndex;
+				item.indexCount = primitive.indexCount;
+				item.imageIndex = textures[materials[primitive.materialIndex].baseColorTextureIndex].imageIndex;
+				item.materialIndex = static_cast<uint32_t>(primitive.materialIndex);
+				item.center = primitive.center;
+				item.radius = primitive.radius;
+				drawList.push_back(item);
 			}
 		}
-		for (auto& child : node.children) {
-			DrawNode(commandBuffer, pipelineLayout, child);
+	}
+
+	/*
+		glTF rendering functions
+	*/
+
+	// Image index of each material's base color texture, indexed by the material index of the draws
+	// This is the content of the material buffer used with bindless textures
+	std::vector<uint32_t> GetMaterialImages() const
+	{
+		std::vector<uint32_t> materialImages(materials.size(), 0);
+		for (const DrawItem& item : drawList) {
+			materialImages[item.materialIndex] = item.imageIndex;
+		}
+		return materialImages;
+	}
+
+	// Transform, bounds, index range and material of every draw in draw list order
+	// The world matrices are copied, so this has to be uploaded again after they have changed
+	std::vector<DrawData> GetDrawData() const
+	{
+		std::vector<DrawData> drawData(drawList.size());
+		for (size_t i = 0; i < drawList.size(); i++) {
+			const DrawItem& item = drawList[i];
+			drawData[i].model = nodes.worldMatrix[item.node];
+			drawData[i].boundingSphere = glm::vec4(item.center, item.radius);
+			drawData[i].firstIndex = item.firstIndex;
+			drawData[i].indexCount = item.indexCount;
+			drawData[i].materialIndex = item.materialIndex;
 		}
+		return drawData;
 	}
 
-	// Draw the glTF scene starting at the top-level-nodes
-	void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+	// Draw the glTF scene from the draw list
+	// With bindless textures all textures are bound once (as an array in set 1) and the material index is passed as the draw's first instance,
+	// otherwise the descriptor set of the draw's image is bound whenever it changes
+	void Draw(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, bool bindless)
 	{
 		// All vertices and indices are stored in single buffers, so we only need to bind once 
 		VkDeviceSize offsets[1] = { 0 };
 		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
 		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		// Render all nodes at top-level
-		for (auto& node : nodes) {
-			DrawNode(commandBuffer, pipelineLayout, node);
+		// Node matrix and texture only need to be passed when they differ from the previous draw
+		uint32_t currentNode = UINT32_MAX;
+		uint32_t currentImage = UINT32_MAX;
+		for (const DrawItem& item : drawList) {
+			if (item.node != currentNode) {
+				// Pass the node's world matrix to the vertex shader using push constants
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &nodes.worldMatrix[item.node]);
+				currentNode = item.node;
+			}
+			if (bindless) {
+				// The vertex shader passes gl_InstanceIndex on to the fragment shader, which looks up the material's texture with it
+				vkCmdDrawIndexed(commandBuffer, item.indexCount, 1, item.firstIndex, 0, item.materialIndex);
+				continue;
+			}
+			if (item.imageIndex != currentImage) {
+				// Bind the descriptor for the current primitive's texture
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &images[item.imageIndex].descriptorSet, 0, nullptr);
+				currentImage = item.imageIndex;
+			}
+			vkCmdDrawIndexed(commandBuffer, item.indexCount, 1, item.firstIndex, 0, 0);
+		}
+	}
+
+	// Draw the glTF scene with indirect draws, commands contains one VkDrawIndexedIndirectCommand per draw list entry
+	// The draws read their transform and material from the draw data with gl_InstanceIndex (the command's first instance is the draw's index)
+	// If multiDraw is false (the multiDrawIndirect feature isn't supported) each command needs a separate call
+	void DrawIndirect(VkCommandBuffer commandBuffer, VkBuffer commands, bool multiDraw, uint32_t maxDrawCount)
+	{
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		const uint32_t drawCount = static_cast<uint32_t>(drawList.size());
+		const uint32_t batchSize = multiDraw ? (std::max)(maxDrawCount, 1u) : 1u;
+		for (uint32_t first = 0; first < drawCount; first += batchSize) {
+			vkCmdDrawIndexedIndirect(commandBuffer, commands, first * sizeof(VkDrawIndexedIndirectCommand), (std::min)(batchSize, drawCount - first), sizeof(VkDrawIndexedIndirectCommand));
 		}
 	}
 
@@ -394,6 +620,49 @@ public:
 		VkDescriptorSetLayout textures;
 	} descriptorSetLayouts;
 
+	// Bindless textures (VK_EXT_descriptor_indexing)
+	// Set 1 then holds the images of all materials in a single array and a buffer with the image index of each material,
+	// so it's bound once instead of once per texture change
+	struct Bindless {
+		// Set if the device supports the required descriptor indexing features, they are enabled at device creation
+		bool supported = false;
+		// Set if the bindless path is used for rendering, which also requires the bindless shaders
+		bool enabled = false;
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT features{};
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		// Image index of each material's base color texture
+		vks::Buffer materials;
+	} bindless;
+
+	// Indirect draws with GPU culling
+	// A compute pass tests the bounding sphere of every draw against the view frustum and writes its indirect command,
+	// the scene is then drawn with a single vkCmdDrawIndexedIndirect that no longer depends on the number of nodes and primitives
+	// The draws can't switch descriptor sets, so this requires the bindless path
+	struct IndirectDraws {
+		// Set if the device and the shaders support indirect drawing of the scene
+		bool supported = false;
+		// Use indirect draws for rendering (if supported)
+		bool enabled = true;
+		// Per draw data (VulkanglTFModel::DrawData) read by the culling shader and the vertex shader
+		vks::Buffer drawData;
+		// One VkDrawIndexedIndirectCommand per draw, written by the culling shader
+		vks::Buffer commands;
+		// Frustum planes for the culling shader
+		vks::Buffer cullBuffer;
+		struct CullData {
+			glm::vec4 frustumPlanes[6];
+			uint32_t drawCount;
+			uint32_t padding[3];
+		} cullData = {};
+		// Shared by the culling pass (set 0) and the indirect graphics pipelines (set 2)
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+		VkPipeline cullPipeline = VK_NULL_HANDLE;
+		VkPipeline solid = VK_NULL_HANDLE;
+		VkPipeline wireframe = VK_NULL_HANDLE;
+	} indirect;
+
 	VulkanExampleGltfScene() : VulkanBase(ENABLE_VALIDATION)
 	{
 		title = "glTF model rendering";
@@ -403,6 +672,10 @@ public:
 		camera.SetRotation(glm::vec3(0.0f, -135.0f, 0.0f));
 		camera.SetPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
 		settings.overlay = true;
+		// Required to query the descriptor indexing features of the device
+		if (InstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+			enabledInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		}
 	}
 
 	~VulkanExampleGltfScene()
@@ -419,6 +692,49 @@ public:
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayouts.textures, nullptr);
 
 		shaderData.buffer.Destroy();
+		bindless.materials.Destroy();
+
+		if (indirect.supported) {
+			vkDestroyPipeline(device, indirect.solid, nullptr);
+			if (indirect.wireframe != VK_NULL_HANDLE) {
+				vkDestroyPipeline(device, indirect.wireframe, nullptr);
+			}
+			vkDestroyPipeline(device, indirect.cullPipeline, nullptr);
+			vkDestroyPipelineLayout(device, indirect.cullPipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(device, indirect.descriptorSetLayout, nullptr);
+		}
+		indirect.drawData.Destroy();
+		indirect.commands.Destroy();
+		indirect.cullBuffer.Destroy();
+	}
+
+	static bool InstanceExtensionSupported(const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+		for (const VkExtensionProperties& extension : extensions) {
+			if (strcmp(extension.extensionName, name) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// The logical device (and with it vulkanDevice) doesn't exist yet when the features are selected, so the physical device is queried directly
+	bool DeviceExtensionSupported(const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+		for (const VkExtensionProperties& extension : extensions) {
+			if (strcmp(extension.extensionName, name) == 0) {
+				return true;
+			}
+		}
+		return false;
 	}
 
 	virtual void GetEnabledFeatures()
@@ -427,6 +743,34 @@ public:
 		if (deviceFeatures.fillModeNonSolid) {
 			enabledFeatures.fillModeNonSolid = VK_TRUE;
 		};
+		// Indirect draws pass the draw index as first instance, and draw all of them with a single call if multi draw is supported
+		if (deviceFeatures.drawIndirectFirstInstance) {
+			enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+		}
+		if (deviceFeatures.multiDrawIndirect) {
+			enabledFeatures.multiDrawIndirect = VK_TRUE;
+		}
+
+		// Bindless textures index a runtime sized array of samplers with the (per draw) material index
+		// If the device doesn't support this, the textures are bound with one descriptor set per image instead
+		PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+		if (getPhysicalDeviceFeatures2 && DeviceExtensionSupported(VK_KHR_MAINTENANCE3_EXTENSION_NAME) && DeviceExtensionSupported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+			VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+			descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+			VkPhysicalDeviceFeatures2KHR deviceFeatures2{};
+			deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+			deviceFeatures2.pNext = &descriptorIndexingFeatures;
+			getPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+			bindless.supported = descriptorIndexingFeatures.runtimeDescriptorArray && descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing;
+		}
+		if (bindless.supported) {
+			enabledDeviceExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+			enabledDeviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+			bindless.features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+			bindless.features.runtimeDescriptorArray = VK_TRUE;
+			bindless.features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+			deviceCreatepNextChain = &bindless.features;
+		}
 	}
 
 	void BuildCommandBuffers()
@@ -454,19 +798,59 @@ public:
 		{
 			renderPassBeginInfo.framebuffer = frameBuffers[i];
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+			const bool indirectDraws = indirect.supported && indirect.enabled;
+			if (indirectDraws) {
+				RecordCulling(drawCmdBuffers[i]);
+			}
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
 			// Bind scene matrices descriptor to set 0
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, wireframe ? pipelines.wireframe : pipelines.solid);
-			glTFModel.Draw(drawCmdBuffers[i], pipelineLayout);
+			if (indirectDraws) {
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, wireframe ? indirect.wireframe : indirect.solid);
+				// Textures and per draw data for all draws
+				const std::array<VkDescriptorSet, 2> descriptorSets = { bindless.descriptorSet, indirect.descriptorSet };
+				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+				glTFModel.DrawIndirect(drawCmdBuffers[i], indirect.commands.buffer, vulkanDevice->enabledFeatures.multiDrawIndirect == VK_TRUE, vulkanDevice->properties.limits.maxDrawIndirectCount);
+			}
+			else {
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, wireframe ? pipelines.wireframe : pipelines.solid);
+				if (bindless.enabled) {
+					// All textures of the scene are bound once
+					vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &bindless.descriptorSet, 0, nullptr);
+				}
+				glTFModel.Draw(drawCmdBuffers[i], pipelineLayout, bindless.enabled);
+			}
 			DrawUI(drawCmdBuffers[i]);
 			vkCmdEndRenderPass(drawCmdBuffers[i]);
 			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
 		}
 	}
 
+	// Record the culling pass that writes the indirect draw commands, must be outside of the render pass
+	void RecordCulling(VkCommandBuffer commandBuffer)
+	{
+		// The previous frame's draws must have consumed the commands before they are rewritten
+		VkBufferMemoryBarrier bufferBarrier = vks::initializers::BufferMemoryBarrier();
+		bufferBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = indirect.commands.buffer;
+		bufferBarrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+		// One invocation per draw
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, indirect.cullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, indirect.cullPipelineLayout, 0, 1, &indirect.descriptorSet, 0, nullptr);
+		vkCmdDispatch(commandBuffer, (indirect.cullData.drawCount + 63) / 64, 1, 1);
+
+		bufferBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+	}
+
 	void LoadglTFFile(std::string filename)
 	{
 		tinygltf::Model glTFInput;
@@ -480,6 +864,9 @@ public:
 		// We let tinygltf handle this, by passing the asset manager of our app
 		tinygltf::asset_manager = androidApp->activity->assetManager;
 #endif
+		// Images are only collected while parsing and decoded in parallel afterwards
+		glTFModel.encodedImages.clear();
+		gltfContext.SetImageLoader(VulkanglTFModel::DeferImageLoad, &glTFModel.encodedImages);
 		bool fileLoaded = gltfContext.LoadASCIIFromFile(&glTFInput, &error, &warning, filename);
 
 		// Pass some Vulkan resources required for setup and rendering to the glTF model loading class
@@ -490,14 +877,25 @@ public:
 		std::vector<VulkanglTFModel::Vertex> vertexBuffer;
 
 		if (fileLoaded) {
-			glTFModel.loadImages(glTFInput);
-			glTFModel.loadMaterials(glTFInput);
-			glTFModel.loadTextures(glTFInput);
+			// Collect all uploads of the scene into a few large transfer submissions instead of one submission per image
+			vulkanDevice->uploader.BeginBatch();
+			{
+				vks::JobSystem jobSystem;
+				jobSystem.SetThreadCount((std::max)(std::thread::hardware_concurrency(), 1u) - 1, static_cast<uint32_t>(glTFInput.images.size()) + 1);
+				glTFModel.LoadImages(glTFInput, jobSystem);
+			}
+			glTFModel.LoadMaterials(glTFInput);
+			glTFModel.LoadTextures(glTFInput);
 			const tinygltf::Scene& scene = glTFInput.scenes[0];
 			for (size_t i = 0; i < scene.nodes.size(); i++) {
 				const tinygltf::Node node = glTFInput.nodes[scene.nodes[i]];
-				glTFModel.loadNode(node, glTFInput, nullptr, indexBuffer, vertexBuffer);
+				glTFModel.LoadNode(node, glTFInput, -1, indexBuffer, vertexBuffer);
 			}
+			glTFModel.UpdateWorldMatrices();
+			glTFModel.BuildDrawList();
+			vks::MeshCache::Get().stats.optimization.Add(glTFModel.optimization);
+			if (vks::MeshCache::Get().verbose)
+				std::cout << "Optimized " << filename << ": " << glTFModel.optimization.ToString() << std::endl;
 		}
 		else {
 			vks::tools::exitFatal("Could not open the glTF file.\n\nThe file is part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
@@ -512,28 +910,6 @@ public:
 		size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
 		glTFModel.indices.count = static_cast<uint32_t>(indexBuffer.size());
 
-		struct StagingBuffer {
-			VkBuffer buffer;
-			VkDeviceMemory memory;
-		} vertexStaging, indexStaging;
-
-		// Create host visible staging buffers (source)
-		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			vertexBufferSize,
-			&vertexStaging.buffer,
-			&vertexStaging.memory,
-			vertexBuffer.data()));
-		// Index data
-		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			indexBufferSize,
-			&indexStaging.buffer,
-			&indexStaging.memory,
-			indexBuffer.data()));
-
 		// Create device local buffers (targat)
 		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
 			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
@@ -548,33 +924,12 @@ public:
 			&glTFModel.indices.buffer,
 			&glTFModel.indices.memory));
 
-		// Copy data from staging buffers (host) do device local buffer (gpu)
-		VkCommandBuffer copyCmd = vulkanDevice->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-		VkBufferCopy copyRegion = {};
-
-		copyRegion.size = vertexBufferSize;
-		vkCmdCopyBuffer(
-			copyCmd,
-			vertexStaging.buffer,
-			glTFModel.vertices.buffer,
-			1,
-			&copyRegion);
-
-		copyRegion.size = indexBufferSize;
-		vkCmdCopyBuffer(
-			copyCmd,
-			indexStaging.buffer,
-			glTFModel.indices.buffer,
-			1,
-			&copyRegion);
+		// Copy data to the device local buffers (gpu) through the uploader's staging ring
+		vulkanDevice->uploader.UploadBuffer(glTFModel.vertices.buffer, vertexBuffer.data(), vertexBufferSize);
+		vulkanDevice->uploader.UploadBuffer(glTFModel.indices.buffer, indexBuffer.data(), indexBufferSize);
 
-		vulkanDevice->FlushCommandBuffer(copyCmd, queue, true);
-
-		// Free staging resources
-		vkDestroyBuffer(device, vertexStaging.buffer, nullptr);
-		vkFreeMemory(device, vertexStaging.memory, nullptr);
-		vkDestroyBuffer(device, indexStaging.buffer, nullptr);
-		vkFreeMemory(device, indexStaging.memory, nullptr);
+		// Submit the remaining uploads and wait for all of them to finish
+		vulkanDevice->uploader.EndBatch();
 	}
 
 	void LoadAssets()
@@ -582,19 +937,80 @@ public:
 		LoadglTFFile(GetAssetPath() + "models/FlightHelmet/glTF/FlightHelmet.gltf");
 	}
 
+	// Select how the textures are bound and how the scene is drawn, based on the device's features and the available shaders
+	void SelectRenderPaths()
+	{
+		const std::string shadersPath = GetAssetPath() + "shaders/gltfscene/";
+		// The SPIR-V is generated by the project's custom build step (or generate-spirv.bat)
+		const bool bindlessShaders = vks::tools::FileExists(shadersPath + "mesh_bindless.vert.spv") && vks::tools::FileExists(shadersPath + "mesh_bindless.frag.spv");
+		if (bindless.supported && !bindlessShaders) {
+			std::cerr << "Bindless textures disabled, mesh_bindless.vert and mesh_bindless.frag have not been compiled to SPIR-V" << std::endl;
+		}
+		bindless.enabled = bindless.supported && !glTFModel.images.empty() && bindlessShaders;
+		const bool indirectShaders = vks::tools::FileExists(shadersPath + "mesh_indirect.vert.spv") && vks::tools::FileExists(shadersPath + "drawcull.comp.spv");
+		if (vulkanDevice->enabledFeatures.drawIndirectFirstInstance && !indirectShaders) {
+			std::cerr << "Indirect draws disabled, mesh_indirect.vert and drawcull.comp have not been compiled to SPIR-V" << std::endl;
+		}
+		indirect.supported = bindless.enabled && vulkanDevice->enabledFeatures.drawIndirectFirstInstance && !glTFModel.drawList.empty() && indirectShaders;
+		std::cout << "Material textures: " << (bindless.enabled ? "bindless" : "one descriptor set per image") << std::endl;
+		std::cout << "Indirect draws: " << (indirect.supported ? (vulkanDevice->enabledFeatures.multiDrawIndirect ? "multi draw" : "one call per draw") : "not supported") << std::endl;
+	}
+
+	// Create the per draw data and the indirect command buffer
+	void PrepareIndirectBuffers()
+	{
+		if (!indirect.supported) {
+			return;
+		}
+		const std::vector<VulkanglTFModel::DrawData> drawData = glTFModel.GetDrawData();
+		const VkDeviceSize drawDataSize = drawData.size() * sizeof(VulkanglTFModel::DrawData);
+		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&indirect.drawData,
+			drawDataSize));
+		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&indirect.commands,
+			drawData.size() * sizeof(VkDrawIndexedIndirectCommand)));
+		vulkanDevice->uploader.UploadBuffer(indirect.drawData.buffer, drawData.data(), drawDataSize);
+		vulkanDevice->uploader.Submit();
+
+		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&indirect.cullBuffer,
+			sizeof(indirect.cullData)));
+		VK_CHECK_RESULT(indirect.cullBuffer.Map());
+		indirect.cullData.drawCount = static_cast<uint32_t>(drawData.size());
+	}
+
 	void SetupDescriptors()
 	{
 		/*
 			This sample uses separate descriptor sets (and layouts) for the matrices and materials (textures)
 		*/
 
+		const uint32_t imageCount = static_cast<uint32_t>(glTFModel.images.size());
+
 		std::vector<VkDescriptorPoolSize> poolSizes = {
 			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
 			// One combined image sampler per model image/texture
-			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(glTFModel.images.size())),
+			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageCount),
 		};
-		// One set for matrices and one per model image/texture
-		const uint32_t maxSetCount = static_cast<uint32_t>(glTFModel.images.size()) + 1;
+		// One set for matrices and one per model image/texture (or one for all of them)
+		uint32_t maxSetCount = imageCount + 1;
+		if (bindless.enabled) {
+			poolSizes.push_back(vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1));
+			maxSetCount = 2;
+		}
+		if (indirect.supported) {
+			// Culling parameters, draw data and indirect commands
+			poolSizes.push_back(vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1));
+			poolSizes.push_back(vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2));
+			maxSetCount++;
+		}
 		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::DescriptorPoolCreateInfo(poolSizes, maxSetCount);
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
 
@@ -603,10 +1019,38 @@ public:
 		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI = vks::initializers::DescriptorSetLayoutCreateInfo(&setLayoutBinding, 1);
 		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayouts.matrices));
 		// Descriptor set layout for passing material textures
-		setLayoutBinding = vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
-		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayouts.textures));
-		// Pipeline layout using both descriptor sets (set 0 = matrices, set 1 = material)
-		std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayouts.matrices, descriptorSetLayouts.textures };
+		if (bindless.enabled) {
+			// Binding 0 : Image index of each material
+			// Binding 1 : All images, declared as a runtime sized array in the fragment shader
+			const std::array<VkDescriptorSetLayoutBinding, 2> bindings = {
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT, 0),
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1, imageCount),
+			};
+			VkDescriptorSetLayoutCreateInfo bindlessLayoutCI = vks::initializers::DescriptorSetLayoutCreateInfo(bindings.data(), static_cast<uint32_t>(bindings.size()));
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &bindlessLayoutCI, nullptr, &descriptorSetLayouts.textures));
+		}
+		else {
+			setLayoutBinding = vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0);
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayouts.textures));
+		}
+		// Descriptor set layout for the indirect draws
+		if (indirect.supported) {
+			// Binding 0 : Culling parameters
+			// Binding 1 : Draw data
+			// Binding 2 : Indirect commands
+			const std::array<VkDescriptorSetLayoutBinding, 3> bindings = {
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 1),
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+			};
+			VkDescriptorSetLayoutCreateInfo indirectLayoutCI = vks::initializers::DescriptorSetLayoutCreateInfo(bindings.data(), static_cast<uint32_t>(bindings.size()));
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &indirectLayoutCI, nullptr, &indirect.descriptorSetLayout));
+		}
+		// Pipeline layout using all descriptor sets (set 0 = matrices, set 1 = material, set 2 = draw data of the indirect draws)
+		std::vector<VkDescriptorSetLayout> setLayouts = { descriptorSetLayouts.matrices, descriptorSetLayouts.textures };
+		if (indirect.supported) {
+			setLayouts.push_back(indirect.descriptorSetLayout);
+		}
 		VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::PipelineLayoutCreateInfo(setLayouts.data(), static_cast<uint32_t>(setLayouts.size()));
 		// We will use push constants to push the local matrices of a primitive to the vertex shader
 		VkPushConstantRange pushConstantRange = vks::initializers::PushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(glm::mat4), 0);
@@ -620,6 +1064,39 @@ public:
 		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
 		VkWriteDescriptorSet writeDescriptorSet = vks::initializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &shaderData.buffer.descriptor);
 		vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+		// Descriptor set for the culling pass and the indirect draws
+		if (indirect.supported) {
+			allocInfo = vks::initializers::DescriptorSetAllocateInfo(descriptorPool, &indirect.descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &indirect.descriptorSet));
+			std::array<VkWriteDescriptorSet, 3> writeDescriptorSets = {
+				vks::initializers::WriteDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &indirect.cullBuffer.descriptor),
+				vks::initializers::WriteDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &indirect.drawData.descriptor),
+				vks::initializers::WriteDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &indirect.commands.descriptor),
+			};
+			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+		}
+		if (bindless.enabled) {
+			// Single descriptor set for all materials
+			const std::vector<uint32_t> materialImages = glTFModel.GetMaterialImages();
+			VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&bindless.materials,
+				(std::max)(materialImages.size(), size_t(1)) * sizeof(uint32_t),
+				materialImages.empty() ? nullptr : const_cast<uint32_t*>(materialImages.data())));
+			allocInfo = vks::initializers::DescriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.textures, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &bindless.descriptorSet));
+			std::vector<VkDescriptorImageInfo> imageDescriptors(imageCount);
+			for (uint32_t i = 0; i < imageCount; i++) {
+				imageDescriptors[i] = glTFModel.images[i].texture.descriptor;
+			}
+			std::array<VkWriteDescriptorSet, 2> writeDescriptorSets = {
+				vks::initializers::WriteDescriptorSet(bindless.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &bindless.materials.descriptor),
+				vks::initializers::WriteDescriptorSet(bindless.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, imageDescriptors.data(), imageCount),
+			};
+			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+			return;
+		}
 		// Descriptor sets for materials
 		for (auto& image : glTFModel.images) {
 			const VkDescriptorSetAllocateInfo allocInfo = vks::initializers::DescriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.textures, 1);
@@ -656,9 +1133,10 @@ public:
 		vertexInputStateCI.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
 		vertexInputStateCI.pVertexAttributeDescriptions = vertexInputAttributes.data();
 
+		const std::string shaderName = bindless.enabled ? "mesh_bindless" : "mesh";
 		const std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {
-			LoadShader(GetAssetPath() + "shaders/gltfscene/mesh.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
-			LoadShader(GetAssetPath() + "shaders/gltfscene/mesh.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+			LoadShader(GetAssetPath() + "shaders/gltfscene/" + shaderName + ".vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+			LoadShader(GetAssetPath() + "shaders/gltfscene/" + shaderName + ".frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
 		};
 
 		VkGraphicsPipelineCreateInfo pipelineCI = vks::initializers::PipelineCreateInfo(pipelineLayout, renderPass, 0);
@@ -682,6 +1160,28 @@ public:
 			rasterizationStateCI.lineWidth = 1.0f;
 			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.wireframe));
 		}
+
+		if (indirect.supported) {
+			// Indirect draw pipelines, the vertex shader fetches the transform from the draw data instead of the push constant
+			const std::array<VkPipelineShaderStageCreateInfo, 2> indirectShaderStages = {
+				LoadShader(GetAssetPath() + "shaders/gltfscene/mesh_indirect.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+				LoadShader(GetAssetPath() + "shaders/gltfscene/mesh_bindless.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+			};
+			pipelineCI.pStages = indirectShaderStages.data();
+			rasterizationStateCI.polygonMode = VK_POLYGON_MODE_FILL;
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &indirect.solid));
+			if (deviceFeatures.fillModeNonSolid) {
+				rasterizationStateCI.polygonMode = VK_POLYGON_MODE_LINE;
+				VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &indirect.wireframe));
+			}
+
+			// Culling pipeline
+			VkPipelineLayoutCreateInfo cullPipelineLayoutCI = vks::initializers::PipelineLayoutCreateInfo(&indirect.descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkCreatePipelineLayout(device, &cullPipelineLayoutCI, nullptr, &indirect.cullPipelineLayout));
+			VkComputePipelineCreateInfo computePipelineCI = vks::initializers::ComputePipelineCreateInfo(indirect.cullPipelineLayout, 0);
+			computePipelineCI.stage = LoadShader(GetAssetPath() + "shaders/gltfscene/drawcull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+			VK_CHECK_RESULT(vkCreateComputePipelines(device, pipelineCache, 1, &computePipelineCI, nullptr, &indirect.cullPipeline));
+		}
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -705,12 +1205,24 @@ public:
 		shaderData.values.projection = camera.matrices.perspective;
 		shaderData.values.model = camera.matrices.view;
 		memcpy(shaderData.buffer.mapped, &shaderData.values, sizeof(shaderData.values));
+
+		if (indirect.supported) {
+			// The draws' bounding spheres are transformed to world space by the culling shader
+			vks::Frustum frustum;
+			frustum.Update(camera.matrices.perspective * camera.matrices.view);
+			for (uint32_t i = 0; i < 6; i++) {
+				indirect.cullData.frustumPlanes[i] = frustum.planes[i];
+			}
+			memcpy(indirect.cullBuffer.mapped, &indirect.cullData, sizeof(indirect.cullData));
+		}
 	}
 
 	void Prepare()
 	{
 		__super::Prepare();
 		LoadAssets();
+		SelectRenderPaths();
+		PrepareIndirectBuffers();
 		PrepareUniformBuffers();
 		SetupDescriptors();
 		PreparePipelines();
@@ -732,6 +1244,12 @@ public:
 			if (overlay->CheckBox("Wireframe", &wireframe)) {
 				BuildCommandBuffers();
 			}
+			overlay->Text("Textures: %s", bindless.enabled ? "bindless" : "set per image");
+			if (indirect.supported) {
+				if (overlay->CheckBox("Indirect draws (GPU culling)", &indirect.enabled)) {
+					BuildCommandBuffers();
+				}
+			}
 		}
 	}
 };
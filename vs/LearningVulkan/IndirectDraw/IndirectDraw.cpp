@@ -5,6 +5,7 @@
 #include <time.h>
 #include <vector>
 #include <random>
+#include <chrono>
 #include <corecrt_math_defines.h>
 
 #define GLM_FORCE_RADIANS
@@ -17,6 +18,7 @@
 #include "VulkanBuffer.hpp"
 #include "VulkanTexture.hpp"
 #include "VulkanModel.hpp"
+#include "BVH.hpp"
 
 #define VERTEX_BUFFER_BIND_ID 0
 #define INSTANCE_BUFFER_BIND_ID 1
@@ -32,6 +34,8 @@
 // Circular range of plant distribution
 #define PLANT_RADIUS 25.0f
 #endif
+// Scale the plant models are loaded with
+#define PLANT_SCALE 0.0025f
 
 class VulkanExampleIndirectDraw : public VulkanBase
 {
@@ -42,11 +46,12 @@ public:
 	} textures;
 
 	// Vertex layout for the models
+	// Quantized components halve the vertex fetch bandwidth (24 instead of 44 bytes per vertex), the vertex input stage converts them back to floats
 	vks::VertexLayout vertexLayout = vks::VertexLayout({
-		vks::VERTEX_COMPONENT_POSITION,
-		vks::VERTEX_COMPONENT_NORMAL,
-		vks::VERTEX_COMPONENT_UV,
-		vks::VERTEX_COMPONENT_COLOR,
+		vks::VERTEX_COMPONENT_POSITION_HALF,
+		vks::VERTEX_COMPONENT_NORMAL_SNORM16,
+		vks::VERTEX_COMPONENT_UV_HALF,
+		vks::VERTEX_COMPONENT_COLOR_UNORM8,
 		});
 
 	struct {
@@ -71,18 +76,25 @@ public:
 
 	// Contains the instanced data
 	vks::Buffer instanceBuffer;
-	// Contains the indirect drawing commands
-	vks::Buffer indirectCommandsBuffer;
-	uint32_t indirectDrawCount;
+	uint32_t indirectDrawCount = 0;
 
 	struct {
 		glm::mat4 projection;
 		glm::mat4 view;
 	} uboVS;
 
-	struct {
-		vks::Buffer scene;
-	} uniformData;
+	// Buffers written by the host every frame, one set per frame in flight so the current frame never waits for the GPU
+	struct FrameData {
+		// Contains the indirect drawing commands
+		vks::Buffer indirectCommands;
+		vks::Buffer uniformBuffer;
+		VkDescriptorSet descriptorSet;
+		// Generation of the indirect commands stored in the buffer
+		uint32_t commandsGeneration = 0;
+	};
+	std::vector<FrameData> frames;
+	// Incremented whenever culling changes the indirect commands
+	uint32_t commandsGeneration = 1;
 
 	struct {
 		VkPipeline plants;
@@ -91,7 +103,6 @@ public:
 	} pipelines;
 
 	VkPipelineLayout pipelineLayout;
-	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
 
 	VkSampler samplerRepeat;
@@ -101,6 +112,16 @@ public:
 	// Store the indirect draw commands containing index offsets and instance count per object
 	std::vector<VkDrawIndexedIndirectCommand> indirectCommands;
 
+	// Instances are culled on the CPU using one bounding volume hierarchy per plant type
+	// Each visible instance range becomes a separate indirect draw command
+	bool frustumCulling = true;
+	vks::Frustum frustum;
+	std::vector<vks::BVH> instanceHierarchies;
+	std::vector<vks::BVH::Range> visibleRanges;
+	std::vector<VkDrawIndexedIndirectCommand> culledCommands;
+	uint32_t visibleObjectCount = 0;
+	double cullTime = 0.0;
+
 	VulkanExampleIndirectDraw() : VulkanBase(ENABLE_VALIDATION)
 	{
 		title = "Indirect rendering";
@@ -110,6 +131,7 @@ public:
 		camera.SetTranslation(glm::vec3(0.4f, 1.25f, 0.0f));
 		camera.movementSpeed = 5.0f;
 		settings.overlay = true;
+		settings.multipleFramesInFlight = true;
 	}
 
 	~VulkanExampleIndirectDraw()
@@ -125,8 +147,11 @@ public:
 		textures.plants.Destroy();
 		textures.ground.Destroy();
 		instanceBuffer.Destroy();
-		indirectCommandsBuffer.Destroy();
-		uniformData.scene.Destroy();
+		for (auto& frame : frames)
+		{
+			frame.indirectCommands.Destroy();
+			frame.uniformBuffer.Destroy();
+		}
 	}
 
 	// Enable physical device features required for this example
@@ -152,7 +177,13 @@ public:
 		}
 	};
 
+	// The command buffer of the acquired image is recorded every frame in Draw, as it reads the buffers of the current frame in flight
 	void BuildCommandBuffers()
+	{
+	}
+
+	// Records the command buffer of swap chain image i with the buffers of a frame in flight
+	void BuildCommandBuffer(uint32_t i, const FrameData& frame)
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::CommandBufferBeginInfo();
 
@@ -167,71 +198,68 @@ public:
 		renderPassBeginInfo.clearValueCount = 2;
 		renderPassBeginInfo.pClearValues = clearValues;
 
-		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
-		{
-			// Set target frame buffer
-			renderPassBeginInfo.framebuffer = frameBuffers[i];
+		// Set target frame buffer
+		renderPassBeginInfo.framebuffer = frameBuffers[i];
 
-			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+		VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
-			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
-			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
+		vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 
-			VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
-			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
+		vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
 
-			VkDeviceSize offsets[1] = { 0 };
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frame.descriptorSet, 0, NULL);
 
-			// Plants
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.plants);
-			// Binding point 0 : Mesh vertex buffer
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.plants.vertices.buffer, offsets);
-			// Binding point 1 : Instance data buffer
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], INSTANCE_BUFFER_BIND_ID, 1, &instanceBuffer.buffer, offsets);
+		// Plants
+		vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.plants);
+		// Binding point 0 : Mesh vertex buffer
+		vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.plants.vertices.buffer, offsets);
+		// Binding point 1 : Instance data buffer
+		vkCmdBindVertexBuffers(drawCmdBuffers[i], INSTANCE_BUFFER_BIND_ID, 1, &instanceBuffer.buffer, offsets);
 
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.plants.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdBindIndexBuffer(drawCmdBuffers[i], models.plants.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 
-			// If the multi draw feature is supported:
-			// One draw call for an arbitrary number of ojects
-			// Index offsets and instance count are taken from the indirect buffer
-			if (vulkanDevice->features.multiDrawIndirect)
-			{
-				vkCmdDrawIndexedIndirect(drawCmdBuffers[i], indirectCommandsBuffer.buffer, 0, indirectDrawCount, sizeof(VkDrawIndexedIndirectCommand));
-			}
-			else
+		// If the multi draw feature is supported:
+		// One draw call for an arbitrary number of ojects
+		// Index offsets and instance count are taken from the indirect buffer
+		if (vulkanDevice->features.multiDrawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(drawCmdBuffers[i], frame.indirectCommands.buffer, 0, indirectDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else
+		{
+			// If multi draw is not available, we must issue separate draw commands
+			for (uint32_t j = 0; j < indirectDrawCount; j++)
 			{
-				// If multi draw is not available, we must issue separate draw commands
-				for (auto j = 0; j < indirectCommands.size(); j++)
-				{
-					vkCmdDrawIndexedIndirect(drawCmdBuffers[i], indirectCommandsBuffer.buffer, j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
-				}
+				vkCmdDrawIndexedIndirect(drawCmdBuffers[i], frame.indirectCommands.buffer, j * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
 			}
+		}
 
-			// Ground
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.ground);
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.ground.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.ground.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(drawCmdBuffers[i], models.ground.indexCount, 1, 0, 0, 0);
-			// Skysphere
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.skysphere);
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.skysphere.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.skysphere.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(drawCmdBuffers[i], models.skysphere.indexCount, 1, 0, 0, 0);
+		// Ground
+		vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.ground);
+		vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.ground.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(drawCmdBuffers[i], models.ground.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(drawCmdBuffers[i], models.ground.indexCount, 1, 0, 0, 0);
+		// Skysphere
+		vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.skysphere);
+		vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.skysphere.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(drawCmdBuffers[i], models.skysphere.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(drawCmdBuffers[i], models.skysphere.indexCount, 1, 0, 0, 0);
 
-			DrawUI(drawCmdBuffers[i]);
+		DrawUI(drawCmdBuffers[i]);
 
-			vkCmdEndRenderPass(drawCmdBuffers[i]);
+		vkCmdEndRenderPass(drawCmdBuffers[i]);
 
-			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
-		}
+		VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
 	}
 
 	void LoadAssets()
 	{
-		models.plants.LoadFromFile(GetAssetPath() + "models/plants.dae", vertexLayout, 0.0025f, vulkanDevice, queue);
+		models.plants.LoadFromFile(GetAssetPath() + "models/plants.dae", vertexLayout, PLANT_SCALE, vulkanDevice, queue);
 		models.ground.LoadFromFile(GetAssetPath() + "models/plane_circle.dae", vertexLayout, PLANT_RADIUS + 1.0f, vulkanDevice, queue);
 		models.skysphere.LoadFromFile(GetAssetPath() + "models/skysphere.dae", vertexLayout, 512.0f / 10.0f, vulkanDevice, queue);
 
@@ -283,41 +311,9 @@ public:
 
 		// Attribute descriptions
 		// Describes memory layout and shader positions
-		vertices.attributeDescriptions.clear();
-
 		// Per-Vertex attributes
-		// Location 0 : Position
-		vertices.attributeDescriptions.push_back(
-			vks::initializers::VertexInputAttributeDescription(
-				VERTEX_BUFFER_BIND_ID,
-				0,
-				VK_FORMAT_R32G32B32_SFLOAT,
-				0)
-		);
-		// Location 1 : Normal
-		vertices.attributeDescriptions.push_back(
-			vks::initializers::VertexInputAttributeDescription(
-				VERTEX_BUFFER_BIND_ID,
-				1,
-				VK_FORMAT_R32G32B32_SFLOAT,
-				sizeof(float) * 3)
-		);
-		// Location 2 : Texture coordinates
-		vertices.attributeDescriptions.push_back(
-			vks::initializers::VertexInputAttributeDescription(
-				VERTEX_BUFFER_BIND_ID,
-				2,
-				VK_FORMAT_R32G32_SFLOAT,
-				sizeof(float) * 6)
-		);
-		// Location 3 : Color
-		vertices.attributeDescriptions.push_back(
-			vks::initializers::VertexInputAttributeDescription(
-				VERTEX_BUFFER_BIND_ID,
-				3,
-				VK_FORMAT_R32G32B32_SFLOAT,
-				sizeof(float) * 8)
-		);
+		// Location 0 : Position, Location 1 : Normal, Location 2 : Texture coordinates, Location 3 : Color
+		vertices.attributeDescriptions = vertexLayout.InputAttributes(VERTEX_BUFFER_BIND_ID);
 
 		// Instanced attributes
 		// Location 4: Position
@@ -350,18 +346,19 @@ public:
 
 	void SetupDescriptorPool()
 	{
-		// Example uses one ubo
+		// Example uses one ubo and descriptor set per frame in flight
+		const uint32_t frameCount = static_cast<uint32_t>(frames.size());
 		std::vector<VkDescriptorPoolSize> poolSizes =
 		{
-			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
-			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2),
+			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount),
+			vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * frameCount),
 		};
 
 		VkDescriptorPoolCreateInfo descriptorPoolInfo =
 			vks::initializers::DescriptorPoolCreateInfo(
 				static_cast<uint32_t>(poolSizes.size()),
 				poolSizes.data(),
-				2);
+				frameCount);
 
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
 	}
@@ -402,7 +399,7 @@ public:
 		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pPipelineLayoutCreateInfo, nullptr, &pipelineLayout));
 	}
 
-	void SetupDescriptorSet()
+	void SetupDescriptorSets()
 	{
 		VkDescriptorSetAllocateInfo allocInfo =
 			vks::initializers::DescriptorSetAllocateInfo(
@@ -410,31 +407,34 @@ public:
 				&descriptorSetLayout,
 				1);
 
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet));
-
-		std::vector<VkWriteDescriptorSet> writeDescriptorSets =
+		for (auto& frame : frames)
 		{
-			// Binding 0: Vertex shader uniform buffer
-			vks::initializers::WriteDescriptorSet(
-			descriptorSet,
-				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-				0,
-				&uniformData.scene.descriptor),
-			// Binding 1: Plants texture array combined
-			vks::initializers::WriteDescriptorSet(
-				descriptorSet,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				1,
-				&textures.plants.descriptor),
-			// Binding 2: Ground texture combined
-			vks::initializers::WriteDescriptorSet(
-				descriptorSet,
-				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-				2,
-				&textures.ground.descriptor)
-		};
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet));
 
-		vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets =
+			{
+				// Binding 0: Vertex shader uniform buffer
+				vks::initializers::WriteDescriptorSet(
+					frame.descriptorSet,
+					VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+					0,
+					&frame.uniformBuffer.descriptor),
+				// Binding 1: Plants texture array combined
+				vks::initializers::WriteDescriptorSet(
+					frame.descriptorSet,
+					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					1,
+					&textures.plants.descriptor),
+				// Binding 2: Ground texture combined
+				vks::initializers::WriteDescriptorSet(
+					frame.descriptorSet,
+					VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					2,
+					&textures.ground.descriptor)
+			};
+
+			vkUpdateDescriptorSets(device, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, NULL);
+		}
 	}
 
 	void PreparePipelines()
@@ -523,51 +523,90 @@ public:
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.skysphere));
 	}
 
-	// Prepare (and stage) a buffer containing the indirect draw commands
+	// Prepare a buffer for the indirect draw commands of each frame in flight
+	// The commands are rewritten by the host whenever the view changes, so the buffers are host visible
 	void PrepareIndirectData()
 	{
-		indirectCommands.clear();
+		objectCount = static_cast<uint32_t>(models.plants.parts.size()) * OBJECT_INSTANCE_COUNT;
 
-		// Create on indirect command for each mesh in the scene
-		uint32_t m = 0;
-		for (auto& modelPart : models.plants.parts)
+		frames.resize(settings.framesInFlight);
+		for (auto& frame : frames)
 		{
-			VkDrawIndexedIndirectCommand indirectCmd{};
-			indirectCmd.instanceCount = OBJECT_INSTANCE_COUNT;
-			indirectCmd.firstInstance = m * OBJECT_INSTANCE_COUNT;
-			indirectCmd.firstIndex = modelPart.indexBase;
-			indirectCmd.indexCount = modelPart.indexCount;
-
-			indirectCommands.push_back(indirectCmd);
+			// Worst case is one draw per instance (every other instance visible)
+			VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+				VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&frame.indirectCommands,
+				objectCount * sizeof(VkDrawIndexedIndirectCommand)));
+
+			VK_CHECK_RESULT(frame.indirectCommands.Map());
+		}
+	}
 
-			m++;
+	// Returns the world space bounding box of a plant instance as transformed by the vertex shader
+	vks::AABB GetInstanceBounds(const InstanceData& instance)
+	{
+		// Model space bounds as stored in the vertex buffer (the model loader scales and flips y)
+		const vks::Model::Dimension& dim = models.plants.dim;
+		glm::vec3 min = glm::vec3(dim.min.x, -dim.max.y, dim.min.z) * PLANT_SCALE * instance.scale + instance.pos;
+		glm::vec3 max = glm::vec3(dim.max.x, -dim.min.y, dim.max.z) * PLANT_SCALE * instance.scale + instance.pos;
+
+		// The shader applies the rotation around the y axis after the translation
+		float s = sin(instance.rot.y);
+		float c = cos(instance.rot.y);
+		vks::AABB bounds;
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+			bounds.Grow(glm::vec3(c * corner.x + s * corner.z, corner.y, -s * corner.x + c * corner.z));
 		}
+		return bounds;
+	}
+
+	// Cull the instances against the current view and build one indirect command per visible instance range
+	// The commands are copied to the buffer of each frame in flight the next time that frame is drawn
+	void UpdateIndirectCommands()
+	{
+		auto tStart = std::chrono::high_resolution_clock::now();
 
-		indirectDrawCount = static_cast<uint32_t>(indirectCommands.size());
+		frustum.Update(camera.matrices.perspective * camera.matrices.view);
 
-		objectCount = 0;
-		for (auto indirectCmd : indirectCommands)
+		culledCommands.clear();
+		visibleObjectCount = 0;
+		for (uint32_t m = 0; m < models.plants.parts.size(); m++)
 		{
-			objectCount += indirectCmd.instanceCount;
-		}
+			VkDrawIndexedIndirectCommand indirectCmd{};
+			indirectCmd.firstIndex = models.plants.parts[m].indexBase;
+			indirectCmd.indexCount = models.plants.parts[m].indexCount;
 
-		vks::Buffer stagingBuffer;
-		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&stagingBuffer,
-			indirectCommands.size() * sizeof(VkDrawIndexedIndirectCommand),
-			indirectCommands.data()));
+			if (!frustumCulling)
+			{
+				visibleRanges.assign(1, { 0, OBJECT_INSTANCE_COUNT });
+				visibleObjectCount += OBJECT_INSTANCE_COUNT;
+			}
+			else
+			{
+				visibleObjectCount += instanceHierarchies[m].Cull(frustum, visibleRanges);
+			}
 
-		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&indirectCommandsBuffer,
-			stagingBuffer.size));
+			for (auto& range : visibleRanges)
+			{
+				indirectCmd.firstInstance = m * OBJECT_INSTANCE_COUNT + range.first;
+				indirectCmd.instanceCount = range.count;
+				culledCommands.push_back(indirectCmd);
+			}
+		}
 
-		vulkanDevice->CopyBuffer(&stagingBuffer, &indirectCommandsBuffer, queue);
+		cullTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
 
-		stagingBuffer.Destroy();
+		bool commandsChanged = (culledCommands.size() != indirectCommands.size()) ||
+			(memcmp(culledCommands.data(), indirectCommands.data(), culledCommands.size() * sizeof(VkDrawIndexedIndirectCommand)) != 0);
+		if (commandsChanged)
+		{
+			std::swap(indirectCommands, culledCommands);
+			indirectDrawCount = static_cast<uint32_t>(indirectCommands.size());
+			commandsGeneration++;
+		}
 	}
 
 	// Prepare (and stage) a buffer containing instanced data for the mesh draws
@@ -588,6 +627,24 @@ public:
 			instanceData[i].texIndex = i / OBJECT_INSTANCE_COUNT;
 		}
 
+		// Build a hierarchy for the instances of each plant type and store the instances in hierarchy order,
+		// so that visible subtrees map to contiguous instance ranges
+		instanceHierarchies.resize(models.plants.parts.size());
+		std::vector<vks::AABB> instanceBounds(OBJECT_INSTANCE_COUNT);
+		std::vector<InstanceData> partInstances(OBJECT_INSTANCE_COUNT);
+		for (uint32_t m = 0; m < instanceHierarchies.size(); m++)
+		{
+			InstanceData* instances = &instanceData[m * OBJECT_INSTANCE_COUNT];
+			for (uint32_t i = 0; i < OBJECT_INSTANCE_COUNT; i++)
+				instanceBounds[i] = GetInstanceBounds(instances[i]);
+			instanceHierarchies[m].Build(instanceBounds);
+
+			const std::vector<uint32_t>& order = instanceHierarchies[m].GetInstanceOrder();
+			for (uint32_t i = 0; i < OBJECT_INSTANCE_COUNT; i++)
+				partInstances[i] = instances[order[i]];
+			std::copy(partInstances.begin(), partInstances.end(), instances);
+		}
+
 		vks::Buffer stagingBuffer;
 		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
 			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -609,32 +666,43 @@ public:
 
 	void PrepareUniformBuffers()
 	{
-		VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&uniformData.scene,
-			sizeof(uboVS)));
+		for (auto& frame : frames)
+		{
+			VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&frame.uniformBuffer,
+				sizeof(uboVS)));
 
-		VK_CHECK_RESULT(uniformData.scene.Map());
+			VK_CHECK_RESULT(frame.uniformBuffer.Map());
+		}
 
-		UpdateUniformBuffer(true);
+		UpdateUniformBuffer();
 	}
 
-	void UpdateUniformBuffer(bool viewChanged)
+	// The matrices are copied to the current frame's uniform buffer in Draw
+	void UpdateUniformBuffer()
 	{
-		if (viewChanged)
-		{
-			uboVS.projection = camera.matrices.perspective;
-			uboVS.view = camera.matrices.view;
-		}
-
-		memcpy(uniformData.scene.mapped, &uboVS, sizeof(uboVS));
+		uboVS.projection = camera.matrices.perspective;
+		uboVS.view = camera.matrices.view;
 	}
 
 	void Draw()
 	{
+		// Waits for the fence of the frame in flight, so its buffers can be written without stalling on the other frames
 		__super::PrepareFrame();
 
+		// The number of frames in flight may be lowered at runtime (benchmark), which only uses the first frames' buffers
+		FrameData& frame = frames[currentFrame % frames.size()];
+		memcpy(frame.uniformBuffer.mapped, &uboVS, sizeof(uboVS));
+		if (frame.commandsGeneration != commandsGeneration)
+		{
+			if (!indirectCommands.empty())
+				memcpy(frame.indirectCommands.mapped, indirectCommands.data(), indirectCommands.size() * sizeof(VkDrawIndexedIndirectCommand));
+			frame.commandsGeneration = commandsGeneration;
+		}
+		BuildCommandBuffer(currentBuffer, frame);
+
 		// Command buffer to be submitted to the queue
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
@@ -653,11 +721,11 @@ public:
 		PrepareInstanceData();
 		SetupVertexDescriptions();
 		PrepareUniformBuffers();
+		UpdateIndirectCommands();
 		SetupDescriptorSetLayout();
 		PreparePipelines();
 		SetupDescriptorPool();
-		SetupDescriptorSet();
-		BuildCommandBuffers();
+		SetupDescriptorSets();
 		prepared = true;
 	}
 
@@ -672,7 +740,8 @@ public:
 
 	virtual void ViewChanged()
 	{
-		UpdateUniformBuffer(true);
+		UpdateUniformBuffer();
+		UpdateIndirectCommands();
 	}
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
@@ -682,8 +751,16 @@ public:
 				overlay->Text("multiDrawIndirect not supported");
 			}
 		}
+		if (overlay->Header("Settings")) {
+			if (overlay->CheckBox("Frustum culling (BVH)", &frustumCulling)) {
+				UpdateIndirectCommands();
+			}
+		}
 		if (overlay->Header("Statistics")) {
 			overlay->Text("Objects: %d", objectCount);
+			overlay->Text("Visible: %d", visibleObjectCount);
+			overlay->Text("Draws: %d", indirectDrawCount);
+			overlay->Text("Cull: %.3f ms", cullTime);
 		}
 	}
 };
@@ -36,11 +36,12 @@ public:
 	} textures;
 
 	// Vertex layout for the models
+	// Quantized components halve the vertex fetch bandwidth (24 instead of 44 bytes per vertex), the vertex input stage converts them back to floats
 	vks::VertexLayout vertexLayout = vks::VertexLayout({
-		vks::VERTEX_COMPONENT_POSITION,
-		vks::VERTEX_COMPONENT_NORMAL,
-		vks::VERTEX_COMPONENT_UV,
-		vks::VERTEX_COMPONENT_COLOR,
+		vks::VERTEX_COMPONENT_POSITION_HALF,
+		vks::VERTEX_COMPONENT_NORMAL_SNORM16,
+		vks::VERTEX_COMPONENT_UV_HALF,
+		vks::VERTEX_COMPONENT_COLOR_UNORM8,
 		});
 
 	struct {
@@ -389,20 +390,17 @@ public:
 		//	layout (location = 0) in vec3 inPos;		Per-Vertex
 		//	...
 		//	layout (location = 4) in vec3 instancePos;	Per-Instance
-		attributeDescriptions = {
-			// Per-vertex attributees
-			// These are advanced for each vertex fetched by the vertex shader
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 0: Position
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),	// Location 1: Normal
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 2, VK_FORMAT_R32G32_SFLOAT, sizeof(float) * 6),		// Location 2: Texture coordinates
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 3, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 8),	// Location 3: Color
+		// Per-vertex attributes (locations 0 - 3: position, normal, texture coordinates, color)
+		// These are advanced for each vertex fetched by the vertex shader
+		attributeDescriptions = vertexLayout.InputAttributes(VERTEX_BUFFER_BIND_ID);
+		attributeDescriptions.insert(attributeDescriptions.end(), {
 			// Per-Instance attributes
 			// These are fetched for each instance rendered
 			vks::initializers::VertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 4, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 4: Position
 			vks::initializers::VertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 5, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),	// Location 5: Rotation
 			vks::initializers::VertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 6, VK_FORMAT_R32_SFLOAT,sizeof(float) * 6),			// Location 6: Scale
 			vks::initializers::VertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 7, VK_FORMAT_R32_SINT, sizeof(float) * 7),			// Location 7: Texture array layer index
-		};
+		});
 		inputState.pVertexBindingDescriptions = bindingDescriptions.data();
 		inputState.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -5,6 +5,8 @@
 #include <vector>
 #include <thread>
 #include <random>
+#include <chrono>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -13,9 +15,14 @@
 
 #include <vulkan/vulkan.h>
 #include "VulkanBase.h"
+#include "VulkanBuffer.hpp"
+#include "VulkanCommandBufferAllocator.hpp"
 
 #include "ThreadPool.hpp"
+#include "JobSystem.hpp"
+#include "JobSystemBenchmark.hpp"
 #include "Frustum.hpp"
+#include "FrustumBenchmark.hpp"
 
 #include "VulkanModel.hpp"
 
@@ -26,6 +33,12 @@ class VulkanExampleMultiThreading : public VulkanBase
 {
 public:
 	bool displaySkybox = true;
+	// Distribute objects over the work stealing job system instead of statically partitioning them over the thread pool
+	bool useJobSystem = true;
+	// Record the secondary command buffers once and reuse them, the per frame matrices are read from a storage buffer instead of push constants
+	bool cacheCommandBuffers = true;
+	// False if the shaders of the cached path haven't been compiled to SPIR-V, only the recording path is used then
+	bool cachedShadersAvailable = false;
 
 	// Vertex layout for the models
 	vks::VertexLayout vertexLayout = vks::VertexLayout({
@@ -52,12 +65,17 @@ public:
 	{
 		VkPipeline phong;
 		VkPipeline starSphere;
+		// Variants reading the matrices from the object storage buffer
+		VkPipeline phongCached = VK_NULL_HANDLE;
+		VkPipeline starSphereCached = VK_NULL_HANDLE;
 	} pipelines;
 
 	VkPipelineLayout pipelineLayout;
+	VkDescriptorSetLayout descriptorSetLayout;
+	// Primary command buffer of the current frame
 	VkCommandBuffer primaryCommandBuffer;
 
-	// Secondary scene command buffers used to store backdrop and user interface
+	// Secondary scene command buffers of the current frame used to store backdrop and user interface
 	struct SecondaryCommandBuffers 
 	{
 		VkCommandBuffer background;
@@ -90,32 +108,106 @@ public:
 		float deltaT;
 		float stateT;
 		bool visible = true;
+		// Index of the frustum plane that rejected the object last, tested first in the next frame
+		uint32_t cullPlane = 0;
+		// Secondary command buffer the object has been recorded to in the current frame
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 	};
 
 	struct ThreadData
 	{
+		// Command pool of the cached command buffers, which are kept across frames and re-recorded individually
 		VkCommandPool commandPool;
-		// One command buffer per render object
-		std::vector<VkCommandBuffer> commandBuffer;
-		// One push constant block per render object
-		std::vector<ThreadPushConstantBlock> pushConstantBlock;
-		// Per object information (position, rotation, etc.)
-		std::vector<ObjectData> objectData;
+		// Objects of this thread whose cached command buffers are re-recorded in the current frame
+		std::vector<uint32_t> staleObjects;
 	};
 
+	// Per object data read by the cached command buffers, std430 layout of phong_cached.vert
+	struct ObjectShaderData
+	{
+		glm::mat4 mvp;
+		glm::vec4 color;
+	};
+
+	// Resources of the cached command buffer path, one set per frame in flight
+	struct CachedFrame
+	{
+		// Matrices and colors of all objects followed by the sky sphere's matrix, updated every frame (host coherent)
+		vks::Buffer objectBuffer;
+		VkDescriptorSet descriptorSet;
+		VkCommandBuffer background;
+		VkCommandBuffer ui;
+		// One secondary command buffer per object, allocated from the command pool of the thread the object is statically assigned to
+		std::vector<VkCommandBuffer> objects;
+		// Generation the command buffers have been recorded at, they're stale if it differs from the current one
+		std::vector<uint32_t> objectGenerations;
+		uint32_t backgroundGeneration = 0;
+		uint32_t uiGeneration = 0;
+	};
+	std::vector<CachedFrame> cachedFrames;
+	// Incremented to invalidate the cached command buffers, e.g. if the viewport or a pipeline changes (0 is never current)
+	uint32_t commandBufferGeneration = 1;
+	// Incremented whenever the UI overlay needs to be recorded again
+	uint32_t uiGeneration = 1;
+	// Number of cached command buffers re-recorded in the last frame
+	uint32_t rerecordedCount = 0;
+
 	std::vector<ThreadData> threadData;
 
+	// Command buffers that are recorded every frame, with one command pool per thread and frame in flight that is reset as a whole.
+	// The slots of the job system and the thread pool use the thread's index, the last slot is used by the main thread for the primary command buffer
+	vks::CommandBufferAllocator commandBufferAllocator;
+
+	// One push constant block per render object
+	std::vector<ThreadPushConstantBlock> pushConstantBlock;
+	// Per object information (position, rotation, etc.)
+	std::vector<ObjectData> objectData;
+	uint32_t numObjects;
+
 	vks::ThreadPool threadPool;
+	vks::JobSystem jobSystem;
+
+	// CPU times (in ms) of the last frames
+	struct TimeHistory
+	{
+		std::array<double, 256> times{};
+		uint32_t count = 0;
 
-	// Fence to wait for all command buffers to finish before presenting to the  swap chain
-	VkFence renderFence = {};
+		void Add(double time)
+		{
+			times[count++ % times.size()] = time;
+		}
+	};
+	// Recording the per object secondary command buffers every frame (cached command buffers not included)
+	TimeHistory recordTimes;
+	// All of UpdateCommandBuffers (culling, animation, recording), with re-recorded [0] and cached [1] command buffers
+	std::array<TimeHistory, 2> updateTimes;
 
 	// Max. dimension of the ufo mesh for use as the sphere radius for frustum culling
 	float objectSphereDim;
+	// Bounds of the ufo mesh in vertex space for the oriented bounding box test
+	struct
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	} objectBox;
 
 	// View frustum for culling invisible objects
 	vks::Frustum frustum;
 
+	// Object bounding spheres as structure of arrays for batch culling
+	struct
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+		std::vector<float> radius;
+	} cullSpheres;
+	std::vector<uint32_t> visibleObjects;
+	uint32_t visibleObjectCount = 0;
+	// CPU time spent on frustum culling (in ms) for the last frame
+	double cullTime = 0.0;
+
 	std::default_random_engine rndEngine;
 
 	VulkanExampleMultiThreading() : VulkanBase(ENABLE_VALIDATION)
@@ -127,6 +219,8 @@ public:
 		camera.SetRotationSpeed(0.5f);
 		camera.SetPerspective(60.0f, (float)width / (float)height, 0.1f, 256.0f);
 		settings.overlay = true;
+		// Object buffers and re-recorded command buffers are kept per frame in flight
+		settings.multipleFramesInFlight = true;
 		// Get number of max. concurrrent threads
 		numThreads = std::thread::hardware_concurrency();
 		assert(numThreads > 0);
@@ -136,7 +230,11 @@ public:
 		std::cout << "numThreads = " << numThreads << std::endl;
 #endif
 		threadPool.SetThreadCount(numThreads);
-		numObjectsPerThread = 512 / numThreads;
+		// The calling thread takes part in the work, so only numThreads - 1 additional workers are spawned
+		jobSystem.SetThreadCount(numThreads - 1);
+		// Benchmarks use enough objects to make the CPU cost of recording the command buffers stand out
+		numObjectsPerThread = (benchmark.active ? 16384 : 512) / numThreads;
+		numObjects = numObjectsPerThread * numThreads;
 		rndEngine.seed(benchmark.active ? 0 : (unsigned)time(nullptr));
 	}
 
@@ -146,19 +244,52 @@ public:
 		// Note : Inherited destructor cleans up resources stored in base class
 		vkDestroyPipeline(device, pipelines.phong, nullptr);
 		vkDestroyPipeline(device, pipelines.starSphere, nullptr);
+		vkDestroyPipeline(device, pipelines.phongCached, nullptr);
+		vkDestroyPipeline(device, pipelines.starSphereCached, nullptr);
 
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+
+		// The cached command buffers are freed with the command pools
+		for (auto& frame : cachedFrames)
+			frame.objectBuffer.Destroy();
 
 		models.ufo.Destroy();
 		models.skySphere.Destroy();
 
 		for (auto& thread : threadData)
 		{
-			vkFreeCommandBuffers(device, thread.commandPool, thread.commandBuffer.size(), thread.commandBuffer.data());
 			vkDestroyCommandPool(device, thread.commandPool, nullptr);
 		}
+		commandBufferAllocator.Destroy();
 
-		vkDestroyFence(device, renderFence, nullptr);
+		if (benchmark.active)
+		{
+			double tAvg, tTail;
+			GetTimes(recordTimes, tAvg, tTail);
+			std::cout << "record : " << (useJobSystem ? "job system" : "thread pool") << " avg " << tAvg << " ms, p99 " << tTail << " ms" << std::endl;
+			std::cout << "update : " << numObjects << " objects" << std::endl;
+			GetTimes(updateTimes[0], tAvg, tTail);
+			std::cout << "  re-recorded every frame avg " << tAvg << " ms, p99 " << tTail << " ms" << std::endl;
+			GetTimes(updateTimes[1], tAvg, tTail);
+			std::cout << "  cached avg " << tAvg << " ms, p99 " << tTail << " ms" << std::endl;
+			std::cout << "command buffers: " << commandBufferAllocator.AllocationCount() << " allocations, " << commandBufferAllocator.poolResets << " pool resets" << std::endl;
+		}
+	}
+
+	// Average and 99th percentile of the measured times
+	void GetTimes(const TimeHistory& history, double& avg, double& tail)
+	{
+		uint32_t count = std::min(history.count, static_cast<uint32_t>(history.times.size()));
+		if (count == 0)
+		{
+			avg = tail = 0.0;
+			return;
+		}
+		std::vector<double> times(history.times.begin(), history.times.begin() + count);
+		std::sort(times.begin(), times.end());
+		avg = std::accumulate(times.begin(), times.end(), 0.0) / count;
+		tail = times[std::min(count - 1, (count * 99) / 100)];
 	}
 
 	float Rnd(float range)
@@ -170,24 +301,14 @@ public:
 	// Create all threads and initialize shader push constants
 	void PrepareMultiThreadedRenderer()
 	{
-		// Since this demo updates the command buffers on each frame
-		// we don't use the per-framebuffer command buffers from the base class,
-		// and create a single primary command buffer instead
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::CommandBufferAllocateInfo(cmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &primaryCommandBuffer));
-
-		// Create additional secondary CBs for background and ui
-		cmdBufAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &secondaryCommandBuffers.background));
-		VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &secondaryCommandBuffers.ui));
-
-		threadData.resize(numThreads);
+		// Slots of the job system and the thread pool each record into their own command pool
+		threadData.resize(std::max(numThreads, jobSystem.ThreadCount()));
 
-		float maxX = std::floor(std::sqrt(numThreads * numObjectsPerThread));
-		uint32_t posX = 0;
-		uint32_t posZ = 0;
+		// Since this demo updates the command buffers on each frame we don't use the per-framebuffer command buffers from the base class,
+		// the primary and secondary command buffers of a frame are taken from the allocator instead
+		commandBufferAllocator.Create(device, swapChain.queueNodeIndex, static_cast<uint32_t>(threadData.size()) + 1, settings.framesInFlight);
 
-		for (uint32_t i = 0; i < numThreads; i++)
+		for (uint32_t i = 0; i < threadData.size(); i++)
 		{
 			ThreadData* thread = &threadData[i];
 
@@ -196,60 +317,80 @@ public:
 			cmdPoolInfo.queueFamilyIndex = swapChain.queueNodeIndex;
 			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 			VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &thread->commandPool));
+		}
 
-			// One secondary command buffer per object that is updated by this thread
-			thread->commandBuffer.resize(numObjectsPerThread);
-			// Generate secondary command buffer for each thread
-			VkCommandBufferAllocateInfo secondaryCmdBufAllocateInfo = vks::initializers::CommandBufferAllocateInfo(thread->commandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, thread->commandBuffer.size());
-			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &secondaryCmdBufAllocateInfo, thread->commandBuffer.data()));
+		pushConstantBlock.resize(numObjects);
+		objectData.resize(numObjects);
+		cullSpheres.x.resize(numObjects);
+		cullSpheres.y.resize(numObjects);
+		cullSpheres.z.resize(numObjects);
+		cullSpheres.radius.assign(numObjects, objectSphereDim * 0.5f);
+		visibleObjects.resize(numObjects);
 
-			thread->pushConstantBlock.resize(numObjectsPerThread);
-			thread->objectData.resize(numObjectsPerThread);
+		for (uint32_t i = 0; i < numObjects; i++)
+		{
+			float theta = 2.0f * float(M_PI) * Rnd(1.0f);
+			float phi = acos(1.0f - 2.0f * Rnd(1.0f));
+			objectData[i].pos = glm::vec3(sin(phi) * cos(theta), 0.0f, cos(phi)) * 35.0f;
+			objectData[i].rotation = glm::vec3(0.0f, Rnd(360.0f), 0.0f);
+			objectData[i].rotationDir = (Rnd(100.0f) < 50.0f) ? 1.0f : -1.0f;
+			objectData[i].rotationSpeed = (2.0f + Rnd(4.0f)) * objectData[i].rotationDir;
+			objectData[i].scale = 0.75f + Rnd(0.5f);
 
-			for (uint32_t j = 0; j < numObjectsPerThread; j++)
-			{
-				float theta = 2.0f * float(M_PI) * Rnd(1.0f);
-				float phi = acos(1.0f - 2.0f * Rnd(1.0f));
-				thread->objectData[j].pos = glm::vec3(sin(phi) * cos(theta), 0.0f, cos(phi)) * 35.0f;
-				thread->objectData[j].rotation = glm::vec3(0.0f, Rnd(360.0f), 0.0f);
-				thread->objectData[j].rotationDir = (Rnd(100.0f) < 50.0f) ? 1.0f : -1.0f;
-				thread->objectData[j].rotationSpeed = (2.0f + Rnd(4.0f)) * thread->objectData[j].rotationDir;
-				thread->objectData[j].scale = 0.75f + Rnd(0.5f);
-
-				thread->pushConstantBlock[j].color = glm::vec3(Rnd(1.0f), Rnd(1.0f), Rnd(1.0f));
-			}
+			pushConstantBlock[i].color = glm::vec3(Rnd(1.0f), Rnd(1.0f), Rnd(1.0f));
+
+			UpdateModelMatrix(&objectData[i]);
 		}
 	}
 
-	// Builds the secondary command buffer for each thread
-	void ThreadRenderCode(uint32_t threadIndex, uint32_t cmdBufferIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	void UpdateModelMatrix(ObjectData* objectData)
 	{
-		ThreadData* thread = &threadData[threadIndex];
-		ObjectData* objectData = &thread->objectData[cmdBufferIndex];
-
-		// Check visibility against view frustum
-		objectData->visible = frustum.CheckSphere(objectData->pos, objectSphereDim * 0.5f);
+		objectData->model = glm::translate(glm::mat4(1.0f), objectData->pos);
+		objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
+		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+		objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
+	}
 
-		if (!objectData->visible)
-			return;
+	// Checks all objects against the view frustum in one SIMD batch and collects the visible ones
+	void CullObjects()
+	{
+		auto tStart = std::chrono::high_resolution_clock::now();
 
-		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::CommandBufferBeginInfo();
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+		for (uint32_t i = 0; i < numObjects; i++)
+		{
+			cullSpheres.x[i] = objectData[i].pos.x;
+			cullSpheres.y[i] = objectData[i].pos.y;
+			cullSpheres.z[i] = objectData[i].pos.z;
+		}
 
-		VkCommandBuffer cmdBuffer = thread->commandBuffer[cmdBufferIndex];
+		vks::Frustum::SphereBatch batch = { cullSpheres.x.data(), cullSpheres.y.data(), cullSpheres.z.data(), cullSpheres.radius.data(), numObjects };
+		visibleObjectCount = frustum.CullSpheres(batch, nullptr, visibleObjects.data());
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
+		// Refine the sphere test with the object's oriented bounding box, the model matrix is the one from the
+		// object's last visible frame which is still current as objects are only animated while visible
+		uint32_t boxVisibleCount = 0;
+		for (uint32_t i = 0; i < visibleObjectCount; i++)
+		{
+			ObjectData& object = objectData[visibleObjects[i]];
+			if (frustum.CheckOrientedBox(object.model, objectBox.min, objectBox.max, object.cullPlane))
+				visibleObjects[boxVisibleCount++] = visibleObjects[i];
+		}
+		visibleObjectCount = boxVisibleCount;
 
-		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
-		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+		for (auto& object : objectData)
+			object.visible = false;
+		for (uint32_t i = 0; i < visibleObjectCount; i++)
+			objectData[visibleObjects[i]].visible = true;
 
-		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
-		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+		cullTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+	}
 
-		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
+	// Advances the animation of an object and updates its matrices
+	void UpdateObject(uint32_t objectIndex)
+	{
+		ObjectData* objectData = &this->objectData[objectIndex];
 
-		// Update
 		if (!paused)
 		{
 			objectData->rotation.y += 2.5f * objectData->rotationSpeed * frameTimer;
@@ -261,17 +402,42 @@ public:
 			objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
 		}
 
-		objectData->model = glm::translate(glm::mat4(1.0f), objectData->pos);
-		objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
-		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-		objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
+		UpdateModelMatrix(objectData);
+
+		pushConstantBlock[objectIndex].mvp = matrices.projection * matrices.view * objectData->model;
+	}
+
+	// Builds the secondary command buffer for one object on the given thread
+	void ThreadRenderCode(uint32_t threadIndex, uint32_t objectIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	{
+		ObjectData* objectData = &this->objectData[objectIndex];
+
+		// Visibility has been determined by CullObjects
+		if (!objectData->visible)
+			return;
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::CommandBufferBeginInfo();
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		VkCommandBuffer cmdBuffer = commandBufferAllocator.Acquire(threadIndex, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		objectData->commandBuffer = cmdBuffer;
 
-		thread->pushConstantBlock[cmdBufferIndex].mvp = matrices.projection * matrices.view * objectData->model;
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
+
+		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
+		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
+
+		UpdateObject(objectIndex);
 
 		// Update shader push constant block
 		// Contains model view  matirx
-		vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ThreadPushConstantBlock), &thread->pushConstantBlock[cmdBufferIndex]);
+		vkCmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ThreadPushConstantBlock), &pushConstantBlock[objectIndex]);
 
 		VkDeviceSize offsets[1] = { 0 };
 		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
@@ -285,12 +451,16 @@ public:
 	{
 		// Secondary command buffer for the sky sphere
 		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::CommandBufferBeginInfo();
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
 
 		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
 		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
 
+		const uint32_t mainThreadSlot = commandBufferAllocator.ThreadCount() - 1;
+		secondaryCommandBuffers.background = commandBufferAllocator.Acquire(mainThreadSlot, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+		secondaryCommandBuffers.ui = commandBufferAllocator.Acquire(mainThreadSlot, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
 		/*
 			Backrground
 		*/
@@ -332,15 +502,146 @@ public:
 		VK_CHECK_RESULT(vkEndCommandBuffer(secondaryCommandBuffers.ui));
 	}
 
+	// Records the cached command buffer of an object, it only references the object's slot in the object buffer and stays valid until the pipeline or viewport changes
+	void RecordCachedObject(CachedFrame& frame, uint32_t objectIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	{
+		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::CommandBufferBeginInfo();
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		VkCommandBuffer cmdBuffer = frame.objects[objectIndex];
+
+		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
+
+		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
+		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phongCached);
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		// The object index selects the object's data in the storage buffer
+		vkCmdDrawIndexed(cmdBuffer, models.ufo.indexCount, 1, 0, 0, objectIndex);
+
+		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+	}
+
+	// Animates the visible objects, writes their matrices to the current frame's object buffer and
+	// only re-records the cached command buffers that are stale, instead of recording all of them every frame
+	void UpdateCachedCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo, std::vector<VkCommandBuffer>& commandBuffers)
+	{
+		CachedFrame& frame = cachedFrames[currentFrame % cachedFrames.size()];
+		// Cached command buffers are executed with any of the swap chain's framebuffers
+		inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+
+		ObjectShaderData* shaderData = static_cast<ObjectShaderData*>(frame.objectBuffer.mapped);
+
+		// All jobs of the previous frame have finished, so their arena slots can be reused
+		jobSystem.ResetJobArena();
+		auto updateObject = [&](uint32_t i) {
+			uint32_t objectIndex = visibleObjects[i];
+			UpdateObject(objectIndex);
+			shaderData[objectIndex].mvp = pushConstantBlock[objectIndex].mvp;
+			shaderData[objectIndex].color = glm::vec4(pushConstantBlock[objectIndex].color, 1.0f);
+		};
+		vks::JobCounter counter;
+		jobSystem.ParallelFor(visibleObjectCount, 64, updateObject, counter);
+
+		glm::mat4 skyMvp = matrices.projection * matrices.view;
+		skyMvp[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		shaderData[numObjects].mvp = skyMvp;
+
+		rerecordedCount = 0;
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::CommandBufferBeginInfo();
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
+		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
+
+		if (frame.backgroundGeneration != commandBufferGeneration)
+		{
+			VK_CHECK_RESULT(vkBeginCommandBuffer(frame.background, &commandBufferBeginInfo));
+			vkCmdSetViewport(frame.background, 0, 1, &viewport);
+			vkCmdSetScissor(frame.background, 0, 1, &scissor);
+			vkCmdBindPipeline(frame.background, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.starSphereCached);
+			vkCmdBindDescriptorSets(frame.background, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+			VkDeviceSize offsets[1] = { 0 };
+			vkCmdBindVertexBuffers(frame.background, 0, 1, &models.skySphere.vertices.buffer, offsets);
+			vkCmdBindIndexBuffer(frame.background, models.skySphere.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexed(frame.background, models.skySphere.indexCount, 1, 0, 0, numObjects);
+			VK_CHECK_RESULT(vkEndCommandBuffer(frame.background));
+			frame.backgroundGeneration = commandBufferGeneration;
+			rerecordedCount++;
+		}
+
+		if (frame.uiGeneration != uiGeneration)
+		{
+			VK_CHECK_RESULT(vkBeginCommandBuffer(frame.ui, &commandBufferBeginInfo));
+			vkCmdSetViewport(frame.ui, 0, 1, &viewport);
+			vkCmdSetScissor(frame.ui, 0, 1, &scissor);
+			if (settings.overlay)
+				DrawUI(frame.ui);
+			VK_CHECK_RESULT(vkEndCommandBuffer(frame.ui));
+			frame.uiGeneration = uiGeneration;
+			rerecordedCount++;
+		}
+
+		// Stale command buffers of visible objects are recorded by the thread owning their command pool, objects that have never been visible are recorded on demand
+		for (auto& thread : threadData)
+			thread.staleObjects.clear();
+		for (uint32_t i = 0; i < visibleObjectCount; i++)
+		{
+			uint32_t objectIndex = visibleObjects[i];
+			if (frame.objectGenerations[objectIndex] != commandBufferGeneration)
+			{
+				threadData[objectIndex / numObjectsPerThread].staleObjects.push_back(objectIndex);
+				frame.objectGenerations[objectIndex] = commandBufferGeneration;
+				rerecordedCount++;
+			}
+		}
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			if (threadData[t].staleObjects.empty())
+				continue;
+			threadPool.threads[t]->AddJob([=, &frame] {
+				for (uint32_t objectIndex : threadData[t].staleObjects)
+					RecordCachedObject(frame, objectIndex, inheritanceInfo);
+			});
+		}
+		threadPool.Wait();
+		jobSystem.Wait(counter);
+
+		if (displaySkybox)
+			commandBuffers.emplace_back(frame.background);
+		for (uint32_t i = 0; i < visibleObjectCount; i++)
+			commandBuffers.emplace_back(frame.objects[visibleObjects[i]]);
+		if (UIOverlay.visible)
+			commandBuffers.emplace_back(frame.ui);
+	}
+
 	// Updates the secondary command buffers using a thread pool
 	// and puts them into the primary command buffer that's
 	// lat submitted to the queue for rendering
 	void UpdateCommandBuffers(VkFramebuffer frameBuffer)
 	{
+		auto tUpdateStart = std::chrono::high_resolution_clock::now();
+
 		// Contains the list of secondary command buffers to be submitted
 		std::vector<VkCommandBuffer> commandBuffers;
 
+		// The frame's fence has been waited for in PrepareFrame, so all command buffers last recorded for this frame can be reset at once
+		commandBufferAllocator.BeginFrame(currentFrame);
+		primaryCommandBuffer = commandBufferAllocator.Acquire(commandBufferAllocator.ThreadCount() - 1, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::CommandBufferBeginInfo();
+		cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		VkClearValue clearValues[2];
 		clearValues[0].color = defaultClearColor;
@@ -370,56 +671,99 @@ public:
 		// Secondary command buffer also use the currently active framebuffer
 		inheritanceInfo.framebuffer = frameBuffer;
 
+		CullObjects();
+
+		if (cacheCommandBuffers)
+		{
+			UpdateCachedCommandBuffers(inheritanceInfo, commandBuffers);
+		}
+		else
+		{
+			RecordCommandBuffers(inheritanceInfo, commandBuffers);
+		}
+
+		// Execute render commands from the secondary command buffer
+		vkCmdExecuteCommands(primaryCommandBuffer, commandBuffers.size(), commandBuffers.data());
+		vkCmdEndRenderPass(primaryCommandBuffer);
+		VK_CHECK_RESULT(vkEndCommandBuffer(primaryCommandBuffer));
+
+		updateTimes[cacheCommandBuffers ? 1 : 0].Add(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tUpdateStart).count());
+	}
+
+	// Records the secondary command buffers of the visible objects, the sky sphere and the UI overlay for the current frame
+	void RecordCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo, std::vector<VkCommandBuffer>& commandBuffers)
+	{
 		// Update secondary scene command buffers
 		UpdateSecondaryCommandBuffers(inheritanceInfo);
 
 		if (displaySkybox)
 			commandBuffers.emplace_back(secondaryCommandBuffers.background);
 
-		// Add a job to the thread's queue for each object to be rendered
-		for (auto t = 0; t < numThreads; t++)
+		auto tStart = std::chrono::high_resolution_clock::now();
+
+		if (useJobSystem)
 		{
-			for (auto i = 0; i < numObjectsPerThread; i++)
+			// All jobs of the previous frame have finished, so their arena slots can be reused
+			jobSystem.ResetJobArena();
+
+			// Visible objects are split into small batches, idle threads steal batches from busy ones
+			auto recordObject = [&](uint32_t i) {
+				ThreadRenderCode(jobSystem.GetThreadIndex(), visibleObjects[i], inheritanceInfo);
+			};
+			vks::JobCounter counter;
+			jobSystem.ParallelFor(visibleObjectCount, 8, recordObject, counter);
+			jobSystem.Wait(counter);
+		}
+		else
+		{
+			// Add a job to the thread's queue for each object to be rendered
+			for (auto t = 0; t < numThreads; t++)
 			{
-				threadPool.threads[t]->AddJob([=] {
-					ThreadRenderCode(t, i, inheritanceInfo);
-				});
+				for (auto i = 0; i < numObjectsPerThread; i++)
+				{
+					threadPool.threads[t]->AddJob([=] {
+						ThreadRenderCode(t, t * numObjectsPerThread + i, inheritanceInfo);
+					});
+				}
 			}
+
+			threadPool.Wait();
 		}
 
-		threadPool.Wait();
+		recordTimes.Add(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count());
 
 		// Only submit if object is within the current view frustum
-		for (auto t = 0; t < numThreads; t++)
+		for (auto& object : objectData)
 		{
-			for (auto i = 0; i < numObjectsPerThread; i++)
-			{
-				if (threadData[t].objectData[i].visible)
-					commandBuffers.emplace_back(threadData[t].commandBuffer[i]);
-			}
+			if (object.visible)
+				commandBuffers.emplace_back(object.commandBuffer);
 		}
 
 		// Render ui last
 		if (UIOverlay.visible)
 			commandBuffers.emplace_back(secondaryCommandBuffers.ui);
-
-		// Execute render commands from the secondary command buffer
-		vkCmdExecuteCommands(primaryCommandBuffer, commandBuffers.size(), commandBuffers.data());
-		vkCmdEndRenderPass(primaryCommandBuffer);
-		VK_CHECK_RESULT(vkEndCommandBuffer(primaryCommandBuffer));
 	}
 
 	void LoadAssets()
 	{
-		models.ufo.LoadFromFile(GetAssetPath() + "models/retroufo_red_lowpoly.dae", vertexLayout, 0.12f, vulkanDevice, queue);
+		const float ufoScale = 0.12f;
+		models.ufo.LoadFromFile(GetAssetPath() + "models/retroufo_red_lowpoly.dae", vertexLayout, ufoScale, vulkanDevice, queue);
 		models.skySphere.LoadFromFile(GetAssetPath() + "models/sphere.obj", vertexLayout, 1.0f, vulkanDevice, queue);
 		objectSphereDim = std::max(std::max(models.ufo.dim.size.x, models.ufo.dim.size.y), models.ufo.dim.size.z);
+		// The model dimensions are stored in file space, the loader scales the vertices and flips their y axis
+		objectBox.min = glm::vec3(models.ufo.dim.min.x, -models.ufo.dim.max.y, models.ufo.dim.min.z) * ufoScale;
+		objectBox.max = glm::vec3(models.ufo.dim.max.x, -models.ufo.dim.min.y, models.ufo.dim.max.z) * ufoScale;
 	}
 
 	void SetupPipelineLayout()
 	{
+		// Object storage buffer of the cached command buffers, not used by the push constant pipelines
+		VkDescriptorSetLayoutBinding setLayoutBinding = vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0);
+		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCI = vks::initializers::DescriptorSetLayoutCreateInfo(&setLayoutBinding, 1);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorSetLayoutCI, nullptr, &descriptorSetLayout));
+
 		VkPipelineLayoutCreateInfo pPipelineLayoutCreateInfo =
-			vks::initializers::PipelineLayoutCreateInfo(nullptr, 0);
+			vks::initializers::PipelineLayoutCreateInfo(&descriptorSetLayout, 1);
 
 		// Push constants for model matrices
 		VkPushConstantRange pushConstantRange =
@@ -519,6 +863,20 @@ public:
 		shaderStages[0] = LoadShader(GetShadersPath() + "multithreading/phong.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetShadersPath() + "multithreading/phong.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.phong));
+		// The SPIR-V of the cached variants is generated by the project's custom build step (or generate-spirv.bat)
+		const std::string phongCachedFile = GetShadersPath() + "multithreading/phong_cached.vert.spv";
+		const std::string starSphereCachedFile = GetShadersPath() + "multithreading/starsphere_cached.vert.spv";
+		cachedShadersAvailable = vks::tools::FileExists(phongCachedFile) && vks::tools::FileExists(starSphereCachedFile);
+		if (cachedShadersAvailable)
+		{
+			shaderStages[0] = LoadShader(phongCachedFile, VK_SHADER_STAGE_VERTEX_BIT);
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.phongCached));
+		}
+		else
+		{
+			std::cerr << "Cached command buffers disabled, phong_cached.vert and starsphere_cached.vert have not been compiled to SPIR-V" << std::endl;
+			cacheCommandBuffers = false;
+		}
 
 		// Star sphere rendering pipeline
 		rasterizationState.cullMode = VK_CULL_MODE_FRONT_BIT;
@@ -526,6 +884,58 @@ public:
 		shaderStages[0] = LoadShader(GetShadersPath() + "multithreading/starsphere.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetShadersPath() + "multithreading/starsphere.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.starSphere));
+		if (cachedShadersAvailable)
+		{
+			shaderStages[0] = LoadShader(starSphereCachedFile, VK_SHADER_STAGE_VERTEX_BIT);
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCI, nullptr, &pipelines.starSphereCached));
+		}
+	}
+
+	// Creates the object buffers, descriptor sets and secondary command buffers of the cached path for each frame in flight
+	void PrepareCachedCommandBuffers()
+	{
+		const uint32_t frameCount = settings.framesInFlight;
+		cachedFrames.resize(frameCount);
+
+		VkDescriptorPoolSize poolSize = vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount);
+		VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::DescriptorPoolCreateInfo(1, &poolSize, frameCount);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
+
+		for (auto& frame : cachedFrames)
+		{
+			// The sky sphere's matrix is stored after the objects
+			VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&frame.objectBuffer,
+				(numObjects + 1) * sizeof(ObjectShaderData)));
+			VK_CHECK_RESULT(frame.objectBuffer.Map());
+
+			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::DescriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &allocInfo, &frame.descriptorSet));
+			VkWriteDescriptorSet writeDescriptorSet = vks::initializers::WriteDescriptorSet(frame.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &frame.objectBuffer.descriptor);
+			vkUpdateDescriptorSets(device, 1, &writeDescriptorSet, 0, nullptr);
+
+			VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::CommandBufferAllocateInfo(cmdPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &frame.background));
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &frame.ui));
+
+			// Objects are statically assigned to the threads of the thread pool, which re-record them from their own command pools
+			frame.objects.resize(numObjects);
+			frame.objectGenerations.assign(numObjects, 0);
+			for (uint32_t t = 0; t < numThreads; t++)
+			{
+				cmdBufAllocateInfo = vks::initializers::CommandBufferAllocateInfo(threadData[t].commandPool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, numObjectsPerThread);
+				VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &frame.objects[t * numObjectsPerThread]));
+			}
+		}
+	}
+
+	// Marks all cached command buffers as stale, they're re-recorded once their objects are visible again
+	void InvalidateCommandBuffers()
+	{
+		commandBufferGeneration++;
+		uiGeneration++;
 	}
 
 	void UpdateMatrices()
@@ -537,14 +947,7 @@ public:
 
 	void Draw()
 	{
-		// Wait for fence to signal that all command buffers are ready
-		VkResult fenceRes;
-		do {
-			fenceRes = vkWaitForFences(device, 1, &renderFence, VK_TRUE, 100000000);
-		} while (fenceRes == VK_TIMEOUT);
-		VK_CHECK_RESULT(fenceRes);
-		vkResetFences(device, 1, &renderFence);
-
+		// Waits for the fence of the frame in flight, so its command buffers and object buffer can be reused
 		__super::PrepareFrame();
 
 		UpdateCommandBuffers(frameBuffers[currentBuffer]);
@@ -552,7 +955,7 @@ public:
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &primaryCommandBuffer;
 
-		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, renderFence));
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
 
 		__super::SubmitFrame();
 	}
@@ -560,14 +963,20 @@ public:
 	void Prepare()
 	{
 		__super::Prepare();
-		// Create a fence for synchronization
-		VkFenceCreateInfo fenceCreateInfo = vks::initializers::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-		vkCreateFence(device, &fenceCreateInfo, nullptr, &renderFence);
 		LoadAssets();
 		SetupPipelineLayout();
 		PreparePipelines();
 		PrepareMultiThreadedRenderer();
+		PrepareCachedCommandBuffers();
 		UpdateMatrices();
+		if (benchmark.active)
+		{
+			// CPU-only comparison of both schedulers and of the culling paths, reported along with the frame benchmark
+			vks::JobSystemBenchmark jobSystemBenchmark;
+			jobSystemBenchmark.Run(jobSystem, threadPool, benchmark);
+			vks::FrustumBenchmark frustumBenchmark;
+			frustumBenchmark.Run(benchmark);
+		}
 		prepared = true;
 	}
 
@@ -575,6 +984,9 @@ public:
 	{
 		if (!prepared)
 			return;
+		// Alternate between both paths, so they're compared under the same conditions
+		if (benchmark.active && cachedShadersAvailable)
+			cacheCommandBuffers = !cacheCommandBuffers;
 		Draw();
 	}
 
@@ -583,13 +995,48 @@ public:
 		UpdateMatrices();
 	}
 
+	// Called by the base class if the UI overlay's draw data changed, the other cached command buffers stay valid
+	virtual void BuildCommandBuffers()
+	{
+		uiGeneration++;
+	}
+
+	virtual void WindowResized()
+	{
+		// The recorded viewport and scissor no longer match
+		InvalidateCommandBuffers();
+	}
+
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
 	{
 		if (overlay->Header("Statistics")) {
 			overlay->Text("Active threads: %d", numThreads);
+			overlay->Text("Visible objects: %d / %d", visibleObjectCount, numObjects);
+			overlay->Text("Cull: %.3f ms", cullTime);
+			double tAvg, tTail;
+			if (cacheCommandBuffers) {
+				overlay->Text("Re-recorded: %d", rerecordedCount);
+			}
+			else {
+				GetTimes(recordTimes, tAvg, tTail);
+				overlay->Text("Record avg: %.3f ms", tAvg);
+				overlay->Text("Record p99: %.3f ms", tTail);
+			}
+			GetTimes(updateTimes[cacheCommandBuffers ? 1 : 0], tAvg, tTail);
+			overlay->Text("Update avg: %.3f ms", tAvg);
+			overlay->Text("Update p99: %.3f ms", tTail);
+			overlay->Text("Job heap allocations: %llu", static_cast<unsigned long long>(vks::JobHeapAllocations().load()));
+			overlay->Text("Command buffer allocations: %u", commandBufferAllocator.AllocationCount());
 		}
 		if (overlay->Header("Settings")) {
 			overlay->CheckBox("Skybox", &displaySkybox);
+			if (overlay->CheckBox("Work stealing", &useJobSystem)) {
+				recordTimes.count = 0;
+				updateTimes[0].count = 0;
+			}
+			if (cachedShadersAvailable) {
+				overlay->CheckBox("Cached command buffers", &cacheCommandBuffers);
+			}
 		}
 
 	}
@@ -13,6 +13,7 @@
 #include "VulkanBase.h"
 #include "VulkanBuffer.hpp"
 #include "VulkanModel.hpp"
+#include "VulkanQueryRing.hpp"
 
 #define VERTEX_BUFFER_BIND_ID 0
 #define ENABLE_VALIDATION false
@@ -68,12 +69,24 @@ public:
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
 
-	// Pool that stores all occlusion queries
-	VkQueryPool queryPool;
+	// Occlusion queries of the teapot and the sphere, with one pool per command buffer
+	// The results are read back when the command buffer is submitted again, so the CPU never waits for them
+	vks::QueryRing queryRing;
 
 	// Passed query samples
 	uint64_t passedSamples[2] = { 1,1 };
 
+	// Skip the visible pass draws of occluded objects on the GPU, using the query results of the same frame (VK_EXT_conditional_rendering)
+	struct {
+		bool supported = false;
+		bool enabled = false;
+		VkPhysicalDeviceConditionalRenderingFeaturesEXT features{};
+		// Passed samples of both objects for each command buffer, as 32 bit values read by the conditional rendering
+		vks::Buffer predicates;
+		PFN_vkCmdBeginConditionalRenderingEXT vkCmdBeginConditionalRenderingEXT = nullptr;
+		PFN_vkCmdEndConditionalRenderingEXT vkCmdEndConditionalRenderingEXT = nullptr;
+	} conditionalRendering;
+
 	VulkanExampleOcclusionQueries() : VulkanBase(ENABLE_VALIDATION)
 	{
 		title = "Occlusion queries";
@@ -83,6 +96,10 @@ public:
 		camera.SetRotationSpeed(0.5f);
 		camera.SetPerspective(60.0f, (float)width / (float)height, 1.0f, 256.0f);
 		settings.overlay = true;
+		// Required to query the conditional rendering features of the device
+		if (InstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+			enabledInstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		}
 	}
 
 	~VulkanExampleOcclusionQueries()
@@ -96,7 +113,8 @@ public:
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryRing.Destroy();
+		conditionalRendering.predicates.Destroy();
 
 		uniformBuffers.occluder.Destroy();
 		uniformBuffers.sphere.Destroy();
@@ -107,32 +125,103 @@ public:
 		models.teapot.Destroy();
 	}
 
-	// Create a query pool for storing the occlusion query result
+	static bool InstanceExtensionSupported(const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+		for (const VkExtensionProperties& extension : extensions) {
+			if (strcmp(extension.extensionName, name) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// The logical device (and with it vulkanDevice) doesn't exist yet when the features are selected, so the physical device is queried directly
+	bool DeviceExtensionSupported(const char* name)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+		for (const VkExtensionProperties& extension : extensions) {
+			if (strcmp(extension.extensionName, name) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	virtual void GetEnabledFeatures()
+	{
+		// If the device doesn't support conditional rendering, the occluded objects are only drawn with a different color
+		PFN_vkGetPhysicalDeviceFeatures2KHR getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+		if (getPhysicalDeviceFeatures2 && DeviceExtensionSupported(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME)) {
+			VkPhysicalDeviceConditionalRenderingFeaturesEXT conditionalRenderingFeatures{};
+			conditionalRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+			VkPhysicalDeviceFeatures2KHR deviceFeatures2{};
+			deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+			deviceFeatures2.pNext = &conditionalRenderingFeatures;
+			getPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures2);
+			conditionalRendering.supported = conditionalRenderingFeatures.conditionalRendering;
+		}
+		if (conditionalRendering.supported) {
+			enabledDeviceExtensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
+			conditionalRendering.features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_CONDITIONAL_RENDERING_FEATURES_EXT;
+			conditionalRendering.features.conditionalRendering = VK_TRUE;
+			deviceCreatepNextChain = &conditionalRendering.features;
+		}
+		conditionalRendering.enabled = conditionalRendering.supported;
+	}
+
+	// Create the query pools for storing the occlusion query results
 	void SetupQueryPool()
 	{
-		VkQueryPoolCreateInfo queryPoolInfo = {};
-		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-		queryPoolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
-		queryPoolInfo.queryCount = 2;
-		VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolInfo, NULL, &queryPool));
+		// The command buffers are pre-recorded, so every swap chain image gets its own pool
+		const uint32_t slotCount = static_cast<uint32_t>(drawCmdBuffers.size());
+		queryRing.Create(device, VK_QUERY_TYPE_OCCLUSION, 2, slotCount);
+
+		if (conditionalRendering.supported) {
+			VK_CHECK_RESULT(vulkanDevice->CreateBuffer(
+				VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&conditionalRendering.predicates,
+				slotCount * 2 * sizeof(uint32_t)));
+			conditionalRendering.vkCmdBeginConditionalRenderingEXT = reinterpret_cast<PFN_vkCmdBeginConditionalRenderingEXT>(vkGetDeviceProcAddr(device, "vkCmdBeginConditionalRenderingEXT"));
+			conditionalRendering.vkCmdEndConditionalRenderingEXT = reinterpret_cast<PFN_vkCmdEndConditionalRenderingEXT>(vkGetDeviceProcAddr(device, "vkCmdEndConditionalRenderingEXT"));
+		}
 	}
 
-	// Retrieves the results of the occlusion queries submitted to the command buffer
+	// Retrieves the results of the occlusion queries of the current command buffer's last submission
+	// The base class has waited for that submission to finish, so the results are read without stalling on the GPU
+	// They are a few frames old, which is fine for displaying them (the conditional rendering uses the current frame's results)
 	void GetQueryResults()
 	{
-		// We use vkGetQueryResults to copy the results into a host visible buffer
-		vkGetQueryPoolResults(
-			device,
-			queryPool,
-			0,
-			2,
-			sizeof(passedSamples),
-			passedSamples,
-			sizeof(uint64_t),
-			// Store results a 64 bit values and wait until the results have been finished
-			// If you don't want to wait, you can use VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
-			// which also returns the state of the result (ready) in the result
-			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+		queryRing.Read(currentBuffer, passedSamples);
+	}
+
+	// Draw the visible pass version of an object, skipped on the GPU if none of its samples passed the occlusion pass
+	void DrawConditional(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t object, vks::Model& model, VkDescriptorSet descriptorSet)
+	{
+		if (conditionalRendering.enabled) {
+			VkConditionalRenderingBeginInfoEXT conditionalRenderingBeginInfo{};
+			conditionalRenderingBeginInfo.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+			conditionalRenderingBeginInfo.buffer = conditionalRendering.predicates.buffer;
+			conditionalRenderingBeginInfo.offset = (slot * 2 + object) * sizeof(uint32_t);
+			conditionalRendering.vkCmdBeginConditionalRenderingEXT(commandBuffer, &conditionalRenderingBeginInfo);
+		}
+
+		VkDeviceSize offsets[1] = { 0 };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
+		vkCmdBindVertexBuffers(commandBuffer, VERTEX_BUFFER_BIND_ID, 1, &model.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, model.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(commandBuffer, model.indexCount, 1, 0, 0, 0);
+
+		if (conditionalRendering.enabled) {
+			conditionalRendering.vkCmdEndConditionalRenderingEXT(commandBuffer);
+		}
 	}
 
 	void BuildCommandBuffers()
@@ -159,9 +248,9 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
-			// Reset query pool
+			// Reset the query pool of this command buffer
 			// Must be done outside of render pass
-			vkCmdResetQueryPool(drawCmdBuffers[i], queryPool, 0, 2);
+			queryRing.Reset(drawCmdBuffers[i], i);
 
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -193,61 +282,88 @@ public:
 			vkCmdDrawIndexed(drawCmdBuffers[i], models.plane.indexCount, 1, 0, 0, 0);
 
 			// Teapot
-			vkCmdBeginQuery(drawCmdBuffers[i], queryPool, 0, VK_FLAGS_NONE);
+			vkCmdBeginQuery(drawCmdBuffers[i], queryRing.Pool(i), 0, VK_FLAGS_NONE);
 
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.teapot, 0, NULL);
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.teapot.vertices.buffer, offsets);
 			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.teapot.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 			vkCmdDrawIndexed(drawCmdBuffers[i], models.teapot.indexCount, 1, 0, 0, 0);
 
-			vkCmdEndQuery(drawCmdBuffers[i], queryPool, 0);
+			vkCmdEndQuery(drawCmdBuffers[i], queryRing.Pool(i), 0);
 
 			// Sphere
-			vkCmdBeginQuery(drawCmdBuffers[i], queryPool, 1, VK_FLAGS_NONE);
+			vkCmdBeginQuery(drawCmdBuffers[i], queryRing.Pool(i), 1, VK_FLAGS_NONE);
 
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.sphere, 0, NULL);
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.sphere.vertices.buffer, offsets);
 			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.sphere.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 			vkCmdDrawIndexed(drawCmdBuffers[i], models.sphere.indexCount, 1, 0, 0, 0);
 
-			vkCmdEndQuery(drawCmdBuffers[i], queryPool, 1);
+			vkCmdEndQuery(drawCmdBuffers[i], queryRing.Pool(i), 1);
 
 			// Visible pass
-			// Clear color and depth attachments
-			VkClearAttachment clearAttachments[2] = {};
-
-			clearAttachments[0].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			clearAttachments[0].clearValue.color = defaultClearColor;
-			clearAttachments[0].colorAttachment = 0;
-
-			clearAttachments[1].aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-			clearAttachments[1].clearValue.depthStencil = { 1.0f, 0 };
-
-			VkClearRect clearRect = {};
-			clearRect.layerCount = 1;
-			clearRect.rect.offset = { 0, 0 };
-			clearRect.rect.extent = { width, height };
-
-			vkCmdClearAttachments(
-				drawCmdBuffers[i],
-				2,
-				clearAttachments,
-				1,
-				&clearRect);
+			if (conditionalRendering.enabled) {
+				// Query results can only be copied outside of a render pass, so the visible pass starts a new one (which also clears the attachments)
+				vkCmdEndRenderPass(drawCmdBuffers[i]);
+
+				// Copy the passed samples to the predicates of this command buffer, waiting for the queries on the GPU
+				vkCmdCopyQueryPoolResults(
+					drawCmdBuffers[i],
+					queryRing.Pool(i),
+					0,
+					2,
+					conditionalRendering.predicates.buffer,
+					i * 2 * sizeof(uint32_t),
+					sizeof(uint32_t),
+					VK_QUERY_RESULT_WAIT_BIT);
+
+				VkMemoryBarrier memoryBarrier = vks::initializers::MemoryBarrier();
+				memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				memoryBarrier.dstAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+				vkCmdPipelineBarrier(
+					drawCmdBuffers[i],
+					VK_PIPELINE_STAGE_TRANSFER_BIT,
+					VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT,
+					0,
+					1, &memoryBarrier,
+					0, nullptr,
+					0, nullptr);
+
+				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+				vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+				vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+			}
+			else {
+				// Clear color and depth attachments
+				VkClearAttachment clearAttachments[2] = {};
+
+				clearAttachments[0].aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				clearAttachments[0].clearValue.color = defaultClearColor;
+				clearAttachments[0].colorAttachment = 0;
+
+				clearAttachments[1].aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+				clearAttachments[1].clearValue.depthStencil = { 1.0f, 0 };
+
+				VkClearRect clearRect = {};
+				clearRect.layerCount = 1;
+				clearRect.rect.offset = { 0, 0 };
+				clearRect.rect.extent = { width, height };
+
+				vkCmdClearAttachments(
+					drawCmdBuffers[i],
+					2,
+					clearAttachments,
+					1,
+					&clearRect);
+			}
 
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.solid);
 
 			// Teapot
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.teapot, 0, NULL);
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.teapot.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.teapot.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(drawCmdBuffers[i], models.teapot.indexCount, 1, 0, 0, 0);
+			DrawConditional(drawCmdBuffers[i], i, 0, models.teapot, descriptorSets.teapot);
 
 			// Sphere
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.sphere, 0, NULL);
-			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.sphere.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.sphere.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(drawCmdBuffers[i], models.sphere.indexCount, 1, 0, 0, 0);
+			DrawConditional(drawCmdBuffers[i], i, 1, models.sphere, descriptorSets.sphere);
 
 			// Occluder
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.occluder);
@@ -266,15 +382,16 @@ public:
 
 	void Draw()
 	{
-		UpdateUniformBuffers();
 		__super::PrepareFrame();
 
+		// Read the query results of this command buffer's last submission before it is submitted again
+		GetQueryResults();
+		UpdateUniformBuffers();
+
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
 		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Read query results for displaying in next frame
-		GetQueryResults();
+		queryRing.Submitted(currentBuffer);
 
 		__super::SubmitFrame();
 	}
@@ -581,9 +698,17 @@ public:
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
 	{
+		if (conditionalRendering.supported) {
+			if (overlay->Header("Settings")) {
+				if (overlay->CheckBox("Conditional rendering", &conditionalRendering.enabled)) {
+					BuildCommandBuffers();
+				}
+			}
+		}
 		if (overlay->Header("Occlusion query results")) {
 			overlay->Text("Teapot: %d samples passed", passedSamples[0]);
 			overlay->Text("Sphere: %d samples passed", passedSamples[1]);
+			overlay->Text("Unavailable results: %d", queryRing.unavailableCount);
 		}
 	}
 
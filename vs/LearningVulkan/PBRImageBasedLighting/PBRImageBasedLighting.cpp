@@ -391,7 +391,8 @@ public:
 		// Skybox pipeline (background cube)
 		shaderStages[0] = LoadShader(GetShadersPath() + "pbribl/skybox.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
 		shaderStages[1] = LoadShader(GetShadersPath() + "pbribl/skybox.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.skybox));
+		// Compiled on a worker thread while the next pipeline is being set up, the builder copies the create info
+		std::future<VkPipeline> skyboxPipeline = pipelineBuilder.Submit(pipelineCreateInfo);
 
 		// PBR pipeline
 		shaderStages[0] = LoadShader(GetShadersPath() + "pbribl/pbribl.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
@@ -399,7 +400,10 @@ public:
 		// Enable depth test and write
 		depthStencilState.depthWriteEnable = VK_TRUE;
 		depthStencilState.depthTestEnable = VK_TRUE;
-		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.pbr));
+		std::future<VkPipeline> pbrPipeline = pipelineBuilder.Submit(pipelineCreateInfo);
+
+		pipelines.skybox = skyboxPipeline.get();
+		pipelines.pbr = pbrPipeline.get();
 	}
 
 	// Generate a BRDF integration map used as a look-up-table (stores roughness / NdotV)
@@ -11,6 +11,7 @@
 #include "VulkanBase.h"
 #include "VulkanModel.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanClusterCuller.hpp"
 
 #define VERTEX_BUFFER_BIND_ID 0
 #define ENABLE_VALIDATAION false
@@ -18,19 +19,23 @@
 class VulkanExamplePipeline : public VulkanBase
 {
 public:
-	// Vertex layout for the models
-	vks::VertexLayout vertexLayout = vks::VertexLayout({
+	// Vertex layout for the models, fixed at compile time so the model loader uses a specialized vertex writer
+	vks::StaticVertexLayout<
 		vks::VERTEX_COMPONENT_POSITION,
 		vks::VERTEX_COMPONENT_NORMAL,
 		vks::VERTEX_COMPONENT_UV,
 		vks::VERTEX_COMPONENT_COLOR
-		});
+		> vertexLayout;
 
 	struct
 	{
 		vks::Model cube;
 	} models;
 
+	// GPU culling of the model's meshlets, falls back to drawing the whole model if the culling shader is not available
+	vks::ClusterCuller clusterCuller;
+	bool clusterCulling = true;
+
 	vks::Buffer uniformBuffer;
 
 	// Same uniform buffer layout as shader
@@ -74,6 +79,7 @@ public:
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
+		clusterCuller.Destroy();
 		models.cube.Destroy();
 		uniformBuffer.Destroy();
 	}
@@ -91,6 +97,19 @@ public:
 		}
 	}
 
+	void DrawModel(VkCommandBuffer commandBuffer)
+	{
+		if (clusterCulling && clusterCuller.ready)
+		{
+			clusterCuller.Draw(commandBuffer);
+		}
+		else
+		{
+			vkCmdBindIndexBuffer(commandBuffer, models.cube.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexed(commandBuffer, models.cube.indexCount, 1, 0, 0, 0);
+		}
+	}
+
 	void BuildCommandBuffers()
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::CommandBufferBeginInfo();
@@ -114,6 +133,10 @@ public:
 			renderPassBeginInfo.framebuffer = frameBuffers[i];
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			// The visible meshlets are the same for all viewports, cull them once before the render pass
+			if (clusterCulling)
+				clusterCuller.Record(drawCmdBuffers[i]);
+
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			VkViewport viewport = vks::initializers::Viewport(static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f);
@@ -126,13 +149,12 @@ public:
 
 			VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.cube.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.cube.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 
 			viewport.width = width / 3.0f;
 			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
 
-			vkCmdDrawIndexed(drawCmdBuffers[i], models.cube.indexCount, 1, 0, 0, 0);
+			DrawModel(drawCmdBuffers[i]);
 
 			// Center : Toon
 			viewport.x = width / 3.0f;
@@ -141,7 +163,7 @@ public:
 			// Line width > 1.0f only if wide lines feature is supported
 			if (deviceFeatures.wideLines)
 				vkCmdSetLineWidth(drawCmdBuffers[i], 2.0f);
-			vkCmdDrawIndexed(drawCmdBuffers[i], models.cube.indexCount, 1, 0, 0, 0);
+			DrawModel(drawCmdBuffers[i]);
 
 			if (deviceFeatures.fillModeNonSolid)
 			{
@@ -149,7 +171,7 @@ public:
 				viewport.x = width / 3.0f + width / 3.0f;
 				vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.wireframe);
-				vkCmdDrawIndexed(drawCmdBuffers[i], models.cube.indexCount, 1, 0, 0, 0);
+				DrawModel(drawCmdBuffers[i]);
 			}
 
 			DrawUI(drawCmdBuffers[i]);
@@ -161,7 +183,10 @@ public:
 
 	void LoadAssets()
 	{
-		models.cube.LoadFromFile(GetAssetPath() + "models/treasure_smooth.dae", vertexLayout, 1.0f, vulkanDevice, queue);
+		vks::ModelCreateInfo modelCreateInfo(1.0f, 1.0f, 0.0f);
+		modelCreateInfo.meshlets = true;
+		models.cube.LoadFromFile(GetAssetPath() + "models/treasure_smooth.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
+		clusterCuller.Create(vulkanDevice, models.cube, GetAssetPath() + "shaders/base/clustercull.comp.spv", pipelineCache);
 	}
 
 	void SetupDescriptorPool()
@@ -247,13 +272,9 @@ public:
 			vks::initializers::VertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, vertexLayout.Stride(), VK_VERTEX_INPUT_RATE_VERTEX)
 		};
 
-		// Attribute descriptions
-		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 0: Position
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),	// Location 1: Color
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 2, VK_FORMAT_R32G32_SFLOAT, sizeof(float) * 6),		// Location 2: Texture coordinates
-			vks::initializers::VertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 3, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 8),	// Location 3: Normal
-		};
+		// Attribute descriptions, generated from the vertex layout
+		// Location 0: Position, Location 1: Normal, Location 2: Texture coordinates, Location 3: Color
+		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = vertexLayout.InputAttributes(VERTEX_BUFFER_BIND_ID);
 
 		VkPipelineVertexInputStateCreateInfo vertexInputState = vks::initializers::PipelineVertexInputStateCreateInfo();
 		vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputBindings.size());
@@ -312,6 +333,9 @@ public:
 		uboVS.projection = camera.matrices.perspective;
 		uboVS.modelView = camera.matrices.view;
 		memcpy(uniformBuffer.mapped, &uboVS, sizeof(uboVS));
+
+		// All pipelines cull back faces, so meshlets facing away from the camera can be skipped too
+		clusterCuller.Update(uboVS.projection * uboVS.modelView, glm::vec3(glm::inverse(uboVS.modelView)[3]), true);
 	}
 
 	void Draw()
@@ -350,6 +374,12 @@ public:
 
 	virtual void OnUpdateUIOverlay(vks::UIOverlay* overlay)
 	{
+		if (clusterCuller.ready && overlay->Header("Settings"))
+		{
+			if (overlay->CheckBox("Cluster culling", &clusterCulling))
+				BuildCommandBuffers();
+			overlay->Text("%u meshlets", clusterCuller.clusterCount);
+		}
 		if (!deviceFeatures.fillModeNonSolid)
 		{
 			if (overlay->Header("Info"))
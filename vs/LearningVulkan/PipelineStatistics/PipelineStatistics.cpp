@@ -13,6 +13,7 @@
 #include "VulkanBase.h"
 #include "VulkanBuffer.hpp"
 #include "VulkanModel.hpp"
+#include "VulkanQueryRing.hpp"
 
 #define ENABLE_VALIDATION false
 #define OBJ_DIM 0.05f
@@ -55,7 +56,8 @@ public:
 	VkDescriptorSet descriptorSet;
 	VkDescriptorSetLayout descriptorSetLayout;
 
-	VkQueryPool queryPool;
+	// One pipeline statistics query per command buffer, read back when the command buffer is submitted again
+	vks::QueryRing queryRing;
 
 	// Vector for storing pipeline statistics results
 	std::vector<uint64_t> pipelineStats;
@@ -80,7 +82,7 @@ public:
 		vkDestroyPipeline(device, pipeline, nullptr);
 		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryRing.Destroy();
 		uniformBuffers.VS.Destroy();
 		for (auto& model : models.objects) {
 			model.Destroy();
@@ -104,7 +106,7 @@ public:
 		}
 	}
 
-	// Setup a query pool for storing pipeline statistics
+	// Setup the query pools for storing pipeline statistics
 	void SetupQueryPool()
 	{
 		pipelineStatNames = {
@@ -121,12 +123,8 @@ public:
 		}
 		pipelineStats.resize(pipelineStatNames.size());
 
-		VkQueryPoolCreateInfo queryPoolInfo = {};
-		queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
-		// This query pool will store pipeline statistics
-		queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
-		// Pipeline counters to be returned for this pool
-		queryPoolInfo.pipelineStatistics =
+		// Pipeline counters to be returned for the query
+		VkQueryPipelineStatisticFlags pipelineStatistics =
 			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
 			VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
 			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
@@ -134,27 +132,20 @@ public:
 			VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
 			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
 		if (deviceFeatures.tessellationShader) {
-			queryPoolInfo.pipelineStatistics |=
+			pipelineStatistics |=
 				VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT |
 				VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT;
 		}
-		queryPoolInfo.queryCount = deviceFeatures.tessellationShader ? 8 : 6;
-		VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolInfo, NULL, &queryPool));
+		// A single query returns all counters, the command buffers are pre-recorded so every swap chain image gets its own pool
+		queryRing.Create(device, VK_QUERY_TYPE_PIPELINE_STATISTICS, 1, static_cast<uint32_t>(drawCmdBuffers.size()), pipelineStatistics);
+		assert(queryRing.ValuesPerQuery() == pipelineStats.size());
 	}
 
-	// Retrieves the results of the pipeline statistics query submitted to the command buffer
+	// Retrieves the results of the pipeline statistics query of the current command buffer's last submission
+	// The base class has waited for that submission to finish, so the results are read without stalling on the GPU
 	void GetQueryResults()
 	{
-		uint32_t count = static_cast<uint32_t>(pipelineStats.size());
-		vkGetQueryPoolResults(
-			device,
-			queryPool,
-			0,
-			1,
-			count * sizeof(uint64_t),
-			pipelineStats.data(),
-			sizeof(uint64_t),
-			VK_QUERY_RESULT_64_BIT);
+		queryRing.Read(currentBuffer, pipelineStats.data());
 	}
 
 	void BuildCommandBuffers()
@@ -179,8 +170,8 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
-			// Reset timestamp query pool
-			vkCmdResetQueryPool(drawCmdBuffers[i], queryPool, 0, static_cast<uint32_t>(pipelineStats.size()));
+			// Reset the query pool of this command buffer
+			queryRing.Reset(drawCmdBuffers[i], i);
 
 			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
@@ -193,7 +184,7 @@ public:
 			VkDeviceSize offsets[1] = { 0 };
 
 			// Start capture of pipeline statistics
-			vkCmdBeginQuery(drawCmdBuffers[i], queryPool, 0, 0);
+			vkCmdBeginQuery(drawCmdBuffers[i], queryRing.Pool(i), 0, 0);
 
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, NULL);
@@ -209,7 +200,7 @@ public:
 			}
 
 			// End capture of pipeline statistics
-			vkCmdEndQuery(drawCmdBuffers[i], queryPool, 0);
+			vkCmdEndQuery(drawCmdBuffers[i], queryRing.Pool(i), 0);
 
 			DrawUI(drawCmdBuffers[i]);
 
@@ -223,12 +214,13 @@ public:
 	{
 		__super::PrepareFrame();
 
+		// Read the query results of this command buffer's last submission before it is submitted again
+		GetQueryResults();
+
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
 		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
-
-		// Read query results for displaying in next frame
-		GetQueryResults();
+		queryRing.Submitted(currentBuffer);
 
 		__super::SubmitFrame();
 	}
@@ -2,7 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <float.h>
 #include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -20,6 +24,7 @@
 #include "VulkanTexture.hpp"
 #include "VulkanDevice.hpp"
 #include "VulkanBuffer.hpp"
+#include "RenderQueue.hpp"
 
 #define VERTEX_BUFFER_BIND_ID 0
 #define ENABLE_VALIDATION false
@@ -57,6 +62,8 @@ struct SceneMaterial
 	VkDescriptorSet descriptorSet;
 	// Pointer to the pipeline used by this material
 	VkPipeline* pipeline;
+	// Descriptor set and push constants of the material for the render queue
+	vks::RenderQueue::Material queueMaterial;
 };
 
 //Stores per-mesh Vulkan resources
@@ -65,6 +72,8 @@ struct ScenePart
 	// Index of first index in the scene buffer
 	uint32_t indexBase;
 	uint32_t indexCount;
+	// Center of the mesh's bounding box, used to sort the draws by depth
+	glm::vec3 center;
 
 	// Pointer to the material used by this mesh
 	SceneMaterial* material;
@@ -192,11 +201,12 @@ private:
 		// Set 1: Material data
 		setLayoutBindings.clear();
 		setLayoutBindings.emplace_back(vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 0));
-		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(vulkanDevice->logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayouts.scene));
+		descriptorLayout = vks::initializers::DescriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(vulkanDevice->logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayouts.material));
 
 		// Setup pipeline layout
 		std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayouts.scene, descriptorSetLayouts.material };
-		auto pipelineLayoutCreateInfo = vks::initializers::PipelineLayoutCreateInfo(setLayouts.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+		auto pipelineLayoutCreateInfo = vks::initializers::PipelineLayoutCreateInfo(setLayouts.data(), static_cast<uint32_t>(setLayouts.size()));
 
 		// We will be using a push constant block to pass material properties to the fragment shaders
 		auto pushConstantRange = vks::initializers::PushConstantRange(VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(SceneMaterialProperties), 0);
@@ -206,7 +216,7 @@ private:
 		VK_CHECK_RESULT(vkCreatePipelineLayout(vulkanDevice->logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
 
 		// Materials descriptor sets
-		for (auto material : materials)
+		for (auto& material : materials)
 		{
 			// Descriptor set
 			auto allocInfo = vks::initializers::DescriptorSetAllocateInfo(descriptorPool, &descriptorSetLayouts.material, 1);
@@ -218,6 +228,9 @@ private:
 			writeDescriptorSets.emplace_back(vks::initializers::WriteDescriptorSet(material.descriptorSet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 0, &material.diffuse.descriptor));
 
 			vkUpdateDescriptorSets(vulkanDevice->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+			material.queueMaterial.descriptorSet = material.descriptorSet;
+			material.queueMaterial.pushConstants = &material.properties;
 		}
 
 		// Scene descriptor set
@@ -257,17 +270,22 @@ private:
 
 			const uint32_t vertexOffset = static_cast<uint32_t>(vertices.size());
 
+			glm::vec3 minPos(FLT_MAX);
+			glm::vec3 maxPos(-FLT_MAX);
 			for (auto v = 0; v < aMesh->mNumVertices; v++)
 			{
 				Vertex vertex;
 				vertex.pos = glm::make_vec3(&aMesh->mVertices[v].x);
 				vertex.pos.y = -vertex.pos.y;
+				minPos = glm::min(minPos, vertex.pos);
+				maxPos = glm::max(maxPos, vertex.pos);
 				vertex.uv = hasUV ? glm::make_vec2(&aMesh->mTextureCoords[0][v].x) : glm::vec2(0.0f);
 				vertex.normal = hasNormals ? glm::make_vec3(&aMesh->mNormals[v].x) : glm::vec3(0.0f);
 				vertex.normal.y = -vertex.normal.y;
 				vertex.color = hasColor ? glm::make_vec3(&aMesh->mColors[0][v].r) : glm::vec3(1.0f);
 				vertices.emplace_back(vertex);
 			}
+			meshes[i].center = (aMesh->mNumVertices > 0) ? (minPos + maxPos) * 0.5f : glm::vec3(0.0f);
 
 			// Indices
 			for (auto f = 0; f < aMesh->mNumFaces; f++)
@@ -349,7 +367,7 @@ public:
 	{
 		VkPipeline solid;
 		VkPipeline blending;
-		VkPipeline wireframe;
+		VkPipeline wireframe = VK_NULL_HANDLE;
 	} pipelines;
 
 	// Shared pipeline layout
@@ -477,9 +495,64 @@ public:
 				&meshes[i].material->properties);
 
 			// Render from the global scene vertex buffer using the mesh index offset
-			vkCmdDrawIndexed(cmdBuffer, meshes[i].indexCount, 1, 0, meshes[i].indexBase, 0);
+			vkCmdDrawIndexed(cmdBuffer, meshes[i].indexCount, 1, meshes[i].indexBase, 0, 0);
 		}
 	}
+
+	// Add the draws of the scene to a render queue
+	// Opaque parts are sorted by pipeline and material and then front to back, transparent parts are drawn afterwards from back to front
+	void AddDraws(vks::RenderQueue& renderQueue, bool wireframe, const glm::mat4& view)
+	{
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			if ((renderSingleScenePart) && (i != scenePartIndex))
+				continue;
+
+			const SceneMaterial& material = *meshes[i].material;
+			const uint32_t materialIndex = static_cast<uint32_t>(&material - materials.data());
+			const float depth = glm::length(glm::vec3(view * glm::vec4(meshes[i].center, 1.0f)));
+
+			vks::RenderQueue::Draw draw;
+			draw.pipeline = wireframe ? pipelines.wireframe : *material.pipeline;
+			draw.material = &material.queueMaterial;
+			draw.indexCount = meshes[i].indexCount;
+			draw.firstIndex = meshes[i].indexBase;
+			draw.vertexOffset = 0;
+
+			if (!wireframe && (material.pipeline == &pipelines.blending))
+			{
+				renderQueue.Add(vks::RenderQueue::TransparentKey(1, 1, materialIndex, depth), draw);
+			}
+			else
+			{
+				renderQueue.Add(vks::RenderQueue::OpaqueKey(0, wireframe ? 2 : 0, materialIndex, depth), draw);
+			}
+		}
+	}
+
+	// Renders the scene through a render queue, which only binds pipelines, descriptor sets and push constants when they change
+	void RenderSorted(VkCommandBuffer cmdBuffer, bool wireframe, const glm::mat4& view, vks::RenderQueue& renderQueue)
+	{
+		VkDeviceSize offsets[1] = { 0 };
+
+		// Bind scene vertex and index buffers
+		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &vertexBuffer.buffer, offsets);
+		vkCmdBindIndexBuffer(cmdBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+
+		// Set 0: Scene descriptor set containing global matrices, the same for all draws
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSetScene, 0, NULL);
+
+		// Set 1 and the push constants are bound by the queue per material
+		renderQueue.materialSet = 1;
+		renderQueue.pushConstantStages = VK_SHADER_STAGE_FRAGMENT_BIT;
+		renderQueue.pushConstantOffset = 0;
+		renderQueue.pushConstantSize = sizeof(SceneMaterialProperties);
+
+		renderQueue.Reset();
+		AddDraws(renderQueue, wireframe, view);
+		renderQueue.Sort();
+		renderQueue.Record(cmdBuffer, pipelineLayout);
+	}
 };
 
 class VulkanExampleSceneRendering : public VulkanBase
@@ -490,6 +563,10 @@ public:
 
 	Scene* scene = nullptr;
 
+	// Sort the draws with a render queue, the current command buffer is re-recorded every frame so the depth order follows the camera
+	bool useRenderQueue = true;
+	vks::RenderQueue renderQueue;
+
 	struct {
 		VkPipelineVertexInputStateCreateInfo inputState;
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
@@ -510,9 +587,64 @@ public:
 
 	~VulkanExampleSceneRendering()
 	{
+		if (benchmark.active && scene)
+		{
+			RenderQueueBenchmark(100000);
+		}
 		delete(scene);
 	}
 
+	// Time adding, sorting and replaying a large number of draws spread over the scene's pipelines and materials
+	// The replay doesn't record commands, it only counts the state changes of the draws in submission and in sorted order
+	void RenderQueueBenchmark(uint32_t drawCount)
+	{
+		std::default_random_engine rndEngine(0);
+		std::uniform_int_distribution<size_t> rndMesh(0, scene->meshes.size() - 1);
+		std::uniform_real_distribution<float> rndDepth(0.0f, 256.0f);
+		std::vector<size_t> meshIndices(drawCount);
+		std::vector<float> depths(drawCount);
+		for (uint32_t i = 0; i < drawCount; i++)
+		{
+			meshIndices[i] = rndMesh(rndEngine);
+			depths[i] = rndDepth(rndEngine);
+		}
+
+		vks::RenderQueue queue;
+		queue.pushConstantSize = sizeof(SceneMaterialProperties);
+		const uint32_t iterations = 10;
+		double tAdd = 0.0, tSort = 0.0, tReplay = 0.0;
+		vks::RenderQueue::Stats unsortedStats;
+		for (uint32_t iteration = 0; iteration < iterations; iteration++)
+		{
+			auto tStart = std::chrono::high_resolution_clock::now();
+			queue.Reset();
+			for (uint32_t i = 0; i < drawCount; i++)
+			{
+				const ScenePart& mesh = scene->meshes[meshIndices[i]];
+				const uint32_t materialIndex = static_cast<uint32_t>(mesh.material - scene->materials.data());
+				const bool transparent = (mesh.material->pipeline == &scene->pipelines.blending);
+				vks::RenderQueue::Draw draw = { *mesh.material->pipeline, &mesh.material->queueMaterial, mesh.indexCount, mesh.indexBase, 0 };
+				queue.Add(transparent ? vks::RenderQueue::TransparentKey(1, 1, materialIndex, depths[i]) : vks::RenderQueue::OpaqueKey(0, 0, materialIndex, depths[i]), draw);
+			}
+			auto tAdded = std::chrono::high_resolution_clock::now();
+			queue.Record(VK_NULL_HANDLE, VK_NULL_HANDLE);
+			unsortedStats = queue.stats;
+			auto tSortStart = std::chrono::high_resolution_clock::now();
+			queue.Sort();
+			auto tSorted = std::chrono::high_resolution_clock::now();
+			queue.Record(VK_NULL_HANDLE, VK_NULL_HANDLE);
+			auto tReplayed = std::chrono::high_resolution_clock::now();
+			tAdd += std::chrono::duration<double, std::milli>(tAdded - tStart).count();
+			tSort += std::chrono::duration<double, std::milli>(tSorted - tSortStart).count();
+			tReplay += std::chrono::duration<double, std::milli>(tReplayed - tSorted).count();
+		}
+		const vks::RenderQueue::Stats& sortedStats = queue.stats;
+		std::cout << "render queue: " << drawCount << " draws, add " << tAdd / iterations << " ms, sort " << tSort / iterations << " ms, replay " << tReplay / iterations << " ms" << std::endl;
+		std::cout << "  pipeline binds: " << unsortedStats.pipelineBinds << " unsorted, " << sortedStats.pipelineBinds << " sorted (" << sortedStats.pipelineBindsAvoided << " avoided)" << std::endl;
+		std::cout << "  descriptor set binds: " << unsortedStats.descriptorSetBinds << " unsorted, " << sortedStats.descriptorSetBinds << " sorted (" << sortedStats.descriptorSetBindsAvoided << " avoided)" << std::endl;
+		std::cout << "  push constant updates: " << unsortedStats.pushConstantUpdates << " unsorted, " << sortedStats.pushConstantUpdates << " sorted (" << sortedStats.pushConstantUpdatesAvoided << " avoided)" << std::endl;
+	}
+
 	// Enable physical device features required for this example				
 	virtual void GetEnabledFeatures()
 	{
@@ -523,6 +655,14 @@ public:
 	}
 
 	void BuildCommandBuffers()
+	{
+		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
+		{
+			RecordCommandBuffer(i);
+		}
+	}
+
+	void RecordCommandBuffer(int32_t i)
 	{
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::CommandBufferBeginInfo();
 
@@ -538,29 +678,32 @@ public:
 		renderPassBeginInfo.renderArea.extent.height = height;
 		renderPassBeginInfo.clearValueCount = 2;
 		renderPassBeginInfo.pClearValues = clearValues;
+		renderPassBeginInfo.framebuffer = frameBuffers[i];
 
-		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i)
-		{
-			renderPassBeginInfo.framebuffer = frameBuffers[i];
-
-			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+		VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
-			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-			VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
-			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+		VkViewport viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
+		vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 
-			VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
-			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+		VkRect2D scissor = vks::initializers::Rect2D(width, height, 0, 0);
+		vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
 
+		if (useRenderQueue)
+		{
+			scene->RenderSorted(drawCmdBuffers[i], wireframe, camera.matrices.view, renderQueue);
+		}
+		else
+		{
 			scene->Render(drawCmdBuffers[i], wireframe);
+		}
 
-			DrawUI(drawCmdBuffers[i]);
+		DrawUI(drawCmdBuffers[i]);
 
-			vkCmdEndRenderPass(drawCmdBuffers[i]);
+		vkCmdEndRenderPass(drawCmdBuffers[i]);
 
-			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
-		}
+		VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
 	}
 
 	void SetupVertexDescriptions()
@@ -723,6 +866,12 @@ public:
 	{
 		__super::PrepareFrame();
 
+		// The acquired image's command buffer is no longer in use, so it can be recorded with the draws sorted for the current camera position
+		if (useRenderQueue)
+		{
+			RecordCommandBuffer(currentBuffer);
+		}
+
 		// Command buffer to be sumitted to the queue
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
@@ -781,6 +930,14 @@ public:
 				if (overlay->CheckBox("Attach light to camera", &attachLight)) {
 					UpdateUniformBuffers();
 				}
+				if (overlay->CheckBox("Sorted render queue", &useRenderQueue)) {
+					BuildCommandBuffers();
+				}
+				if (useRenderQueue) {
+					overlay->Text("Pipeline binds: %u (%u avoided)", renderQueue.stats.pipelineBinds, renderQueue.stats.pipelineBindsAvoided);
+					overlay->Text("Set binds: %u (%u avoided)", renderQueue.stats.descriptorSetBinds, renderQueue.stats.descriptorSetBindsAvoided);
+					overlay->Text("Push constants: %u (%u avoided)", renderQueue.stats.pushConstantUpdates, renderQueue.stats.pushConstantUpdatesAvoided);
+				}
 				if (overlay->CheckBox("Render single part", &scene->renderSingleScenePart)) {
 					BuildCommandBuffers();
 				}
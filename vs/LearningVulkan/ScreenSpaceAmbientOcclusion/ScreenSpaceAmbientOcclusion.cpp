@@ -517,6 +517,9 @@ public:
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			// GPU times of the passes are displayed in the overlay and written to the benchmark results
+			gpuProfiler.BeginFrame(drawCmdBuffers[i], i);
+
 			/*
 				Offscreen SSAO generation
 			*/
@@ -540,6 +543,8 @@ public:
 					First pass: Fill G-Buffer components (positions+depth, normals, albedo) using MRT
 				*/
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "G-Buffer");
+
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				VkViewport viewport = vks::initializers::Viewport((float)frameBuffers.offscreen.width, (float)frameBuffers.offscreen.height, 0.0f, 1.0f);
@@ -557,6 +562,8 @@ public:
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
+
 				/*
 					Second pass: SSAO generation
 				*/
@@ -571,6 +578,8 @@ public:
 				renderPassBeginInfo.clearValueCount = 2;
 				renderPassBeginInfo.pClearValues = clearValues.data();
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "SSAO");
+
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				viewport = vks::initializers::Viewport((float)frameBuffers.ssao.width, (float)frameBuffers.ssao.height, 0.0f, 1.0f);
@@ -584,6 +593,8 @@ public:
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
+
 				/*
 					Third pass: SSAO blur
 				*/
@@ -593,6 +604,8 @@ public:
 				renderPassBeginInfo.renderArea.extent.width = frameBuffers.ssaoBlur.width;
 				renderPassBeginInfo.renderArea.extent.height = frameBuffers.ssaoBlur.height;
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "SSAO blur");
+
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 				viewport = vks::initializers::Viewport((float)frameBuffers.ssaoBlur.width, (float)frameBuffers.ssaoBlur.height, 0.0f, 1.0f);
@@ -605,6 +618,8 @@ public:
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
+
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
 			}
 
 			/*
@@ -638,8 +653,10 @@ public:
 				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.composition, 0, 1, &descriptorSets.composition, 0, NULL);
 
 				// Final composition pass
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "Composition");
 				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.composition);
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
 
 				DrawUI(drawCmdBuffers[i]);
 
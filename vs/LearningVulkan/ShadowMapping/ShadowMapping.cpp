@@ -311,10 +311,15 @@ public:
 		{
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			// GPU times of the passes are displayed in the overlay and written to the benchmark results
+			gpuProfiler.BeginFrame(drawCmdBuffers[i], i);
+
 			/*
 				First render pass: Generate shadow map by rendering the scene from light's POV
 			*/
 			{
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "Shadow map");
+
 				clearValues[0].depthStencil = { 1.0f, 0 };
 
 				VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::RenderPassBeginInfo();
@@ -349,6 +354,8 @@ public:
 				vkCmdDrawIndexed(drawCmdBuffers[i], scenes[sceneIndex].indexCount, 1, 0, 0, 0);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
+
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
 			}
 
 			/*
@@ -373,6 +380,8 @@ public:
 
 				vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
+				gpuProfiler.BeginScope(drawCmdBuffers[i], "Scene");
+
 				viewport = vks::initializers::Viewport((float)width, (float)height, 0.0f, 1.0f);
 				vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
 
@@ -396,6 +405,8 @@ public:
 				vkCmdBindIndexBuffer(drawCmdBuffers[i], scenes[sceneIndex].indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 				vkCmdDrawIndexed(drawCmdBuffers[i], scenes[sceneIndex].indexCount, 1, 0, 0, 0);
 
+				gpuProfiler.EndScope(drawCmdBuffers[i]);
+
 				DrawUI(drawCmdBuffers[i]);
 
 				vkCmdEndRenderPass(drawCmdBuffers[i]);
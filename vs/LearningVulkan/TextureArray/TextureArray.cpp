@@ -519,16 +519,13 @@ public:
 			uboVS.instance[i].arrayIndex.x = (float)i;
 		}
 
+		// Map persistent
+		VK_CHECK_RESULT(uniformBufferVS.Map());
+
 		// Update instanced part of the uniform buffer
-		uint8_t* pData;
 		uint32_t dataOffset = sizeof(uboVS.matrices);
 		uint32_t dataSize = layerCount * sizeof(UboInstanceData);
-		VK_CHECK_RESULT(vkMapMemory(device, uniformBufferVS.memory, dataOffset, dataSize, 0, (void**)&pData));
-		memcpy(pData, uboVS.instance, dataSize);
-		vkUnmapMemory(device, uniformBufferVS.memory);
-
-		// Map persistent
-		VK_CHECK_RESULT(uniformBufferVS.Map());
+		memcpy(static_cast<uint8_t*>(uniformBufferVS.mapped) + dataOffset, uboVS.instance, dataSize);
 
 		UpdateUniformBuffersCamera();
 	}
@@ -0,0 +1,399 @@
+#pragma once
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <float.h>
+#include <stdint.h>
+#include <assert.h>
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+
+namespace vks
+{
+	/** @brief Axis aligned bounding box */
+	struct AABB
+	{
+		glm::vec3 min = glm::vec3(FLT_MAX);
+		glm::vec3 max = glm::vec3(-FLT_MAX);
+
+		void Grow(const glm::vec3& point)
+		{
+			min = glm::min(min, point);
+			max = glm::max(max, point);
+		}
+
+		void Grow(const AABB& other)
+		{
+			min = glm::min(min, other.min);
+			max = glm::max(max, other.max);
+		}
+
+		glm::vec3 Center() const
+		{
+			return (min + max) * 0.5f;
+		}
+
+		// Half of the surface area, which is all the SAH needs
+		float HalfArea() const
+		{
+			glm::vec3 e = max - min;
+			return e.x * e.y + e.y * e.z + e.z * e.x;
+		}
+	};
+
+	/**
+	* Bounding volume hierarchy over a set of instance bounding boxes
+	*
+	* Built top-down with a binned surface area heuristic into a flat array of 32 byte nodes in depth first order,
+	* so the left child of a node directly follows it and every subtree covers a contiguous range of instances.
+	* Callers should reorder their instance data by GetInstanceOrder() once after building, the ranges returned by Cull()
+	* can then be used as firstInstance / instanceCount of (indirect) draws.
+	* Moving instances are handled by Update() + Refit(), which only touch the changed leaves and their ancestors.
+	*/
+	class BVH
+	{
+	public:
+		/** @brief Range of instances in BVH order */
+		struct Range
+		{
+			uint32_t first;
+			uint32_t count;
+		};
+
+		struct Node
+		{
+			glm::vec3 min;
+			// First instance for leaves, index of the right child for inner nodes (the left child is the next node)
+			uint32_t offset;
+			glm::vec3 max;
+			// Number of instances for leaves, 0 for inner nodes
+			uint32_t count;
+		};
+		static_assert(sizeof(Node) == 32, "BVH nodes should fit two to a cache line");
+
+	private:
+		static const uint32_t binCount = 16;
+		// Deeper than this the build falls back to median splits, which keeps the traversal stack bounded
+		static const uint32_t maxSahDepth = 32;
+		static const uint32_t maxStackSize = 96;
+
+		std::vector<Node> nodes;
+		// Instance range of every node, only read when a whole subtree is accepted
+		std::vector<Range> subtreeRanges;
+		std::vector<uint32_t> parents;
+		std::vector<uint32_t> instanceOrder;
+		std::vector<uint32_t> instanceLeaf;
+		std::vector<AABB> bounds;
+		std::vector<glm::vec3> centroids;
+		uint32_t maxLeafSize = 4;
+
+		std::vector<uint32_t> dirtyNodes;
+		std::vector<bool> dirtyFlags;
+
+		void SetNodeBounds(uint32_t index, const AABB& box)
+		{
+			nodes[index].min = box.min;
+			nodes[index].max = box.max;
+		}
+
+		AABB GetNodeBounds(uint32_t index) const
+		{
+			AABB box;
+			box.min = nodes[index].min;
+			box.max = nodes[index].max;
+			return box;
+		}
+
+		AABB LeafBounds(uint32_t first, uint32_t count) const
+		{
+			AABB box;
+			for (uint32_t i = first; i < first + count; i++)
+				box.Grow(bounds[instanceOrder[i]]);
+			return box;
+		}
+
+		// Tries to find a binned SAH split, returns false if all centroids fall into the same bin
+		bool FindSahSplit(uint32_t first, uint32_t count, const AABB& centroidBounds, uint32_t& splitAxis, uint32_t& splitBin) const
+		{
+			float bestCost = FLT_MAX;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+				if (extent <= 0.0f)
+					continue;
+
+				AABB binBounds[binCount];
+				uint32_t binCounts[binCount] = {};
+				float scale = binCount / extent;
+				for (uint32_t i = first; i < first + count; i++)
+				{
+					uint32_t instance = instanceOrder[i];
+					uint32_t bin = std::min(binCount - 1, static_cast<uint32_t>((centroids[instance][axis] - centroidBounds.min[axis]) * scale));
+					binBounds[bin].Grow(bounds[instance]);
+					binCounts[bin]++;
+				}
+
+				// Sweep from the right to get the cost of everything right of each split plane
+				float rightCosts[binCount];
+				AABB rightBox;
+				uint32_t rightCount = 0;
+				for (uint32_t bin = binCount - 1; bin > 0; bin--)
+				{
+					rightBox.Grow(binBounds[bin]);
+					rightCount += binCounts[bin];
+					rightCosts[bin] = rightCount > 0 ? rightCount * rightBox.HalfArea() : 0.0f;
+				}
+
+				AABB leftBox;
+				uint32_t leftCount = 0;
+				for (uint32_t bin = 1; bin < binCount; bin++)
+				{
+					leftBox.Grow(binBounds[bin - 1]);
+					leftCount += binCounts[bin - 1];
+					if (leftCount == 0 || leftCount == count)
+						continue;
+					float cost = leftCount * leftBox.HalfArea() + rightCosts[bin];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						splitAxis = axis;
+						splitBin = bin;
+					}
+				}
+			}
+			return bestCost < FLT_MAX;
+		}
+
+		uint32_t BuildNode(uint32_t first, uint32_t count, uint32_t parent, uint32_t depth)
+		{
+			uint32_t index = static_cast<uint32_t>(nodes.size());
+			nodes.emplace_back();
+			subtreeRanges.push_back({ first, count });
+			parents.push_back(parent);
+			SetNodeBounds(index, LeafBounds(first, count));
+
+			if (count <= maxLeafSize)
+			{
+				nodes[index].offset = first;
+				nodes[index].count = count;
+				for (uint32_t i = first; i < first + count; i++)
+					instanceLeaf[instanceOrder[i]] = index;
+				return index;
+			}
+
+			AABB centroidBounds;
+			for (uint32_t i = first; i < first + count; i++)
+				centroidBounds.Grow(centroids[instanceOrder[i]]);
+
+			uint32_t* begin = instanceOrder.data() + first;
+			uint32_t* end = begin + count;
+			uint32_t* middle = nullptr;
+
+			uint32_t axis, bin;
+			if (depth < maxSahDepth && FindSahSplit(first, count, centroidBounds, axis, bin))
+			{
+				float minimum = centroidBounds.min[axis];
+				float scale = binCount / (centroidBounds.max[axis] - minimum);
+				middle = std::partition(begin, end, [&](uint32_t instance)
+					{
+						return std::min(binCount - 1, static_cast<uint32_t>((centroids[instance][axis] - minimum) * scale)) < bin;
+					});
+			}
+			if (middle == nullptr || middle == begin || middle == end)
+			{
+				// No usable SAH split (coincident centroids or too deep), split at the median of the widest axis
+				glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+				axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+				middle = begin + count / 2;
+				std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b)
+					{
+						return centroids[a][axis] < centroids[b][axis];
+					});
+			}
+
+			uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+			BuildNode(first, leftCount, index, depth + 1);
+			uint32_t right = BuildNode(first + leftCount, count - leftCount, index, depth + 1);
+			nodes[index].offset = right;
+			nodes[index].count = 0;
+			return index;
+		}
+
+		static void AddRange(std::vector<Range>& ranges, uint32_t first, uint32_t count)
+		{
+			// Nodes are visited in instance order, so neighbouring visible leaves can be merged
+			if (!ranges.empty() && ranges.back().first + ranges.back().count == first)
+				ranges.back().count += count;
+			else
+				ranges.push_back({ first, count });
+		}
+
+	public:
+		/**
+		* Build the hierarchy from scratch
+		*
+		* @param instanceBounds World space bounding box of each instance
+		* @param leafSize (Optional) Maximum number of instances per leaf
+		*/
+		void Build(const std::vector<AABB>& instanceBounds, uint32_t leafSize = 4)
+		{
+			assert(leafSize > 0);
+			maxLeafSize = leafSize;
+			bounds = instanceBounds;
+			const uint32_t count = static_cast<uint32_t>(bounds.size());
+
+			nodes.clear();
+			subtreeRanges.clear();
+			parents.clear();
+			dirtyNodes.clear();
+			nodes.reserve(2 * count);
+			subtreeRanges.reserve(2 * count);
+			parents.reserve(2 * count);
+
+			instanceOrder.resize(count);
+			std::iota(instanceOrder.begin(), instanceOrder.end(), 0);
+			instanceLeaf.resize(count);
+			centroids.resize(count);
+			for (uint32_t i = 0; i < count; i++)
+				centroids[i] = bounds[i].Center();
+
+			if (count > 0)
+				BuildNode(0, count, UINT32_MAX, 0);
+			dirtyFlags.assign(nodes.size(), false);
+		}
+
+		/** @brief Change the bounding box of an instance, takes effect on the next Refit() */
+		void Update(uint32_t instance, const AABB& instanceBounds)
+		{
+			bounds[instance] = instanceBounds;
+			// Mark the leaf and all of its ancestors, stopping at the first one that has already been marked by another instance
+			for (uint32_t node = instanceLeaf[instance]; node != UINT32_MAX && !dirtyFlags[node]; node = parents[node])
+			{
+				dirtyFlags[node] = true;
+				dirtyNodes.push_back(node);
+			}
+		}
+
+		/**
+		* Refit the bounds of all nodes affected by Update() calls since the last refit
+		*
+		* @note The topology is kept, so the tree quality degrades if instances move far from where they were at build time
+		*/
+		void Refit()
+		{
+			// Children always come after their parents, so refitting in descending order visits them first
+			std::sort(dirtyNodes.begin(), dirtyNodes.end(), std::greater<uint32_t>());
+			for (uint32_t index : dirtyNodes)
+			{
+				const Node& node = nodes[index];
+				if (node.count > 0)
+				{
+					SetNodeBounds(index, LeafBounds(node.offset, node.count));
+				}
+				else
+				{
+					AABB box = GetNodeBounds(index + 1);
+					box.Grow(GetNodeBounds(node.offset));
+					SetNodeBounds(index, box);
+				}
+				dirtyFlags[index] = false;
+			}
+			dirtyNodes.clear();
+		}
+
+		/**
+		* Cull the hierarchy against a frustum
+		*
+		* Planes a node is completely in front of aren't tested for its children, and subtrees that are completely
+		* inside the frustum are accepted as a whole without visiting their nodes
+		*
+		* @param frustum Frustum to test against
+		* @param visibleRanges Receives the visible instance ranges (in BVH order, ascending and non-adjacent)
+		*
+		* @return Number of visible instances
+		*
+		* @note Per leaf results match Frustum::CheckBox for the leaf bounds
+		*/
+		uint32_t Cull(const Frustum& frustum, std::vector<Range>& visibleRanges) const
+		{
+			visibleRanges.clear();
+			if (nodes.empty())
+				return 0;
+
+			struct StackEntry
+			{
+				uint32_t node;
+				uint32_t planeMask;
+			};
+			StackEntry stack[maxStackSize];
+			uint32_t stackSize = 0;
+			stack[stackSize++] = { 0, (1u << 6) - 1 };
+
+			uint32_t visibleCount = 0;
+			while (stackSize > 0)
+			{
+				StackEntry entry = stack[--stackSize];
+				const Node& node = nodes[entry.node];
+
+				bool outside = false;
+				for (uint32_t i = 0; i < 6; i++)
+				{
+					if ((entry.planeMask & (1u << i)) == 0)
+						continue;
+					const glm::vec4& plane = frustum.planes[i];
+					// p-vertex is the corner furthest along the plane normal, n-vertex the one opposite to it
+					float p = plane.x * (plane.x >= 0.0f ? node.max.x : node.min.x) + plane.y * (plane.y >= 0.0f ? node.max.y : node.min.y) + plane.z * (plane.z >= 0.0f ? node.max.z : node.min.z) + plane.w;
+					if (p < 0.0f)
+					{
+						outside = true;
+						break;
+					}
+					float n = plane.x * (plane.x >= 0.0f ? node.min.x : node.max.x) + plane.y * (plane.y >= 0.0f ? node.min.y : node.max.y) + plane.z * (plane.z >= 0.0f ? node.min.z : node.max.z) + plane.w;
+					if (n >= 0.0f)
+						entry.planeMask &= ~(1u << i);
+				}
+				if (outside)
+					continue;
+
+				if (node.count > 0)
+				{
+					AddRange(visibleRanges, node.offset, node.count);
+					visibleCount += node.count;
+				}
+				else if (entry.planeMask == 0)
+				{
+					const Range& range = subtreeRanges[entry.node];
+					AddRange(visibleRanges, range.first, range.count);
+					visibleCount += range.count;
+				}
+				else
+				{
+					assert(stackSize + 2 <= maxStackSize);
+					// Push the right child first so the left one is popped next and ranges come out in ascending order
+					stack[stackSize++] = { node.offset, entry.planeMask };
+					stack[stackSize++] = { entry.node + 1, entry.planeMask };
+				}
+			}
+			return visibleCount;
+		}
+
+		/** @brief Instance index for each position in BVH order, instance data should be stored in this order */
+		const std::vector<uint32_t>& GetInstanceOrder() const
+		{
+			return instanceOrder;
+		}
+
+		const std::vector<Node>& GetNodes() const
+		{
+			return nodes;
+		}
+
+		/** @brief Bounds of all instances */
+		AABB GetBounds() const
+		{
+			return nodes.empty() ? AABB() : GetNodeBounds(0);
+		}
+	};
+}
@@ -1,8 +1,12 @@
+#pragma once
+
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <numeric>
 #include <limits>
 #include <functional>
+#include <utility>
 #include <chrono>
 #include <iomanip>
 #include <stdio.h>
@@ -30,16 +34,91 @@ namespace vks
         double runtime = 0.0;
         uint32_t frameCount = 0;
 
-        void Run(std::function<void()> renderFunc, VkPhysicalDeviceProperties deviceProperties)
+        // Time from creating the example until the first frame, and the size of the pipeline cache data it started with (0 = cold start)
+        double startupTime = 0.0;
+        size_t pipelineCacheSize = 0;
+        // Number of models loaded from their source files (cold) and from the mesh cache (warm), and the time spent on each
+        uint32_t meshColdLoads = 0;
+        uint32_t meshWarmLoads = 0;
+        double meshColdTime = 0.0;
+        double meshWarmTime = 0.0;
+        // Vertex cache statistics of the meshes optimized by cold loads, empty if none have been
+        std::string meshOptimization;
+        // Levels of detail generated by cold loads
+        uint32_t meshLodLevels = 0;
+        // Meshlets built by cold loads
+        uint32_t meshMeshlets = 0;
+
+        // Results of all runs, used to compare different configurations (e.g. number of frames in flight)
+        struct Result
+        {
+            std::string name;
+            double runtime;
+            uint32_t frameCount;
+            // Average GPU time of each profiled scope (ms)
+            std::vector<std::pair<std::string, double>> gpuTimes;
+        };
+        std::vector<Result> results;
+
+        // Results of CPU-only micro benchmarks run by a sample before the frame benchmark (e.g. job scheduling or culling)
+        struct CpuResult
+        {
+            std::string name;
+            // Processed items (jobs, objects, ...) per second
+            double throughput;
+            // Average and 99th percentile time of a single item or batch (us)
+            double avg;
+            double p99;
+            // Number of results that differ from the reference implementation (or jobs that never ran)
+            uint32_t errors;
+        };
+        std::vector<CpuResult> cpuResults;
+
+        // Called when the warm up phase of a run has finished, e.g. to reset statistics that should only cover the measured frames
+        std::function<void()> measureStarted;
+
+        void Run(std::function<void()> renderFunc, VkPhysicalDeviceProperties deviceProperties, const std::string& name = "")
         {
             active = true;
             this->deviceProperties = deviceProperties;
+            if (results.empty())
+            {
 #if defined(_WIN32)
-            AttachConsole(ATTACH_PARENT_PROCESS);
-            freopen_s(&stream, "COUNT$", "w+", stdout);
-            freopen_s(&stream, "COUNT$", "w+", stderr);
+                AttachConsole(ATTACH_PARENT_PROCESS);
+                freopen_s(&stream, "COUNT$", "w+", stdout);
+                freopen_s(&stream, "COUNT$", "w+", stderr);
 #endif
-            std::cout << std::fixed << std::setprecision(3);
+                std::cout << std::fixed << std::setprecision(3);
+                std::cout << "startup: " << startupTime << " ms (" << (pipelineCacheSize > 0 ? "warm, " + std::to_string(pipelineCacheSize) + " bytes of pipeline cache" : std::string("cold, no pipeline cache")) << ")" << std::endl;
+                if (meshColdLoads + meshWarmLoads > 0)
+                {
+                    std::cout << "meshes : " << meshColdLoads << " cold in " << meshColdTime << " ms, " << meshWarmLoads << " warm (mesh cache) in " << meshWarmTime << " ms" << std::endl;
+                }
+                if (!meshOptimization.empty())
+                {
+                    std::cout << "meshes : optimized " << meshOptimization << std::endl;
+                }
+                if (meshLodLevels > 0)
+                {
+                    std::cout << "meshes : " << meshLodLevels << " levels of detail generated" << std::endl;
+                }
+                if (meshMeshlets > 0)
+                {
+                    std::cout << "meshes : " << meshMeshlets << " meshlets built" << std::endl;
+                }
+                for (auto& cpuResult : cpuResults)
+                {
+                    std::cout << "cpu    : " << cpuResult.name << " " << cpuResult.throughput << " /s, avg " << cpuResult.avg << " us, p99 " << cpuResult.p99 << " us";
+                    if (cpuResult.errors > 0)
+                    {
+                        std::cout << ", " << cpuResult.errors << " errors";
+                    }
+                    std::cout << std::endl;
+                }
+            }
+            runtime = 0.0;
+            frameCount = 0;
+            frameTimes.clear();
 
             double tMeasured = 0.0;
             // Warm up phase to get more stable frame rates
@@ -53,6 +132,11 @@ namespace vks
                 };
             }
 
+            if (measureStarted)
+            {
+                measureStarted();
+            }
+
             // Benchmark phase
             {
                 while (runtime < (duration * 1000.0))
@@ -61,14 +145,52 @@ namespace vks
                     renderFunc();
                     auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
                     tMeasured += tDiff;
+                    runtime += tDiff;
                     frameTimes.emplace_back(tDiff);
                     frameCount++;
                 }
-                std::cout << "Benchmark finished" << std::endl;
+                results.push_back({ name, runtime, frameCount });
+                std::cout << "Benchmark finished" << (name.empty() ? "" : " (" + name + ")") << std::endl;
 				std::cout << "device : " << deviceProperties.deviceName << " (driver version: " << deviceProperties.driverVersion << ")" << std::endl;
 				std::cout << "runtime: " << (runtime / 1000.0) << std::endl;
 				std::cout << "frames : " << frameCount << std::endl;
 				std::cout << "fps    : " << frameCount / (runtime / 1000.0) << std::endl;
+				if (results.size() > 1)
+				{
+					double baseFps = results[0].frameCount / (results[0].runtime / 1000.0);
+					std::cout << "speedup: " << (frameCount / (runtime / 1000.0)) / baseFps << "x (compared to " << results[0].name << ")" << std::endl;
+				}
+            }
+        }
+
+        // Store the result of a CPU micro benchmark, printed and saved along with the frame benchmark
+        void AddCpuResult(const std::string& name, double throughput, double avg, double p99, uint32_t errors = 0)
+        {
+            cpuResults.push_back({ name, throughput, avg, p99, errors });
+        }
+
+        // Average and 99th percentile of a set of times, the times are sorted in place
+        static void GetStats(std::vector<double>& times, double& avg, double& p99)
+        {
+            if (times.empty())
+            {
+                avg = p99 = 0.0;
+                return;
+            }
+            std::sort(times.begin(), times.end());
+            avg = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+            p99 = times[(std::min)(times.size() - 1, (times.size() * 99) / 100)];
+        }
+
+        // Store the GPU times measured during the last run
+        void AddGpuTimes(const std::vector<std::pair<std::string, double>>& gpuTimes)
+        {
+            if (results.empty() || gpuTimes.empty())
+                return;
+            results.back().gpuTimes = gpuTimes;
+            for (auto& gpuTime : gpuTimes)
+            {
+                std::cout << "gpu    : " << gpuTime.first << " " << gpuTime.second << " ms" << std::endl;
             }
         }
 
@@ -79,8 +201,35 @@ namespace vks
             {
 				result << std::fixed << std::setprecision(4);
 
-				result << "device,driverversion,duration (ms),frames,fps" << std::endl;
-				result << deviceProperties.deviceName << "," << deviceProperties.driverVersion << "," << runtime << "," << frameCount << "," << frameCount / (runtime / 1000.0) << std::endl;
+				result << "device,driverversion,run,duration (ms),frames,fps" << std::endl;
+				for (auto& run : results)
+				{
+					result << deviceProperties.deviceName << "," << deviceProperties.driverVersion << "," << run.name << "," << run.runtime << "," << run.frameCount << "," << run.frameCount / (run.runtime / 1000.0) << std::endl;
+				}
+
+				result << std::endl << "startup (ms),pipeline cache (bytes),cold mesh loads,cold mesh load time (ms),warm mesh loads,warm mesh load time (ms)" << std::endl;
+				result << startupTime << "," << pipelineCacheSize << "," << meshColdLoads << "," << meshColdTime << "," << meshWarmLoads << "," << meshWarmTime << std::endl;
+
+				if (std::any_of(results.begin(), results.end(), [](const Result& run) { return !run.gpuTimes.empty(); }))
+				{
+					result << std::endl << "run,gpu scope,gpu time (ms)" << std::endl;
+					for (auto& run : results)
+					{
+						for (auto& gpuTime : run.gpuTimes)
+						{
+							result << run.name << "," << gpuTime.first << "," << gpuTime.second << std::endl;
+						}
+					}
+				}
+
+				if (!cpuResults.empty())
+				{
+					result << std::endl << "cpu benchmark,throughput (1/s),avg (us),p99 (us),errors" << std::endl;
+					for (auto& cpuResult : cpuResults)
+					{
+						result << cpuResult.name << "," << cpuResult.throughput << "," << cpuResult.avg << "," << cpuResult.p99 << "," << cpuResult.errors << std::endl;
+					}
+				}
 
 				if (outputFrameTimes) 
                 {
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+// x86 (32 or 64 bit) target, SSE2 is part of the baseline on x64 and the default for 32 bit builds (/arch:SSE2)
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VKS_CPU_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Marks functions that use intrinsics of an instruction set the project isn't compiled for, they must only be called if the CPU supports it.
+// MSVC allows all intrinsics without /arch, GCC and Clang need the target attribute
+#if defined(VKS_CPU_X86) && !defined(_MSC_VER)
+#define VKS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define VKS_TARGET_AVX __attribute__((target("avx")))
+#else
+#define VKS_TARGET_SSSE3
+#define VKS_TARGET_AVX
+#endif
+
+namespace vks
+{
+	namespace cpu
+	{
+		/** @brief Instruction sets supported by the CPU (and the OS, for the extended AVX registers) */
+		struct Features
+		{
+			bool sse2 = false;
+			bool ssse3 = false;
+			bool sse41 = false;
+			bool avx = false;
+			bool avx2 = false;
+		};
+
+		inline Features DetectFeatures()
+		{
+			Features features;
+#if defined(VKS_CPU_X86)
+			uint32_t regs[4] = {};
+#if defined(_MSC_VER)
+			__cpuid(reinterpret_cast<int*>(regs), 0);
+#else
+			__cpuid(0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+			const uint32_t maxLeaf = regs[0];
+			if (maxLeaf < 1)
+				return features;
+
+#if defined(_MSC_VER)
+			__cpuid(reinterpret_cast<int*>(regs), 1);
+#else
+			__cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+			features.sse2 = (regs[3] & (1u << 26)) != 0;
+			features.ssse3 = (regs[2] & (1u << 9)) != 0;
+			features.sse41 = (regs[2] & (1u << 19)) != 0;
+			// AVX also needs the OS to save the upper halves of the registers (OSXSAVE and XCR0 bits 1 and 2)
+			const bool osxsave = (regs[2] & (1u << 27)) != 0;
+			if (osxsave && (regs[2] & (1u << 28)))
+			{
+#if defined(_MSC_VER)
+				const uint64_t xcr0 = _xgetbv(0);
+#else
+				uint32_t xcr0Low, xcr0High;
+				__asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+				const uint64_t xcr0 = (static_cast<uint64_t>(xcr0High) << 32) | xcr0Low;
+#endif
+				features.avx = (xcr0 & 0x6) == 0x6;
+			}
+
+			if (features.avx && (maxLeaf >= 7))
+			{
+#if defined(_MSC_VER)
+				__cpuidex(reinterpret_cast<int*>(regs), 7, 0);
+#else
+				__cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+				features.avx2 = (regs[1] & (1u << 5)) != 0;
+			}
+#endif
+			return features;
+		}
+
+		/** @brief Instruction sets supported by the CPU, detected once on first use */
+		inline const Features& GetFeatures()
+		{
+			static const Features features = DetectFeatures();
+			return features;
+		}
+	}
+}
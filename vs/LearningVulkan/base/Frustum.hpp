@@ -1,7 +1,21 @@
+#pragma once
+
 #include <array>
 #include <math.h>
+#include <string.h>
+#include <stdint.h>
 #include <glm/glm.hpp>
 
+#include "CpuFeatures.hpp"
+
+// SIMD paths of the batch culling functions. SSE is part of the x86 baseline, the AVX path is compiled along with it
+// and selected at runtime if the CPU supports it, so the project doesn't need to be built with /arch:AVX
+#if defined(VKS_CPU_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define VKS_FRUSTUM_SSE
+#define VKS_FRUSTUM_AVX
+#include <immintrin.h>
+#endif
+
 namespace vks
 {
 	class Frustum
@@ -10,6 +24,28 @@ namespace vks
 		enum side { LEFT = 0, RIGHT = 1, TOP = 2, BOTTOM = 3, BACK = 4, FRONT = 5 };
 		std::array<glm::vec4, 6> planes;
 
+		/** @brief Structure of arrays of bounding spheres for batch culling */
+		struct SphereBatch
+		{
+			const float* x;
+			const float* y;
+			const float* z;
+			const float* radius;
+			uint32_t count;
+		};
+
+		/** @brief Structure of arrays of axis aligned bounding boxes for batch culling */
+		struct AABBBatch
+		{
+			const float* minX;
+			const float* minY;
+			const float* minZ;
+			const float* maxX;
+			const float* maxY;
+			const float* maxZ;
+			uint32_t count;
+		};
+
 		void Update(glm::mat4 matrix)
 		{
 			planes[LEFT].x = matrix[0].w + matrix[0].x;
@@ -60,5 +96,336 @@ namespace vks
 			}
 			return true;
 		}
+
+		/**
+		* Check a sphere against the frustum, testing the plane that rejected it last time first
+		*
+		* @param planeCache Per object index of the last rejecting plane, updated when another plane rejects the sphere
+		*/
+		bool CheckSphere(const glm::vec3& pos, float radius, uint32_t& planeCache) const
+		{
+			return CheckPlanes([&](uint32_t i)
+				{
+					return (planes[i].x * pos.x) + (planes[i].y * pos.y) + (planes[i].z * pos.z) + planes[i].w > -radius;
+				}, planeCache);
+		}
+
+		/** @brief Check an axis aligned box given by its min and max corners using the p-vertex (the corner furthest along each plane normal) */
+		bool CheckBox(const glm::vec3& min, const glm::vec3& max) const
+		{
+			uint32_t planeCache = 0;
+			return CheckBox(min, max, planeCache);
+		}
+
+		/** @brief Check an axis aligned box, testing the plane that rejected it last time first */
+		bool CheckBox(const glm::vec3& min, const glm::vec3& max, uint32_t& planeCache) const
+		{
+			return CheckPlanes([&](uint32_t i)
+				{
+					glm::vec3 p(planes[i].x >= 0.0f ? max.x : min.x, planes[i].y >= 0.0f ? max.y : min.y, planes[i].z >= 0.0f ? max.z : min.z);
+					return (planes[i].x * p.x) + (planes[i].y * p.y) + (planes[i].z * p.z) + planes[i].w >= 0.0f;
+				}, planeCache);
+		}
+
+		/**
+		* Check an oriented box against the frustum
+		*
+		* @param transform Transformation from box space to world space (e.g. the model matrix)
+		* @param min Minimum corner in box space (e.g. vks::Model::dim.min)
+		* @param max Maximum corner in box space (e.g. vks::Model::dim.max)
+		*/
+		bool CheckOrientedBox(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max) const
+		{
+			uint32_t planeCache = 0;
+			return CheckOrientedBox(transform, min, max, planeCache);
+		}
+
+		/** @brief Check an oriented box, testing the plane that rejected it last time first */
+		bool CheckOrientedBox(const glm::mat4& transform, const glm::vec3& min, const glm::vec3& max, uint32_t& planeCache) const
+		{
+			// Box center and half axes in world space, the axes carry the extents (and any scaling of the transform)
+			glm::vec3 center = glm::vec3(transform * glm::vec4((min + max) * 0.5f, 1.0f));
+			glm::vec3 extents = (max - min) * 0.5f;
+			glm::vec3 axisX = glm::vec3(transform[0]) * extents.x;
+			glm::vec3 axisY = glm::vec3(transform[1]) * extents.y;
+			glm::vec3 axisZ = glm::vec3(transform[2]) * extents.z;
+			return CheckPlanes([&](uint32_t i)
+				{
+					glm::vec3 normal = glm::vec3(planes[i]);
+					// Projected radius of the box onto the plane normal
+					float radius = fabsf(glm::dot(normal, axisX)) + fabsf(glm::dot(normal, axisY)) + fabsf(glm::dot(normal, axisZ));
+					return glm::dot(normal, center) + planes[i].w > -radius;
+				}, planeCache);
+		}
+
+		/** @brief Instruction sets of the batch culling functions */
+		enum class SimdPath { Scalar, SSE, AVX };
+
+		/** @brief Fastest batch culling path supported by the build and the CPU, used unless another path is requested */
+		static SimdPath BestSimdPath()
+		{
+#if defined(VKS_FRUSTUM_AVX)
+			if (cpu::GetFeatures().avx)
+				return SimdPath::AVX;
+#endif
+#if defined(VKS_FRUSTUM_SSE)
+			return SimdPath::SSE;
+#else
+			return SimdPath::Scalar;
+#endif
+		}
+
+		/**
+		* Cull a batch of bounding spheres against the frustum using SIMD (with a scalar fallback)
+		*
+		* @param spheres Spheres to test
+		* @param visibleMask (Optional) Receives one bit per sphere (bit i % 32 of word i / 32), must hold (count + 31) / 32 words
+		* @param visibleIndices (Optional) Receives the indices of all visible spheres in ascending order, must hold count elements
+		*
+		* @return Number of visible spheres
+		*
+		* @note Results match CheckSphere exactly
+		*/
+		uint32_t CullSpheres(const SphereBatch& spheres, uint32_t* visibleMask, uint32_t* visibleIndices = nullptr) const
+		{
+			return CullSpheres(spheres, visibleMask, visibleIndices, BestSimdPath());
+		}
+
+		/** @brief Cull a batch of bounding spheres with the given path, which must not be faster than BestSimdPath (e.g. to compare the paths) */
+		uint32_t CullSpheres(const SphereBatch& spheres, uint32_t* visibleMask, uint32_t* visibleIndices, SimdPath path) const
+		{
+			if (visibleMask)
+				memset(visibleMask, 0, ((spheres.count + 31) / 32) * sizeof(uint32_t));
+
+			uint32_t visibleCount = 0;
+			uint32_t i = 0;
+#if defined(VKS_FRUSTUM_AVX)
+			if (path == SimdPath::AVX)
+				i = CullSpheresAVX(spheres, visibleMask, visibleIndices, visibleCount);
+#endif
+#if defined(VKS_FRUSTUM_SSE)
+			if (path == SimdPath::SSE)
+				i = CullSpheresSSE(spheres, visibleMask, visibleIndices, visibleCount);
+#endif
+			// Scalar path for the remaining spheres (or all of them if no SIMD instruction set is available)
+			for (; i < spheres.count; i++)
+			{
+				bool visible = true;
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					if ((planes[p].x * spheres.x[i]) + (planes[p].y * spheres.y[i]) + (planes[p].z * spheres.z[i]) + planes[p].w <= -spheres.radius[i])
+					{
+						visible = false;
+						break;
+					}
+				}
+				WriteVisibility(visible ? 1u : 0u, 1, i, visibleMask, visibleIndices, visibleCount);
+			}
+			return visibleCount;
+		}
+
+		/**
+		* Cull a batch of axis aligned bounding boxes against the frustum using SIMD (with a scalar fallback)
+		*
+		* A box is rejected if its corner furthest along the plane normal (p-vertex) lies behind any plane
+		*
+		* @param boxes Boxes to test
+		* @param visibleMask (Optional) Receives one bit per box (bit i % 32 of word i / 32), must hold (count + 31) / 32 words
+		* @param visibleIndices (Optional) Receives the indices of all visible boxes in ascending order, must hold count elements
+		*
+		* @return Number of visible boxes
+		*
+		* @note Results match CheckBox exactly for finite bounds
+		*/
+		uint32_t CullAABBs(const AABBBatch& boxes, uint32_t* visibleMask, uint32_t* visibleIndices = nullptr) const
+		{
+			return CullAABBs(boxes, visibleMask, visibleIndices, BestSimdPath());
+		}
+
+		/** @brief Cull a batch of axis aligned bounding boxes with the given path, which must not be faster than BestSimdPath (e.g. to compare the paths) */
+		uint32_t CullAABBs(const AABBBatch& boxes, uint32_t* visibleMask, uint32_t* visibleIndices, SimdPath path) const
+		{
+			if (visibleMask)
+				memset(visibleMask, 0, ((boxes.count + 31) / 32) * sizeof(uint32_t));
+
+			// The p-vertex only depends on the sign of the plane normal, so select the source arrays once per plane
+			PVertexArrays pv;
+			for (uint32_t p = 0; p < 6; p++)
+			{
+				pv.x[p] = planes[p].x >= 0.0f ? boxes.maxX : boxes.minX;
+				pv.y[p] = planes[p].y >= 0.0f ? boxes.maxY : boxes.minY;
+				pv.z[p] = planes[p].z >= 0.0f ? boxes.maxZ : boxes.minZ;
+			}
+
+			uint32_t visibleCount = 0;
+			uint32_t i = 0;
+#if defined(VKS_FRUSTUM_AVX)
+			if (path == SimdPath::AVX)
+				i = CullAABBsAVX(pv, boxes.count, visibleMask, visibleIndices, visibleCount);
+#endif
+#if defined(VKS_FRUSTUM_SSE)
+			if (path == SimdPath::SSE)
+				i = CullAABBsSSE(pv, boxes.count, visibleMask, visibleIndices, visibleCount);
+#endif
+			for (; i < boxes.count; i++)
+			{
+				bool visible = true;
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					if ((planes[p].x * pv.x[p][i]) + (planes[p].y * pv.y[p][i]) + (planes[p].z * pv.z[p][i]) + planes[p].w < 0.0f)
+					{
+						visible = false;
+						break;
+					}
+				}
+				WriteVisibility(visible ? 1u : 0u, 1, i, visibleMask, visibleIndices, visibleCount);
+			}
+			return visibleCount;
+		}
+
+	private:
+		// Source arrays of the p-vertex coordinates for each plane
+		struct PVertexArrays
+		{
+			const float* x[6];
+			const float* y[6];
+			const float* z[6];
+		};
+
+		// The SIMD functions process all complete groups of 4 (SSE) or 8 (AVX) elements and return the index of the first remaining one
+#if defined(VKS_FRUSTUM_AVX)
+		VKS_TARGET_AVX uint32_t CullSpheresAVX(const SphereBatch& spheres, uint32_t* visibleMask, uint32_t* visibleIndices, uint32_t& visibleCount) const
+		{
+			uint32_t i = 0;
+			for (; i + 8 <= spheres.count; i += 8)
+			{
+				__m256 x = _mm256_loadu_ps(spheres.x + i);
+				__m256 y = _mm256_loadu_ps(spheres.y + i);
+				__m256 z = _mm256_loadu_ps(spheres.z + i);
+				__m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+				__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+						_mm256_mul_ps(_mm256_set1_ps(planes[p].x), x),
+						_mm256_mul_ps(_mm256_set1_ps(planes[p].y), y)),
+						_mm256_mul_ps(_mm256_set1_ps(planes[p].z), z)),
+						_mm256_set1_ps(planes[p].w));
+					visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, negRadius, _CMP_NLE_UQ));
+				}
+				WriteVisibility(static_cast<uint32_t>(_mm256_movemask_ps(visible)), 8, i, visibleMask, visibleIndices, visibleCount);
+			}
+			// Avoid the transition penalty when the caller continues with SSE code
+			_mm256_zeroupper();
+			return i;
+		}
+
+		VKS_TARGET_AVX uint32_t CullAABBsAVX(const PVertexArrays& pv, uint32_t count, uint32_t* visibleMask, uint32_t* visibleIndices, uint32_t& visibleCount) const
+		{
+			uint32_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+						_mm256_mul_ps(_mm256_set1_ps(planes[p].x), _mm256_loadu_ps(pv.x[p] + i)),
+						_mm256_mul_ps(_mm256_set1_ps(planes[p].y), _mm256_loadu_ps(pv.y[p] + i))),
+						_mm256_mul_ps(_mm256_set1_ps(planes[p].z), _mm256_loadu_ps(pv.z[p] + i))),
+						_mm256_set1_ps(planes[p].w));
+					visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_NLT_UQ));
+				}
+				WriteVisibility(static_cast<uint32_t>(_mm256_movemask_ps(visible)), 8, i, visibleMask, visibleIndices, visibleCount);
+			}
+			_mm256_zeroupper();
+			return i;
+		}
+#endif
+
+#if defined(VKS_FRUSTUM_SSE)
+		uint32_t CullSpheresSSE(const SphereBatch& spheres, uint32_t* visibleMask, uint32_t* visibleIndices, uint32_t& visibleCount) const
+		{
+			uint32_t i = 0;
+			for (; i + 4 <= spheres.count; i += 4)
+			{
+				__m128 x = _mm_loadu_ps(spheres.x + i);
+				__m128 y = _mm_loadu_ps(spheres.y + i);
+				__m128 z = _mm_loadu_ps(spheres.z + i);
+				__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+				__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(_mm_set1_ps(planes[p].x), x),
+						_mm_mul_ps(_mm_set1_ps(planes[p].y), y)),
+						_mm_mul_ps(_mm_set1_ps(planes[p].z), z)),
+						_mm_set1_ps(planes[p].w));
+					visible = _mm_and_ps(visible, _mm_cmpnle_ps(d, negRadius));
+				}
+				WriteVisibility(static_cast<uint32_t>(_mm_movemask_ps(visible)), 4, i, visibleMask, visibleIndices, visibleCount);
+			}
+			return i;
+		}
+
+		uint32_t CullAABBsSSE(const PVertexArrays& pv, uint32_t count, uint32_t* visibleMask, uint32_t* visibleIndices, uint32_t& visibleCount) const
+		{
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+				for (uint32_t p = 0; p < 6; p++)
+				{
+					__m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(_mm_set1_ps(planes[p].x), _mm_loadu_ps(pv.x[p] + i)),
+						_mm_mul_ps(_mm_set1_ps(planes[p].y), _mm_loadu_ps(pv.y[p] + i))),
+						_mm_mul_ps(_mm_set1_ps(planes[p].z), _mm_loadu_ps(pv.z[p] + i))),
+						_mm_set1_ps(planes[p].w));
+					visible = _mm_and_ps(visible, _mm_cmpnlt_ps(d, _mm_setzero_ps()));
+				}
+				WriteVisibility(static_cast<uint32_t>(_mm_movemask_ps(visible)), 4, i, visibleMask, visibleIndices, visibleCount);
+			}
+			return i;
+		}
+#endif
+
+		// Runs the per plane test starting with the cached plane, which objects that didn't move are likely to fail again
+		template<typename PlaneTest>
+		bool CheckPlanes(PlaneTest inside, uint32_t& planeCache) const
+		{
+			if (planeCache >= planes.size())
+				planeCache = 0;
+			if (!inside(planeCache))
+				return false;
+			for (uint32_t i = 0; i < planes.size(); i++)
+			{
+				if (i != planeCache && !inside(i))
+				{
+					planeCache = i;
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Stores the visibility bits of a group of consecutive elements starting at index first
+		static void WriteVisibility(uint32_t bits, uint32_t groupSize, uint32_t first, uint32_t* visibleMask, uint32_t* visibleIndices, uint32_t& visibleCount)
+		{
+			if (visibleMask)
+				visibleMask[first >> 5] |= bits << (first & 31);
+			if (visibleIndices)
+			{
+				// Branchless compaction, the index is always written but only kept if the element is visible
+				for (uint32_t j = 0; j < groupSize; j++)
+				{
+					visibleIndices[visibleCount] = first + j;
+					visibleCount += (bits >> j) & 1;
+				}
+			}
+			else
+			{
+				for (uint32_t j = 0; j < groupSize; j++)
+					visibleCount += (bits >> j) & 1;
+			}
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <stdint.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Benchmark.hpp"
+#include "Frustum.hpp"
+
+namespace vks
+{
+	/**
+	* CPU-only exactness check and timing of the batch culling paths of vks::Frustum
+	*
+	* Culls random bounding spheres and boxes scattered around a perspective frustum (so some are inside, some outside and
+	* some intersect a plane) with every path supported by the CPU. Each path's visibility mask and index list is compared
+	* with the per object CheckSphere and CheckBox results, mismatches are reported as errors of the path's result.
+	*/
+	class FrustumBenchmark
+	{
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct
+		{
+			std::vector<float> x, y, z, radius;
+		} spheres;
+		struct
+		{
+			std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+		} boxes;
+		std::vector<bool> referenceSpheres;
+		std::vector<bool> referenceBoxes;
+
+		static const char* PathName(Frustum::SimdPath path)
+		{
+			switch (path)
+			{
+			case Frustum::SimdPath::SSE:
+				return "SSE";
+			case Frustum::SimdPath::AVX:
+				return "AVX";
+			default:
+				return "scalar";
+			}
+		}
+
+		// Number of objects whose bit or index list entry differ from the reference
+		static uint32_t CountMismatches(const std::vector<bool>& reference, const std::vector<uint32_t>& mask, const std::vector<uint32_t>& indices, uint32_t visibleCount)
+		{
+			uint32_t mismatches = 0;
+			uint32_t next = 0;
+			for (uint32_t i = 0; i < reference.size(); i++)
+			{
+				const bool maskVisible = (mask[i >> 5] >> (i & 31)) & 1;
+				const bool listed = (next < visibleCount) && (indices[next] == i);
+				if (listed)
+					next++;
+				if ((maskVisible != reference[i]) || (listed != reference[i]))
+					mismatches++;
+			}
+			return mismatches;
+		}
+
+		// Times iterations calls of cull (returning the visible count) and adds the result, checked against the reference
+		template<typename Cull>
+		void Measure(const std::string& name, const std::vector<bool>& reference, Cull cull, Benchmark& benchmark)
+		{
+			const uint32_t count = static_cast<uint32_t>(reference.size());
+			std::vector<uint32_t> mask((count + 31) / 32);
+			std::vector<uint32_t> indices(count);
+			std::vector<double> times(iterations);
+			uint32_t visibleCount = 0;
+			double runtime = 0.0;
+			for (uint32_t i = 0; i < iterations; i++)
+			{
+				auto tStart = Clock::now();
+				visibleCount = cull(mask.data(), indices.data());
+				auto tDiff = std::chrono::duration<double, std::micro>(Clock::now() - tStart).count();
+				times[i] = tDiff;
+				runtime += tDiff;
+			}
+			const uint32_t errors = CountMismatches(reference, mask, indices, visibleCount);
+			double avg, p99;
+			Benchmark::GetStats(times, avg, p99);
+			benchmark.AddCpuResult(name, (static_cast<double>(count) * iterations) / (runtime / 1000000.0), avg, p99, errors);
+		}
+
+	public:
+		/** @brief Number of spheres and boxes culled per batch */
+		uint32_t objectCount = 65536;
+		/** @brief Number of timed batches per path */
+		uint32_t iterations = 200;
+
+		/** @brief Runs the check and timing and adds a result per primitive type and path to the benchmark (batch times in us) */
+		void Run(Benchmark& benchmark)
+		{
+			Frustum frustum;
+			glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 256.0f);
+			glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.3f, 0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			frustum.Update(projection * view);
+
+			std::default_random_engine rndEngine(0);
+			std::uniform_real_distribution<float> rndPos(-300.0f, 300.0f);
+			std::uniform_real_distribution<float> rndSize(0.1f, 20.0f);
+			spheres.x.resize(objectCount);
+			spheres.y.resize(objectCount);
+			spheres.z.resize(objectCount);
+			spheres.radius.resize(objectCount);
+			boxes.minX.resize(objectCount);
+			boxes.minY.resize(objectCount);
+			boxes.minZ.resize(objectCount);
+			boxes.maxX.resize(objectCount);
+			boxes.maxY.resize(objectCount);
+			boxes.maxZ.resize(objectCount);
+			referenceSpheres.resize(objectCount);
+			referenceBoxes.resize(objectCount);
+			for (uint32_t i = 0; i < objectCount; i++)
+			{
+				glm::vec3 center(rndPos(rndEngine), rndPos(rndEngine), rndPos(rndEngine));
+				glm::vec3 extents(rndSize(rndEngine), rndSize(rndEngine), rndSize(rndEngine));
+				spheres.x[i] = center.x;
+				spheres.y[i] = center.y;
+				spheres.z[i] = center.z;
+				spheres.radius[i] = extents.x;
+				boxes.minX[i] = center.x - extents.x;
+				boxes.minY[i] = center.y - extents.y;
+				boxes.minZ[i] = center.z - extents.z;
+				boxes.maxX[i] = center.x + extents.x;
+				boxes.maxY[i] = center.y + extents.y;
+				boxes.maxZ[i] = center.z + extents.z;
+			}
+
+			// Reference results and timing of the per object functions
+			Measure("cull spheres CheckSphere", referenceSpheres, [&](uint32_t* mask, uint32_t* indices)
+				{
+					uint32_t visibleCount = 0;
+					for (uint32_t i = 0; i < objectCount; i++)
+					{
+						const bool visible = frustum.CheckSphere(glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]);
+						referenceSpheres[i] = visible;
+						if (visible)
+						{
+							mask[i >> 5] |= 1u << (i & 31);
+							indices[visibleCount++] = i;
+						}
+					}
+					return visibleCount;
+				}, benchmark);
+			Measure("cull boxes CheckBox", referenceBoxes, [&](uint32_t* mask, uint32_t* indices)
+				{
+					uint32_t visibleCount = 0;
+					for (uint32_t i = 0; i < objectCount; i++)
+					{
+						const bool visible = frustum.CheckBox(glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]));
+						referenceBoxes[i] = visible;
+						if (visible)
+						{
+							mask[i >> 5] |= 1u << (i & 31);
+							indices[visibleCount++] = i;
+						}
+					}
+					return visibleCount;
+				}, benchmark);
+
+			const Frustum::SphereBatch sphereBatch = { spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data(), objectCount };
+			const Frustum::AABBBatch boxBatch = { boxes.minX.data(), boxes.minY.data(), boxes.minZ.data(), boxes.maxX.data(), boxes.maxY.data(), boxes.maxZ.data(), objectCount };
+			const Frustum::SimdPath bestPath = Frustum::BestSimdPath();
+			for (Frustum::SimdPath path : { Frustum::SimdPath::Scalar, Frustum::SimdPath::SSE, Frustum::SimdPath::AVX })
+			{
+				if (path > bestPath)
+					break;
+				Measure(std::string("cull spheres ") + PathName(path), referenceSpheres, [&](uint32_t* mask, uint32_t* indices)
+					{
+						return frustum.CullSpheres(sphereBatch, mask, indices, path);
+					}, benchmark);
+				Measure(std::string("cull boxes ") + PathName(path), referenceBoxes, [&](uint32_t* mask, uint32_t* indices)
+					{
+						return frustum.CullAABBs(boxBatch, mask, indices, path);
+					}, benchmark);
+			}
+		}
+	};
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <assert.h>
+
+namespace vks
+{
+	/** @brief Number of heap allocations done while submitting jobs (oversized captures and job arena overflows), stays constant in steady state */
+	inline std::atomic<uint64_t>& JobHeapAllocations()
+	{
+		static std::atomic<uint64_t> count{ 0 };
+		return count;
+	}
+
+	/**
+	* Move-only void() callable with fixed size inline storage
+	*
+	* Replaces std::function for jobs so that submitting a job doesn't allocate.
+	* Callables that don't fit into the inline storage are moved to the heap, which is counted by JobHeapAllocations()
+	*/
+	template<size_t Capacity = 96>
+	class JobFunction
+	{
+	private:
+		struct Operations
+		{
+			void (*invoke)(void* storage);
+			void (*destroy)(void* storage);
+			void (*move)(void* dst, void* src);
+		};
+
+		template<typename F>
+		static const Operations* InlineOperations()
+		{
+			static const Operations operations = {
+				[](void* storage) { (*static_cast<F*>(storage))(); },
+				[](void* storage) { static_cast<F*>(storage)->~F(); },
+				[](void* dst, void* src) { new (dst) F(std::move(*static_cast<F*>(src))); static_cast<F*>(src)->~F(); }
+			};
+			return &operations;
+		}
+
+		template<typename F>
+		static const Operations* HeapOperations()
+		{
+			static const Operations operations = {
+				[](void* storage) { (**static_cast<F**>(storage))(); },
+				[](void* storage) { delete *static_cast<F**>(storage); },
+				[](void* dst, void* src) { *static_cast<F**>(dst) = *static_cast<F**>(src); }
+			};
+			return &operations;
+		}
+
+		alignas(std::max_align_t) unsigned char storage[Capacity];
+		const Operations* operations = nullptr;
+
+	public:
+		JobFunction() = default;
+
+		template<typename Function, typename F = typename std::decay<Function>::type, typename = typename std::enable_if<!std::is_same<F, JobFunction>::value>::type>
+		JobFunction(Function&& function)
+		{
+			if constexpr (sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t))
+			{
+				new (storage) F(std::forward<Function>(function));
+				operations = InlineOperations<F>();
+			}
+			else
+			{
+				*reinterpret_cast<F**>(storage) = new F(std::forward<Function>(function));
+				operations = HeapOperations<F>();
+				JobHeapAllocations().fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		JobFunction(JobFunction&& other)
+		{
+			*this = std::move(other);
+		}
+
+		JobFunction& operator=(JobFunction&& other)
+		{
+			if (this != &other)
+			{
+				Reset();
+				if (other.operations)
+				{
+					other.operations->move(storage, other.storage);
+					operations = other.operations;
+					other.operations = nullptr;
+				}
+			}
+			return *this;
+		}
+
+		JobFunction(const JobFunction&) = delete;
+		JobFunction& operator=(const JobFunction&) = delete;
+
+		~JobFunction()
+		{
+			Reset();
+		}
+
+		// Destroys the stored callable
+		void Reset()
+		{
+			if (operations)
+			{
+				operations->destroy(storage);
+				operations = nullptr;
+			}
+		}
+
+		explicit operator bool() const
+		{
+			return operations != nullptr;
+		}
+
+		void operator()()
+		{
+			assert(operations);
+			operations->invoke(storage);
+		}
+	};
+}
@@ -0,0 +1,400 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <assert.h>
+
+#include "JobFunction.hpp"
+
+namespace vks
+{
+	/** @brief Counter based fence, incremented for each submitted job and decremented once that job has finished */
+	class JobCounter
+	{
+	private:
+		std::atomic<uint32_t> pending{ 0 };
+
+		friend class JobSystem;
+
+	public:
+		/** @brief Returns true once all jobs associated with this counter have finished */
+		bool Done() const
+		{
+			return pending.load(std::memory_order_acquire) == 0;
+		}
+	};
+
+	/** @brief Fixed capacity Chase-Lev work stealing deque, the owning thread pushes and pops at the bottom, other threads steal from the top */
+	template<typename T>
+	class WorkStealingDeque
+	{
+	private:
+		std::atomic<int64_t> top{ 0 };
+		std::atomic<int64_t> bottom{ 0 };
+		std::unique_ptr<std::atomic<T*>[]> buffer;
+		int64_t mask;
+
+	public:
+		/** @param capacity Maximum number of queued elements (must be a power of two) */
+		WorkStealingDeque(uint32_t capacity = 4096)
+		{
+			assert((capacity & (capacity - 1)) == 0);
+			buffer = std::make_unique<std::atomic<T*>[]>(capacity);
+			mask = static_cast<int64_t>(capacity) - 1;
+		}
+
+		// Owner thread only, returns false if the deque is full
+		bool Push(T* item)
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed);
+			int64_t t = top.load(std::memory_order_acquire);
+			if (b - t > mask)
+				return false;
+			buffer[b & mask].store(item, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Owner thread only, takes the most recently pushed element
+		T* Pop()
+		{
+			int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+
+			if (t > b)
+			{
+				// Deque was empty
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			T* item = buffer[b & mask].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// Last element, race against concurrent steals
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					item = nullptr;
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return item;
+		}
+
+		// Any thread, takes the oldest element
+		T* Steal()
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t b = bottom.load(std::memory_order_acquire);
+
+			if (t >= b)
+				return nullptr;
+
+			T* item = buffer[t & mask].load(std::memory_order_relaxed);
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return item;
+		}
+
+		bool Empty() const
+		{
+			return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+		}
+	};
+
+	/**
+	* Work stealing job system
+	*
+	* Every thread owns a lock-free deque, jobs are pushed to the deque of the submitting thread
+	* and idle threads steal from the others, so imbalanced workloads don't stall on a single thread.
+	* Slot 0 belongs to the thread that called SetThreadCount, which executes jobs while waiting on a counter.
+	* Jobs are taken from a per-frame arena and store their callable inline, so submission doesn't allocate
+	* as long as the arena is reset once per frame (see ResetJobArena).
+	*
+	* @note Jobs may only be submitted from the owning thread or from within other jobs
+	*/
+	class JobSystem
+	{
+	private:
+		struct Job
+		{
+			JobFunction<> function;
+			JobCounter* counter = nullptr;
+			// Set for jobs allocated on the heap after the arena ran out of slots
+			bool heap = false;
+		};
+
+		struct Worker
+		{
+			WorkStealingDeque<Job> deque;
+			std::thread thread;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::thread::id ownerThread;
+
+		// Per-frame job arena, slots are handed out linearly and recycled all at once
+		std::unique_ptr<Job[]> arena;
+		uint32_t arenaSize = 0;
+		std::atomic<uint32_t> arenaUsed{ 0 };
+
+		// Jobs that have been pushed but not yet taken by any thread, used to put idle workers to sleep
+		std::atomic<int32_t> queuedJobs{ 0 };
+		std::atomic<uint32_t> sleepingWorkers{ 0 };
+		std::atomic<bool> destroying{ false };
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		struct ThreadContext
+		{
+			JobSystem* system = nullptr;
+			uint32_t index = 0;
+		};
+		static ThreadContext& LocalContext()
+		{
+			static thread_local ThreadContext context;
+			return context;
+		}
+
+		Job* TakeJob(uint32_t index)
+		{
+			Job* job = workers[index]->deque.Pop();
+			if (!job)
+			{
+				// Own deque is empty, try to steal from the others starting at a random victim
+				static thread_local std::minstd_rand rndEngine(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+				const uint32_t count = static_cast<uint32_t>(workers.size());
+				const uint32_t start = rndEngine() % count;
+				for (uint32_t i = 0; i < count && !job; i++)
+				{
+					uint32_t victim = (start + i) % count;
+					if (victim != index)
+						job = workers[victim]->deque.Steal();
+				}
+			}
+			if (job)
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+
+		template<typename Function>
+		Job* AllocateJob(Function&& function, JobCounter* counter)
+		{
+			Job* job;
+			uint32_t index = arenaUsed.fetch_add(1, std::memory_order_relaxed);
+			if (index < arenaSize)
+			{
+				job = &arena[index];
+			}
+			else
+			{
+				job = new Job();
+				job->heap = true;
+				JobHeapAllocations().fetch_add(1, std::memory_order_relaxed);
+			}
+			job->function = JobFunction<>(std::forward<Function>(function));
+			job->counter = counter;
+			return job;
+		}
+
+		void Execute(Job* job)
+		{
+			JobCounter* counter = job->counter;
+			job->function();
+			// Release the callable before signaling, the arena slot may be recycled as soon as the counter reaches zero
+			job->function.Reset();
+			if (job->heap)
+				delete job;
+			if (counter)
+				counter->pending.fetch_sub(1, std::memory_order_release);
+		}
+
+		void Loop(uint32_t index)
+		{
+			LocalContext() = { this, index };
+			while (true)
+			{
+				Job* job = TakeJob(index);
+				if (job)
+				{
+					Execute(job);
+					continue;
+				}
+
+				// Spin for a short while before going to sleep to keep latency low for bursts of jobs
+				bool found = false;
+				for (uint32_t spin = 0; spin < 64 && !found; spin++)
+				{
+					std::this_thread::yield();
+					found = queuedJobs.load(std::memory_order_relaxed) > 0 || destroying.load(std::memory_order_relaxed);
+				}
+				if (found)
+				{
+					if (destroying.load())
+						break;
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(mutex);
+				sleepingWorkers.fetch_add(1);
+				condition.wait(lock, [this]
+					{
+						return queuedJobs.load() > 0 || destroying.load();
+					}
+				);
+				sleepingWorkers.fetch_sub(1);
+				if (destroying.load())
+					break;
+			}
+		}
+
+		void WakeWorkers(uint32_t count)
+		{
+			if (sleepingWorkers.load() == 0)
+				return;
+			std::lock_guard<std::mutex> lock(mutex);
+			if (count > 1)
+				condition.notify_all();
+			else
+				condition.notify_one();
+		}
+
+		void Shutdown()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				destroying = true;
+				condition.notify_all();
+			}
+			for (auto& worker : workers)
+			{
+				if (worker->thread.joinable())
+					worker->thread.join();
+			}
+			// Run anything that was left in the queues so counters don't stay pending
+			for (auto& worker : workers)
+			{
+				while (Job* job = worker->deque.Steal())
+					Execute(job);
+			}
+			workers.clear();
+			destroying = false;
+			queuedJobs = 0;
+		}
+
+	public:
+		~JobSystem()
+		{
+			Shutdown();
+		}
+
+		/**
+		* Sets the number of worker threads, the calling thread becomes the owner and takes slot 0
+		*
+		* @param count Number of worker threads to spawn in addition to the owning thread
+		* @param maxJobsPerFrame (Optional) Number of job slots in the per-frame arena, jobs beyond that are allocated on the heap
+		*/
+		void SetThreadCount(uint32_t count, uint32_t maxJobsPerFrame = 4096)
+		{
+			Shutdown();
+			arena = std::make_unique<Job[]>(maxJobsPerFrame);
+			arenaSize = maxJobsPerFrame;
+			arenaUsed = 0;
+			ownerThread = std::this_thread::get_id();
+			LocalContext() = { this, 0 };
+			workers.resize(count + 1);
+			for (auto& worker : workers)
+				worker = std::make_unique<Worker>();
+			for (uint32_t i = 1; i <= count; i++)
+				workers[i]->thread = std::thread(&JobSystem::Loop, this, i);
+		}
+
+		/** @brief Number of thread slots including the owning thread */
+		uint32_t ThreadCount() const
+		{
+			return static_cast<uint32_t>(workers.size());
+		}
+
+		/** @brief Index of the calling thread's slot (0 for the owning thread) */
+		uint32_t GetThreadIndex()
+		{
+			ThreadContext& context = LocalContext();
+			if (context.system == this)
+				return context.index;
+			assert(std::this_thread::get_id() == ownerThread);
+			return 0;
+		}
+
+		/** @brief Recycles all slots of the job arena, must only be called once all previously submitted jobs have finished */
+		void ResetJobArena()
+		{
+			assert(queuedJobs.load() == 0);
+			arenaUsed.store(0, std::memory_order_relaxed);
+		}
+
+		/** @brief Adds a job to the calling thread's deque, the counter (if any) is signaled once the job has finished */
+		template<typename Function>
+		void Submit(Function&& function, JobCounter* counter = nullptr)
+		{
+			assert(!workers.empty());
+			Job* job = AllocateJob(std::forward<Function>(function), counter);
+			if (counter)
+				counter->pending.fetch_add(1, std::memory_order_relaxed);
+			if (!workers[GetThreadIndex()]->deque.Push(job))
+			{
+				// Deque is full, run the job in place
+				Execute(job);
+				return;
+			}
+			queuedJobs.fetch_add(1);
+			WakeWorkers(1);
+		}
+
+		/**
+		* Splits [0, count) into chunks of grain elements and submits one job per chunk
+		*
+		* @param count Number of elements to process
+		* @param grain Number of elements processed by a single job
+		* @param function Function called for each element index
+		* @param counter Counter to wait on for completion of all chunks
+		*
+		* @note The function is referenced by the jobs and must stay alive until the counter has been waited on
+		*/
+		template<typename Function>
+		void ParallelFor(uint32_t count, uint32_t grain, const Function& function, JobCounter& counter)
+		{
+			assert(grain > 0);
+			for (uint32_t begin = 0; begin < count; begin += grain)
+			{
+				uint32_t end = std::min(begin + grain, count);
+				Submit([&function, begin, end]
+					{
+						for (uint32_t i = begin; i < end; i++)
+							function(i);
+					}, &counter);
+			}
+		}
+
+		/** @brief Wait until all jobs associated with the counter have finished, the calling thread executes queued jobs in the meantime */
+		void Wait(const JobCounter& counter)
+		{
+			uint32_t index = GetThreadIndex();
+			while (!counter.Done())
+			{
+				Job* job = TakeJob(index);
+				if (job)
+					Execute(job);
+				else
+					std::this_thread::yield();
+			}
+		}
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <stdint.h>
+
+#include "Benchmark.hpp"
+#include "JobSystem.hpp"
+#include "ThreadPool.hpp"
+
+namespace vks
+{
+	/**
+	* CPU-only micro benchmark comparing the enqueue/dequeue performance of the work stealing job system and the thread pool
+	*
+	* Both schedulers run the same batches of small jobs. The throughput covers everything from the first enqueue until all jobs
+	* of a batch have finished, the latency of a job is the time from its enqueue until a thread starts running it.
+	* Jobs are submitted from the calling thread, the thread pool gets them round robin like the statically partitioned
+	* recording of the MultiThreading sample, the job system lets idle workers steal them.
+	*/
+	class JobSystemBenchmark
+	{
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		// Per job latency (us) of all measured batches, jobs that never ran keep a negative value
+		std::vector<double> latencies;
+		// Per job result of the busy work, so it can't be optimized out
+		std::vector<uint32_t> results;
+
+		void RunJob(uint32_t index, Clock::time_point submitTime)
+		{
+			latencies[index] = std::chrono::duration<double, std::micro>(Clock::now() - submitTime).count();
+			uint32_t value = index;
+			for (uint32_t i = 0; i < jobWork; i++)
+			{
+				value = value * 1664525u + 1013904223u;
+			}
+			results[index] = value;
+		}
+
+		// Runs a warm up batch and batchCount measured batches, submitBatch(first) must run the jobs first to first + batchSize - 1 and wait for them
+		template<typename SubmitBatch>
+		void Measure(const std::string& name, SubmitBatch submitBatch, Benchmark& benchmark)
+		{
+			latencies.assign(batchSize, -1.0);
+			results.resize(batchSize);
+			submitBatch(0);
+
+			latencies.assign(batchSize * batchCount, -1.0);
+			results.resize(batchSize * batchCount);
+			double runtime = 0.0;
+			for (uint32_t batch = 0; batch < batchCount; batch++)
+			{
+				auto tStart = Clock::now();
+				submitBatch(batch * batchSize);
+				runtime += std::chrono::duration<double>(Clock::now() - tStart).count();
+			}
+
+			uint32_t lostJobs = 0;
+			for (double latency : latencies)
+			{
+				if (latency < 0.0)
+					lostJobs++;
+			}
+			double avg, p99;
+			Benchmark::GetStats(latencies, avg, p99);
+			benchmark.AddCpuResult(name, latencies.size() / runtime, avg, p99, lostJobs);
+		}
+
+	public:
+		/** @brief Jobs per batch, should not exceed the job system's arena so submitting never allocates */
+		uint32_t batchSize = 4096;
+		/** @brief Number of measured batches */
+		uint32_t batchCount = 64;
+		/** @brief Iterations of busy work per job, 0 only measures the scheduling overhead */
+		uint32_t jobWork = 256;
+
+		/**
+		* Runs the benchmark for both schedulers and adds a "job system" and a "thread pool" result to the benchmark
+		*
+		* @note Must be called from the thread that owns the job system, while neither of the schedulers has any pending work
+		*/
+		void Run(JobSystem& jobSystem, ThreadPool& threadPool, Benchmark& benchmark)
+		{
+			Measure("job system", [&](uint32_t first)
+				{
+					jobSystem.ResetJobArena();
+					JobCounter counter;
+					for (uint32_t i = first; i < first + batchSize; i++)
+					{
+						Clock::time_point submitTime = Clock::now();
+						jobSystem.Submit([this, i, submitTime] { RunJob(i, submitTime); }, &counter);
+					}
+					jobSystem.Wait(counter);
+				}, benchmark);
+
+			Measure("thread pool", [&](uint32_t first)
+				{
+					const uint32_t threadCount = static_cast<uint32_t>(threadPool.threads.size());
+					for (uint32_t i = first; i < first + batchSize; i++)
+					{
+						Clock::time_point submitTime = Clock::now();
+						threadPool.threads[i % threadCount]->AddJob([this, i, submitTime] { RunJob(i, submitTime); });
+					}
+					threadPool.Wait();
+				}, benchmark);
+
+			latencies.clear();
+			latencies.shrink_to_fit();
+			results.clear();
+			results.shrink_to_fit();
+		}
+	};
+}
@@ -0,0 +1,466 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace vks
+{
+	/**
+	* Reordering of indexed triangle lists for better GPU vertex reuse and less overdraw
+	*
+	* All functions work on a single mesh (model part or glTF primitive) whose indices are relative to its first vertex,
+	* OptimizeMesh runs the whole pipeline on a range of a larger vertex and index buffer
+	*/
+	namespace meshopt
+	{
+		/** @brief Size of the simulated post-transform vertex cache (FIFO) */
+		const uint32_t defaultCacheSize = 16;
+
+		/** @brief Post-transform vertex cache efficiency of an index buffer */
+		struct CacheStats
+		{
+			/** @brief Vertex shader invocations (cache misses) */
+			size_t misses = 0;
+			size_t triangles = 0;
+			/** @brief Number of distinct vertices referenced */
+			size_t vertices = 0;
+
+			/** @brief Average cache miss ratio, vertex shader invocations per triangle (0.5 is optimal for large regular meshes, 3 is the worst) */
+			float Acmr() const
+			{
+				return triangles ? float(misses) / float(triangles) : 0.0f;
+			}
+
+			/** @brief Average transform to vertex ratio, vertex shader invocations per vertex (1 is optimal) */
+			float Atvr() const
+			{
+				return vertices ? float(misses) / float(vertices) : 0.0f;
+			}
+
+			void Add(const CacheStats& other)
+			{
+				misses += other.misses;
+				triangles += other.triangles;
+				vertices += other.vertices;
+			}
+		};
+
+		/** @brief Statistics of an optimized mesh (or a sum of meshes) */
+		struct Result
+		{
+			CacheStats before;
+			CacheStats after;
+			size_t verticesBefore = 0;
+			size_t verticesAfter = 0;
+
+			void Add(const Result& other)
+			{
+				before.Add(other.before);
+				after.Add(other.after);
+				verticesBefore += other.verticesBefore;
+				verticesAfter += other.verticesAfter;
+			}
+
+			std::string ToString() const
+			{
+				std::stringstream ss;
+				ss << std::fixed << std::setprecision(3);
+				ss << "ACMR " << before.Acmr() << " -> " << after.Acmr() << ", ATVR " << before.Atvr() << " -> " << after.Atvr();
+				ss << ", vertices " << verticesBefore << " -> " << verticesAfter;
+				return ss.str();
+			}
+		};
+
+		/**
+		* Simulate a FIFO post-transform vertex cache
+		*
+		* @param indices Triangle list indices
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices, all indices must be smaller
+		* @param cacheSize (Optional) Number of cache entries
+		*/
+		inline CacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = defaultCacheSize)
+		{
+			CacheStats stats;
+			stats.triangles = indexCount / 3;
+			// A vertex is in the cache if fewer than cacheSize vertices have been added since it was added itself
+			std::vector<size_t> timestamps(vertexCount, 0);
+			std::vector<bool> used(vertexCount, false);
+			size_t time = cacheSize + 1;
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				uint32_t v = indices[i];
+				if (time - timestamps[v] > cacheSize)
+				{
+					timestamps[v] = time++;
+					stats.misses++;
+				}
+				if (!used[v])
+				{
+					used[v] = true;
+					stats.vertices++;
+				}
+			}
+			return stats;
+		}
+
+		/**
+		* Merge vertices with identical data
+		*
+		* @param vertices Vertex data, compacted in place
+		* @param vertexCount Number of vertices
+		* @param stride Size of a vertex in bytes
+		* @param indices Indices, remapped to the merged vertices
+		* @param indexCount Number of indices
+		* @param baseVertex (Optional) Index of the first vertex, which is subtracted from the indices on input and added again on output
+		*
+		* @return Number of vertices after merging
+		*/
+		inline size_t WeldVertices(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount, uint32_t baseVertex = 0)
+		{
+			uint8_t* data = static_cast<uint8_t*>(vertices);
+			// Open addressing hash table of vertex indices, keyed by the vertex data
+			size_t tableSize = 1;
+			while (tableSize < vertexCount * 2)
+				tableSize *= 2;
+			const uint32_t empty = ~0u;
+			std::vector<uint32_t> table(tableSize, empty);
+			std::vector<uint32_t> remap(vertexCount);
+			size_t uniqueCount = 0;
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				const uint8_t* vertex = data + v * stride;
+				uint64_t hash = 0xcbf29ce484222325ull;
+				for (size_t b = 0; b < stride; b++)
+				{
+					hash ^= vertex[b];
+					hash *= 0x100000001b3ull;
+				}
+				size_t slot = static_cast<size_t>(hash) & (tableSize - 1);
+				while ((table[slot] != empty) && (memcmp(data + static_cast<size_t>(table[slot]) * stride, vertex, stride) != 0))
+				{
+					slot = (slot + 1) & (tableSize - 1);
+				}
+				if (table[slot] == empty)
+				{
+					// First occurence, move it to the end of the unique vertices
+					if (uniqueCount != v)
+						memcpy(data + uniqueCount * stride, vertex, stride);
+					table[slot] = static_cast<uint32_t>(uniqueCount++);
+				}
+				remap[v] = table[slot];
+			}
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				indices[i] = remap[indices[i] - baseVertex] + baseVertex;
+			}
+			return uniqueCount;
+		}
+
+		/**
+		* Reorder triangles for post-transform vertex cache reuse (Tipsify, Sander et al. 2007, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+		*
+		* @param indices Triangle list indices, reordered in place
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices
+		* @param clusters (Optional) Receives the index of the first triangle of each cluster, clusters start wherever the cache has been flushed and can be reordered freely
+		* @param cacheSize (Optional) Number of cache entries to optimize for
+		*/
+		inline void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount, std::vector<uint32_t>* clusters = nullptr, uint32_t cacheSize = defaultCacheSize)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (clusters)
+				clusters->clear();
+			if (triangleCount == 0)
+				return;
+
+			// Vertex to triangle adjacency
+			std::vector<uint32_t> liveTriangles(vertexCount, 0);
+			for (size_t i = 0; i < triangleCount * 3; i++)
+			{
+				liveTriangles[indices[i]]++;
+			}
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+			}
+			std::vector<uint32_t> adjacency(triangleCount * 3);
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t i = 0; i < triangleCount * 3; i++)
+				{
+					adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+			}
+
+			std::vector<uint32_t> output;
+			output.reserve(triangleCount * 3);
+			std::vector<size_t> timestamps(vertexCount, 0);
+			std::vector<bool> emitted(triangleCount, false);
+			std::vector<uint32_t> deadEnd;
+			std::vector<uint32_t> candidates;
+			size_t time = cacheSize + 1;
+			size_t cursor = 0;
+			int64_t fanning = indices[0];
+			bool flushed = true;
+
+			while (fanning >= 0)
+			{
+				if (flushed && clusters)
+					clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+				flushed = false;
+
+				// Emit all remaining triangles around the fanning vertex
+				candidates.clear();
+				for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++)
+				{
+					uint32_t t = adjacency[a];
+					if (emitted[t])
+						continue;
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						uint32_t v = indices[t * 3 + k];
+						output.push_back(v);
+						deadEnd.push_back(v);
+						candidates.push_back(v);
+						liveTriangles[v]--;
+						if (time - timestamps[v] > cacheSize)
+						{
+							timestamps[v] = time++;
+						}
+					}
+					emitted[t] = true;
+				}
+
+				// Next fanning vertex: the candidate that stays in the cache the longest while its remaining triangles are emitted
+				int64_t best = -1;
+				size_t bestPriority = 0;
+				for (uint32_t v : candidates)
+				{
+					if (liveTriangles[v] == 0)
+						continue;
+					size_t priority = 0;
+					if (time - timestamps[v] + 2 * liveTriangles[v] <= cacheSize)
+						priority = time - timestamps[v];
+					if ((best < 0) || (priority > bestPriority))
+					{
+						best = v;
+						bestPriority = priority;
+					}
+				}
+				if (best < 0)
+				{
+					// Dead end, continue with a recently used vertex that still has triangles left
+					while (!deadEnd.empty())
+					{
+						uint32_t v = deadEnd.back();
+						deadEnd.pop_back();
+						if (liveTriangles[v] > 0)
+						{
+							best = v;
+							break;
+						}
+					}
+				}
+				if (best < 0)
+				{
+					// Nothing left nearby, continue with the next vertex in input order, which starts a new cluster
+					while (cursor < vertexCount)
+					{
+						if (liveTriangles[cursor] > 0)
+						{
+							best = static_cast<int64_t>(cursor);
+							break;
+						}
+						cursor++;
+					}
+					flushed = true;
+				}
+				fanning = best;
+			}
+
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		}
+
+		/**
+		* Reorder the clusters of a cache optimized mesh so outward facing clusters are drawn first, which reduces overdraw from most view directions
+		*
+		* The new order is only kept if the cache efficiency doesn't get worse than threshold times the current one
+		*
+		* @param indices Triangle list indices, reordered in place
+		* @param indexCount Number of indices
+		* @param positions Pointer to the position (3 floats) of the first vertex
+		* @param positionStride Distance between the positions of consecutive vertices in bytes
+		* @param vertexCount Number of vertices
+		* @param clusters First triangle of each cluster (see OptimizeVertexCache)
+		* @param threshold (Optional) Maximum allowed ACMR increase (1.05 = 5%)
+		*/
+		inline void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const void* positions, size_t positionStride, size_t vertexCount, const std::vector<uint32_t>& clusters, float threshold = 1.05f)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (clusters.size() < 2)
+				return;
+			auto position = [&](uint32_t v) { return reinterpret_cast<const float*>(static_cast<const uint8_t*>(positions) + v * positionStride); };
+
+			// Area weighted centroid and summed normal of each cluster
+			struct Cluster
+			{
+				uint32_t first;
+				uint32_t count;
+				float centroid[3];
+				float normal[3];
+				float area;
+				float sortKey;
+			};
+			std::vector<Cluster> sorted(clusters.size());
+			float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+			float meshArea = 0.0f;
+			for (size_t c = 0; c < clusters.size(); c++)
+			{
+				Cluster& cluster = sorted[c];
+				cluster = {};
+				cluster.first = clusters[c];
+				cluster.count = static_cast<uint32_t>(((c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount) - clusters[c]);
+				for (uint32_t t = cluster.first; t < cluster.first + cluster.count; t++)
+				{
+					const float* p0 = position(indices[t * 3 + 0]);
+					const float* p1 = position(indices[t * 3 + 1]);
+					const float* p2 = position(indices[t * 3 + 2]);
+					float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+					float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+					float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+					float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (int k = 0; k < 3; k++)
+					{
+						cluster.centroid[k] += (p0[k] + p1[k] + p2[k]) / 3.0f * area;
+						cluster.normal[k] += n[k];
+					}
+					cluster.area += area;
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					meshCentroid[k] += cluster.centroid[k];
+				}
+				meshArea += cluster.area;
+			}
+			if (meshArea <= 0.0f)
+				return;
+			for (int k = 0; k < 3; k++)
+			{
+				meshCentroid[k] /= meshArea;
+			}
+
+			// Clusters facing away from the center of the mesh are likely to occlude the others
+			for (Cluster& cluster : sorted)
+			{
+				float length = sqrtf(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+				cluster.sortKey = 0.0f;
+				if ((cluster.area > 0.0f) && (length > 0.0f))
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						cluster.sortKey += (cluster.centroid[k] / cluster.area - meshCentroid[k]) * cluster.normal[k] / length;
+					}
+				}
+			}
+			std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+			std::vector<uint32_t> reordered;
+			reordered.reserve(triangleCount * 3);
+			for (const Cluster& cluster : sorted)
+			{
+				reordered.insert(reordered.end(), indices + cluster.first * 3, indices + (cluster.first + cluster.count) * 3);
+			}
+
+			float acmr = AnalyzeVertexCache(indices, triangleCount * 3, vertexCount).Acmr();
+			if (AnalyzeVertexCache(reordered.data(), reordered.size(), vertexCount).Acmr() <= acmr * threshold)
+			{
+				memcpy(indices, reordered.data(), reordered.size() * sizeof(uint32_t));
+			}
+		}
+
+		/**
+		* Reorder vertices in the order they're first used by the index buffer, which improves memory locality of vertex fetches
+		*
+		* @param vertices Vertex data, reordered in place
+		* @param vertexCount Number of vertices
+		* @param stride Size of a vertex in bytes
+		* @param indices Indices, remapped to the new vertex order
+		* @param indexCount Number of indices
+		*
+		* @return Number of vertices after reordering, vertices that aren't referenced are removed
+		*/
+		inline size_t OptimizeVertexFetch(void* vertices, size_t vertexCount, size_t stride, uint32_t* indices, size_t indexCount)
+		{
+			uint8_t* data = static_cast<uint8_t*>(vertices);
+			const uint32_t unused = ~0u;
+			std::vector<uint32_t> remap(vertexCount, unused);
+			std::vector<uint8_t> reordered(vertexCount * stride);
+			uint32_t next = 0;
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				uint32_t& target = remap[indices[i]];
+				if (target == unused)
+				{
+					memcpy(reordered.data() + static_cast<size_t>(next) * stride, data + static_cast<size_t>(indices[i]) * stride, stride);
+					target = next++;
+				}
+				indices[i] = target;
+			}
+			memcpy(data, reordered.data(), static_cast<size_t>(next) * stride);
+			return next;
+		}
+
+		/**
+		* Optimize a mesh stored in a range of a vertex and index buffer: merge duplicate vertices, reorder triangles
+		* for vertex cache reuse and then for overdraw, and reorder vertices for fetch locality
+		*
+		* @param vertices Pointer to the first vertex of the mesh, the optimized vertices are written to the start of the range
+		* @param vertexCount Number of vertices of the mesh
+		* @param stride Size of a vertex in bytes
+		* @param positionOffset Offset of the vertex position (3 floats) in bytes, pass ~0 if the vertices don't have a position (no overdraw optimization)
+		* @param indices Pointer to the first index of the mesh (triangle list)
+		* @param indexCount Number of indices of the mesh
+		* @param baseVertex (Optional) Index of the first vertex of the mesh, which is subtracted from the indices on input and added again on output
+		*
+		* @return Statistics before and after optimization, verticesAfter is the new vertex count of the mesh
+		*/
+		inline Result OptimizeMesh(void* vertices, size_t vertexCount, size_t stride, size_t positionOffset, uint32_t* indices, size_t indexCount, uint32_t baseVertex = 0)
+		{
+			Result result;
+			result.verticesBefore = vertexCount;
+			// Incomplete triangles at the end are ignored
+			indexCount -= indexCount % 3;
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				indices[i] -= baseVertex;
+			}
+			result.before = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+			vertexCount = WeldVertices(vertices, vertexCount, stride, indices, indexCount);
+			std::vector<uint32_t> clusters;
+			OptimizeVertexCache(indices, indexCount, vertexCount, &clusters);
+			if (positionOffset != ~size_t(0))
+			{
+				OptimizeOverdraw(indices, indexCount, static_cast<uint8_t*>(vertices) + positionOffset, stride, vertexCount, clusters);
+			}
+			vertexCount = OptimizeVertexFetch(vertices, vertexCount, stride, indices, indexCount);
+
+			result.after = AnalyzeVertexCache(indices, indexCount, vertexCount);
+			result.verticesAfter = vertexCount;
+			for (size_t i = 0; i < indexCount; i++)
+			{
+				indices[i] += baseVertex;
+			}
+			return result;
+		}
+	}
+}
@@ -0,0 +1,452 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace vks
+{
+	/**
+	* Quadric error metric (Garland & Heckbert) mesh simplification for generating levels of detail
+	*
+	* Simplification only removes triangles by collapsing edges onto existing vertices, so all levels of detail
+	* of a mesh share its vertex buffer and only need their own range of indices
+	*/
+	namespace meshopt
+	{
+		/** @brief Sum of squared distances to a set of weighted planes, stored as the unique coefficients of the symmetric 4x4 matrix */
+		struct Quadric
+		{
+			double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+			double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+			double c = 0.0;
+			/** @brief Sum of the plane weights, the error is normalized by it */
+			double w = 0.0;
+
+			/** @brief Quadric of the plane a*x + b*y + c*z + d = 0 (with normalized a, b, c) */
+			static Quadric FromPlane(double a, double b, double c, double d, double weight)
+			{
+				Quadric q;
+				q.a00 = a * a * weight;
+				q.a11 = b * b * weight;
+				q.a22 = c * c * weight;
+				q.a01 = a * b * weight;
+				q.a02 = a * c * weight;
+				q.a12 = b * c * weight;
+				q.b0 = a * d * weight;
+				q.b1 = b * d * weight;
+				q.b2 = c * d * weight;
+				q.c = d * d * weight;
+				q.w = weight;
+				return q;
+			}
+
+			void Add(const Quadric& other)
+			{
+				a00 += other.a00; a11 += other.a11; a22 += other.a22;
+				a01 += other.a01; a02 += other.a02; a12 += other.a12;
+				b0 += other.b0; b1 += other.b1; b2 += other.b2;
+				c += other.c;
+				w += other.w;
+			}
+
+			/** @brief Weighted mean of the squared distances of p to the planes */
+			double Error(const float* p) const
+			{
+				double x = p[0], y = p[1], z = p[2];
+				double r = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				return (w > 0.0) ? fabs(r) / w : 0.0;
+			}
+		};
+
+		namespace detail
+		{
+			/** @brief Triangles around each vertex (compressed rows) */
+			struct TriangleAdjacency
+			{
+				std::vector<uint32_t> offsets;
+				std::vector<uint32_t> triangles;
+
+				void Build(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+				{
+					offsets.assign(vertexCount + 1, 0);
+					for (size_t i = 0; i < indexCount; i++)
+					{
+						offsets[indices[i] + 1]++;
+					}
+					for (size_t v = 0; v < vertexCount; v++)
+					{
+						offsets[v + 1] += offsets[v];
+					}
+					triangles.resize(indexCount);
+					std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+					for (size_t i = 0; i < indexCount; i++)
+					{
+						triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+					}
+				}
+			};
+
+			inline void Normal(const float* p0, const float* p1, const float* p2, float* n)
+			{
+				float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+				n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+				n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+			}
+
+			enum VertexKind : uint8_t
+			{
+				/** @brief Interior vertex, can be collapsed onto any neighbour */
+				VERTEX_MANIFOLD,
+				/** @brief Vertex on a single open boundary, can only be collapsed along the boundary */
+				VERTEX_BORDER,
+				/** @brief Seam (several vertices at the same position with different attributes) or non-manifold vertex, never collapsed */
+				VERTEX_LOCKED,
+			};
+		}
+
+		/**
+		* Simplify a triangle list by edge collapses, in order of increasing quadric error
+		*
+		* Vertices that share their position with other vertices (UV, normal or color seams) and vertices on complex boundaries are never moved,
+		* open boundaries are only collapsed along themselves, so seams and silhouettes of open meshes are preserved
+		*
+		* @param destination Receives the simplified indices, needs room for indexCount indices (may be the same as indices)
+		* @param indices Triangle list indices
+		* @param indexCount Number of indices
+		* @param vertices Vertex data
+		* @param vertexCount Number of vertices, all indices must be smaller
+		* @param stride Size of a vertex in bytes
+		* @param positionOffset Offset of the vertex position (3 floats) in bytes
+		* @param targetIndexCount Number of indices to stop at
+		* @param targetError Maximum error relative to the size of the mesh (0.01 = 1% of the largest extent), simplification stops before exceeding it
+		* @param resultError (Optional) Receives the relative error of the simplified mesh
+		*
+		* @return Number of indices written to destination
+		*/
+		inline size_t Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride, size_t positionOffset, size_t targetIndexCount, float targetError, float* resultError = nullptr)
+		{
+			indexCount -= indexCount % 3;
+			if (destination != indices)
+				memmove(destination, indices, indexCount * sizeof(uint32_t));
+			if (resultError)
+				*resultError = 0.0f;
+			if ((indexCount == 0) || (vertexCount == 0))
+				return indexCount;
+
+			// Positions scaled to the unit cube, so errors are relative to the mesh size
+			std::vector<float> positions(vertexCount * 3);
+			float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				memcpy(&positions[v * 3], static_cast<const uint8_t*>(vertices) + v * stride + positionOffset, 3 * sizeof(float));
+				for (int k = 0; k < 3; k++)
+				{
+					minPos[k] = (std::min)(minPos[k], positions[v * 3 + k]);
+					maxPos[k] = (std::max)(maxPos[k], positions[v * 3 + k]);
+				}
+			}
+			float extent = (std::max)((std::max)(maxPos[0] - minPos[0], maxPos[1] - minPos[1]), maxPos[2] - minPos[2]);
+			float invExtent = (extent > 0.0f) ? 1.0f / extent : 0.0f;
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					positions[v * 3 + k] = (positions[v * 3 + k] - minPos[k]) * invExtent;
+				}
+			}
+
+			// Group vertices with the same position, wedge links all vertices of a group in a circular list
+			std::vector<uint32_t> remap(vertexCount);
+			std::vector<uint32_t> wedge(vertexCount);
+			{
+				size_t tableSize = 1;
+				while (tableSize < vertexCount * 2)
+					tableSize *= 2;
+				const uint32_t empty = ~0u;
+				std::vector<uint32_t> table(tableSize, empty);
+				for (size_t v = 0; v < vertexCount; v++)
+				{
+					const float* p = &positions[v * 3];
+					uint64_t hash = 0xcbf29ce484222325ull;
+					const uint8_t* bytes = reinterpret_cast<const uint8_t*>(p);
+					for (size_t b = 0; b < 3 * sizeof(float); b++)
+					{
+						hash ^= bytes[b];
+						hash *= 0x100000001b3ull;
+					}
+					size_t slot = static_cast<size_t>(hash) & (tableSize - 1);
+					while ((table[slot] != empty) && (memcmp(&positions[static_cast<size_t>(table[slot]) * 3], p, 3 * sizeof(float)) != 0))
+					{
+						slot = (slot + 1) & (tableSize - 1);
+					}
+					if (table[slot] == empty)
+					{
+						table[slot] = static_cast<uint32_t>(v);
+						remap[v] = static_cast<uint32_t>(v);
+						wedge[v] = static_cast<uint32_t>(v);
+					}
+					else
+					{
+						uint32_t first = table[slot];
+						remap[v] = first;
+						wedge[v] = wedge[first];
+						wedge[first] = static_cast<uint32_t>(v);
+					}
+				}
+			}
+
+			detail::TriangleAdjacency adjacency;
+			adjacency.Build(destination, indexCount, vertexCount);
+
+			// An edge a -> b is open if no triangle at the same positions contains b -> a
+			auto hasEdge = [&](uint32_t from, uint32_t to)
+			{
+				uint32_t v = from;
+				do
+				{
+					for (uint32_t t = adjacency.offsets[v]; t < adjacency.offsets[v + 1]; t++)
+					{
+						const uint32_t* tri = &destination[adjacency.triangles[t] * 3];
+						for (int k = 0; k < 3; k++)
+						{
+							if ((tri[k] == v) && (remap[tri[(k + 1) % 3]] == remap[to]))
+								return true;
+						}
+					}
+					v = wedge[v];
+				} while (v != from);
+				return false;
+			};
+
+			// Classify the vertices and find the boundary loops
+			const uint32_t none = ~0u;
+			std::vector<uint32_t> openNext(vertexCount, none);
+			std::vector<uint32_t> openPrev(vertexCount, none);
+			std::vector<uint8_t> openCount(vertexCount, 0);
+			std::vector<detail::VertexKind> kind(vertexCount, detail::VERTEX_MANIFOLD);
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = destination[i + k];
+					uint32_t b = destination[i + (k + 1) % 3];
+					if (!hasEdge(b, a))
+					{
+						if (openNext[a] != none)
+							kind[a] = detail::VERTEX_LOCKED;
+						if (openPrev[b] != none)
+							kind[b] = detail::VERTEX_LOCKED;
+						openNext[a] = b;
+						openPrev[b] = a;
+						openCount[a]++;
+						openCount[b]++;
+					}
+				}
+			}
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				if (wedge[v] != v)
+				{
+					kind[v] = detail::VERTEX_LOCKED;
+				}
+				else if (kind[v] == detail::VERTEX_MANIFOLD && openCount[v] > 0)
+				{
+					kind[v] = ((openNext[v] != none) && (openPrev[v] != none)) ? detail::VERTEX_BORDER : detail::VERTEX_LOCKED;
+				}
+			}
+
+			// Error quadrics per position, from the area weighted triangle planes and planes perpendicular to open edges
+			std::vector<Quadric> quadrics(vertexCount);
+			for (size_t i = 0; i < indexCount; i += 3)
+			{
+				const float* p[3] = { &positions[destination[i] * 3], &positions[destination[i + 1] * 3], &positions[destination[i + 2] * 3] };
+				float n[3];
+				detail::Normal(p[0], p[1], p[2], n);
+				float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length == 0.0f)
+					continue;
+				n[0] /= length; n[1] /= length; n[2] /= length;
+				float area = length * 0.5f;
+				Quadric q = Quadric::FromPlane(n[0], n[1], n[2], -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]), area);
+				for (int k = 0; k < 3; k++)
+				{
+					quadrics[remap[destination[i + k]]].Add(q);
+				}
+				for (int k = 0; k < 3; k++)
+				{
+					uint32_t a = destination[i + k];
+					uint32_t b = destination[i + (k + 1) % 3];
+					if (openNext[a] != b)
+						continue;
+					const float* pa = p[k];
+					const float* pb = p[(k + 1) % 3];
+					float e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+					float edgeLength = sqrtf(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+					float bn[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+					float bnLength = sqrtf(bn[0] * bn[0] + bn[1] * bn[1] + bn[2] * bn[2]);
+					if (bnLength == 0.0f)
+						continue;
+					bn[0] /= bnLength; bn[1] /= bnLength; bn[2] /= bnLength;
+					// Boundaries are weighted strongly so they keep their shape
+					const float borderWeight = 10.0f;
+					Quadric bq = Quadric::FromPlane(bn[0], bn[1], bn[2], -(bn[0] * pa[0] + bn[1] * pa[1] + bn[2] * pa[2]), edgeLength * edgeLength * borderWeight);
+					quadrics[remap[a]].Add(bq);
+					quadrics[remap[b]].Add(bq);
+				}
+			}
+
+			struct Collapse
+			{
+				uint32_t source;
+				uint32_t target;
+				float error;
+			};
+			std::vector<Collapse> collapses;
+			std::vector<uint32_t> order;
+			std::vector<uint32_t> collapseRemap(vertexCount);
+			std::vector<uint8_t> touched(vertexCount);
+			const double maxError = static_cast<double>(targetError) * static_cast<double>(targetError);
+			double error = 0.0;
+
+			while (indexCount > targetIndexCount)
+			{
+				adjacency.Build(destination, indexCount, vertexCount);
+
+				// Candidate collapses, interior edges are seen from both triangles but only added once
+				collapses.clear();
+				for (size_t i = 0; i < indexCount; i += 3)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t a = destination[i + k];
+						uint32_t b = destination[i + (k + 1) % 3];
+						bool open = (openNext[a] == b) || (openPrev[b] == a);
+						if (!open && (a > b))
+							continue;
+						uint32_t ends[2] = { a, b };
+						for (int e = 0; e < 2; e++)
+						{
+							uint32_t source = ends[e];
+							uint32_t target = ends[1 - e];
+							bool allowed = (kind[source] == detail::VERTEX_MANIFOLD) ||
+								((kind[source] == detail::VERTEX_BORDER) && ((openNext[source] == target) || (openPrev[source] == target)));
+							if (!allowed)
+								continue;
+							Quadric q = quadrics[remap[source]];
+							q.Add(quadrics[remap[target]]);
+							collapses.push_back({ source, target, static_cast<float>(q.Error(&positions[target * 3])) });
+						}
+					}
+				}
+				if (collapses.empty())
+					break;
+
+				order.resize(collapses.size());
+				for (size_t i = 0; i < order.size(); i++)
+				{
+					order[i] = static_cast<uint32_t>(i);
+				}
+				std::sort(order.begin(), order.end(), [&](uint32_t l, uint32_t r) { return collapses[l].error < collapses[r].error; });
+
+				// Each collapse removes about two triangles, limit the pass so it doesn't overshoot the target
+				size_t collapseGoal = (std::max)(static_cast<size_t>(1), (indexCount - targetIndexCount) / 6);
+				size_t collapseCount = 0;
+				for (size_t v = 0; v < vertexCount; v++)
+				{
+					collapseRemap[v] = static_cast<uint32_t>(v);
+				}
+				std::fill(touched.begin(), touched.end(), 0);
+
+				for (uint32_t c : order)
+				{
+					const Collapse& collapse = collapses[c];
+					if (collapse.error > maxError)
+						break;
+					if (collapseCount >= collapseGoal)
+						break;
+					if (touched[collapse.source] || touched[collapse.target])
+						continue;
+
+					// Reject collapses that flip (or degenerate) any of the remaining triangles around the source
+					const float* target = &positions[collapse.target * 3];
+					bool flips = false;
+					for (uint32_t t = adjacency.offsets[collapse.source]; (t < adjacency.offsets[collapse.source + 1]) && !flips; t++)
+					{
+						const uint32_t* tri = &destination[adjacency.triangles[t] * 3];
+						if ((tri[0] == collapse.target) || (tri[1] == collapse.target) || (tri[2] == collapse.target))
+							continue;
+						const float* p[3];
+						const float* q[3];
+						for (int k = 0; k < 3; k++)
+						{
+							p[k] = &positions[tri[k] * 3];
+							q[k] = (tri[k] == collapse.source) ? target : p[k];
+						}
+						float n0[3], n1[3];
+						detail::Normal(p[0], p[1], p[2], n0);
+						detail::Normal(q[0], q[1], q[2], n1);
+						float d = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+						float l0 = n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2];
+						float l1 = n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2];
+						flips = (d <= 0.25f * sqrtf(l0 * l1));
+					}
+					if (flips)
+						continue;
+
+					// The triangles around the source change, so none of their vertices may take part in another collapse of this pass
+					for (uint32_t t = adjacency.offsets[collapse.source]; t < adjacency.offsets[collapse.source + 1]; t++)
+					{
+						const uint32_t* tri = &destination[adjacency.triangles[t] * 3];
+						touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+					}
+					collapseRemap[collapse.source] = collapse.target;
+					quadrics[remap[collapse.target]].Add(quadrics[remap[collapse.source]]);
+					if (kind[collapse.source] == detail::VERTEX_BORDER)
+					{
+						// Close the boundary loop over the removed vertex
+						if (openNext[collapse.source] == collapse.target)
+						{
+							openNext[openPrev[collapse.source]] = collapse.target;
+							openPrev[collapse.target] = openPrev[collapse.source];
+						}
+						else
+						{
+							openPrev[openNext[collapse.source]] = collapse.target;
+							openNext[collapse.target] = openNext[collapse.source];
+						}
+					}
+					error = (std::max)(error, static_cast<double>(collapse.error));
+					collapseCount++;
+				}
+				if (collapseCount == 0)
+					break;
+
+				// Apply the collapses and remove the triangles that became degenerate
+				size_t writeIndex = 0;
+				for (size_t i = 0; i < indexCount; i += 3)
+				{
+					uint32_t a = collapseRemap[destination[i]];
+					uint32_t b = collapseRemap[destination[i + 1]];
+					uint32_t c = collapseRemap[destination[i + 2]];
+					if ((a == b) || (b == c) || (c == a))
+						continue;
+					destination[writeIndex++] = a;
+					destination[writeIndex++] = b;
+					destination[writeIndex++] = c;
+				}
+				indexCount = writeIndex;
+			}
+
+			if (resultError)
+				*resultError = static_cast<float>(sqrt(error));
+			return indexCount;
+		}
+	}
+}
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "MeshSimplifier.hpp"
+
+namespace vks
+{
+	namespace meshopt
+	{
+		/** @brief Default limits of a meshlet, small enough for a single mesh shader workgroup */
+		const uint32_t maxMeshletVertices = 64;
+		const uint32_t maxMeshletTriangles = 124;
+
+		/**
+		* Cluster of neighbouring triangles with its culling data
+		*
+		* The layout matches the std430 layout of the cluster culling shader (see vks::ClusterCuller)
+		*/
+		struct Meshlet
+		{
+			/** @brief Bounding sphere */
+			float center[3];
+			float radius;
+			/**
+			* Normal cone of the triangles, all of them face away from a viewer at position p if
+			* dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius
+			* A cutoff of 1 disables the test
+			*/
+			float coneAxis[3];
+			float coneCutoff;
+			/** @brief Range of the meshlet's triangles in the index buffer */
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			/** @brief Number of distinct vertices */
+			uint32_t vertexCount;
+			uint32_t padding;
+		};
+
+		/**
+		* Compute bounding sphere and normal cone of a meshlet
+		*
+		* @param meshlet Meshlet to update
+		* @param meshletIndices Indices of the meshlet's triangles (meshlet.indexCount)
+		* @param positions Pointer to the position (3 floats) of the first vertex
+		* @param positionStride Distance between the positions of consecutive vertices in bytes
+		* @param flipNormals True if front faces are wound clockwise (with respect to the normals the cone is built from)
+		*/
+		inline void ComputeMeshletBounds(Meshlet& meshlet, const uint32_t* meshletIndices, const void* positions, size_t positionStride, bool flipNormals)
+		{
+			auto position = [&](uint32_t index)
+			{
+				return reinterpret_cast<const float*>(static_cast<const uint8_t*>(positions) + index * positionStride);
+			};
+
+			// Sphere around the center of the bounding box
+			float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t i = 0; i < meshlet.indexCount; i++)
+			{
+				const float* p = position(meshletIndices[i]);
+				for (int k = 0; k < 3; k++)
+				{
+					minPos[k] = (std::min)(minPos[k], p[k]);
+					maxPos[k] = (std::max)(maxPos[k], p[k]);
+				}
+			}
+			float radiusSquared = 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				meshlet.center[k] = (minPos[k] + maxPos[k]) * 0.5f;
+			}
+			for (uint32_t i = 0; i < meshlet.indexCount; i++)
+			{
+				const float* p = position(meshletIndices[i]);
+				float d[3] = { p[0] - meshlet.center[0], p[1] - meshlet.center[1], p[2] - meshlet.center[2] };
+				radiusSquared = (std::max)(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			}
+			meshlet.radius = sqrtf(radiusSquared);
+
+			// Cone around the average of the triangle normals, opened up to the normal furthest from it
+			std::vector<float> normals;
+			normals.reserve(meshlet.indexCount);
+			float axis[3] = { 0.0f, 0.0f, 0.0f };
+			for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3)
+			{
+				float n[3];
+				detail::Normal(position(meshletIndices[i]), position(meshletIndices[i + 1]), position(meshletIndices[i + 2]), n);
+				float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length == 0.0f)
+					continue;
+				float scale = (flipNormals ? -1.0f : 1.0f) / length;
+				for (int k = 0; k < 3; k++)
+				{
+					normals.push_back(n[k] * scale);
+					axis[k] += n[k] * scale;
+				}
+			}
+			meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+			meshlet.coneCutoff = 1.0f;
+			float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			if (axisLength == 0.0f)
+				return;
+			float minDot = 1.0f;
+			for (size_t i = 0; i < normals.size(); i += 3)
+			{
+				minDot = (std::min)(minDot, (normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]) / axisLength);
+			}
+			// Cones wider than ~85 degrees would hardly ever be culled
+			if (minDot <= 0.1f)
+				return;
+			for (int k = 0; k < 3; k++)
+			{
+				meshlet.coneAxis[k] = axis[k] / axisLength;
+			}
+			meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+		}
+
+		/**
+		* Split a triangle list into meshlets of neighbouring triangles
+		*
+		* Meshlets are grown from a seed triangle by adding the adjacent triangle that adds the fewest new vertices (and is closest to the meshlet),
+		* until the vertex or triangle limit is reached. The indices are reordered so the triangles of each meshlet are consecutive.
+		*
+		* @param indices Triangle list indices, reordered in place
+		* @param indexCount Number of indices
+		* @param vertices Vertex data
+		* @param vertexCount Number of vertices, all indices must be smaller
+		* @param stride Size of a vertex in bytes
+		* @param positionOffset Offset of the vertex position (3 floats) in bytes
+		* @param flipNormals (Optional) True if front faces are wound clockwise
+		* @param indexBase (Optional) Index of the first index in the complete index buffer, added to the meshlets' first index
+		* @param maxVertices (Optional) Maximum number of distinct vertices per meshlet (at least 3)
+		* @param maxTriangles (Optional) Maximum number of triangles per meshlet
+		*
+		* @return The meshlets in index buffer order
+		*/
+		inline std::vector<Meshlet> BuildMeshlets(uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t stride, size_t positionOffset,
+			bool flipNormals = false, uint32_t indexBase = 0, uint32_t maxVertices = maxMeshletVertices, uint32_t maxTriangles = maxMeshletTriangles)
+		{
+			std::vector<Meshlet> meshlets;
+			const size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0)
+				return meshlets;
+			const uint8_t* positions = static_cast<const uint8_t*>(vertices) + positionOffset;
+			auto centroid = [&](size_t triangle, float* c)
+			{
+				c[0] = c[1] = c[2] = 0.0f;
+				for (int k = 0; k < 3; k++)
+				{
+					const float* p = reinterpret_cast<const float*>(positions + indices[triangle * 3 + k] * stride);
+					c[0] += p[0] / 3.0f;
+					c[1] += p[1] / 3.0f;
+					c[2] += p[2] / 3.0f;
+				}
+			};
+
+			detail::TriangleAdjacency adjacency;
+			adjacency.Build(indices, triangleCount * 3, vertexCount);
+
+			const uint32_t none = ~0u;
+			std::vector<uint8_t> emitted(triangleCount, 0);
+			std::vector<uint32_t> order;
+			order.reserve(triangleCount);
+			// Meshlet each vertex has last been added to
+			std::vector<uint32_t> vertexMeshlet(vertexCount, none);
+			size_t seed = 0;
+
+			while (order.size() < triangleCount)
+			{
+				const uint32_t meshletIndex = static_cast<uint32_t>(meshlets.size());
+				Meshlet meshlet = {};
+				meshlet.firstIndex = indexBase + static_cast<uint32_t>(order.size() * 3);
+				float center[3] = { 0.0f, 0.0f, 0.0f };
+				uint32_t triangles = 0;
+
+				while (emitted[seed])
+					seed++;
+				uint32_t current = static_cast<uint32_t>(seed);
+				while (current != none)
+				{
+					emitted[current] = 1;
+					order.push_back(current);
+					triangles++;
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t v = indices[current * 3 + k];
+						if (vertexMeshlet[v] != meshletIndex)
+						{
+							vertexMeshlet[v] = meshletIndex;
+							meshlet.vertexCount++;
+						}
+					}
+					float c[3];
+					centroid(current, c);
+					for (int k = 0; k < 3; k++)
+					{
+						center[k] += (c[k] - center[k]) / static_cast<float>(triangles);
+					}
+					if (triangles >= maxTriangles)
+						break;
+
+					// Continue with the best triangle around the one just added
+					uint32_t best = none;
+					uint32_t bestNew = 4;
+					float bestDistance = FLT_MAX;
+					for (int k = 0; k < 3; k++)
+					{
+						uint32_t v = indices[current * 3 + k];
+						for (uint32_t a = adjacency.offsets[v]; a < adjacency.offsets[v + 1]; a++)
+						{
+							uint32_t t = adjacency.triangles[a];
+							if (emitted[t])
+								continue;
+							uint32_t newVertices = (vertexMeshlet[indices[t * 3]] != meshletIndex) + (vertexMeshlet[indices[t * 3 + 1]] != meshletIndex) + (vertexMeshlet[indices[t * 3 + 2]] != meshletIndex);
+							if ((meshlet.vertexCount + newVertices > maxVertices) || (newVertices > bestNew))
+								continue;
+							centroid(t, c);
+							float distance = (c[0] - center[0]) * (c[0] - center[0]) + (c[1] - center[1]) * (c[1] - center[1]) + (c[2] - center[2]) * (c[2] - center[2]);
+							if ((newVertices < bestNew) || (distance < bestDistance))
+							{
+								best = t;
+								bestNew = newVertices;
+								bestDistance = distance;
+							}
+						}
+					}
+					// Disconnected triangles (e.g. flat shaded meshes) continue with the next triangle in index order, which is usually close after vertex cache optimization
+					if (best == none)
+					{
+						while ((seed < triangleCount) && emitted[seed])
+							seed++;
+						if ((seed < triangleCount) && (meshlet.vertexCount + (vertexMeshlet[indices[seed * 3]] != meshletIndex) + (vertexMeshlet[indices[seed * 3 + 1]] != meshletIndex) + (vertexMeshlet[indices[seed * 3 + 2]] != meshletIndex) <= maxVertices))
+							best = static_cast<uint32_t>(seed);
+					}
+					current = best;
+				}
+				meshlet.indexCount = triangles * 3;
+				meshlets.push_back(meshlet);
+			}
+
+			// Store the triangles in meshlet order
+			std::vector<uint32_t> sourceIndices(indices, indices + triangleCount * 3);
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				memcpy(&indices[i * 3], &sourceIndices[order[i] * 3], 3 * sizeof(uint32_t));
+			}
+			for (Meshlet& meshlet : meshlets)
+			{
+				ComputeMeshletBounds(meshlet, indices + (meshlet.firstIndex - indexBase), positions, stride, flipNormals);
+			}
+			return meshlets;
+		}
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "CpuFeatures.hpp"
+
+// SIMD path used for the conversions. It's compiled on all x86 targets and selected at runtime if the CPU supports SSSE3,
+// so the project doesn't need to be built with /arch:AVX (MSVC never defines __SSSE3__)
+#if defined(VKS_CPU_X86)
+#define VKS_PIXELS_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace vks
+{
+	/**
+	* Conversion of 8 bit per channel pixel data to the RGBA layout used for VK_FORMAT_R8G8B8A8_* textures
+	*
+	* Most devices don't support 24 bit formats, so RGB images have to be expanded before they are uploaded.
+	* The conversions process 16 pixels per iteration with byte shuffles if the CPU supports SSSE3, and 4 pixels per iteration with 32 bit words otherwise
+	*/
+	namespace pixels
+	{
+		namespace detail
+		{
+			/** @brief Expand three channel pixels to four, starting at pixel first, r, g and b select the source bytes of the destination's first three channels */
+			template<int R, int G, int B>
+			inline void ExpandToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t first, size_t pixelCount, uint8_t alpha)
+			{
+				size_t i = first;
+				if ((R == 0) && (G == 1) && (B == 2))
+				{
+					// Three little endian words hold 4 pixels, shift them into place
+					const uint32_t alphaBits = static_cast<uint32_t>(alpha) << 24;
+					for (; i + 4 <= pixelCount; i += 4)
+					{
+						uint32_t in[3];
+						memcpy(in, src + i * 3, sizeof(in));
+						uint32_t out[4];
+						out[0] = (in[0] & 0x00ffffffu) | alphaBits;
+						out[1] = (in[0] >> 24) | ((in[1] & 0x0000ffffu) << 8) | alphaBits;
+						out[2] = (in[1] >> 16) | ((in[2] & 0x000000ffu) << 16) | alphaBits;
+						out[3] = (in[2] >> 8) | alphaBits;
+						memcpy(dst + i * 4, out, sizeof(out));
+					}
+				}
+				for (; i < pixelCount; i++)
+				{
+					dst[i * 4 + 0] = src[i * 3 + R];
+					dst[i * 4 + 1] = src[i * 3 + G];
+					dst[i * 4 + 2] = src[i * 3 + B];
+					dst[i * 4 + 3] = alpha;
+				}
+			}
+
+#if defined(VKS_PIXELS_SSSE3)
+			/** @brief SSSE3 version of ExpandToRgbaScalar for blocks of 16 pixels, returns the number of converted pixels */
+			template<int R, int G, int B>
+			VKS_TARGET_SSSE3 inline size_t ExpandToRgbaSSSE3(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha)
+			{
+				size_t i = 0;
+				const __m128i shuffle = _mm_setr_epi8(
+					R, G, B, -1, 3 + R, 3 + G, 3 + B, -1,
+					6 + R, 6 + G, 6 + B, -1, 9 + R, 9 + G, 9 + B, -1);
+				const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(alpha) << 24));
+				for (; i + 16 <= pixelCount; i += 16)
+				{
+					// 48 source bytes hold 16 pixels, realign them so each register starts with the next 4 pixels
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 16));
+					const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 32));
+					const __m128i p0 = a;
+					const __m128i p1 = _mm_alignr_epi8(b, a, 12);
+					const __m128i p2 = _mm_alignr_epi8(c, b, 8);
+					const __m128i p3 = _mm_srli_si128(c, 4);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alphaMask));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 16), _mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alphaMask));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 32), _mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alphaMask));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4 + 48), _mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alphaMask));
+				}
+				return i;
+			}
+
+			/** @brief SSSE3 version of SwapRedBlue for blocks of 4 pixels, returns the number of converted pixels */
+			VKS_TARGET_SSSE3 inline size_t SwapRedBlueSSSE3(uint8_t* pixels, size_t pixelCount)
+			{
+				size_t i = 0;
+				const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+				for (; i + 4 <= pixelCount; i += 4)
+				{
+					__m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i * 4), _mm_shuffle_epi8(p, shuffle));
+				}
+				return i;
+			}
+#endif
+
+			template<int R, int G, int B>
+			inline void ExpandToRgba(const uint8_t* src, uint8_t* dst, size_t pixelCount, uint8_t alpha)
+			{
+				size_t first = 0;
+#if defined(VKS_PIXELS_SSSE3)
+				if (cpu::GetFeatures().ssse3)
+					first = ExpandToRgbaSSSE3<R, G, B>(src, dst, pixelCount, alpha);
+#endif
+				ExpandToRgbaScalar<R, G, B>(src, dst, first, pixelCount, alpha);
+			}
+		}
+
+		/**
+		* Expand RGB pixels to RGBA
+		*
+		* @param rgb Source pixels, 3 bytes each
+		* @param rgba Destination pixels, 4 bytes each, must not overlap the source
+		* @param pixelCount Number of pixels to convert
+		* @param alpha (Optional) Value of the added alpha channel
+		*/
+		inline void RgbToRgba(const uint8_t* rgb, uint8_t* rgba, size_t pixelCount, uint8_t alpha = 255)
+		{
+			detail::ExpandToRgba<0, 1, 2>(rgb, rgba, pixelCount, alpha);
+		}
+
+		/** @brief Expand BGR pixels to RGBA, see RgbToRgba */
+		inline void BgrToRgba(const uint8_t* bgr, uint8_t* rgba, size_t pixelCount, uint8_t alpha = 255)
+		{
+			detail::ExpandToRgba<2, 1, 0>(bgr, rgba, pixelCount, alpha);
+		}
+
+		/** @brief Swap the first and third channel of 4 byte pixels in place (BGRA <-> RGBA) */
+		inline void SwapRedBlue(uint8_t* pixels, size_t pixelCount)
+		{
+			size_t i = 0;
+#if defined(VKS_PIXELS_SSSE3)
+			if (cpu::GetFeatures().ssse3)
+				i = detail::SwapRedBlueSSSE3(pixels, pixelCount);
+#endif
+			for (; i < pixelCount; i++)
+			{
+				uint32_t p;
+				memcpy(&p, pixels + i * 4, sizeof(p));
+				p = (p & 0xff00ff00u) | ((p & 0x000000ffu) << 16) | ((p >> 16) & 0x000000ffu);
+				memcpy(pixels + i * 4, &p, sizeof(p));
+			}
+		}
+	}
+}
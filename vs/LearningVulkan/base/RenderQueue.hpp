@@ -0,0 +1,268 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+namespace vks
+{
+	/**
+	* Sort a list of 64 bit keys with a 32 bit payload each (LSD radix sort, 8 bits per pass)
+	*
+	* The sort is stable, so draws with equal keys keep their submission order. Passes over bytes that are the same for all keys are skipped,
+	* which makes sorting keys that only use a few bits (e.g. small pass, pipeline and material ids) considerably cheaper.
+	*
+	* @param keys Keys to sort, sorted in place
+	* @param values Payload of the keys, reordered with them
+	* @param count Number of keys
+	* @param keysTemp Scratch space for count keys
+	* @param valuesTemp Scratch space for count values
+	*/
+	inline void RadixSort(uint64_t* keys, uint32_t* values, size_t count, uint64_t* keysTemp, uint32_t* valuesTemp)
+	{
+		if (count < 2)
+			return;
+
+		// Histograms of all 8 bytes are gathered in a single pass over the keys
+		std::vector<size_t> histograms(8 * 256, 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint64_t key = keys[i];
+			for (uint32_t pass = 0; pass < 8; pass++)
+			{
+				histograms[pass * 256 + ((key >> (pass * 8)) & 0xff)]++;
+			}
+		}
+
+		uint64_t* srcKeys = keys;
+		uint32_t* srcValues = values;
+		uint64_t* dstKeys = keysTemp;
+		uint32_t* dstValues = valuesTemp;
+		for (uint32_t pass = 0; pass < 8; pass++)
+		{
+			size_t* histogram = &histograms[pass * 256];
+			const uint32_t shift = pass * 8;
+			// All keys share this byte, the pass wouldn't change the order
+			if (histogram[(srcKeys[0] >> shift) & 0xff] == count)
+				continue;
+			size_t offset = 0;
+			for (uint32_t bucket = 0; bucket < 256; bucket++)
+			{
+				const size_t bucketSize = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucketSize;
+			}
+			for (size_t i = 0; i < count; i++)
+			{
+				const size_t target = histogram[(srcKeys[i] >> shift) & 0xff]++;
+				dstKeys[target] = srcKeys[i];
+				dstValues[target] = srcValues[i];
+			}
+			std::swap(srcKeys, dstKeys);
+			std::swap(srcValues, dstValues);
+		}
+		// An odd number of passes leaves the result in the scratch space
+		if (srcKeys != keys)
+		{
+			memcpy(keys, srcKeys, count * sizeof(uint64_t));
+			memcpy(values, srcValues, count * sizeof(uint32_t));
+		}
+	}
+
+	/**
+	* Collects the draws of a frame as sort keys, sorts them and records them with redundant state changes removed
+	*
+	* Keys are built with OpaqueKey or TransparentKey, the most significant bits select the pass (draw order of the passes),
+	* opaque draws are then grouped by pipeline and material and drawn front to back, transparent draws are drawn back to front.
+	*
+	* Usage:
+	* - Reset at the start of a frame (or command buffer)
+	* - Add all draws in any order
+	* - Sort, then Record inside of the render pass with the vertex and index buffers bound
+	*/
+	class RenderQueue
+	{
+	public:
+		/** @brief Number of bits of the key fields */
+		static const uint32_t passBits = 4;
+		static const uint32_t pipelineBits = 12;
+		static const uint32_t materialBits = 16;
+		static const uint32_t depthBits = 32;
+
+		/** @brief State bound for a material, shared by all of its draws */
+		struct Material
+		{
+			/** @brief Bound to the queue's material set */
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			/** @brief (Optional) Data passed with vkCmdPushConstants using the queue's push constant range */
+			const void* pushConstants = nullptr;
+		};
+
+		struct Draw
+		{
+			VkPipeline pipeline;
+			const Material* material;
+			uint32_t indexCount;
+			uint32_t firstIndex;
+			int32_t vertexOffset;
+		};
+
+		/** @brief State changes of the last Record, and the ones that have been skipped because the state was already bound */
+		struct Stats
+		{
+			uint32_t draws = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t pipelineBindsAvoided = 0;
+			uint32_t descriptorSetBinds = 0;
+			uint32_t descriptorSetBindsAvoided = 0;
+			uint32_t pushConstantUpdates = 0;
+			uint32_t pushConstantUpdatesAvoided = 0;
+		} stats;
+
+		/** @brief Descriptor set index the materials' descriptor sets are bound to */
+		uint32_t materialSet = 0;
+		/** @brief Push constant range of the materials' push constants */
+		VkShaderStageFlags pushConstantStages = 0;
+		uint32_t pushConstantOffset = 0;
+		uint32_t pushConstantSize = 0;
+
+		/**
+		* Key of an opaque draw, sorted by pass, pipeline, material and then front to back
+		*
+		* @param pass Pass of the draw, lower passes are drawn first (passBits)
+		* @param pipeline Id of the draw's pipeline (pipelineBits)
+		* @param material Id of the draw's material (materialBits)
+		* @param depth Distance of the draw from the camera, negative values are clamped to 0
+		*/
+		static uint64_t OpaqueKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
+		{
+			return (static_cast<uint64_t>(pass & ((1u << passBits) - 1)) << (pipelineBits + materialBits + depthBits)) |
+				(static_cast<uint64_t>(pipeline & ((1u << pipelineBits) - 1)) << (materialBits + depthBits)) |
+				(static_cast<uint64_t>(material & ((1u << materialBits) - 1)) << depthBits) |
+				DepthBits(depth);
+		}
+
+		/** @brief Key of a transparent draw, sorted by pass and then back to front (pipeline and material only break ties), see OpaqueKey */
+		static uint64_t TransparentKey(uint32_t pass, uint32_t pipeline, uint32_t material, float depth)
+		{
+			return (static_cast<uint64_t>(pass & ((1u << passBits) - 1)) << (pipelineBits + materialBits + depthBits)) |
+				(static_cast<uint64_t>(~DepthBits(depth) & 0xffffffffu) << (pipelineBits + materialBits)) |
+				(static_cast<uint64_t>(pipeline & ((1u << pipelineBits) - 1)) << materialBits) |
+				static_cast<uint64_t>(material & ((1u << materialBits) - 1));
+		}
+
+		/** @brief Remove all draws, keeps the allocated memory */
+		void Reset()
+		{
+			keys.clear();
+			order.clear();
+			draws.clear();
+		}
+
+		/** @brief Add a draw with a key built by OpaqueKey or TransparentKey */
+		void Add(uint64_t key, const Draw& draw)
+		{
+			keys.push_back(key);
+			order.push_back(static_cast<uint32_t>(draws.size()));
+			draws.push_back(draw);
+		}
+
+		/** @brief Number of draws added since the last Reset */
+		uint32_t Size() const
+		{
+			return static_cast<uint32_t>(draws.size());
+		}
+
+		/** @brief Sort the draws by their keys */
+		void Sort()
+		{
+			keysTemp.resize(keys.size());
+			orderTemp.resize(order.size());
+			RadixSort(keys.data(), order.data(), keys.size(), keysTemp.data(), orderTemp.data());
+		}
+
+		/**
+		* Record the draws in key order (or submission order if Sort hasn't been called), state that is already bound isn't bound again
+		*
+		* @param commandBuffer Command buffer inside of a render pass, the vertex and index buffers must be bound. Pass VK_NULL_HANDLE to only update the statistics
+		* @param pipelineLayout Pipeline layout of all pipelines of the queue
+		*/
+		void Record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout)
+		{
+			stats = Stats();
+			VkPipeline currentPipeline = VK_NULL_HANDLE;
+			VkDescriptorSet currentSet = VK_NULL_HANDLE;
+			const void* currentPushConstants = nullptr;
+			for (uint32_t index : order)
+			{
+				const Draw& draw = draws[index];
+				if (draw.pipeline != currentPipeline)
+				{
+					if (commandBuffer != VK_NULL_HANDLE)
+						vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+					currentPipeline = draw.pipeline;
+					stats.pipelineBinds++;
+				}
+				else
+				{
+					stats.pipelineBindsAvoided++;
+				}
+				if (draw.material)
+				{
+					if (draw.material->descriptorSet != VK_NULL_HANDLE)
+					{
+						if (draw.material->descriptorSet != currentSet)
+						{
+							if (commandBuffer != VK_NULL_HANDLE)
+								vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, materialSet, 1, &draw.material->descriptorSet, 0, nullptr);
+							currentSet = draw.material->descriptorSet;
+							stats.descriptorSetBinds++;
+						}
+						else
+						{
+							stats.descriptorSetBindsAvoided++;
+						}
+					}
+					if (draw.material->pushConstants && (pushConstantSize > 0))
+					{
+						if (draw.material->pushConstants != currentPushConstants)
+						{
+							if (commandBuffer != VK_NULL_HANDLE)
+								vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantStages, pushConstantOffset, pushConstantSize, draw.material->pushConstants);
+							currentPushConstants = draw.material->pushConstants;
+							stats.pushConstantUpdates++;
+						}
+						else
+						{
+							stats.pushConstantUpdatesAvoided++;
+						}
+					}
+				}
+				if (commandBuffer != VK_NULL_HANDLE)
+					vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, draw.vertexOffset, 0);
+				stats.draws++;
+			}
+		}
+
+	private:
+		std::vector<uint64_t> keys;
+		std::vector<uint64_t> keysTemp;
+		// Indices of the draws in key order
+		std::vector<uint32_t> order;
+		std::vector<uint32_t> orderTemp;
+		std::vector<Draw> draws;
+
+		// Non-negative floats keep their order when compared as integers
+		static uint64_t DepthBits(float depth)
+		{
+			if (!(depth > 0.0f))
+				return 0;
+			uint32_t bits;
+			memcpy(&bits, &depth, sizeof(bits));
+			return bits;
+		}
+	};
+}
@@ -1,18 +1,30 @@
+#pragma once
+
 #include <vector>
 #include <thread>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
+#include <memory>
+
+#include "JobFunction.hpp"
 
 namespace vks
 {
 	class Thread
 	{
+	public:
+		// Max. number of jobs that can be queued on a thread, AddJob blocks while the queue is full
+		static const uint32_t maxJobs = 1024;
+
 	private:
 		bool destroying = false;
 		std::thread worker;
-		std::queue<std::function<void()>> jobs;
+		// Fixed size ring buffer of jobs with inline storage, so queueing a job doesn't allocate
+		std::unique_ptr<JobFunction<>[]> jobs;
+		uint32_t head = 0;
+		uint32_t count = 0;
 		std::mutex mutex;
 		std::condition_variable condition;
 
@@ -21,24 +33,27 @@ namespace vks
 		{
 			while (true)
 			{
-				std::function<void()> job;
+				JobFunction<>* job;
 				{
 					std::unique_lock<std::mutex> lock(mutex);
 					condition.wait(lock, [this]
 						{
-							return !jobs.empty() || destroying;
+							return count > 0 || destroying;
 						}
 					);
 					if (destroying)
 						break;
-					job = jobs.front();
+					// The slot at head isn't touched by AddJob while the job is still counted as queued
+					job = &jobs[head];
 				}
-				job();
+				(*job)();
+				job->Reset();
 
 				{
 					std::lock_guard<std::mutex> lock(mutex);
-					jobs.pop();
-					condition.notify_one();
+					head = (head + 1) % maxJobs;
+					count--;
+					condition.notify_all();
 				}
 			}
 		}
@@ -46,6 +61,7 @@ namespace vks
 	public:
 		Thread()
 		{
+			jobs = std::make_unique<JobFunction<>[]>(maxJobs);
 			worker = std::thread(&Thread::Loop, this);
 		}
 
@@ -56,18 +72,25 @@ namespace vks
 				Wait();
 				mutex.lock();
 				destroying = true;
-				condition.notify_one();
+				condition.notify_all();
 				mutex.unlock();
 				worker.join();
 			}
 		}
 
 		// Add a new job to the thread's queue
-		void AddJob(std::function<void()> function)
+		template<typename Function>
+		void AddJob(Function&& function)
 		{
-			std::lock_guard<std::mutex> lock(mutex);
-			jobs.push(std::move(function));
-			condition.notify_one();
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]()
+				{
+					return count < maxJobs;
+				}
+			);
+			jobs[(head + count) % maxJobs] = JobFunction<>(std::forward<Function>(function));
+			count++;
+			condition.notify_all();
 		}
 
 		// Wait until all work items have been finished
@@ -76,7 +99,7 @@ namespace vks
 			std::unique_lock<std::mutex> lock(mutex);
 			condition.wait(lock, [this]()
 				{
-					return jobs.empty();
+					return count == 0;
 				}
 			);
 		}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace vks
+{
+	/**
+	* Conversion of vertex attributes to the compact formats used by the quantized vertex components (see vks::Component)
+	*
+	* All of them are read by the vertex input stage as floats again, only the octahedral encoding needs to be decoded in the shader
+	*/
+	namespace quantize
+	{
+		/** @brief IEEE 754 half precision float, rounded to nearest even (for VK_FORMAT_R16*_SFLOAT) */
+		inline uint16_t Half(float value)
+		{
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			uint32_t sign = (bits >> 16) & 0x8000u;
+			uint32_t absBits = bits & 0x7fffffffu;
+			// NaN stays NaN, overflow becomes infinity
+			if (absBits >= 0x7f800000u)
+				return static_cast<uint16_t>(sign | 0x7c00u | ((absBits > 0x7f800000u) ? 0x200u : 0u));
+			if (absBits >= 0x477ff000u)
+				return static_cast<uint16_t>(sign | 0x7c00u);
+			// Too small for a normal half, round to a denormal (or zero)
+			if (absBits < 0x38800000u)
+			{
+				float absValue;
+				memcpy(&absValue, &absBits, sizeof(absValue));
+				return static_cast<uint16_t>(sign | static_cast<uint32_t>(nearbyintf(absValue * 16777216.0f)));
+			}
+			uint32_t mantissaOdd = (absBits >> 13) & 1u;
+			absBits += 0xc8000fffu + mantissaOdd;
+			return static_cast<uint16_t>(sign | (absBits >> 13));
+		}
+
+		/** @brief [-1, 1] to a 16 bit signed normalized integer (for VK_FORMAT_R16*_SNORM) */
+		inline int16_t Snorm16(float value)
+		{
+			value = (std::max)(-1.0f, (std::min)(1.0f, value));
+			return static_cast<int16_t>(lrintf(value * 32767.0f));
+		}
+
+		/** @brief [0, 1] to a 16 bit unsigned normalized integer (for VK_FORMAT_R16*_UNORM) */
+		inline uint16_t Unorm16(float value)
+		{
+			value = (std::max)(0.0f, (std::min)(1.0f, value));
+			return static_cast<uint16_t>(lrintf(value * 65535.0f));
+		}
+
+		/** @brief [0, 1] to an 8 bit unsigned normalized integer (for VK_FORMAT_R8*_UNORM) */
+		inline uint8_t Unorm8(float value)
+		{
+			value = (std::max)(0.0f, (std::min)(1.0f, value));
+			return static_cast<uint8_t>(lrintf(value * 255.0f));
+		}
+
+		/**
+		* Octahedral encoding of a unit vector, projects it onto an octahedron which is unfolded onto the [-1, 1] square
+		*
+		* Decode in the shader with:
+		* vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+		* float t = max(-n.z, 0.0);
+		* n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+		* n = normalize(n);
+		*
+		* @param v Vector to encode, doesn't need to be normalized
+		* @param encoded Receives the two coordinates on the square
+		*/
+		inline void Octahedral(const float* v, float* encoded)
+		{
+			float length = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+			if (length == 0.0f)
+			{
+				encoded[0] = encoded[1] = 0.0f;
+				return;
+			}
+			float x = v[0] / length;
+			float y = v[1] / length;
+			if (v[2] < 0.0f)
+			{
+				// Fold the lower hemisphere over the diagonals
+				float fx = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+				float fy = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+				x = fx;
+				y = fy;
+			}
+			encoded[0] = x;
+			encoded[1] = y;
+		}
+	}
+}
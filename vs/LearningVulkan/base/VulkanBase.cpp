@@ -122,21 +122,46 @@ void VulkanBase::DestroyCommandBuffers()
     vkFreeCommandBuffers(device, cmdPool, static_cast<uint32_t>(drawCmdBuffers.size()), drawCmdBuffers.data());
 }
 
+void VulkanBase::CreateGpuProfiler()
+{
+    // Timestamps are written by the command buffers of the swap chain images, whose number may change when the swap chain is recreated
+    gpuProfiler.Destroy();
+    const uint32_t timestampValidBits = vulkanDevice->queueFamilyProperties[vulkanDevice->queueFamilyIndices.graphics].timestampValidBits;
+    gpuProfiler.Create(device, deviceProperties.limits, timestampValidBits, static_cast<uint32_t>(drawCmdBuffers.size()));
+}
+
 void VulkanBase::CreatePipelineCache()
 {
-    VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
-    pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
-    VK_CHECK_RESULT(vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache));
+    VK_CHECK_RESULT(persistentPipelineCache.Create(device, deviceProperties, GetPipelineCacheFilename(), settings.loadPipelineCache));
+    pipelineCache = persistentPipelineCache.cache;
+    pipelineBuilder.Create(device, pipelineCache);
+}
+
+std::string VulkanBase::GetPipelineCacheFilename()
+{
+    // Stored next to the executable with one file per GPU, the driver version and cache UUID are validated on load
+    std::string filename = args.empty() ? name : std::string(args[0]);
+    size_t extension = filename.find_last_of('.');
+    size_t separator = filename.find_last_of("/\\");
+    if ((extension != std::string::npos) && ((separator == std::string::npos) || (extension > separator)))
+        filename = filename.substr(0, extension);
+    char deviceKey[32];
+    snprintf(deviceKey, sizeof(deviceKey), "_%04x_%04x", deviceProperties.vendorID, deviceProperties.deviceID);
+    return filename + deviceKey + ".pipelinecache";
 }
 
 void VulkanBase::Prepare()
 {
     if (vulkanDevice->enableDebugMarkers)
         vks::debugmarker::Setup(device);
+    // Samples that write shared resources every frame rely on the previous frame having finished
+    if (!settings.multipleFramesInFlight)
+        settings.framesInFlight = 1;
     InitSwapChain();
     CreateCommandPool();
     SetupSwapChain();
     CreateCommandBuffers();
+    CreateGpuProfiler();
     CreateSynchronizationPrimitives();
     SetupDepthStencil();
     SetupRenderPass();
@@ -154,6 +179,7 @@ void VulkanBase::Prepare()
         };
         UIOverlay.PrepareResources();
         UIOverlay.PreparePipeline(pipelineCache, renderPass);
+        UIOverlay.SetFrameCount(settings.framesInFlight);
     }
 }
 
@@ -220,8 +246,35 @@ void VulkanBase::RenderLoop()
 {
     if (benchmark.active)
     {
-        benchmark.Run([=] { Render(); }, vulkanDevice->properties);
+        benchmark.startupTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTimestamp).count();
+        benchmark.pipelineCacheSize = persistentPipelineCache.loadedSize;
+        const vks::MeshCache::Stats& meshLoads = vks::MeshCache::Get().stats;
+        benchmark.meshColdLoads = meshLoads.coldLoads;
+        benchmark.meshWarmLoads = meshLoads.warmLoads;
+        benchmark.meshColdTime = meshLoads.coldTime;
+        benchmark.meshWarmTime = meshLoads.warmTime;
+        if (meshLoads.optimization.before.triangles > 0)
+            benchmark.meshOptimization = meshLoads.optimization.ToString();
+        benchmark.meshLodLevels = meshLoads.lodLevels;
+        benchmark.meshMeshlets = meshLoads.meshlets;
+        // GPU times only cover the measured frames of each run
+        benchmark.measureStarted = [=] { gpuProfiler.ResetStats(); };
+        // Run with CPU and GPU serialized first to report the throughput gained by overlapping them
+        uint32_t framesInFlight = settings.framesInFlight;
+        if (framesInFlight > 1)
+        {
+            SetFramesInFlight(1);
+            benchmark.Run([=] { Render(); }, vulkanDevice->properties, "1 frame in flight");
+            benchmark.AddGpuTimes(gpuProfiler.Averages());
+            SetFramesInFlight(framesInFlight);
+        }
+        benchmark.Run([=] { Render(); }, vulkanDevice->properties, std::to_string(framesInFlight) + (framesInFlight > 1 ? " frames in flight" : " frame in flight"));
+        benchmark.AddGpuTimes(gpuProfiler.Averages());
         vkDeviceWaitIdle(device);
+        std::cout << vulkanDevice->memoryAllocator.GetReport();
+        const vks::Uploader::Stats& uploads = vulkanDevice->uploader.stats;
+        std::cout << "Uploads: " << uploads.copyCount << " copies, " << (uploads.bytes / (1024.0 * 1024.0)) << " MiB in " << uploads.submitCount << " submits"
+            << (vulkanDevice->uploader.DedicatedTransferQueue() ? " (dedicated transfer queue)" : "") << ", " << uploads.stallCount << " ring stalls, " << uploads.overflowCount << " oversized\n";
         if (benchmark.filename != "")
             benchmark.SaveResult();
         return;
@@ -522,6 +575,12 @@ void VulkanBase::UpdateOverlay()
 
 	ImGui::NewFrame();
 
+	// Widget callbacks of the samples may re-record the command buffers, which must not be pending execution
+	if (ImGui::IsAnyItemActive())
+	{
+		WaitForFramesInFlight();
+	}
+
 	ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 0);
 	ImGui::SetNextWindowPos(ImVec2(10, 10));
 	ImGui::SetNextWindowSize(ImVec2(0, 0), ImGuiCond_FirstUseEver);
@@ -535,6 +594,14 @@ void VulkanBase::UpdateOverlay()
 #endif
 	ImGui::PushItemWidth(110.0f * UIOverlay.scale);
 	OnUpdateUIOverlay(&UIOverlay);
+	// GPU times of the scopes recorded by the sample, nested scopes are indented
+	if (!gpuProfiler.Timings().empty() && UIOverlay.Header("GPU timings"))
+	{
+		for (auto& timing : gpuProfiler.Timings())
+		{
+			UIOverlay.Text("%*s%s: %.3f ms", static_cast<int>(timing.depth * 2), "", timing.name.c_str(), timing.smoothed);
+		}
+	}
 	ImGui::PopItemWidth();
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	ImGui::PopStyleVar();
@@ -544,6 +611,14 @@ void VulkanBase::UpdateOverlay()
 	ImGui::PopStyleVar();
 	ImGui::Render();
 
+	// The overlay is drawn by the next frame, whose buffers may still be read by the GPU until its fence has been signaled
+	UIOverlay.SetFrame(currentFrame);
+	VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentFrame], VK_TRUE, UINT64_MAX));
+	// Command buffers of all frames may be re-recorded
+	if (UIOverlay.BufferUpdateRequired() || UIOverlay.updated)
+	{
+		WaitForFramesInFlight();
+	}
 	if (UIOverlay.Update() || UIOverlay.updated) 
     {
 		BuildCommandBuffers();
@@ -573,6 +648,9 @@ void VulkanBase::DrawUI(const VkCommandBuffer commandBuffer)
 
 void VulkanBase::PrepareFrame()
 {
+    // Wait until the GPU has finished the frame that last used this frame's semaphore and fence
+    VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentFrame], VK_TRUE, UINT64_MAX));
+    semaphores.presentComplete = presentCompleteSemaphores[currentFrame];
     // Acquire the next image from the swap chain
     VkResult result = swapChain.AcquireNextImage(semaphores.presentComplete, &currentBuffer);
     // Recreate the swap chain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presnetation (SUBOPTIMAL)
@@ -580,11 +658,26 @@ void VulkanBase::PrepareFrame()
         WindowResize();
     else
         VK_CHECK_RESULT(result);
+    // The command buffer of the acquired image may still be executing for an older frame
+    if (imageFences[currentBuffer] != VK_NULL_HANDLE && imageFences[currentBuffer] != waitFences[currentFrame])
+        VK_CHECK_RESULT(vkWaitForFences(device, 1, &imageFences[currentBuffer], VK_TRUE, UINT64_MAX));
+    imageFences[currentBuffer] = waitFences[currentFrame];
+    semaphores.renderComplete = renderCompleteSemaphores[currentBuffer];
+    // The image's last submission has finished, so its timestamps can be read without waiting
+    gpuProfiler.Resolve(currentBuffer);
 }
 
 void VulkanBase::SubmitFrame()
 {
+    gpuProfiler.Submitted(currentBuffer);
     VkResult result = swapChain.QueuePresent(queue, currentBuffer, semaphores.renderComplete);
+    // Samples submit their command buffers without a fence, an empty submission signals the frame's fence once all of them have finished
+    VK_CHECK_RESULT(vkResetFences(device, 1, &waitFences[currentFrame]));
+    VK_CHECK_RESULT(vkQueueSubmit(queue, 0, nullptr, waitFences[currentFrame]));
+    // With a single frame in flight the CPU and GPU are serialized, so the sample can update its resources right away
+    if (waitFences.size() == 1)
+        VK_CHECK_RESULT(vkWaitForFences(device, 1, &waitFences[currentFrame], VK_TRUE, UINT64_MAX));
+    currentFrame = (currentFrame + 1) % static_cast<uint32_t>(waitFences.size());
     if (!((result == VK_SUCCESS) || (result == VK_SUBOPTIMAL_KHR))) {
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			// Swap chain is no longer compatible with the surface and needs to be recreated
@@ -594,11 +687,30 @@ void VulkanBase::SubmitFrame()
 			VK_CHECK_RESULT(result);
 		}
 	}
-	VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+}
+
+void VulkanBase::WaitForFramesInFlight()
+{
+	if (!waitFences.empty())
+	{
+		VK_CHECK_RESULT(vkWaitForFences(device, static_cast<uint32_t>(waitFences.size()), waitFences.data(), VK_TRUE, UINT64_MAX));
+	}
+}
+
+void VulkanBase::SetFramesInFlight(uint32_t count)
+{
+	vkDeviceWaitIdle(device);
+	DestroySynchronizationPrimitives();
+	settings.framesInFlight = count > 0 ? count : 1;
+	CreateSynchronizationPrimitives();
+	if (settings.overlay)
+		UIOverlay.SetFrameCount(settings.framesInFlight);
 }
 
 VulkanBase::VulkanBase(bool enableValidation)
 {
+	startTimestamp = std::chrono::high_resolution_clock::now();
+
 #if !defined(VK_USE_PLATFORM_ANDROID_KHR)
 	// Check for a valid asset path
 	struct stat info;
@@ -701,6 +813,37 @@ VulkanBase::VulkanBase(bool enableValidation)
         {
 			benchmark.outputFrameTimes = true;
 		}
+		// Ignore the pipeline cache of the last run
+		if ((args[i] == std::string("-npc")) || (args[i] == std::string("--nopipelinecache"))) 
+        {
+			settings.loadPipelineCache = false;
+		}
+		// Ignore the mesh cache files of the last run
+		if ((args[i] == std::string("-nmc")) || (args[i] == std::string("--nomeshcache"))) 
+        {
+			vks::MeshCache::Get().load = false;
+		}
+		// Print the processing statistics of each loaded mesh
+		if ((args[i] == std::string("-vm")) || (args[i] == std::string("--verbosemeshes"))) 
+        {
+			vks::MeshCache::Get().verbose = true;
+		}
+		// Number of frames in flight
+		if ((args[i] == std::string("-fif")) || (args[i] == std::string("--framesinflight"))) 
+        {
+			if (args.size() > i + 1) 
+            {
+				uint32_t num = strtol(args[i + 1], &numConvPtr, 10);
+				if ((numConvPtr != args[i + 1]) && (num > 0)) 
+                {
+					settings.framesInFlight = num;
+				}
+				else 
+                {
+					std::cerr << "Number of frames in flight must be specified as a number greater than zero!" << std::endl;
+				}
+			}
+		}
 	}
 	
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -749,15 +892,16 @@ VulkanBase::~VulkanBase()
 	vkDestroyImage(device, depthStencil.image, nullptr);
 	vkFreeMemory(device, depthStencil.mem, nullptr);
 
-	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	// Merges the worker caches, so pipelines built in parallel end up in the saved cache
+	pipelineBuilder.Destroy();
+	persistentPipelineCache.Save();
+	persistentPipelineCache.Destroy();
 
 	vkDestroyCommandPool(device, cmdPool, nullptr);
 
-	vkDestroySemaphore(device, semaphores.presentComplete, nullptr);
-	vkDestroySemaphore(device, semaphores.renderComplete, nullptr);
-	for (auto& fence : waitFences) {
-		vkDestroyFence(device, fence, nullptr);
-	}
+	DestroySynchronizationPrimitives();
+
+	gpuProfiler.Destroy();
 
 	if (settings.overlay) {
 		UIOverlay.FreeResources();
@@ -920,17 +1064,8 @@ bool VulkanBase::InitVulkan()
 
 	swapChain.Connect(instance, physicalDevice, device);
 
-	// Create synchronization objects
-	VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::SemaphoreCreateInfo();
-	// Create a semaphore used to synchronize image presentation
-	// Ensures that the image is displayed before we start submitting new commands to the queu
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphores.presentComplete));
-	// Create a semaphore used to synchronize command submission
-	// Ensures that the image is not presented until all commands have been sumbitted and executed
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphores.renderComplete));
-
 	// Set up submit info structure
-	// Semaphores will stay the same during application lifetime
+	// Points to the semaphores of the current frame, which are created in CreateSynchronizationPrimitives and switched in PrepareFrame
 	// Command buffer submission info is set by each example
 	submitInfo = vks::initializers::SubmitInfo();
 	submitInfo.pWaitDstStageMask = &submitPipelineStages;
@@ -1964,13 +2099,57 @@ void VulkanBase::BuildCommandBuffers() {}
 
 void VulkanBase::CreateSynchronizationPrimitives()
 {
-	// Wait fences to sync command buffer access
+	// Wait fences and image acquisition semaphores for each frame in flight
 	VkFenceCreateInfo fenceCreateInfo = vks::initializers::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
-	waitFences.resize(drawCmdBuffers.size());
-	for (auto& fence : waitFences) 
+	VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::SemaphoreCreateInfo();
+	waitFences.resize(settings.framesInFlight);
+	presentCompleteSemaphores.resize(settings.framesInFlight);
+	for (uint32_t i = 0; i < settings.framesInFlight; i++)
     {
-		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
+		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &waitFences[i]));
+		// Ensures that the image is displayed before we start submitting new commands to the queue
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &presentCompleteSemaphores[i]));
+	}
+	currentFrame = 0;
+	semaphores.presentComplete = presentCompleteSemaphores[0];
+	CreateImageSynchronizationPrimitives();
+}
+
+void VulkanBase::CreateImageSynchronizationPrimitives()
+{
+	// Ensures that the image is not presented until all commands have been sumbitted and executed
+	VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::SemaphoreCreateInfo();
+	for (auto& semaphore : renderCompleteSemaphores)
+	{
+		vkDestroySemaphore(device, semaphore, nullptr);
+	}
+	renderCompleteSemaphores.resize(swapChain.imageCount);
+	for (auto& semaphore : renderCompleteSemaphores)
+	{
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphore));
+	}
+	semaphores.renderComplete = renderCompleteSemaphores[0];
+	imageFences.assign(swapChain.imageCount, VK_NULL_HANDLE);
+}
+
+void VulkanBase::DestroySynchronizationPrimitives()
+{
+	for (auto& fence : waitFences)
+	{
+		vkDestroyFence(device, fence, nullptr);
+	}
+	for (auto& semaphore : presentCompleteSemaphores)
+	{
+		vkDestroySemaphore(device, semaphore, nullptr);
+	}
+	for (auto& semaphore : renderCompleteSemaphores)
+	{
+		vkDestroySemaphore(device, semaphore, nullptr);
 	}
+	waitFences.clear();
+	presentCompleteSemaphores.clear();
+	renderCompleteSemaphores.clear();
+	imageFences.clear();
 }
 
 void VulkanBase::CreateCommandPool()
@@ -2142,6 +2321,8 @@ void VulkanBase::WindowResize()
 	width = destWidth;
 	height = destHeight;
 	SetupSwapChain();
+	// The number of swap chain images may have changed
+	CreateImageSynchronizationPrimitives();
 
 	// Recreate the frame buffers
 	vkDestroyImageView(device, depthStencil.view, nullptr);
@@ -2164,6 +2345,7 @@ void VulkanBase::WindowResize()
 	// references to the recreated frame buffer
 	DestroyCommandBuffers();
 	CreateCommandBuffers();
+	CreateGpuProfiler();
 	BuildCommandBuffers();
 
 	vkDeviceWaitIdle(device);
@@ -49,6 +49,10 @@
 #include "VulkanSwapChain.hpp"
 #include "Camera.hpp"
 #include "Benchmark.hpp"
+#include "VulkanPipelineCache.hpp"
+#include "VulkanMeshCache.hpp"
+#include "VulkanPipelineBuilder.hpp"
+#include "VulkanProfiler.hpp"
 
 class VulkanBase
 {
@@ -63,12 +67,20 @@ private:
     void NextFrame();
     void UpdateOverlay();
     void CreatePipelineCache();
+    std::string GetPipelineCacheFilename();
     void CreateCommandPool();
     void CreateSynchronizationPrimitives();
+    void DestroySynchronizationPrimitives();
+    void CreateImageSynchronizationPrimitives();
     void InitSwapChain();
     void SetupSwapChain();
     void CreateCommandBuffers();
     void DestroyCommandBuffers();
+    void CreateGpuProfiler();
+    // Pipeline cache persisted to disk between runs
+    vks::PipelineCache persistentPipelineCache;
+    // Time the example was created at, used to measure startup time
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTimestamp;
 protected:
     // Frame counter to display fps
 	uint32_t frameCounter = 0;
@@ -117,9 +129,13 @@ protected:
 	std::vector<VkShaderModule> shaderModules;
 	// Pipeline cache object
 	VkPipelineCache pipelineCache;
+	// Compiles pipelines on worker threads, merges its per-thread caches into pipelineCache
+	vks::PipelineBuilder pipelineBuilder;
+	// GPU times of named scopes, with one slot per command buffer in drawCmdBuffers (see vks::GpuProfiler)
+	vks::GpuProfiler gpuProfiler;
 	// Wraps the swap chain to present images (framebuffers) to the windowing system
 	VulkanSwapChain swapChain;
-	// Synchronization semaphores
+	// Synchronization semaphores of the current frame (switched by PrepareFrame)
 	struct 
     {
 		// Swap chain image presentation
@@ -127,7 +143,16 @@ protected:
 		// Command buffer submission and execution
 		VkSemaphore renderComplete;
 	} semaphores;
+	// One fence per frame in flight, signaled once all work submitted for that frame has finished
 	std::vector<VkFence> waitFences;
+	// Index of the current frame in flight
+	uint32_t currentFrame = 0;
+	// Image acquisition semaphores, one per frame in flight
+	std::vector<VkSemaphore> presentCompleteSemaphores;
+	// Render complete semaphores, one per swap chain image as they're only free again once the image has been presented
+	std::vector<VkSemaphore> renderCompleteSemaphores;
+	// Fence of the frame that last rendered to each swap chain image (not owned)
+	std::vector<VkFence> imageFences;
     public: 
 	bool prepared = false;
 	uint32_t width = 1280;
@@ -154,6 +179,15 @@ protected:
 		bool vsync = false;
 		/** @brief Enable UI overlay */
 		bool overlay = false;
+		/** @brief Number of frames the CPU may record and submit ahead of the GPU, 1 waits for each frame to finish before starting the next one */
+		uint32_t framesInFlight = 2;
+		/**
+		* @brief Set by samples that keep the resources they write every frame (uniform buffers, re-recorded command buffers) per frame in flight,
+		* all other samples run with a single frame in flight regardless of framesInFlight
+		*/
+		bool multipleFramesInFlight = false;
+		/** @brief Initialize the pipeline cache from the file written by the last run, if false it's only written (cold start) */
+		bool loadPipelineCache = true;
 	} settings;
 
 	VkClearColorValue defaultClearColor = { { 0.025f, 0.025f, 0.025f, 1.0f } };
@@ -340,6 +374,10 @@ protected:
 	void PrepareFrame();
 	/** @brief Presents the current image to the swap chain */
 	void SubmitFrame();
+	/** @brief Waits until the GPU has finished all frames in flight, required before changing resources that submitted frames may still use (e.g. re-recording all command buffers) */
+	void WaitForFramesInFlight();
+	/** @brief Changes the number of frames in flight at runtime (only for samples that set settings.multipleFramesInFlight) */
+	void SetFramesInFlight(uint32_t count);
 	/** @brief (Virtual) Default image acquire + submission and command buffer submission function */
 	virtual void RenderFrame();
 
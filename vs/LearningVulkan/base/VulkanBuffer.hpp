@@ -5,6 +5,7 @@
 
 #include "vulkan/vk_platform.h"
 #include "VulkanTools.h"
+#include "VulkanMemoryAllocator.hpp"
 
 namespace vks
 {
@@ -13,6 +14,8 @@ namespace vks
         VkDevice device;
         VkBuffer buffer = VK_NULL_HANDLE;
         VkDeviceMemory memory = VK_NULL_HANDLE;
+        /** @brief Range of the memory owned by this buffer if it has been created by the memory allocator, memory is shared with other resources then */
+        MemoryAllocation allocation;
         VkDescriptorBufferInfo descriptor;
         VkDeviceSize size = 0;
         VkDeviceSize aligment = 0;
@@ -33,6 +36,14 @@ namespace vks
 		*/
         VkResult Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
         {
+            if (allocation)
+            {
+                // Sub-allocated memory is persistently mapped by the allocator
+                if (!allocation.mapped)
+                    return VK_ERROR_MEMORY_MAP_FAILED;
+                mapped = static_cast<uint8_t*>(allocation.mapped) + offset;
+                return VK_SUCCESS;
+            }
             return vkMapMemory(device, memory, offset, size, 0, &mapped);
         }
 
@@ -45,7 +56,8 @@ namespace vks
         {
             if (mapped)
             {
-                vkUnmapMemory(device, memory);
+                if (!allocation)
+                    vkUnmapMemory(device, memory);
                 mapped = nullptr;
             }
         }
@@ -59,7 +71,7 @@ namespace vks
 		*/
         VkResult Bind(VkDeviceSize offset = 0)
         {
-            return vkBindBufferMemory(device, buffer, memory, offset);
+            return vkBindBufferMemory(device, buffer, memory, allocation.offset + offset);
         }
 
 		/**
@@ -101,6 +113,8 @@ namespace vks
 		*/
         VkResult Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
         {
+            if (allocation)
+                return allocation.allocator->Flush(allocation, size, offset);
             VkMappedMemoryRange mappedrange = {};
             mappedrange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
             mappedrange.memory = memory;
@@ -121,6 +135,8 @@ namespace vks
 		*/
         VkResult Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
         {
+            if (allocation)
+                return allocation.allocator->Invalidate(allocation, size, offset);
             VkMappedMemoryRange mappedrange = {};
             mappedrange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
             mappedrange.memory = memory;
@@ -136,7 +152,9 @@ namespace vks
         {
             if (buffer)
                 vkDestroyBuffer(device, buffer, nullptr);
-            if (memory)
+            if (allocation)
+                allocation.Free();
+            else if (memory)
                 vkFreeMemory(device, memory, nullptr);
         }
     };
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+#include <glm/glm.hpp>
+
+#include "VulkanDevice.hpp"
+#include "VulkanBuffer.hpp"
+#include "VulkanModel.hpp"
+#include "VulkanTools.h"
+#include "Frustum.hpp"
+
+namespace vks
+{
+	/**
+	* GPU culling of the meshlets of a model (see vks::ModelCreateInfo::meshlets)
+	*
+	* A compute pass tests the bounding sphere of each meshlet against the view frustum and its normal cone against the camera position,
+	* and compacts the indices of the visible meshlets into a separate index buffer that is drawn with a single indirect draw.
+	*
+	* Usage:
+	* - Create once after the model has been loaded
+	* - Update whenever the camera changes
+	* - Record outside of a render pass, then Draw inside of it in place of the model's vkCmdDrawIndexed
+	*/
+	class ClusterCuller
+	{
+	private:
+		vks::VulkanDevice* vulkanDevice = nullptr;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline pipeline = VK_NULL_HANDLE;
+
+		/** @brief Meshlets of the culled parts (input) */
+		vks::Buffer clusters;
+		/** @brief Indices of the visible meshlets (output), bound as index buffer for the draw */
+		vks::Buffer visibleIndices;
+		/** @brief VkDrawIndexedIndirectCommand whose index count is accumulated by the shader */
+		vks::Buffer drawCommand;
+		vks::Buffer uniformBuffer;
+
+		// Same layout as the shader's uniform block
+		struct UniformData
+		{
+			glm::vec4 frustumPlanes[6];
+			glm::vec4 cameraPos;
+			uint32_t clusterCount;
+			uint32_t coneCulling;
+			uint32_t padding[2];
+		} uniformData;
+
+	public:
+		/** @brief False if the culling shader couldn't be loaded or the model has no meshlets, Draw must not be used then */
+		bool ready = false;
+		/** @brief Number of meshlets tested per dispatch */
+		uint32_t clusterCount = 0;
+		/** @brief Number of indices of all culled parts, the upper bound of the indirect draw */
+		uint32_t indexCount = 0;
+
+		/**
+		* Create the buffers and the compute pipeline
+		*
+		* @param device Device to create the resources on
+		* @param model Model loaded with meshlets
+		* @param shaderFile Path of the compiled cluster culling shader (base/clustercull.comp.spv)
+		* @param pipelineCache (Optional) Pipeline cache used to create the compute pipeline
+		* @param firstPart (Optional) First model part whose meshlets are culled
+		* @param partCount (Optional) Number of parts to cull, by default all parts after firstPart (pass 1 for the full detail level of a model with levels of detail)
+		*
+		* @return True if the culler can be used
+		*/
+		bool Create(vks::VulkanDevice* device, const vks::Model& model, const std::string& shaderFile, VkPipelineCache pipelineCache = VK_NULL_HANDLE, uint32_t firstPart = 0, uint32_t partCount = ~0u)
+		{
+			vulkanDevice = device;
+			ready = false;
+
+			std::vector<vks::meshopt::Meshlet> meshlets;
+			indexCount = 0;
+			for (uint32_t i = firstPart; (i < model.parts.size()) && (i - firstPart < partCount); i++)
+			{
+				const vks::Model::ModelPart& part = model.parts[i];
+				meshlets.insert(meshlets.end(), model.meshlets.begin() + part.meshletBase, model.meshlets.begin() + part.meshletBase + part.meshletCount);
+				indexCount += part.indexCount;
+			}
+			clusterCount = static_cast<uint32_t>(meshlets.size());
+			if ((clusterCount == 0) || ((model.indices.usageFlags & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) == 0))
+			{
+				printf("Cluster culling disabled, the model has not been loaded with meshlets\n");
+				return false;
+			}
+
+			VkShaderModule shaderModule = vks::tools::LoadShader(shaderFile.c_str(), device->logicalDevice);
+			if (shaderModule == VK_NULL_HANDLE)
+			{
+				printf("Cluster culling disabled, the shader \"%s\" could not be loaded\n", shaderFile.c_str());
+				return false;
+			}
+
+			// Buffers
+			const VkDeviceSize clustersSize = meshlets.size() * sizeof(vks::meshopt::Meshlet);
+			VK_CHECK_RESULT(device->CreateBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&clusters,
+				clustersSize));
+			VK_CHECK_RESULT(device->CreateBuffer(
+				VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&visibleIndices,
+				static_cast<VkDeviceSize>(indexCount) * sizeof(uint32_t)));
+			VK_CHECK_RESULT(device->CreateBuffer(
+				VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&drawCommand,
+				sizeof(VkDrawIndexedIndirectCommand)));
+			VK_CHECK_RESULT(device->CreateBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&uniformBuffer,
+				sizeof(uniformData)));
+			VK_CHECK_RESULT(uniformBuffer.Map());
+
+			// The index count is reset every frame, the other members of the draw stay the same
+			VkDrawIndexedIndirectCommand command = {};
+			command.instanceCount = 1;
+			device->uploader.UploadBuffer(clusters.buffer, meshlets.data(), clustersSize);
+			device->uploader.UploadBuffer(drawCommand.buffer, &command, sizeof(command));
+			device->uploader.Submit();
+
+			uniformData = {};
+			uniformData.clusterCount = clusterCount;
+			memcpy(uniformBuffer.mapped, &uniformData, sizeof(uniformData));
+
+			// Descriptors
+			std::vector<VkDescriptorPoolSize> poolSizes =
+			{
+				vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+				vks::initializers::DescriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4)
+			};
+			VkDescriptorPoolCreateInfo descriptorPoolInfo = vks::initializers::DescriptorPoolCreateInfo(poolSizes, 1);
+			VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+
+			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings =
+			{
+				// Binding 0: Frustum planes and camera position
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+				// Binding 1: Meshlets
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+				// Binding 2: Indices of the model
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+				// Binding 3: Indices of the visible meshlets
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+				// Binding 4: Indirect draw command
+				vks::initializers::DescriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4)
+			};
+			VkDescriptorSetLayoutCreateInfo descriptorLayout = vks::initializers::DescriptorSetLayoutCreateInfo(setLayoutBindings.data(), static_cast<uint32_t>(setLayoutBindings.size()));
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayout, nullptr, &descriptorSetLayout));
+
+			VkDescriptorSetAllocateInfo allocInfo = vks::initializers::DescriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &allocInfo, &descriptorSet));
+
+			VkDescriptorBufferInfo sourceIndices = { model.indices.buffer, 0, VK_WHOLE_SIZE };
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets =
+			{
+				vks::initializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffer.descriptor),
+				vks::initializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &clusters.descriptor),
+				vks::initializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &sourceIndices),
+				vks::initializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3, &visibleIndices.descriptor),
+				vks::initializers::WriteDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &drawCommand.descriptor)
+			};
+			vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+			// Pipeline
+			VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vks::initializers::PipelineLayoutCreateInfo(&descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+
+			VkComputePipelineCreateInfo computePipelineCreateInfo = vks::initializers::ComputePipelineCreateInfo(pipelineLayout, 0);
+			computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			computePipelineCreateInfo.stage.module = shaderModule;
+			computePipelineCreateInfo.stage.pName = "main";
+			VK_CHECK_RESULT(vkCreateComputePipelines(device->logicalDevice, pipelineCache, 1, &computePipelineCreateInfo, nullptr, &pipeline));
+			vkDestroyShaderModule(device->logicalDevice, shaderModule, nullptr);
+
+			ready = true;
+			return true;
+		}
+
+		/**
+		* Update the culling parameters
+		*
+		* @param modelViewProjection Transform from model to clip space, the frustum planes are extracted in model space
+		* @param cameraPos Camera position in model space
+		* @param coneCulling Cull meshlets that only contain back faces, only enable if the draw culls back faces
+		*/
+		void Update(const glm::mat4& modelViewProjection, const glm::vec3& cameraPos, bool coneCulling)
+		{
+			if (!ready)
+				return;
+			vks::Frustum frustum;
+			frustum.Update(modelViewProjection);
+			for (uint32_t i = 0; i < 6; i++)
+			{
+				uniformData.frustumPlanes[i] = frustum.planes[i];
+			}
+			uniformData.cameraPos = glm::vec4(cameraPos, 1.0f);
+			uniformData.coneCulling = coneCulling ? 1u : 0u;
+			memcpy(uniformBuffer.mapped, &uniformData, sizeof(uniformData));
+		}
+
+		/** @brief Record the culling pass, must be outside of a render pass and before Draw */
+		void Record(VkCommandBuffer commandBuffer)
+		{
+			if (!ready)
+				return;
+
+			// The previous draw must have consumed the output before it is reset and rewritten
+			VkBufferMemoryBarrier bufferBarrier = vks::initializers::BufferMemoryBarrier();
+			bufferBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = drawCommand.buffer;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+			vkCmdFillBuffer(commandBuffer, drawCommand.buffer, 0, sizeof(uint32_t), 0);
+
+			bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+			// One workgroup per meshlet, split into rows if there are more than the guaranteed limit of a dimension
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+			const uint32_t maxGroupCount = 65535;
+			vkCmdDispatch(commandBuffer, (std::min)(clusterCount, maxGroupCount), (clusterCount + maxGroupCount - 1) / maxGroupCount, 1);
+
+			VkBufferMemoryBarrier outputBarriers[2];
+			outputBarriers[0] = vks::initializers::BufferMemoryBarrier();
+			outputBarriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			outputBarriers[0].dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			outputBarriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			outputBarriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			outputBarriers[0].buffer = drawCommand.buffer;
+			outputBarriers[0].size = VK_WHOLE_SIZE;
+			outputBarriers[1] = outputBarriers[0];
+			outputBarriers[1].dstAccessMask = VK_ACCESS_INDEX_READ_BIT;
+			outputBarriers[1].buffer = visibleIndices.buffer;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+				0, 0, nullptr, 2, outputBarriers, 0, nullptr);
+		}
+
+		/** @brief Draw the visible meshlets, the model's vertex buffer and a graphics pipeline must be bound */
+		void Draw(VkCommandBuffer commandBuffer)
+		{
+			if (!ready)
+				return;
+			vkCmdBindIndexBuffer(commandBuffer, visibleIndices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdDrawIndexedIndirect(commandBuffer, drawCommand.buffer, 0, 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		/** @brief Release all Vulkan resources */
+		void Destroy()
+		{
+			if (vulkanDevice == nullptr)
+				return;
+			VkDevice device = vulkanDevice->logicalDevice;
+			vkDestroyPipeline(device, pipeline, nullptr);
+			vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+			vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+			vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+			clusters.Destroy();
+			visibleIndices.Destroy();
+			drawCommand.Destroy();
+			uniformBuffer.Destroy();
+			vulkanDevice = nullptr;
+			ready = false;
+		}
+	};
+}
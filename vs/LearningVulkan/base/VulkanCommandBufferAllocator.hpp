@@ -0,0 +1,149 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+#include "VulkanInitializers.hpp"
+
+namespace vks
+{
+	/**
+	* Command buffers for recording from multiple threads, with one command pool per thread and frame in flight
+	*
+	* Command buffers are handed out linearly from the pool of the calling thread and the current frame, and are only valid for that frame.
+	* Instead of resetting or freeing them one by one, all pools of a frame are reset with vkResetCommandPool once the frame's fence has been signaled,
+	* which keeps the command buffers (and their memory) for the next time the frame is recorded.
+	* The pools are created without VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, so the driver doesn't need to track the command buffers separately.
+	*
+	* Each thread index must only be used by one thread at a time, which makes the allocator safe for multi-threaded recording without locks.
+	*/
+	class CommandBufferAllocator
+	{
+	private:
+		struct Pool
+		{
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			/** @brief Command buffers allocated so far, indexed by level */
+			std::vector<VkCommandBuffer> commandBuffers[2];
+			/** @brief Command buffers handed out since the last reset, indexed by level */
+			uint32_t used[2] = { 0, 0 };
+			/** @brief Calls to vkAllocateCommandBuffers, counted per pool as pools are used by different threads */
+			uint32_t allocations = 0;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		uint32_t threadCount = 0;
+		uint32_t frameCount = 0;
+		uint32_t currentFrame = 0;
+		// Pools of all threads for the first frame, followed by the ones for the next frames
+		std::vector<Pool> pools;
+
+	public:
+		/** @brief Number of command pool resets since creation */
+		uint32_t poolResets = 0;
+
+		/**
+		* Create the command pools
+		*
+		* @param device Logical device
+		* @param queueFamilyIndex Family of the queue the command buffers are submitted to
+		* @param threadCount Number of threads that record command buffers
+		* @param frameCount Number of frames in flight
+		*/
+		void Create(VkDevice device, uint32_t queueFamilyIndex, uint32_t threadCount, uint32_t frameCount)
+		{
+			assert((threadCount > 0) && (frameCount > 0));
+			this->device = device;
+			this->threadCount = threadCount;
+			this->frameCount = frameCount;
+			currentFrame = 0;
+			pools.resize(threadCount * frameCount);
+			for (auto& pool : pools)
+			{
+				VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::CommandPoolCreateInfo();
+				cmdPoolInfo.queueFamilyIndex = queueFamilyIndex;
+				cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+				VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &pool.commandPool));
+			}
+		}
+
+		/** @brief Destroy the command pools, which also frees all command buffers */
+		void Destroy()
+		{
+			for (auto& pool : pools)
+			{
+				vkDestroyCommandPool(device, pool.commandPool, nullptr);
+			}
+			pools.clear();
+		}
+
+		/**
+		* Start recording a frame, resets the command pools of all threads for the frame
+		*
+		* @param frame Index of the frame in flight (wraps around at the frame count)
+		*
+		* @note The GPU must have finished all command buffers handed out for this frame the last time, e.g. by waiting for the frame's fence
+		*/
+		void BeginFrame(uint32_t frame)
+		{
+			currentFrame = frame % frameCount;
+			for (uint32_t thread = 0; thread < threadCount; thread++)
+			{
+				Pool& pool = pools[currentFrame * threadCount + thread];
+				if ((pool.used[0] == 0) && (pool.used[1] == 0))
+					continue;
+				VK_CHECK_RESULT(vkResetCommandPool(device, pool.commandPool, 0));
+				pool.used[0] = pool.used[1] = 0;
+				poolResets++;
+			}
+		}
+
+		/**
+		* Returns an unused command buffer of the current frame, ready to be begun
+		*
+		* @param thread Index of the calling thread
+		* @param level Level of the command buffer (primary or secondary)
+		*/
+		VkCommandBuffer Acquire(uint32_t thread, VkCommandBufferLevel level)
+		{
+			assert(thread < threadCount);
+			Pool& pool = pools[currentFrame * threadCount + thread];
+			const uint32_t levelIndex = (level == VK_COMMAND_BUFFER_LEVEL_PRIMARY) ? 0 : 1;
+			std::vector<VkCommandBuffer>& commandBuffers = pool.commandBuffers[levelIndex];
+			if (pool.used[levelIndex] == commandBuffers.size())
+			{
+				// Grow by half of the current size so the pools quickly settle at the number of command buffers a frame needs
+				const uint32_t count = (std::max)(static_cast<uint32_t>(commandBuffers.size() / 2), 1u);
+				commandBuffers.resize(commandBuffers.size() + count);
+				VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::CommandBufferAllocateInfo(pool.commandPool, level, count);
+				VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &commandBuffers[pool.used[levelIndex]]));
+				pool.allocations++;
+			}
+			return commandBuffers[pool.used[levelIndex]++];
+		}
+
+		/** @brief Calls to vkAllocateCommandBuffers since creation, stops growing once every pool holds as many command buffers as a frame needs */
+		uint32_t AllocationCount() const
+		{
+			uint32_t count = 0;
+			for (auto& pool : pools)
+			{
+				count += pool.allocations;
+			}
+			return count;
+		}
+
+		uint32_t ThreadCount() const
+		{
+			return threadCount;
+		}
+
+		uint32_t FrameCount() const
+		{
+			return frameCount;
+		}
+	};
+}
@@ -8,6 +8,7 @@
 #include "vulkan/vulkan.h"
 #include "VulkanTools.h"
 #include "VulkanBuffer.hpp"
+#include "VulkanUploader.hpp"
 
 
 namespace vks
@@ -33,6 +34,10 @@ namespace vks
 
         /** @brief Default command pool for the graphics queue family index */
         VkCommandPool commandPool = VK_NULL_HANDLE;
+        /** @brief Sub-allocates device memory for buffers, textures and framebuffer attachments */
+        vks::MemoryAllocator memoryAllocator;
+        /** @brief Stages and batches uploads to device local buffers and images, on a dedicated transfer queue if available */
+        vks::Uploader uploader;
 
         /** @brief Set to true when the debug marker extension is detected */
 		bool enableDebugMarkers = false;
@@ -97,6 +102,8 @@ namespace vks
         {
             if (commandPool)
                 vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
+            uploader.Destroy();
+            memoryAllocator.Destroy();
             if (logicalDevice)
                 vkDestroyDevice(logicalDevice, nullptr);
         }
@@ -206,7 +213,7 @@ namespace vks
             std::vector<const char*> enabledExtensions, 
             void* pNextChain,
             bool useSwapChain = true,
-            VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)
+            VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT)
         {
             // Desired queues need to be requested upon logical device creation
             // Due to differing queue family configurations of Vulkan implementations this can be a bit tricky, especially if the application
@@ -252,6 +259,26 @@ namespace vks
                 queueFamilyIndices.compute = queueFamilyIndices.graphics;
             }
 
+            // Dedicated transfer queue, used by the uploader
+            if (requestedQueueTypes & VK_QUEUE_TRANSFER_BIT)
+            {
+                queueFamilyIndices.transfer = GetQueueFamilyIndex(VK_QUEUE_TRANSFER_BIT);
+                if ((queueFamilyIndices.transfer != queueFamilyIndices.graphics) && (queueFamilyIndices.transfer != queueFamilyIndices.compute))
+                {
+                    // If transfer family index differs, we need an additional queue create info for the transfer queue
+                    VkDeviceQueueCreateInfo queueInfo{};
+                    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+                    queueInfo.queueFamilyIndex = queueFamilyIndices.transfer;
+                    queueInfo.queueCount = 1;
+                    queueInfo.pQueuePriorities = &defaultQueuePriority;
+                    queueCreateInfos.emplace_back(queueInfo);
+                }
+            }
+            else
+            {
+                queueFamilyIndices.transfer = queueFamilyIndices.graphics;
+            }
+
             // Create the logical device representation
             std::vector<const char*> deviceExtensions(enabledExtensions);
             if (useSwapChain)
@@ -294,6 +321,10 @@ namespace vks
             {
                 // Create a default command pool for graphics command buffers
                 commandPool = CreateCommandPool(queueFamilyIndices.graphics);
+                memoryAllocator.Create(physicalDevice, logicalDevice);
+                // Uploaded resources are handed over to the graphics queue (or the compute queue for compute only devices)
+                uint32_t consumerFamily = (requestedQueueTypes & VK_QUEUE_GRAPHICS_BIT) ? queueFamilyIndices.graphics : queueFamilyIndices.compute;
+                uploader.Create(logicalDevice, &memoryAllocator, properties, consumerFamily, queueFamilyIndices.transfer);
             }
 
             this->enabledFeatures = enabledFeatures;
@@ -364,6 +395,9 @@ namespace vks
 		* @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
 		*
 		* @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
+		*
+		* @note The memory is sub-allocated by the memoryAllocator and shared with other resources, host visible buffers that are
+		* only used as a transfer source (staging buffers) are placed in the allocator's transient pools
 		*/
         VkResult CreateBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vks::Buffer *buffer, VkDeviceSize size, void *data = nullptr)
 		{
@@ -373,14 +407,12 @@ namespace vks
 			VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo(usageFlags, size);
 			VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, &buffer->buffer));
 
-			// Create the memory backing up the buffer handle
+			// Sub-allocate the memory backing up the buffer handle, this also binds it to the buffer
 			VkMemoryRequirements memReqs;
-			VkMemoryAllocateInfo memAlloc = vks::initializers::MemoryAllocateInfo();
 			vkGetBufferMemoryRequirements(logicalDevice, buffer->buffer, &memReqs);
-			memAlloc.allocationSize = memReqs.size;
-			// Find a memory type index that fits the properties of the buffer
-			memAlloc.memoryTypeIndex = GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-			VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAlloc, nullptr, &buffer->memory));
+			bool staging = (usageFlags == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) && (memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+			VK_CHECK_RESULT(memoryAllocator.AllocateBuffer(buffer->buffer, memoryPropertyFlags, &buffer->allocation, staging ? vks::MemoryUsage::Transient : vks::MemoryUsage::Default));
+			buffer->memory = buffer->allocation.memory;
 
 			buffer->aligment = memReqs.alignment;
 			buffer->size = size;
@@ -401,8 +433,7 @@ namespace vks
 			// Initialize a default descriptor that covers the whole buffer size
 			buffer->SetupDescriptor();
 
-			// Attach the memory to the buffer object
-			return buffer->Bind();
+			return VK_SUCCESS;
 		}
 
         /**
@@ -410,16 +441,16 @@ namespace vks
 		* 
 		* @param src Pointer to the source buffer to copy from
 		* @param dst Pointer to the destination buffer to copy tp
-		* @param queue Pointer
+		* @param queue Unused, the copy is submitted by the uploader
 		* @param copyRegion (Optional) Pointer to a copy region, if NULL, the whole buffer is copied
 		*
 		* @note Source and destionation pointers must have the approriate transfer usage flags set (TRANSFER_SRC / TRANSFER_DST)
+		* @note Inside of an uploader batch the source must stay valid until the batch has ended
 		*/
 		void CopyBuffer(vks::Buffer *src, vks::Buffer *dst, VkQueue queue, VkBufferCopy *copyRegion = nullptr)
 		{
 			assert(dst->size <= src->size);
 			assert(src->buffer);
-			VkCommandBuffer copyCmd = CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 			VkBufferCopy bufferCopy{};
 			if (copyRegion == nullptr)
 			{
@@ -430,9 +461,8 @@ namespace vks
 				bufferCopy = *copyRegion;
 			}
 
-			vkCmdCopyBuffer(copyCmd, src->buffer, dst->buffer, 1, &bufferCopy);
-
-			FlushCommandBuffer(copyCmd, queue);
+			uploader.CopyBuffer(src->buffer, dst->buffer, bufferCopy);
+			uploader.Submit();
 		}
 
         /** 
@@ -17,6 +17,7 @@ namespace vks
 	{
 		VkImage image;
 		VkDeviceMemory memory;
+		vks::MemoryAllocation allocation;
 		VkImageView view;
 		VkFormat format;
 		VkImageSubresourceRange subresourceRange;
@@ -107,11 +108,11 @@ namespace vks
 		~FrameBuffer()
 		{
 			assert(vulkanDevice);
-			for (auto attachment : attachments)
+			for (auto& attachment : attachments)
 			{
 				vkDestroyImage(vulkanDevice->logicalDevice, attachment.image, nullptr);
 				vkDestroyImageView(vulkanDevice->logicalDevice, attachment.view, nullptr);
-				vkFreeMemory(vulkanDevice->logicalDevice, attachment.memory, nullptr);
+				attachment.allocation.Free();
 			}
 			vkDestroySampler(vulkanDevice->logicalDevice, sampler, nullptr);
 			vkDestroyRenderPass(vulkanDevice->logicalDevice, renderPass, nullptr);
@@ -160,16 +161,10 @@ namespace vks
 			image.tiling = VK_IMAGE_TILING_OPTIMAL;
 			image.usage = createInfo.usage;
 
-			VkMemoryAllocateInfo memAlloc = vks::initializers::MemoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
 			// Create image for this attachment
 			VK_CHECK_RESULT(vkCreateImage(vulkanDevice->logicalDevice, &image, nullptr, &attachment.image));
-			vkGetImageMemoryRequirements(vulkanDevice->logicalDevice, attachment.image, &memReqs);
-			memAlloc.allocationSize = memReqs.size;
-			memAlloc.memoryTypeIndex = vulkanDevice->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(vulkanDevice->logicalDevice, &memAlloc, nullptr, &attachment.memory));
-			VK_CHECK_RESULT(vkBindImageMemory(vulkanDevice->logicalDevice, attachment.image, attachment.memory, 0));
+			VK_CHECK_RESULT(vulkanDevice->memoryAllocator.AllocateImage(attachment.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &attachment.allocation));
+			attachment.memory = attachment.allocation.memory;
 
 			attachment.subresourceRange = {};
 			attachment.subresourceRange.aspectMask = aspectMask;
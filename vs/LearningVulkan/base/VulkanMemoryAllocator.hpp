@@ -0,0 +1,904 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <string.h>
+#include <assert.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	class MemoryAllocator;
+	struct MemoryBlock;
+
+	/** @brief Placement hint for an allocation */
+	enum class MemoryUsage
+	{
+		/** @brief Sub-allocated from a block, large requests get their own device allocation */
+		Default,
+		/** @brief Short lived allocation (e.g. staging buffers), linearly allocated from a pool that is recycled once all of its allocations have been freed */
+		Transient,
+		/** @brief Always gets its own device allocation */
+		Dedicated
+	};
+
+	/** @brief Memory range handed out by the MemoryAllocator, resources are bound at memory + offset */
+	struct MemoryAllocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		/** @brief Host address of the allocation for host visible memory, blocks stay mapped for their whole lifetime */
+		void* mapped = nullptr;
+		MemoryAllocator* allocator = nullptr;
+		/** @brief Block the allocation has been taken from, null for dedicated allocations */
+		MemoryBlock* block = nullptr;
+		uint32_t node = 0;
+		uint32_t memoryType = 0;
+
+		explicit operator bool() const
+		{
+			return memory != VK_NULL_HANDLE;
+		}
+
+		/** @brief Return the memory to the allocator it has been taken from */
+		void Free();
+	};
+
+	/**
+	* Two-level segregated fit (TLSF) bookkeeping of the ranges inside a memory block
+	*
+	* Free ranges are binned by size into power of two classes, each split into 16 linear sub classes,
+	* with bitmaps to find a non-empty class large enough for a request in constant time.
+	* Neighbouring free ranges are merged when a range is freed. Only offsets are tracked, device memory is never touched.
+	*/
+	class TlsfMetadata
+	{
+	public:
+		static const uint32_t invalidNode = ~0u;
+
+	private:
+		static const uint32_t slBits = 4;
+		static const uint32_t slCount = 1 << slBits;
+		// Sizes below 1 << minShift share the first level
+		static const uint32_t minShift = 8;
+		static const uint32_t flCount = 64 - minShift + 1;
+
+		struct Node
+		{
+			VkDeviceSize offset;
+			VkDeviceSize size;
+			uint32_t prevPhysical;
+			uint32_t nextPhysical;
+			// Links of the free list of the node's size class, nextFree also links unused nodes
+			uint32_t prevFree;
+			uint32_t nextFree;
+			bool free;
+		};
+
+		std::vector<Node> nodes;
+		uint32_t unusedNodes = invalidNode;
+		uint64_t flBitmap = 0;
+		uint32_t slBitmap[flCount] = {};
+		uint32_t freeLists[flCount][slCount];
+
+		static uint32_t Msb(uint64_t value)
+		{
+#if defined(_MSC_VER) && defined(_M_IX86)
+			// The 64 bit scans are only available on x64
+			unsigned long index;
+			if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+				return index + 32;
+			_BitScanReverse(&index, static_cast<unsigned long>(value));
+			return index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return index;
+#else
+			return 63 - __builtin_clzll(value);
+#endif
+		}
+
+		static uint32_t Lsb(uint64_t value)
+		{
+#if defined(_MSC_VER) && defined(_M_IX86)
+			unsigned long index;
+			if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+				return index;
+			_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+			return index + 32;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return index;
+#else
+			return __builtin_ctzll(value);
+#endif
+		}
+
+		static void Mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
+		{
+			if (size < (1ull << minShift))
+			{
+				fl = 0;
+				sl = static_cast<uint32_t>(size >> (minShift - slBits));
+			}
+			else
+			{
+				uint32_t msb = Msb(size);
+				fl = msb - minShift + 1;
+				sl = static_cast<uint32_t>(size >> (msb - slBits)) & (slCount - 1);
+			}
+		}
+
+		// Rounds the size up to the next class boundary, so every range in the class found for it is large enough
+		static VkDeviceSize RoundUp(VkDeviceSize size)
+		{
+			if (size < (1ull << minShift))
+				return size + (1ull << (minShift - slBits)) - 1;
+			return size + (1ull << (Msb(size) - slBits)) - 1;
+		}
+
+		static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		uint32_t CreateNode(VkDeviceSize offset, VkDeviceSize size)
+		{
+			uint32_t index;
+			if (unusedNodes != invalidNode)
+			{
+				index = unusedNodes;
+				unusedNodes = nodes[index].nextFree;
+			}
+			else
+			{
+				index = static_cast<uint32_t>(nodes.size());
+				nodes.emplace_back();
+			}
+			nodes[index] = { offset, size, invalidNode, invalidNode, invalidNode, invalidNode, false };
+			return index;
+		}
+
+		void ReleaseNode(uint32_t index)
+		{
+			nodes[index].nextFree = unusedNodes;
+			unusedNodes = index;
+		}
+
+		void InsertFree(uint32_t index)
+		{
+			Node& node = nodes[index];
+			uint32_t fl, sl;
+			Mapping(node.size, fl, sl);
+			node.free = true;
+			node.prevFree = invalidNode;
+			node.nextFree = freeLists[fl][sl];
+			if (node.nextFree != invalidNode)
+				nodes[node.nextFree].prevFree = index;
+			freeLists[fl][sl] = index;
+			flBitmap |= 1ull << fl;
+			slBitmap[fl] |= 1u << sl;
+		}
+
+		void RemoveFree(uint32_t index)
+		{
+			Node& node = nodes[index];
+			uint32_t fl, sl;
+			Mapping(node.size, fl, sl);
+			if (node.prevFree != invalidNode)
+				nodes[node.prevFree].nextFree = node.nextFree;
+			else
+				freeLists[fl][sl] = node.nextFree;
+			if (node.nextFree != invalidNode)
+				nodes[node.nextFree].prevFree = node.prevFree;
+			if (freeLists[fl][sl] == invalidNode)
+			{
+				slBitmap[fl] &= ~(1u << sl);
+				if (slBitmap[fl] == 0)
+					flBitmap &= ~(1ull << fl);
+			}
+			node.free = false;
+		}
+
+		// Returns the head of the first non-empty free list with a size class of at least (fl, sl)
+		uint32_t FindFree(uint32_t fl, uint32_t sl) const
+		{
+			uint32_t slMap = slBitmap[fl] & (~0u << sl);
+			if (slMap == 0)
+			{
+				uint64_t flMap = flBitmap & (~0ull << (fl + 1));
+				if (flMap == 0)
+					return invalidNode;
+				fl = Lsb(flMap);
+				slMap = slBitmap[fl];
+			}
+			return freeLists[fl][Lsb(slMap)];
+		}
+
+		bool Fits(uint32_t index, VkDeviceSize size, VkDeviceSize alignment) const
+		{
+			const Node& node = nodes[index];
+			return AlignUp(node.offset, alignment) + size <= node.offset + node.size;
+		}
+
+	public:
+		VkDeviceSize size = 0;
+		VkDeviceSize usedSize = 0;
+		uint32_t allocationCount = 0;
+		uint32_t freeRangeCount = 0;
+
+		void Init(VkDeviceSize size)
+		{
+			for (auto& list : freeLists)
+				for (auto& head : list)
+					head = invalidNode;
+			nodes.clear();
+			unusedNodes = invalidNode;
+			flBitmap = 0;
+			memset(slBitmap, 0, sizeof(slBitmap));
+			this->size = size;
+			usedSize = 0;
+			allocationCount = 0;
+			freeRangeCount = 1;
+			InsertFree(CreateNode(0, size));
+		}
+
+		/**
+		* Take a range from the free ranges
+		*
+		* @param size Size of the range
+		* @param alignment Required alignment of the range's offset
+		* @param offset Offset of the range
+		*
+		* @return Node of the range, needed to free it, or invalidNode if there is no free range that fits
+		*/
+		uint32_t Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+		{
+			uint32_t fl, sl;
+			// Good fit: any range in the class of size + worst case alignment padding fits
+			Mapping(RoundUp(size + alignment - 1), fl, sl);
+			uint32_t index = fl < flCount ? FindFree(fl, sl) : invalidNode;
+			if (index == invalidNode)
+			{
+				// Fall back to the ranges in the request's own class, some of them may still fit
+				Mapping(size, fl, sl);
+				for (index = freeLists[fl][sl]; index != invalidNode && !Fits(index, size, alignment); index = nodes[index].nextFree);
+				if (index == invalidNode)
+					return invalidNode;
+			}
+			RemoveFree(index);
+			freeRangeCount--;
+
+			// Padding in front of the aligned offset becomes a free range of its own
+			VkDeviceSize alignedOffset = AlignUp(nodes[index].offset, alignment);
+			if (alignedOffset > nodes[index].offset)
+			{
+				uint32_t padding = CreateNode(nodes[index].offset, alignedOffset - nodes[index].offset);
+				nodes[padding].prevPhysical = nodes[index].prevPhysical;
+				nodes[padding].nextPhysical = index;
+				if (nodes[index].prevPhysical != invalidNode)
+					nodes[nodes[index].prevPhysical].nextPhysical = padding;
+				nodes[index].prevPhysical = padding;
+				nodes[index].size -= nodes[padding].size;
+				nodes[index].offset = alignedOffset;
+				InsertFree(padding);
+				freeRangeCount++;
+			}
+			// Remainder behind the allocation is returned to the free ranges
+			if (nodes[index].size > size)
+			{
+				uint32_t remainder = CreateNode(nodes[index].offset + size, nodes[index].size - size);
+				nodes[remainder].prevPhysical = index;
+				nodes[remainder].nextPhysical = nodes[index].nextPhysical;
+				if (nodes[index].nextPhysical != invalidNode)
+					nodes[nodes[index].nextPhysical].prevPhysical = remainder;
+				nodes[index].nextPhysical = remainder;
+				nodes[index].size = size;
+				InsertFree(remainder);
+				freeRangeCount++;
+			}
+
+			offset = nodes[index].offset;
+			usedSize += size;
+			allocationCount++;
+			return index;
+		}
+
+		/** @brief Return a range to the free ranges, merging it with free neighbours */
+		void Free(uint32_t index)
+		{
+			assert(!nodes[index].free);
+			usedSize -= nodes[index].size;
+			allocationCount--;
+
+			uint32_t prev = nodes[index].prevPhysical;
+			if (prev != invalidNode && nodes[prev].free)
+			{
+				RemoveFree(prev);
+				freeRangeCount--;
+				nodes[prev].size += nodes[index].size;
+				nodes[prev].nextPhysical = nodes[index].nextPhysical;
+				if (nodes[index].nextPhysical != invalidNode)
+					nodes[nodes[index].nextPhysical].prevPhysical = prev;
+				ReleaseNode(index);
+				index = prev;
+			}
+			uint32_t next = nodes[index].nextPhysical;
+			if (next != invalidNode && nodes[next].free)
+			{
+				RemoveFree(next);
+				freeRangeCount--;
+				nodes[index].size += nodes[next].size;
+				nodes[index].nextPhysical = nodes[next].nextPhysical;
+				if (nodes[next].nextPhysical != invalidNode)
+					nodes[nodes[next].nextPhysical].prevPhysical = index;
+				ReleaseNode(next);
+			}
+			InsertFree(index);
+			freeRangeCount++;
+		}
+
+		/** @brief Size of the largest free range */
+		VkDeviceSize LargestFreeRange() const
+		{
+			if (flBitmap == 0)
+				return 0;
+			uint32_t fl = Msb(flBitmap);
+			VkDeviceSize largest = 0;
+			for (uint32_t index = freeLists[fl][Msb(slBitmap[fl])]; index != invalidNode; index = nodes[index].nextFree)
+				largest = std::max(largest, nodes[index].size);
+			return largest;
+		}
+	};
+
+	/** @brief Device memory allocation that is split into sub-allocations */
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		uint32_t pool = 0;
+		// General blocks
+		TlsfMetadata tlsf;
+		// Transient blocks are allocated linearly and rewound once all allocations have been freed
+		VkDeviceSize linearOffset = 0;
+		VkDeviceSize linearUsed = 0;
+		uint32_t linearCount = 0;
+	};
+
+	/** @brief Allocation statistics of a memory type (or all memory types) */
+	struct MemoryStats
+	{
+		/** @brief Number of device memory blocks that are sub-allocated */
+		uint32_t blockCount = 0;
+		/** @brief Number of live sub-allocations */
+		uint32_t allocationCount = 0;
+		/** @brief Number of live allocations that have their own device memory */
+		uint32_t dedicatedAllocationCount = 0;
+		/** @brief Number of free ranges inside the blocks */
+		uint32_t freeRangeCount = 0;
+		VkDeviceSize blockBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize dedicatedBytes = 0;
+		VkDeviceSize largestFreeRange = 0;
+		/** @brief Sum of the largest free range of each block */
+		VkDeviceSize contiguousFreeBytes = 0;
+
+		/** @brief Share of free block memory that is not part of its block's largest free range (0 = not fragmented) */
+		float Fragmentation() const
+		{
+			VkDeviceSize freeBytes = blockBytes - usedBytes;
+			return freeBytes > 0 ? 1.0f - static_cast<float>(contiguousFreeBytes) / static_cast<float>(freeBytes) : 0.0f;
+		}
+
+		void Add(const MemoryStats& other)
+		{
+			blockCount += other.blockCount;
+			allocationCount += other.allocationCount;
+			dedicatedAllocationCount += other.dedicatedAllocationCount;
+			freeRangeCount += other.freeRangeCount;
+			blockBytes += other.blockBytes;
+			usedBytes += other.usedBytes;
+			dedicatedBytes += other.dedicatedBytes;
+			largestFreeRange = std::max(largestFreeRange, other.largestFreeRange);
+			contiguousFreeBytes += other.contiguousFreeBytes;
+		}
+	};
+
+	/**
+	* Sub-allocates device memory from large blocks instead of calling vkAllocateMemory per resource
+	*
+	* There is one set of blocks per memory type, ranges inside a block are managed with TLSF.
+	* Transient allocations like staging buffers come from separate linearly allocated blocks.
+	* Requests larger than half a block get a dedicated allocation.
+	* If bufferImageGranularity is larger than one, buffers (and linear images) and optimal tiled images
+	* are placed in different blocks, so they never share a granularity page.
+	* Host visible blocks are mapped once on creation.
+	*
+	* @note All functions are thread safe
+	*/
+	class MemoryAllocator
+	{
+	private:
+		struct Pool
+		{
+			std::vector<std::unique_ptr<MemoryBlock>> blocks;
+			uint32_t memoryType = 0;
+			bool transient = false;
+			VkDeviceSize preferredBlockSize = 0;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		VkDeviceSize bufferImageGranularity = 1;
+		VkDeviceSize nonCoherentAtomSize = 1;
+		uint32_t maxMemoryAllocationCount = 0;
+
+		// Pools per memory type, resource kind (linear / optimal) and usage (default / transient)
+		std::vector<Pool> pools;
+		std::vector<uint32_t> dedicatedCount;
+		std::vector<VkDeviceSize> dedicatedBytes;
+		uint64_t totalDeviceAllocations = 0;
+		uint64_t totalAllocations = 0;
+		std::mutex mutex;
+
+		static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		uint32_t PoolIndex(uint32_t memoryType, bool optimalImage, bool transient) const
+		{
+			uint32_t kind = (bufferImageGranularity > 1 && optimalImage) ? 1 : 0;
+			return (memoryType * 2 + kind) * 2 + (transient ? 1 : 0);
+		}
+
+		bool HostVisible(uint32_t memoryType) const
+		{
+			return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+		}
+
+		bool HostCoherent(uint32_t memoryType) const
+		{
+			return (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+		}
+
+		VkResult AllocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory* memory, void** mapped)
+		{
+			VkMemoryAllocateInfo memAlloc = vks::initializers::MemoryAllocateInfo();
+			memAlloc.allocationSize = size;
+			memAlloc.memoryTypeIndex = memoryType;
+			VkResult result = vkAllocateMemory(device, &memAlloc, nullptr, memory);
+			if (result != VK_SUCCESS)
+				return result;
+			totalDeviceAllocations++;
+			*mapped = nullptr;
+			if (HostVisible(memoryType))
+			{
+				result = vkMapMemory(device, *memory, 0, VK_WHOLE_SIZE, 0, mapped);
+				if (result != VK_SUCCESS)
+				{
+					vkFreeMemory(device, *memory, nullptr);
+					*memory = VK_NULL_HANDLE;
+				}
+			}
+			return result;
+		}
+
+		VkResult AllocateDedicated(uint32_t memoryType, VkDeviceSize size, MemoryAllocation* allocation)
+		{
+			void* mapped;
+			VkResult result = AllocateDeviceMemory(memoryType, size, &allocation->memory, &mapped);
+			if (result != VK_SUCCESS)
+				return result;
+			allocation->offset = 0;
+			allocation->size = size;
+			allocation->mapped = mapped;
+			allocation->block = nullptr;
+			dedicatedCount[memoryType]++;
+			dedicatedBytes[memoryType] += size;
+			return VK_SUCCESS;
+		}
+
+		bool AllocateFromBlock(MemoryBlock* block, bool transient, VkDeviceSize size, VkDeviceSize alignment, MemoryAllocation* allocation)
+		{
+			VkDeviceSize offset;
+			if (transient)
+			{
+				offset = AlignUp(block->linearOffset, alignment);
+				if (offset + size > block->size)
+					return false;
+				block->linearOffset = offset + size;
+				block->linearUsed += size;
+				block->linearCount++;
+				allocation->node = 0;
+			}
+			else
+			{
+				uint32_t node = block->tlsf.Allocate(size, alignment, offset);
+				if (node == TlsfMetadata::invalidNode)
+					return false;
+				allocation->node = node;
+			}
+			allocation->memory = block->memory;
+			allocation->offset = offset;
+			allocation->size = size;
+			allocation->mapped = block->mapped ? static_cast<uint8_t*>(block->mapped) + offset : nullptr;
+			allocation->block = block;
+			return true;
+		}
+
+		static bool BlockEmpty(const MemoryBlock& block, bool transient)
+		{
+			return transient ? block.linearCount == 0 : block.tlsf.allocationCount == 0;
+		}
+
+		void DestroyBlock(MemoryBlock& block)
+		{
+			// Freeing implicitly unmaps the memory
+			vkFreeMemory(device, block.memory, nullptr);
+		}
+
+	public:
+		~MemoryAllocator()
+		{
+			Destroy();
+		}
+
+		/**
+		* Set up the allocator for a device
+		*
+		* @param physicalDevice Physical device to query memory types and limits from
+		* @param device Logical device to allocate memory from
+		*/
+		void Create(VkPhysicalDevice physicalDevice, VkDevice device)
+		{
+			this->device = device;
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+			bufferImageGranularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+			nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+			maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+			pools.clear();
+			pools.resize(memoryProperties.memoryTypeCount * 4);
+			for (uint32_t i = 0; i < static_cast<uint32_t>(pools.size()); i++)
+			{
+				Pool& pool = pools[i];
+				pool.memoryType = i / 4;
+				pool.transient = (i & 1) != 0;
+				// 64 MiB blocks, smaller ones for small heaps (e.g. the 256 MiB device local + host visible heap)
+				VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[pool.memoryType].heapIndex].size;
+				pool.preferredBlockSize = heapSize <= 1024ull * 1024 * 1024 ? heapSize / 8 : 64ull * 1024 * 1024;
+			}
+			dedicatedCount.assign(memoryProperties.memoryTypeCount, 0);
+			dedicatedBytes.assign(memoryProperties.memoryTypeCount, 0);
+		}
+
+		/** @brief Free all blocks, allocations that are still alive become invalid */
+		void Destroy()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& pool : pools)
+			{
+				for (auto& block : pool.blocks)
+					DestroyBlock(*block);
+				pool.blocks.clear();
+			}
+		}
+
+		/**
+		* Get the index of a memory type that has all the requested property bits set
+		*
+		* @throw Throws an exception if no memory type could be found that supports the requested properties
+		*/
+		uint32_t GetMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+		{
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+			{
+				if ((typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+					return i;
+			}
+			throw std::runtime_error("Could not find a matching memory type");
+		}
+
+		/**
+		* Allocate memory for a resource
+		*
+		* @param memReqs Memory requirements of the resource
+		* @param memoryType Index of the memory type to allocate from
+		* @param optimalImage True for optimal tiled images, false for buffers and linear tiled images (used to respect bufferImageGranularity)
+		* @param allocation Receives the allocated range
+		* @param usage (Optional) Placement hint
+		*
+		* @return VkResult of the device memory allocation (if one was required)
+		*/
+		VkResult Allocate(const VkMemoryRequirements& memReqs, uint32_t memoryType, bool optimalImage, MemoryAllocation* allocation, MemoryUsage usage = MemoryUsage::Default)
+		{
+			assert(device != VK_NULL_HANDLE);
+			VkDeviceSize size = memReqs.size;
+			VkDeviceSize alignment = std::max<VkDeviceSize>(memReqs.alignment, 1);
+			// Flushed ranges of non-coherent memory are rounded to nonCoherentAtomSize, which must not touch other allocations
+			if (HostVisible(memoryType) && !HostCoherent(memoryType))
+			{
+				alignment = std::max(alignment, nonCoherentAtomSize);
+				size = AlignUp(size, nonCoherentAtomSize);
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+			allocation->allocator = this;
+			allocation->memoryType = memoryType;
+			totalAllocations++;
+
+			bool transient = usage == MemoryUsage::Transient;
+			uint32_t poolIndex = PoolIndex(memoryType, optimalImage, transient);
+			Pool& pool = pools[poolIndex];
+			if (usage == MemoryUsage::Dedicated || size > pool.preferredBlockSize / 2)
+				return AllocateDedicated(memoryType, size, allocation);
+
+			for (auto& block : pool.blocks)
+			{
+				if (AllocateFromBlock(block.get(), transient, size, alignment, allocation))
+					return VK_SUCCESS;
+			}
+
+			// Start with smaller blocks and grow up to the preferred size, so samples with few resources don't reserve a lot of memory
+			uint32_t shift = 3 - std::min<uint32_t>(static_cast<uint32_t>(pool.blocks.size()), 3);
+			VkDeviceSize blockSize = pool.preferredBlockSize >> shift;
+			while (blockSize < size * 2)
+				blockSize *= 2;
+
+			std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+			VkResult result = AllocateDeviceMemory(memoryType, blockSize, &block->memory, &block->mapped);
+			if (result != VK_SUCCESS)
+			{
+				// Out of memory for a full block, the request itself may still fit
+				return AllocateDedicated(memoryType, size, allocation);
+			}
+			block->size = blockSize;
+			block->pool = poolIndex;
+			if (!transient)
+				block->tlsf.Init(blockSize);
+			bool allocated = AllocateFromBlock(block.get(), transient, size, alignment, allocation);
+			assert(allocated);
+			pool.blocks.push_back(std::move(block));
+			return VK_SUCCESS;
+		}
+
+		/**
+		* Allocate memory for a buffer and bind it
+		*
+		* @param buffer Buffer to allocate memory for
+		* @param memoryPropertyFlags Memory properties for this buffer (i.e. device local, host visible, coherent)
+		* @param allocation Receives the allocated range
+		* @param usage (Optional) Placement hint
+		*
+		* @return VkResult of the allocation and bind calls
+		*/
+		VkResult AllocateBuffer(VkBuffer buffer, VkMemoryPropertyFlags memoryPropertyFlags, MemoryAllocation* allocation, MemoryUsage usage = MemoryUsage::Default)
+		{
+			VkMemoryRequirements memReqs;
+			vkGetBufferMemoryRequirements(device, buffer, &memReqs);
+			VkResult result = Allocate(memReqs, GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags), false, allocation, usage);
+			if (result != VK_SUCCESS)
+				return result;
+			return vkBindBufferMemory(device, buffer, allocation->memory, allocation->offset);
+		}
+
+		/**
+		* Allocate memory for an image and bind it
+		*
+		* @param image Image to allocate memory for
+		* @param memoryPropertyFlags Memory properties for this image
+		* @param allocation Receives the allocated range
+		* @param linearTiling (Optional) Set to true for images created with VK_IMAGE_TILING_LINEAR
+		* @param usage (Optional) Placement hint
+		*
+		* @return VkResult of the allocation and bind calls
+		*/
+		VkResult AllocateImage(VkImage image, VkMemoryPropertyFlags memoryPropertyFlags, MemoryAllocation* allocation, bool linearTiling = false, MemoryUsage usage = MemoryUsage::Default)
+		{
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(device, image, &memReqs);
+			VkResult result = Allocate(memReqs, GetMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags), !linearTiling, allocation, usage);
+			if (result != VK_SUCCESS)
+				return result;
+			return vkBindImageMemory(device, image, allocation->memory, allocation->offset);
+		}
+
+		/** @brief Return the allocation's memory, the allocation is reset */
+		void Free(MemoryAllocation& allocation)
+		{
+			if (!allocation)
+				return;
+			std::lock_guard<std::mutex> lock(mutex);
+			MemoryBlock* block = allocation.block;
+			if (!block)
+			{
+				vkFreeMemory(device, allocation.memory, nullptr);
+				dedicatedCount[allocation.memoryType]--;
+				dedicatedBytes[allocation.memoryType] -= allocation.size;
+			}
+			else
+			{
+				Pool& pool = pools[block->pool];
+				if (pool.transient)
+				{
+					block->linearUsed -= allocation.size;
+					if (--block->linearCount == 0)
+					{
+						block->linearOffset = 0;
+						block->linearUsed = 0;
+					}
+				}
+				else
+				{
+					block->tlsf.Free(allocation.node);
+				}
+				// Keep one empty block per pool around to avoid allocating and freeing device memory back to back
+				if (BlockEmpty(*block, pool.transient))
+				{
+					for (size_t i = 0; i < pool.blocks.size(); i++)
+					{
+						if (pool.blocks[i].get() != block && BlockEmpty(*pool.blocks[i], pool.transient))
+						{
+							auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const std::unique_ptr<MemoryBlock>& b) { return b.get() == block; });
+							DestroyBlock(*block);
+							pool.blocks.erase(it);
+							break;
+						}
+					}
+				}
+			}
+			allocation = MemoryAllocation();
+		}
+
+		/**
+		* Flush a range of a host visible allocation to make host writes visible to the device
+		*
+		* @note Only required for non-coherent memory, a no-op for coherent memory
+		*
+		* @param allocation Allocation to flush
+		* @param size (Optional) Size of the range to flush. Pass VK_WHOLE_SIZE to flush the complete allocation.
+		* @param offset (Optional) Byte offset from the beginning of the allocation
+		*/
+		VkResult Flush(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
+		{
+			if (HostCoherent(allocation.memoryType))
+				return VK_SUCCESS;
+			VkMappedMemoryRange mappedRange = MappedRange(allocation, size, offset);
+			return vkFlushMappedMemoryRanges(device, 1, &mappedRange);
+		}
+
+		/**
+		* Invalidate a range of a host visible allocation to make device writes visible to the host
+		*
+		* @note Only required for non-coherent memory, a no-op for coherent memory
+		*/
+		VkResult Invalidate(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
+		{
+			if (HostCoherent(allocation.memoryType))
+				return VK_SUCCESS;
+			VkMappedMemoryRange mappedRange = MappedRange(allocation, size, offset);
+			return vkInvalidateMappedMemoryRanges(device, 1, &mappedRange);
+		}
+
+		/** @brief Memory range of the allocation's device memory, rounded to nonCoherentAtomSize */
+		VkMappedMemoryRange MappedRange(const MemoryAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const
+		{
+			if (size == VK_WHOLE_SIZE)
+				size = allocation.size - offset;
+			VkDeviceSize begin = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+			VkDeviceSize end = AlignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+			VkDeviceSize memorySize = allocation.block ? allocation.block->size : allocation.size;
+			VkMappedMemoryRange mappedRange = vks::initializers::MappedMemoryRange();
+			mappedRange.memory = allocation.memory;
+			mappedRange.offset = begin;
+			mappedRange.size = end < memorySize ? end - begin : VK_WHOLE_SIZE;
+			return mappedRange;
+		}
+
+		/** @brief Statistics of a single memory type */
+		MemoryStats GetStats(uint32_t memoryType)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			MemoryStats stats;
+			for (auto& pool : pools)
+			{
+				if (pool.memoryType != memoryType)
+					continue;
+				for (auto& block : pool.blocks)
+				{
+					VkDeviceSize largestFreeRange;
+					stats.blockCount++;
+					stats.blockBytes += block->size;
+					if (pool.transient)
+					{
+						// Gaps of freed transient allocations are only reused once the block is rewound
+						stats.allocationCount += block->linearCount;
+						stats.usedBytes += block->linearUsed;
+						stats.freeRangeCount++;
+						largestFreeRange = block->size - block->linearOffset;
+					}
+					else
+					{
+						stats.allocationCount += block->tlsf.allocationCount;
+						stats.usedBytes += block->tlsf.usedSize;
+						stats.freeRangeCount += block->tlsf.freeRangeCount;
+						largestFreeRange = block->tlsf.LargestFreeRange();
+					}
+					stats.largestFreeRange = std::max(stats.largestFreeRange, largestFreeRange);
+					stats.contiguousFreeBytes += largestFreeRange;
+				}
+			}
+			stats.dedicatedAllocationCount = dedicatedCount[memoryType];
+			stats.dedicatedBytes = dedicatedBytes[memoryType];
+			return stats;
+		}
+
+		/** @brief Statistics summed over all memory types */
+		MemoryStats GetTotalStats()
+		{
+			MemoryStats total;
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+				total.Add(GetStats(i));
+			return total;
+		}
+
+		/** @brief Human readable report of the allocation statistics and fragmentation per memory type */
+		std::string GetReport()
+		{
+			const double MiB = 1024.0 * 1024.0;
+			std::stringstream ss;
+			MemoryStats total = GetTotalStats();
+			ss << "Device memory: " << (total.blockCount + total.dedicatedAllocationCount) << " device allocations (limit " << maxMemoryAllocationCount << ") for "
+				<< (total.allocationCount + total.dedicatedAllocationCount) << " resources, "
+				<< totalDeviceAllocations << " vkAllocateMemory calls for " << totalAllocations << " requests in total\n";
+			ss << "type heap flags      blocks  block MiB  used MiB  allocs  dedicated (MiB)  free ranges  largest free MiB  fragmentation\n";
+			ss << std::fixed << std::setprecision(2);
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+			{
+				MemoryStats stats = GetStats(i);
+				if (stats.blockCount == 0 && stats.dedicatedAllocationCount == 0)
+					continue;
+				VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+				std::string flagString;
+				flagString += (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? "D" : "-";
+				flagString += (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) ? "V" : "-";
+				flagString += (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ? "C" : "-";
+				flagString += (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? "$" : "-";
+				ss << std::setw(4) << i << std::setw(5) << memoryProperties.memoryTypes[i].heapIndex << " " << std::left << std::setw(8) << flagString << std::right
+					<< std::setw(8) << stats.blockCount
+					<< std::setw(11) << stats.blockBytes / MiB
+					<< std::setw(10) << stats.usedBytes / MiB
+					<< std::setw(8) << stats.allocationCount
+					<< std::setw(8) << stats.dedicatedAllocationCount << " (" << std::setw(7) << stats.dedicatedBytes / MiB << ")"
+					<< std::setw(13) << stats.freeRangeCount
+					<< std::setw(18) << stats.largestFreeRange / MiB
+					<< std::setw(14) << stats.Fragmentation() * 100.0f << "%\n";
+			}
+			return ss.str();
+		}
+	};
+
+	inline void MemoryAllocation::Free()
+	{
+		if (allocator)
+			allocator->Free(*this);
+	}
+}
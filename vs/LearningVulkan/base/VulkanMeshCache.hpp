@@ -0,0 +1,244 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <utility>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MeshOptimizer.hpp"
+
+namespace vks
+{
+	/** @brief Read only memory mapping of a whole file */
+	class MappedFile
+	{
+	private:
+#if defined(_WIN32)
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+#endif
+
+	public:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile()
+		{
+			Close();
+		}
+
+		/**
+		* Map the file into memory
+		*
+		* @param filename Name of the file to map
+		*
+		* @return True if the file has been mapped, false if it doesn't exist, is empty or can't be mapped
+		*/
+		bool Open(const std::string& filename)
+		{
+			Close();
+#if defined(_WIN32)
+			file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return false;
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(file, &fileSize) && (fileSize.QuadPart > 0))
+			{
+				mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != NULL)
+				{
+					data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					size = static_cast<size_t>(fileSize.QuadPart);
+				}
+			}
+#else
+			int fd = open(filename.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+			struct stat fileStat;
+			if ((fstat(fd, &fileStat) == 0) && (fileStat.st_size > 0))
+			{
+				void* mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (mapped != MAP_FAILED)
+				{
+					data = static_cast<const uint8_t*>(mapped);
+					size = static_cast<size_t>(fileStat.st_size);
+				}
+			}
+			// The mapping stays valid after the descriptor has been closed
+			close(fd);
+#endif
+			if (data == nullptr)
+			{
+				Close();
+				return false;
+			}
+			return true;
+		}
+
+		void Close()
+		{
+#if defined(_WIN32)
+			if (data)
+				UnmapViewOfFile(data);
+			if (mapping != NULL)
+				CloseHandle(mapping);
+			if (file != INVALID_HANDLE_VALUE)
+				CloseHandle(file);
+			mapping = NULL;
+			file = INVALID_HANDLE_VALUE;
+#else
+			if (data)
+				munmap(const_cast<uint8_t*>(data), size);
+#endif
+			data = nullptr;
+			size = 0;
+		}
+	};
+
+	/**
+	* Binary cache for the final vertex and index data of the model loader, so warm starts don't need to import and post-process the source file
+	*
+	* Cache files are stored next to the source file, one per combination of source file and load settings (vertex layout, scale, etc.).
+	* They contain a hash of the source file they were built from and are rebuilt if it changes.
+	*/
+	class MeshCache
+	{
+	public:
+		static const uint32_t fileMagic = 0x434D4B56; // "VKMC"
+		static const uint32_t fileVersion = 5;
+
+		/** @brief Header at the start of a cache file, followed by the model parts, the meshlets, the vertex data and the index data */
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			/** @brief Hash of the load settings (see GetFilename) */
+			uint64_t key;
+			uint64_t sourceHash;
+			uint64_t sourceSize;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t partCount;
+			uint32_t partSize;
+			uint32_t meshletCount;
+			uint32_t meshletSize;
+			uint64_t vertexDataSize;
+			uint64_t indexDataSize;
+			float dimMin[3];
+			float dimMax[3];
+			/** @brief Dequantization of 16 bit positions (see vks::Model::quantization) */
+			float quantizationOffset[3];
+			float quantizationScale[3];
+		};
+
+		/** @brief Number of meshes and time spent loading them, from the source files (cold) and from cache files (warm) */
+		struct Stats
+		{
+			uint32_t coldLoads = 0;
+			uint32_t warmLoads = 0;
+			double coldTime = 0.0;
+			double warmTime = 0.0;
+			/** @brief Vertex cache statistics of all meshes optimized while loading them from their source files */
+			meshopt::Result optimization;
+			/** @brief Number of levels of detail generated by simplification */
+			uint32_t lodLevels = 0;
+			/** @brief Number of meshlets built for cluster culling */
+			uint32_t meshlets = 0;
+		} stats;
+
+		/** @brief Load meshes from existing cache files, if false they're only written (cold start) */
+		bool load = true;
+		/** @brief Write a cache file after a mesh has been loaded from its source file */
+		bool save = true;
+		/** @brief Print the processing statistics of each mesh loaded from its source file, they're always added to the stats */
+		bool verbose = false;
+
+		/** @brief Cache settings and statistics shared by all model loaders */
+		static MeshCache& Get()
+		{
+			static MeshCache meshCache;
+			return meshCache;
+		}
+
+		/** @brief 64 bit FNV-1a hash, pass the result of a previous call as hash to combine multiple blocks */
+		static uint64_t Hash(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 0x100000001b3ull;
+			}
+			return hash;
+		}
+
+		/** @brief Name of the cache file for the source file loaded with the settings described by key */
+		static std::string GetFilename(const std::string& source, uint64_t key)
+		{
+			char suffix[40];
+			snprintf(suffix, sizeof(suffix), ".%016llx.meshcache", static_cast<unsigned long long>(key));
+			return source + suffix;
+		}
+
+		/**
+		* Write a cache file
+		*
+		* The data is written to a temporary file first which then replaces the cache file,
+		* so an interrupted write never leaves a truncated cache behind
+		*
+		* @param filename Name of the cache file
+		* @param header Header of the file, magic and version are filled in
+		* @param blocks Data following the header (parts, meshlets, vertex data, index data)
+		*
+		* @return True if the file has been written
+		*/
+		static bool Write(const std::string& filename, FileHeader header, const std::vector<std::pair<const void*, size_t>>& blocks)
+		{
+			header.magic = fileMagic;
+			header.version = fileVersion;
+
+			std::string tempFilename = filename + ".tmp";
+			{
+				std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+				if (!file.is_open())
+					return false;
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				for (auto& block : blocks)
+				{
+					file.write(static_cast<const char*>(block.first), block.second);
+				}
+				file.flush();
+				if (!file)
+				{
+					file.close();
+					remove(tempFilename.c_str());
+					return false;
+				}
+			}
+#if defined(_WIN32)
+			bool replaced = MoveFileExA(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			bool replaced = rename(tempFilename.c_str(), filename.c_str()) == 0;
+#endif
+			if (!replaced)
+				remove(tempFilename.c_str());
+			return replaced;
+		}
+	};
+}
@@ -4,6 +4,10 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <type_traits>
 
 #include "vulkan/vulkan.h"
 
@@ -18,6 +22,11 @@
 
 #include "VulkanDevice.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanMeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshletBuilder.hpp"
+#include "VertexQuantization.hpp"
 
 #if defined(__ANDROID__)
 #include <android/asset_manager.h>
@@ -34,9 +43,270 @@ namespace vks
 		VERTEX_COMPONENT_TANGENT = 0x4,
 		VERTEX_COMPONENT_BITANGENT = 0x5,
 		VERTEX_COMPONENT_DUMMY_FLOAT = 0x6,
-		VERTEX_COMPONENT_DUMMY_VEC4 = 0x7
+		VERTEX_COMPONENT_DUMMY_VEC4 = 0x7,
+		// Quantized components, see vks::quantize
+		/** @brief Half float position (w = 1) */
+		VERTEX_COMPONENT_POSITION_HALF = 0x8,
+		/** @brief 16 bit normalized position relative to the model's bounds (w = 1), position = Model::quantization.offset + value * Model::quantization.scale */
+		VERTEX_COMPONENT_POSITION_UNORM16 = 0x9,
+		/** @brief 16 bit normalized normal (w = 0) */
+		VERTEX_COMPONENT_NORMAL_SNORM16 = 0xA,
+		/** @brief Octahedral encoded normal, needs to be decoded in the shader */
+		VERTEX_COMPONENT_NORMAL_OCT = 0xB,
+		/** @brief Octahedral encoded tangent (xy) and the sign of the bitangent (z), bitangent = cross(normal, tangent) * z */
+		VERTEX_COMPONENT_TANGENT_OCT = 0xC,
+		/** @brief Half float texture coordinates */
+		VERTEX_COMPONENT_UV_HALF = 0xD,
+		/** @brief 8 bit normalized color (alpha = 1) */
+		VERTEX_COMPONENT_COLOR_UNORM8 = 0xE
 	} Component;
 
+	/** @brief Size of a vertex component in 4 byte words (floats), which is what the vertex data is stored in */
+	constexpr uint32_t ComponentSize(Component component)
+	{
+		return (component == VERTEX_COMPONENT_UV) ? 2 :
+			(component == VERTEX_COMPONENT_DUMMY_FLOAT) ? 1 :
+			(component == VERTEX_COMPONENT_DUMMY_VEC4) ? 4 :
+			(component == VERTEX_COMPONENT_POSITION_HALF) ? 2 :
+			(component == VERTEX_COMPONENT_POSITION_UNORM16) ? 2 :
+			(component == VERTEX_COMPONENT_NORMAL_SNORM16) ? 2 :
+			(component == VERTEX_COMPONENT_NORMAL_OCT) ? 1 :
+			(component == VERTEX_COMPONENT_TANGENT_OCT) ? 2 :
+			(component == VERTEX_COMPONENT_UV_HALF) ? 1 :
+			(component == VERTEX_COMPONENT_COLOR_UNORM8) ? 1 :
+			// All components except the ones listed above are made up of 3 floats
+			3;
+	}
+
+	/** @brief Vertex input format of a vertex component */
+	inline VkFormat ComponentFormat(Component component)
+	{
+		switch (component) {
+		case VERTEX_COMPONENT_POSITION_HALF:
+			return VK_FORMAT_R16G16B16A16_SFLOAT;
+		case VERTEX_COMPONENT_POSITION_UNORM16:
+			return VK_FORMAT_R16G16B16A16_UNORM;
+		case VERTEX_COMPONENT_NORMAL_SNORM16:
+		case VERTEX_COMPONENT_TANGENT_OCT:
+			return VK_FORMAT_R16G16B16A16_SNORM;
+		case VERTEX_COMPONENT_NORMAL_OCT:
+			return VK_FORMAT_R16G16_SNORM;
+		case VERTEX_COMPONENT_UV_HALF:
+			return VK_FORMAT_R16G16_SFLOAT;
+		case VERTEX_COMPONENT_COLOR_UNORM8:
+			return VK_FORMAT_R8G8B8A8_UNORM;
+		default:
+			break;
+		}
+		static const VkFormat formats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		return formats[ComponentSize(component) - 1];
+	}
+
+	/**
+	* Get vertex input attributes for a list of vertex components
+	*
+	* @param components Vertex components in the order they're stored in the vertex
+	* @param binding Binding the vertex buffer is bound to
+	* @param firstLocation (Optional) Shader location of the first component, the following components use consecutive locations
+	*
+	* @return One attribute per component, dummy components only add padding and don't get an attribute
+	*/
+	inline std::vector<VkVertexInputAttributeDescription> VertexInputAttributes(const Component* components, size_t componentCount, uint32_t binding, uint32_t firstLocation = 0)
+	{
+		std::vector<VkVertexInputAttributeDescription> attributes;
+		uint32_t offset = 0;
+		for (size_t i = 0; i < componentCount; i++)
+		{
+			if ((components[i] != VERTEX_COMPONENT_DUMMY_FLOAT) && (components[i] != VERTEX_COMPONENT_DUMMY_VEC4))
+			{
+				attributes.push_back({ firstLocation++, binding, ComponentFormat(components[i]), offset });
+			}
+			offset += ComponentSize(components[i]) * sizeof(float);
+		}
+		return attributes;
+	}
+
+	/** @brief Source data for the vertices of a single mesh */
+	struct VertexSource
+	{
+		const aiVector3D* positions;
+		const aiVector3D* normals;
+		// Meshes without texture coordinates or tangents read the same zero vector for every vertex (step 0)
+		const aiVector3D* texCoords;
+		const aiVector3D* tangents;
+		const aiVector3D* bitangents;
+		uint32_t texCoordStep;
+		uint32_t tangentStep;
+		aiColor3D color;
+		glm::vec3 scale;
+		glm::vec2 uvscale;
+		glm::vec3 center;
+		// Bounds of the (scaled and centered) positions of the whole model for VERTEX_COMPONENT_POSITION_UNORM16
+		glm::vec3 positionMin;
+		glm::vec3 positionInvExtent;
+	};
+
+	/**
+	* Write one component of a vertex
+	*
+	* The component is a template argument, so only its branch is compiled into each instantiation
+	* and quantized components read the source attributes they're packed from directly
+	*/
+	template<Component C>
+	inline void WriteVertexComponent(float* dst, const VertexSource& src, uint32_t index)
+	{
+		if constexpr (C == VERTEX_COMPONENT_POSITION)
+		{
+			dst[0] = src.positions[index].x * src.scale.x + src.center.x;
+			dst[1] = -src.positions[index].y * src.scale.y + src.center.y;
+			dst[2] = src.positions[index].z * src.scale.z + src.center.z;
+		}
+		else if constexpr (C == VERTEX_COMPONENT_NORMAL)
+		{
+			dst[0] = src.normals[index].x;
+			dst[1] = -src.normals[index].y;
+			dst[2] = src.normals[index].z;
+		}
+		else if constexpr (C == VERTEX_COMPONENT_UV)
+		{
+			dst[0] = src.texCoords[index * src.texCoordStep].x * src.uvscale.s;
+			dst[1] = src.texCoords[index * src.texCoordStep].y * src.uvscale.t;
+		}
+		else if constexpr (C == VERTEX_COMPONENT_COLOR)
+		{
+			dst[0] = src.color.r;
+			dst[1] = src.color.g;
+			dst[2] = src.color.b;
+		}
+		else if constexpr (C == VERTEX_COMPONENT_TANGENT)
+		{
+			dst[0] = src.tangents[index * src.tangentStep].x;
+			dst[1] = src.tangents[index * src.tangentStep].y;
+			dst[2] = src.tangents[index * src.tangentStep].z;
+		}
+		else if constexpr (C == VERTEX_COMPONENT_BITANGENT)
+		{
+			dst[0] = src.bitangents[index * src.tangentStep].x;
+			dst[1] = src.bitangents[index * src.tangentStep].y;
+			dst[2] = src.bitangents[index * src.tangentStep].z;
+		}
+		// Dummy components for padding
+		else if constexpr (C == VERTEX_COMPONENT_DUMMY_FLOAT)
+		{
+			dst[0] = 0.0f;
+		}
+		else if constexpr (C == VERTEX_COMPONENT_DUMMY_VEC4)
+		{
+			dst[0] = 0.0f;
+			dst[1] = 0.0f;
+			dst[2] = 0.0f;
+			dst[3] = 0.0f;
+		}
+		// Quantized components are packed into the float storage of the vertex
+		else if constexpr (C == VERTEX_COMPONENT_POSITION_HALF)
+		{
+			float position[3];
+			WriteVertexComponent<VERTEX_COMPONENT_POSITION>(position, src, index);
+			uint16_t half[4];
+			half[0] = quantize::Half(position[0]);
+			half[1] = quantize::Half(position[1]);
+			half[2] = quantize::Half(position[2]);
+			half[3] = quantize::Half(1.0f);
+			memcpy(dst, half, sizeof(half));
+		}
+		else if constexpr (C == VERTEX_COMPONENT_POSITION_UNORM16)
+		{
+			float position[3];
+			WriteVertexComponent<VERTEX_COMPONENT_POSITION>(position, src, index);
+			uint16_t unorm[4];
+			unorm[0] = quantize::Unorm16((position[0] - src.positionMin.x) * src.positionInvExtent.x);
+			unorm[1] = quantize::Unorm16((position[1] - src.positionMin.y) * src.positionInvExtent.y);
+			unorm[2] = quantize::Unorm16((position[2] - src.positionMin.z) * src.positionInvExtent.z);
+			unorm[3] = quantize::Unorm16(1.0f);
+			memcpy(dst, unorm, sizeof(unorm));
+		}
+		else if constexpr (C == VERTEX_COMPONENT_NORMAL_SNORM16)
+		{
+			float normal[3];
+			WriteVertexComponent<VERTEX_COMPONENT_NORMAL>(normal, src, index);
+			int16_t snorm[4];
+			snorm[0] = quantize::Snorm16(normal[0]);
+			snorm[1] = quantize::Snorm16(normal[1]);
+			snorm[2] = quantize::Snorm16(normal[2]);
+			snorm[3] = 0;
+			memcpy(dst, snorm, sizeof(snorm));
+		}
+		else if constexpr (C == VERTEX_COMPONENT_NORMAL_OCT)
+		{
+			float normal[3];
+			float octahedral[2];
+			WriteVertexComponent<VERTEX_COMPONENT_NORMAL>(normal, src, index);
+			quantize::Octahedral(normal, octahedral);
+			int16_t snorm[2];
+			snorm[0] = quantize::Snorm16(octahedral[0]);
+			snorm[1] = quantize::Snorm16(octahedral[1]);
+			memcpy(dst, snorm, sizeof(snorm));
+		}
+		else if constexpr (C == VERTEX_COMPONENT_TANGENT_OCT)
+		{
+			float normal[3];
+			float tangent[3];
+			float bitangent[3];
+			float octahedral[2];
+			WriteVertexComponent<VERTEX_COMPONENT_NORMAL>(normal, src, index);
+			WriteVertexComponent<VERTEX_COMPONENT_TANGENT>(tangent, src, index);
+			WriteVertexComponent<VERTEX_COMPONENT_BITANGENT>(bitangent, src, index);
+			// Handedness of the tangent frame, the bitangent itself is reconstructed from normal and tangent
+			glm::vec3 reconstructed = glm::cross(glm::make_vec3(normal), glm::make_vec3(tangent));
+			float sign = (glm::dot(reconstructed, glm::make_vec3(bitangent)) < 0.0f) ? -1.0f : 1.0f;
+			quantize::Octahedral(tangent, octahedral);
+			int16_t snorm[4];
+			snorm[0] = quantize::Snorm16(octahedral[0]);
+			snorm[1] = quantize::Snorm16(octahedral[1]);
+			snorm[2] = quantize::Snorm16(sign);
+			snorm[3] = 0;
+			memcpy(dst, snorm, sizeof(snorm));
+		}
+		else if constexpr (C == VERTEX_COMPONENT_UV_HALF)
+		{
+			uint16_t half[2];
+			half[0] = quantize::Half(src.texCoords[index * src.texCoordStep].x * src.uvscale.s);
+			half[1] = quantize::Half(src.texCoords[index * src.texCoordStep].y * src.uvscale.t);
+			memcpy(dst, half, sizeof(half));
+		}
+		else if constexpr (C == VERTEX_COMPONENT_COLOR_UNORM8)
+		{
+			uint8_t unorm8[4];
+			unorm8[0] = quantize::Unorm8(src.color.r);
+			unorm8[1] = quantize::Unorm8(src.color.g);
+			unorm8[2] = quantize::Unorm8(src.color.b);
+			unorm8[3] = 255;
+			memcpy(dst, unorm8, sizeof(unorm8));
+		}
+	}
+
+	/** @brief Write one component of a vertex with the component only known at runtime (see VertexLayout::WriteVertices) */
+	inline void WriteVertexComponent(Component component, float* dst, const VertexSource& src, uint32_t index)
+	{
+		switch (component) {
+		case VERTEX_COMPONENT_POSITION: WriteVertexComponent<VERTEX_COMPONENT_POSITION>(dst, src, index); break;
+		case VERTEX_COMPONENT_NORMAL: WriteVertexComponent<VERTEX_COMPONENT_NORMAL>(dst, src, index); break;
+		case VERTEX_COMPONENT_COLOR: WriteVertexComponent<VERTEX_COMPONENT_COLOR>(dst, src, index); break;
+		case VERTEX_COMPONENT_UV: WriteVertexComponent<VERTEX_COMPONENT_UV>(dst, src, index); break;
+		case VERTEX_COMPONENT_TANGENT: WriteVertexComponent<VERTEX_COMPONENT_TANGENT>(dst, src, index); break;
+		case VERTEX_COMPONENT_BITANGENT: WriteVertexComponent<VERTEX_COMPONENT_BITANGENT>(dst, src, index); break;
+		case VERTEX_COMPONENT_DUMMY_FLOAT: WriteVertexComponent<VERTEX_COMPONENT_DUMMY_FLOAT>(dst, src, index); break;
+		case VERTEX_COMPONENT_DUMMY_VEC4: WriteVertexComponent<VERTEX_COMPONENT_DUMMY_VEC4>(dst, src, index); break;
+		case VERTEX_COMPONENT_POSITION_HALF: WriteVertexComponent<VERTEX_COMPONENT_POSITION_HALF>(dst, src, index); break;
+		case VERTEX_COMPONENT_POSITION_UNORM16: WriteVertexComponent<VERTEX_COMPONENT_POSITION_UNORM16>(dst, src, index); break;
+		case VERTEX_COMPONENT_NORMAL_SNORM16: WriteVertexComponent<VERTEX_COMPONENT_NORMAL_SNORM16>(dst, src, index); break;
+		case VERTEX_COMPONENT_NORMAL_OCT: WriteVertexComponent<VERTEX_COMPONENT_NORMAL_OCT>(dst, src, index); break;
+		case VERTEX_COMPONENT_TANGENT_OCT: WriteVertexComponent<VERTEX_COMPONENT_TANGENT_OCT>(dst, src, index); break;
+		case VERTEX_COMPONENT_UV_HALF: WriteVertexComponent<VERTEX_COMPONENT_UV_HALF>(dst, src, index); break;
+		case VERTEX_COMPONENT_COLOR_UNORM8: WriteVertexComponent<VERTEX_COMPONENT_COLOR_UNORM8>(dst, src, index); break;
+		};
+	}
+
 	/** @brief Stores vertex layout components for model loading and Vulkan vertex input and atribute bindings  */
 	struct VertexLayout {
 	public:
@@ -48,28 +318,100 @@ namespace vks
 			this->components = std::move(components);
 		}
 
-		uint32_t Stride()
+		uint32_t Stride() const
 		{
 			uint32_t res = 0;
 			for (auto& component : components)
 			{
-				switch (component)
+				res += ComponentSize(component) * sizeof(float);
+			}
+			return res;
+		}
+
+		/** @brief Vertex input attributes for all components, see vks::VertexInputAttributes */
+		std::vector<VkVertexInputAttributeDescription> InputAttributes(uint32_t binding, uint32_t firstLocation = 0) const
+		{
+			return VertexInputAttributes(components.data(), components.size(), binding, firstLocation);
+		}
+
+		/** @brief Write the vertices of a mesh, the components are looked up for every vertex */
+		static void WriteVertices(const VertexLayout& layout, const VertexSource& src, uint32_t vertexCount, float* dst)
+		{
+			std::vector<uint32_t> offsets;
+			uint32_t floatCount = 0;
+			for (auto& component : layout.components)
+			{
+				offsets.push_back(floatCount);
+				floatCount += ComponentSize(component);
+			}
+			for (uint32_t i = 0; i < vertexCount; i++, dst += floatCount)
+			{
+				for (size_t c = 0; c < layout.components.size(); c++)
 				{
-				case VERTEX_COMPONENT_UV:
-					res += 2 * sizeof(float);
-					break;
-				case VERTEX_COMPONENT_DUMMY_FLOAT:
-					res += sizeof(float);
-					break;
-				case VERTEX_COMPONENT_DUMMY_VEC4:
-					res += 4 * sizeof(float);
-					break;
-				default:
-					// All components except the ones listed above are made up of 3 floats
-					res += 3 * sizeof(float);
+					WriteVertexComponent(layout.components[c], dst + offsets[c], src, i);
 				}
 			}
-			return res;
+		}
+	};
+
+	/**
+	* Vertex layout with the components fixed at compile time
+	*
+	* Models loaded with it use a vertex writer generated for the layout, with the component offsets known and no branches per vertex.
+	* It converts to a VertexLayout for everything that takes one at runtime, e.g.:
+	*
+	* vks::StaticVertexLayout<vks::VERTEX_COMPONENT_POSITION, vks::VERTEX_COMPONENT_NORMAL, vks::VERTEX_COMPONENT_UV> vertexLayout;
+	* model.LoadFromFile(filename, vertexLayout, 1.0f, vulkanDevice, queue);
+	* pipelineBuilder.VertexInput(vertexLayout.Stride(), vertexLayout.InputAttributes(0));
+	*/
+	template<Component... Components>
+	struct StaticVertexLayout {
+	private:
+		// Offset of a component in floats
+		static constexpr uint32_t Offset(size_t index)
+		{
+			const Component components[] = { Components... };
+			uint32_t offset = 0;
+			for (size_t i = 0; i < index; i++)
+			{
+				offset += ComponentSize(components[i]);
+			}
+			return offset;
+		}
+
+		template<size_t... Index>
+		static void WriteVertex(const VertexSource& src, uint32_t index, float* dst, std::index_sequence<Index...>)
+		{
+			int expand[] = { 0, (WriteVertexComponent<Components>(dst + std::integral_constant<uint32_t, Offset(Index)>::value, src, index), 0)... };
+			(void)expand;
+		}
+
+	public:
+		static constexpr uint32_t Stride()
+		{
+			return Offset(sizeof...(Components)) * sizeof(float);
+		}
+
+		/** @brief Vertex input attributes for all components, see vks::VertexInputAttributes */
+		static std::vector<VkVertexInputAttributeDescription> InputAttributes(uint32_t binding, uint32_t firstLocation = 0)
+		{
+			const Component components[] = { Components... };
+			return VertexInputAttributes(components, sizeof...(Components), binding, firstLocation);
+		}
+
+		/** @brief Write the vertices of a mesh with the writer generated for this layout, the layout argument is ignored */
+		static void WriteVertices(const VertexLayout& /*layout*/, const VertexSource& src, uint32_t vertexCount, float* dst)
+		{
+			const uint32_t floatCount = Offset(sizeof...(Components));
+			for (uint32_t i = 0; i < vertexCount; i++, dst += floatCount)
+			{
+				WriteVertex(src, i, dst, std::make_index_sequence<sizeof...(Components)>());
+			}
+		}
+
+		operator VertexLayout() const
+		{
+			return VertexLayout({ Components... });
 		}
 	};
 
@@ -79,6 +421,25 @@ namespace vks
 		glm::vec3 scale;
 		glm::vec2 uvscale;
 		VkMemoryPropertyFlags memoryPropertyFlags = 0;
+		/**
+		* Reorder the triangles and vertices of each part for vertex cache, overdraw and vertex fetch efficiency (see vks::meshopt)
+		* Off by default, as it only pays off for vertex bound meshes, the gain is reported in vks::MeshCache::Stats::optimization
+		*/
+		bool optimize = false;
+		/**
+		* Number of levels of detail to generate by simplification (see vks::meshopt::Simplify), 0 keeps the parts of the source file
+		* If set, part 0 contains the whole model and each following part a simplified version of it
+		*/
+		uint32_t lodCount = 0;
+		/** @brief Index count of each generated level of detail relative to the previous one */
+		float lodReduction = 0.5f;
+		/** @brief Maximum error of the first generated level of detail relative to the model size, doubled for each further level */
+		float lodError = 0.01f;
+		/**
+		* Split each part into meshlets with bounding spheres and normal cones for cluster culling (see vks::meshopt::BuildMeshlets and vks::ClusterCuller)
+		* The index buffer can then also be bound as a storage buffer
+		*/
+		bool meshlets = false;
 
 		ModelCreateInfo() : center(glm::vec3(0.0f)), scale(glm::vec3(1.0f)), uvscale(glm::vec2(1.0f)) {};
 
@@ -111,9 +472,18 @@ namespace vks
 			uint32_t vertexCount;
 			uint32_t indexBase;
 			uint32_t indexCount;
+			/** @brief Range of the part's meshlets, only set if the model has been loaded with meshlets */
+			uint32_t meshletBase;
+			uint32_t meshletCount;
 		};
 		std::vector<ModelPart> parts;
 
+		/** @brief Meshlets of all parts, their index ranges refer to the model's index buffer */
+		std::vector<vks::meshopt::Meshlet> meshlets;
+
+		/** @brief Vertex cache statistics of all parts before and after optimization, only set if the model has been loaded from its source file */
+		vks::meshopt::Result optimization;
+
 		static const int defaultFlags = aiProcess_FlipWindingOrder | aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals;
 
 		struct Dimension
@@ -123,31 +493,254 @@ namespace vks
 			glm::vec3 size;
 		} dim;
 
+		/** @brief Transform from VERTEX_COMPONENT_POSITION_UNORM16 values to positions, the bounds of the scaled and centered model */
+		struct Quantization
+		{
+			glm::vec3 offset = glm::vec3(0.0f);
+			glm::vec3 scale = glm::vec3(1.0f);
+		} quantization;
+
+		/** @brief Release the memory of a buffer, which is either sub-allocated by the device or has been allocated by the sample */
+		void FreeMemory(vks::Buffer& buffer)
+		{
+			if (buffer.allocation)
+			{
+				buffer.allocation.Free();
+			}
+			else
+			{
+				vkFreeMemory(device, buffer.memory, nullptr);
+			}
+		}
+
 		/** @brief Release all Vulkan resources of this model */
 		void Destroy()
 		{
 			assert(device);
 			vkDestroyBuffer(device, vertices.buffer, nullptr);
-			vkFreeMemory(device, vertices.memory, nullptr);
+			FreeMemory(vertices);
 			if (indices.buffer != VK_NULL_HANDLE)
 			{
 				vkDestroyBuffer(device, indices.buffer, nullptr);
-				vkFreeMemory(device, indices.memory, nullptr);
+				FreeMemory(indices);
 			}
 		}
 
+		/** @brief Create the device local vertex and index buffers and upload the data to them */
+		void CreateBuffers(const void* vertexData, VkDeviceSize vertexDataSize, const void* indexData, VkDeviceSize indexDataSize, vks::ModelCreateInfo* createInfo, vks::VulkanDevice* device)
+		{
+			VkBufferUsageFlags usageFlags = createInfo ? createInfo->memoryPropertyFlags : 0;
+			// The cluster culling shader reads the indices of the visible meshlets
+			VkBufferUsageFlags indexUsageFlags = meshlets.empty() ? 0 : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+			// Create device local target buffers
+			// Vertex buffer
+			VK_CHECK_RESULT(device->CreateBuffer(
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usageFlags,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&vertices,
+				vertexDataSize));
+
+			// Index buffer
+			VK_CHECK_RESULT(device->CreateBuffer(
+				VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | indexUsageFlags | usageFlags,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&indices,
+				indexDataSize));
+
+			// Copy to the device local buffers through the uploader's staging ring
+			device->uploader.UploadBuffer(vertices.buffer, vertexData, vertexDataSize);
+			device->uploader.UploadBuffer(indices.buffer, indexData, indexDataSize);
+			device->uploader.Submit();
+		}
+
+		/** @brief Hash of everything besides the source file that affects the generated vertex and index data */
+		static uint64_t CacheKey(const vks::VertexLayout& layout, const vks::ModelCreateInfo& settings)
+		{
+			uint32_t flags[5] = { MeshCache::fileVersion, static_cast<uint32_t>(defaultFlags), settings.optimize ? 1u : 0u, settings.lodCount, settings.meshlets ? 1u : 0u };
+			float lodSettings[2] = { settings.lodReduction, settings.lodError };
+			uint64_t key = MeshCache::Hash(flags, sizeof(flags));
+			key = MeshCache::Hash(layout.components.data(), layout.components.size() * sizeof(Component), key);
+			key = MeshCache::Hash(glm::value_ptr(settings.scale), sizeof(settings.scale), key);
+			key = MeshCache::Hash(glm::value_ptr(settings.uvscale), sizeof(settings.uvscale), key);
+			key = MeshCache::Hash(glm::value_ptr(settings.center), sizeof(settings.center), key);
+			return MeshCache::Hash(lodSettings, sizeof(lodSettings), key);
+		}
+
 		/**
-		* Loads a 3D model from a file into Vulkan buffers
+		* Replace the parts with levels of detail of the whole model
 		*
-		* @param device Pointer to the Vulkan device used to generated the vertex and index buffers on
-		* @param filename File to load (must be a model format supported by ASSIMP)
-		* @param layout Vertex layout components (position, normals, tangents, etc.)
-		* @param createInfo MeshCreateInfo structure for load time settings like scale, center, etc.
-		* @param copyQueue Queue used for the memory staging copy commands (must support transfer)
+		* Part 0 contains all triangles, the simplified triangles of each further level are appended to the index buffer.
+		* All levels use the same vertices, so switching between them only changes the index range of a draw
+		*
+		* @param vertexBuffer Vertex data of the model
+		* @param indexBuffer Index data of the model, receives the indices of the generated levels
+		* @param stride Size of a vertex in bytes
+		* @param positionOffset Offset of the vertex position in bytes
+		* @param settings Number of levels, reduction and error per level
 		*/
-		bool LoadFromFile(const std::string& filename, vks::VertexLayout layout, vks::ModelCreateInfo* createInfo, vks::VulkanDevice* device, VkQueue copyQueue)
+		void GenerateLods(const std::vector<float>& vertexBuffer, std::vector<uint32_t>& indexBuffer, size_t stride, size_t positionOffset, const vks::ModelCreateInfo& settings)
+		{
+			ModelPart lod = {};
+			lod.vertexCount = vertexCount;
+			lod.indexCount = indexCount;
+			parts.assign(1, lod);
+
+			const uint32_t baseIndexCount = indexCount;
+			float targetIndexCount = static_cast<float>(baseIndexCount);
+			float targetError = settings.lodError;
+			for (uint32_t level = 1; level <= settings.lodCount; level++)
+			{
+				targetIndexCount *= settings.lodReduction;
+				float error = 0.0f;
+				indexBuffer.resize(indexCount + baseIndexCount);
+				uint32_t* lodIndices = indexBuffer.data() + indexCount;
+				lod.indexBase = indexCount;
+				lod.indexCount = static_cast<uint32_t>(vks::meshopt::Simplify(lodIndices, indexBuffer.data(), baseIndexCount, vertexBuffer.data(), vertexCount, stride, positionOffset,
+					static_cast<size_t>(targetIndexCount), targetError, &error));
+				if (settings.optimize)
+				{
+					vks::meshopt::OptimizeVertexCache(lodIndices, lod.indexCount, vertexCount);
+				}
+				if (MeshCache::Get().verbose)
+					printf("LOD %u: %u triangles, error %.4f\n", level, lod.indexCount / 3, error);
+				indexCount += lod.indexCount;
+				parts.push_back(lod);
+				targetError *= 2.0f;
+			}
+			indexBuffer.resize(indexCount);
+		}
+
+		/**
+		* Split all parts into meshlets
+		*
+		* The triangles of each part are reordered into meshlet order, which mostly keeps the vertex cache order as meshlets are seeded in index order
+		*
+		* @param vertexBuffer Vertex data of the model
+		* @param indexBuffer Index data of the model, reordered per part
+		* @param stride Size of a vertex in bytes
+		* @param positionOffset Offset of the vertex position in bytes
+		* @param normalOffset Offset of the vertex normal in bytes, used to orient the normal cones so they point to the outside, ~0 if the layout has none
+		*/
+		void GenerateMeshlets(const std::vector<float>& vertexBuffer, std::vector<uint32_t>& indexBuffer, size_t stride, size_t positionOffset, size_t normalOffset)
+		{
+			const uint8_t* vertexData = reinterpret_cast<const uint8_t*>(vertexBuffer.data());
+			meshlets.clear();
+			for (ModelPart& part : parts)
+			{
+				uint32_t* partIndices = indexBuffer.data() + part.indexBase;
+				// The loader flips the winding order, so compare the triangle normals with the vertex normals instead of assuming one
+				bool flipNormals = false;
+				if (normalOffset != ~size_t(0))
+				{
+					int agreement = 0;
+					for (uint32_t i = 0; i + 2 < part.indexCount; i += 3)
+					{
+						float n[3];
+						vks::meshopt::detail::Normal(
+							reinterpret_cast<const float*>(vertexData + partIndices[i] * stride + positionOffset),
+							reinterpret_cast<const float*>(vertexData + partIndices[i + 1] * stride + positionOffset),
+							reinterpret_cast<const float*>(vertexData + partIndices[i + 2] * stride + positionOffset), n);
+						const float* vertexNormal = reinterpret_cast<const float*>(vertexData + partIndices[i] * stride + normalOffset);
+						float d = n[0] * vertexNormal[0] + n[1] * vertexNormal[1] + n[2] * vertexNormal[2];
+						agreement += (d > 0.0f) ? 1 : ((d < 0.0f) ? -1 : 0);
+					}
+					flipNormals = agreement < 0;
+				}
+				std::vector<vks::meshopt::Meshlet> partMeshlets = vks::meshopt::BuildMeshlets(partIndices, part.indexCount, vertexBuffer.data(), part.vertexBase + part.vertexCount,
+					stride, positionOffset, flipNormals, part.indexBase);
+				part.meshletBase = static_cast<uint32_t>(meshlets.size());
+				part.meshletCount = static_cast<uint32_t>(partMeshlets.size());
+				meshlets.insert(meshlets.end(), partMeshlets.begin(), partMeshlets.end());
+			}
+		}
+
+		/**
+		* Load the model from a cache file written by an earlier run
+		*
+		* The vertex and index data is uploaded straight from the mapped file
+		*
+		* @return True if the cache file exists and matches the key and source file
+		*/
+		bool LoadFromCache(const std::string& cacheFilename, uint64_t key, uint64_t sourceHash, uint64_t sourceSize, vks::ModelCreateInfo* createInfo, vks::VulkanDevice* device)
+		{
+			vks::MappedFile file;
+			if (!file.Open(cacheFilename) || (file.size < sizeof(MeshCache::FileHeader)))
+				return false;
+
+			MeshCache::FileHeader header;
+			memcpy(&header, file.data, sizeof(header));
+			uint64_t partsSize = static_cast<uint64_t>(header.partCount) * sizeof(ModelPart);
+			uint64_t meshletsSize = static_cast<uint64_t>(header.meshletCount) * sizeof(vks::meshopt::Meshlet);
+			if ((header.magic != MeshCache::fileMagic) || (header.version != MeshCache::fileVersion) ||
+				(header.key != key) || (header.sourceHash != sourceHash) || (header.sourceSize != sourceSize) ||
+				(header.partSize != sizeof(ModelPart)) || (header.meshletSize != sizeof(vks::meshopt::Meshlet)) ||
+				(header.indexDataSize != static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t)) ||
+				(sizeof(header) + partsSize + meshletsSize + header.vertexDataSize + header.indexDataSize != file.size))
+			{
+				return false;
+			}
+
+			const uint8_t* data = file.data + sizeof(header);
+			parts.resize(header.partCount);
+			memcpy(parts.data(), data, static_cast<size_t>(partsSize));
+			data += partsSize;
+			meshlets.resize(header.meshletCount);
+			memcpy(meshlets.data(), data, static_cast<size_t>(meshletsSize));
+			data += meshletsSize;
+			vertexCount = header.vertexCount;
+			indexCount = header.indexCount;
+			dim.min = glm::min(dim.min, glm::make_vec3(header.dimMin));
+			dim.max = glm::max(dim.max, glm::make_vec3(header.dimMax));
+			dim.size = dim.max - dim.min;
+			quantization.offset = glm::make_vec3(header.quantizationOffset);
+			quantization.scale = glm::make_vec3(header.quantizationScale);
+
+			CreateBuffers(data, header.vertexDataSize, data + header.vertexDataSize, header.indexDataSize, createInfo, device);
+			return true;
+		}
+
+		/** @brief Writes the vertices of a mesh in the given layout, see VertexLayout::WriteVertices and StaticVertexLayout::WriteVertices */
+		typedef void (*VertexWriter)(const VertexLayout& layout, const VertexSource& src, uint32_t vertexCount, float* dst);
+
+		bool Load(const std::string& filename, const vks::VertexLayout& layout, VertexWriter writeVertices, vks::ModelCreateInfo* createInfo, vks::VulkanDevice* device)
 		{
 			this->device = device->logicalDevice;
+			auto tStart = std::chrono::high_resolution_clock::now();
+			vks::MeshCache& meshCache = vks::MeshCache::Get();
+
+			// Load time settings, the defaults are used if no create info has been passed
+			const vks::ModelCreateInfo settings = createInfo ? *createInfo : vks::ModelCreateInfo();
+			const glm::vec3 scale = settings.scale;
+			const glm::vec2 uvscale = settings.uvscale;
+			const glm::vec3 center = settings.center;
+			const bool optimize = settings.optimize;
+			// Simplification and meshlet building need triangles to share vertices, which the importer doesn't join (optimization welds them anyway)
+			const bool weld = !optimize && ((settings.lodCount > 0) || settings.meshlets);
+
+#if !defined(__ANDROID__)
+			// Use the cache file if it has been built from the current source file with the same settings
+			std::string cacheFilename;
+			uint64_t cacheKey = 0;
+			uint64_t sourceHash = 0;
+			uint64_t sourceSize = 0;
+			{
+				vks::MappedFile source;
+				if (source.Open(filename))
+				{
+					sourceHash = MeshCache::Hash(source.data, source.size);
+					sourceSize = source.size;
+					cacheKey = CacheKey(layout, settings);
+					cacheFilename = MeshCache::GetFilename(filename, cacheKey);
+				}
+			}
+			if (meshCache.load && !cacheFilename.empty() && LoadFromCache(cacheFilename, cacheKey, sourceHash, sourceSize, createInfo, device))
+			{
+				meshCache.stats.warmLoads++;
+				meshCache.stats.warmTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+				return true;
+			}
+#endif
 
 			Assimp::Importer Importer;
 			const aiScene* pScene;
@@ -188,21 +781,68 @@ namespace vks
 				parts.clear();
 				parts.resize(pScene->mNumMeshes);
 
-				glm::vec3 scale(1.0f);
-				glm::vec2 uvscale(1.0f);
-				glm::vec3 center(0.0f);
-				if (createInfo)
+				std::vector<float> vertexBuffer;
+				std::vector<uint32_t> indexBuffer;
+
+				// Size the buffers up front, the vertices are written in place
+				size_t totalVertexCount = 0;
+				size_t totalFaceCount = 0;
+				for (unsigned int i = 0; i < pScene->mNumMeshes; i++)
 				{
-					scale = createInfo->scale;
-					uvscale = createInfo->uvscale;
-					center = createInfo->center;
+					totalVertexCount += pScene->mMeshes[i]->mNumVertices;
+					totalFaceCount += pScene->mMeshes[i]->mNumFaces;
 				}
+				const uint32_t vertexFloatCount = layout.Stride() / sizeof(float);
+				vertexBuffer.resize(totalVertexCount * vertexFloatCount);
+				indexBuffer.reserve(totalFaceCount * 3);
 
-				std::vector<float> vertexBuffer;
-				std::vector<uint32_t> indexBuffer;
+				// 16 bit positions are stored relative to the bounds of the whole model
+				quantization = {};
+				if (std::find(layout.components.begin(), layout.components.end(), VERTEX_COMPONENT_POSITION_UNORM16) != layout.components.end())
+				{
+					glm::vec3 min(FLT_MAX);
+					glm::vec3 max(-FLT_MAX);
+					for (unsigned int i = 0; i < pScene->mNumMeshes; i++)
+					{
+						for (unsigned int j = 0; j < pScene->mMeshes[i]->mNumVertices; j++)
+						{
+							const aiVector3D& p = pScene->mMeshes[i]->mVertices[j];
+							const glm::vec3 pos = glm::vec3(p.x, -p.y, p.z) * scale + center;
+							min = glm::min(min, pos);
+							max = glm::max(max, pos);
+						}
+					}
+					if (totalVertexCount > 0)
+					{
+						quantization.offset = min;
+						quantization.scale = max - min;
+					}
+				}
+				const glm::vec3 positionInvExtent = glm::vec3(
+					(quantization.scale.x > 0.0f) ? 1.0f / quantization.scale.x : 0.0f,
+					(quantization.scale.y > 0.0f) ? 1.0f / quantization.scale.y : 0.0f,
+					(quantization.scale.z > 0.0f) ? 1.0f / quantization.scale.z : 0.0f);
+
+				// Byte offsets of the positions for the overdraw optimization and of the normals for the meshlet cones
+				size_t positionOffset = ~size_t(0);
+				size_t normalOffset = ~size_t(0);
+				for (size_t i = 0, offset = 0; i < layout.components.size(); i++)
+				{
+					if ((layout.components[i] == VERTEX_COMPONENT_POSITION) && (positionOffset == ~size_t(0)))
+					{
+						positionOffset = offset;
+					}
+					if ((layout.components[i] == VERTEX_COMPONENT_NORMAL) && (normalOffset == ~size_t(0)))
+					{
+						normalOffset = offset;
+					}
+					offset += ComponentSize(layout.components[i]) * sizeof(float);
+				}
 
 				vertexCount = 0;
 				indexCount = 0;
+				optimization = {};
+				meshlets.clear();
 
 				// Load meshes
 				for (unsigned int i = 0; i < pScene->mNumMeshes; i++)
@@ -213,150 +853,122 @@ namespace vks
 					parts[i].vertexBase = vertexCount;
 					parts[i].indexBase = indexCount;
 
-					vertexCount += pScene->mMeshes[i]->mNumVertices;
-
 					aiColor3D pColor(0.f, 0.f, 0.f);
 					pScene->mMaterials[paiMesh->mMaterialIndex]->Get(AI_MATKEY_COLOR_DIFFUSE, pColor);
 
 					const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
 
+					VertexSource source;
+					source.positions = paiMesh->mVertices;
+					source.normals = paiMesh->mNormals;
+					source.texCoords = (paiMesh->HasTextureCoords(0)) ? paiMesh->mTextureCoords[0] : &Zero3D;
+					source.texCoordStep = (paiMesh->HasTextureCoords(0)) ? 1 : 0;
+					source.tangents = (paiMesh->HasTangentsAndBitangents()) ? paiMesh->mTangents : &Zero3D;
+					source.bitangents = (paiMesh->HasTangentsAndBitangents()) ? paiMesh->mBitangents : &Zero3D;
+					source.tangentStep = (paiMesh->HasTangentsAndBitangents()) ? 1 : 0;
+					source.color = pColor;
+					source.scale = scale;
+					source.uvscale = uvscale;
+					source.center = center;
+					source.positionMin = quantization.offset;
+					source.positionInvExtent = positionInvExtent;
+					float* meshVertices = vertexBuffer.data() + static_cast<size_t>(vertexCount) * vertexFloatCount;
+					writeVertices(layout, source, paiMesh->mNumVertices, meshVertices);
+
 					for (unsigned int j = 0; j < paiMesh->mNumVertices; j++)
 					{
-						const aiVector3D* pPos = &(paiMesh->mVertices[j]);
-						const aiVector3D* pNormal = &(paiMesh->mNormals[j]);
-						const aiVector3D* pTexCoord = (paiMesh->HasTextureCoords(0)) ? &(paiMesh->mTextureCoords[0][j]) : &Zero3D;
-						const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[j]) : &Zero3D;
-						const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[j]) : &Zero3D;
-
-						for (auto& component : layout.components)
-						{
-							switch (component) {
-							case VERTEX_COMPONENT_POSITION:
-								vertexBuffer.push_back(pPos->x * scale.x + center.x);
-								vertexBuffer.push_back(-pPos->y * scale.y + center.y);
-								vertexBuffer.push_back(pPos->z * scale.z + center.z);
-								break;
-							case VERTEX_COMPONENT_NORMAL:
-								vertexBuffer.push_back(pNormal->x);
-								vertexBuffer.push_back(-pNormal->y);
-								vertexBuffer.push_back(pNormal->z);
-								break;
-							case VERTEX_COMPONENT_UV:
-								vertexBuffer.push_back(pTexCoord->x * uvscale.s);
-								vertexBuffer.push_back(pTexCoord->y * uvscale.t);
-								break;
-							case VERTEX_COMPONENT_COLOR:
-								vertexBuffer.push_back(pColor.r);
-								vertexBuffer.push_back(pColor.g);
-								vertexBuffer.push_back(pColor.b);
-								break;
-							case VERTEX_COMPONENT_TANGENT:
-								vertexBuffer.push_back(pTangent->x);
-								vertexBuffer.push_back(pTangent->y);
-								vertexBuffer.push_back(pTangent->z);
-								break;
-							case VERTEX_COMPONENT_BITANGENT:
-								vertexBuffer.push_back(pBiTangent->x);
-								vertexBuffer.push_back(pBiTangent->y);
-								vertexBuffer.push_back(pBiTangent->z);
-								break;
-								// Dummy components for padding
-							case VERTEX_COMPONENT_DUMMY_FLOAT:
-								vertexBuffer.push_back(0.0f);
-								break;
-							case VERTEX_COMPONENT_DUMMY_VEC4:
-								vertexBuffer.push_back(0.0f);
-								vertexBuffer.push_back(0.0f);
-								vertexBuffer.push_back(0.0f);
-								vertexBuffer.push_back(0.0f);
-								break;
-							};
-						}
-
-						dim.max.x = fmax(pPos->x, dim.max.x);
-						dim.max.y = fmax(pPos->y, dim.max.y);
-						dim.max.z = fmax(pPos->z, dim.max.z);
-
-						dim.min.x = fmin(pPos->x, dim.min.x);
-						dim.min.y = fmin(pPos->y, dim.min.y);
-						dim.min.z = fmin(pPos->z, dim.min.z);
+						const glm::vec3 pos = glm::make_vec3(&paiMesh->mVertices[j].x);
+						dim.max = glm::max(pos, dim.max);
+						dim.min = glm::min(pos, dim.min);
 					}
 
 					dim.size = dim.max - dim.min;
 
 					parts[i].vertexCount = paiMesh->mNumVertices;
 
-					uint32_t indexBase = static_cast<uint32_t>(indexBuffer.size());
+					// Indices are relative to the first vertex of the part
 					for (unsigned int j = 0; j < paiMesh->mNumFaces; j++)
 					{
 						const aiFace& Face = paiMesh->mFaces[j];
 						if (Face.mNumIndices != 3)
 							continue;
-						indexBuffer.push_back(indexBase + Face.mIndices[0]);
-						indexBuffer.push_back(indexBase + Face.mIndices[1]);
-						indexBuffer.push_back(indexBase + Face.mIndices[2]);
+						indexBuffer.push_back(parts[i].vertexBase + Face.mIndices[0]);
+						indexBuffer.push_back(parts[i].vertexBase + Face.mIndices[1]);
+						indexBuffer.push_back(parts[i].vertexBase + Face.mIndices[2]);
 						parts[i].indexCount += 3;
 						indexCount += 3;
 					}
+
+					if (optimize && (parts[i].indexCount > 0))
+					{
+						vks::meshopt::Result result = vks::meshopt::OptimizeMesh(meshVertices, parts[i].vertexCount, layout.Stride(), positionOffset,
+							indexBuffer.data() + parts[i].indexBase, parts[i].indexCount, parts[i].vertexBase);
+						parts[i].vertexCount = static_cast<uint32_t>(result.verticesAfter);
+						optimization.Add(result);
+					}
+					else if (weld && (parts[i].indexCount > 0))
+					{
+						parts[i].vertexCount = static_cast<uint32_t>(vks::meshopt::WeldVertices(meshVertices, parts[i].vertexCount, layout.Stride(),
+							indexBuffer.data() + parts[i].indexBase, parts[i].indexCount, parts[i].vertexBase));
+					}
+
+					vertexCount += parts[i].vertexCount;
 				}
+				// Welding and fetch optimization may have removed vertices
+				vertexBuffer.resize(static_cast<size_t>(vertexCount) * vertexFloatCount);
 
+				if (optimize)
+				{
+					meshCache.stats.optimization.Add(optimization);
+					if (meshCache.verbose)
+						printf("Optimized '%s': %s\n", filename.c_str(), optimization.ToString().c_str());
+				}
+
+				if ((settings.lodCount > 0) && (positionOffset != ~size_t(0)))
+				{
+					if (meshCache.verbose)
+						printf("Generating %u levels of detail for '%s' (%u triangles)\n", settings.lodCount, filename.c_str(), indexCount / 3);
+					GenerateLods(vertexBuffer, indexBuffer, layout.Stride(), positionOffset, settings);
+					meshCache.stats.lodLevels += settings.lodCount;
+				}
+
+				if (settings.meshlets && (positionOffset != ~size_t(0)))
+				{
+					GenerateMeshlets(vertexBuffer, indexBuffer, layout.Stride(), positionOffset, normalOffset);
+					meshCache.stats.meshlets += static_cast<uint32_t>(meshlets.size());
+					if (meshCache.verbose)
+						printf("Built %u meshlets for '%s'\n", static_cast<uint32_t>(meshlets.size()), filename.c_str());
+				}
 
 				uint32_t vBufferSize = static_cast<uint32_t>(vertexBuffer.size()) * sizeof(float);
 				uint32_t iBufferSize = static_cast<uint32_t>(indexBuffer.size()) * sizeof(uint32_t);
 
-				// Use staging buffer to move vertex and index buffer to device local memory
-				// Create staging buffers
-				vks::Buffer vertexStaging, indexStaging;
-
-				// Vertex buffer
-				VK_CHECK_RESULT(device->CreateBuffer(
-					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					&vertexStaging,
-					vBufferSize,
-					vertexBuffer.data()));
-
-				// Index buffer
-				VK_CHECK_RESULT(device->CreateBuffer(
-					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					&indexStaging,
-					iBufferSize,
-					indexBuffer.data()));
-
-				// Create device local target buffers
-				// Vertex buffer
-				VK_CHECK_RESULT(device->CreateBuffer(
-					VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | createInfo->memoryPropertyFlags,
-					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-					&vertices,
-					vBufferSize));
-
-				// Index buffer
-				VK_CHECK_RESULT(device->CreateBuffer(
-					VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | createInfo->memoryPropertyFlags,
-					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-					&indices,
-					iBufferSize));
-
-				// Copy from staging buffers
-				VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-				VkBufferCopy copyRegion{};
-
-				copyRegion.size = vBufferSize;
-				vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
-
-				copyRegion.size = iBufferSize;
-				vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
-
-				device->FlushCommandBuffer(copyCmd, copyQueue);
-
-				// Destroy staging resources
-				vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-				vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-				vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-				vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
+				CreateBuffers(vertexBuffer.data(), vBufferSize, indexBuffer.data(), iBufferSize, createInfo, device);
+
+#if !defined(__ANDROID__)
+				if (meshCache.save && !cacheFilename.empty())
+				{
+					MeshCache::FileHeader header{};
+					header.key = cacheKey;
+					header.sourceHash = sourceHash;
+					header.sourceSize = sourceSize;
+					header.vertexCount = vertexCount;
+					header.indexCount = indexCount;
+					header.partCount = static_cast<uint32_t>(parts.size());
+					header.partSize = sizeof(ModelPart);
+					header.meshletCount = static_cast<uint32_t>(meshlets.size());
+					header.meshletSize = sizeof(vks::meshopt::Meshlet);
+					header.vertexDataSize = vBufferSize;
+					header.indexDataSize = iBufferSize;
+					memcpy(header.dimMin, glm::value_ptr(dim.min), sizeof(header.dimMin));
+					memcpy(header.dimMax, glm::value_ptr(dim.max), sizeof(header.dimMax));
+					memcpy(header.quantizationOffset, glm::value_ptr(quantization.offset), sizeof(header.quantizationOffset));
+					memcpy(header.quantizationScale, glm::value_ptr(quantization.scale), sizeof(header.quantizationScale));
+					MeshCache::Write(cacheFilename, header, { { parts.data(), parts.size() * sizeof(ModelPart) }, { meshlets.data(), meshlets.size() * sizeof(vks::meshopt::Meshlet) }, { vertexBuffer.data(), vBufferSize }, { indexBuffer.data(), iBufferSize } });
+				}
+#endif
+				meshCache.stats.coldLoads++;
+				meshCache.stats.coldTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
 
 				return true;
 			}
@@ -370,6 +982,30 @@ namespace vks
 			}
 		};
 
+		/**
+		* Loads a 3D model from a file into Vulkan buffers
+		*
+		* The generated vertex and index data is stored in a cache file next to the source file,
+		* later loads with the same settings use that instead of importing the source file again (see vks::MeshCache)
+		*
+		* @param device Pointer to the Vulkan device used to generated the vertex and index buffers on
+		* @param filename File to load (must be a model format supported by ASSIMP)
+		* @param layout Vertex layout components (position, normals, tangents, etc.)
+		* @param createInfo MeshCreateInfo structure for load time settings like scale, center, etc.
+		* @param copyQueue Unused, the upload is submitted by the device's uploader
+		*/
+		bool LoadFromFile(const std::string& filename, vks::VertexLayout layout, vks::ModelCreateInfo* createInfo, vks::VulkanDevice* device, VkQueue copyQueue)
+		{
+			return Load(filename, layout, &VertexLayout::WriteVertices, createInfo, device);
+		}
+
+		/** @brief Loads a 3D model from a file into Vulkan buffers, with the vertex writer generated for a compile time layout */
+		template<Component... Components>
+		bool LoadFromFile(const std::string& filename, vks::StaticVertexLayout<Components...> layout, vks::ModelCreateInfo* createInfo, vks::VulkanDevice* device, VkQueue copyQueue)
+		{
+			return Load(filename, layout, &StaticVertexLayout<Components...>::WriteVertices, createInfo, device);
+		}
+
 		/**
 		* Loads a 3D model from a file into Vulkan buffers
 		*
@@ -377,12 +1013,20 @@ namespace vks
 		* @param filename File to load (must be a model format supported by ASSIMP)
 		* @param layout Vertex layout components (position, normals, tangents, etc.)
 		* @param scale Load time scene scale
-		* @param copyQueue Queue used for the memory staging copy commands (must support transfer)
+		* @param copyQueue Unused, the upload is submitted by the device's uploader
 		*/
 		bool LoadFromFile(const std::string& filename, vks::VertexLayout layout, float scale, vks::VulkanDevice* device, VkQueue copyQueue)
 		{
 			vks::ModelCreateInfo modelCreateInfo(scale, 1.0f, 0.0f);
 			return LoadFromFile(filename, layout, &modelCreateInfo, device, copyQueue);
 		}
+
+		/** @brief Loads a 3D model from a file into Vulkan buffers, with the vertex writer generated for a compile time layout */
+		template<Component... Components>
+		bool LoadFromFile(const std::string& filename, vks::StaticVertexLayout<Components...> layout, float scale, vks::VulkanDevice* device, VkQueue copyQueue)
+		{
+			vks::ModelCreateInfo modelCreateInfo(scale, 1.0f, 0.0f);
+			return LoadFromFile(filename, layout, &modelCreateInfo, device, copyQueue);
+		}
 	};
 };
\ No newline at end of file
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	/**
+	* Compiles graphics and compute pipelines on a pool of worker threads
+	*
+	* Create infos are deep copied on submission, so the caller may change or release the state structures right after submitting
+	* (pNext chains are not copied and need to stay valid until the pipeline has been created).
+	* Each worker compiles into its own pipeline cache to avoid contention on the application's cache,
+	* the worker caches are merged back into it on Wait() and Destroy().
+	*
+	* @note Pipelines must only be submitted from a single thread
+	*/
+	class PipelineBuilder
+	{
+	private:
+		// Copy of a shader stage including its entry point name and specialization data
+		struct ShaderStage
+		{
+			VkPipelineShaderStageCreateInfo createInfo;
+			std::string name;
+			VkSpecializationInfo specializationInfo;
+			std::vector<VkSpecializationMapEntry> mapEntries;
+			std::vector<uint8_t> data;
+
+			ShaderStage(const VkPipelineShaderStageCreateInfo& stage) : createInfo(stage), name(stage.pName)
+			{
+				if (stage.pSpecializationInfo)
+				{
+					specializationInfo = *stage.pSpecializationInfo;
+					mapEntries.assign(specializationInfo.pMapEntries, specializationInfo.pMapEntries + specializationInfo.mapEntryCount);
+					const uint8_t* src = static_cast<const uint8_t*>(specializationInfo.pData);
+					data.assign(src, src + specializationInfo.dataSize);
+				}
+			}
+
+			// Points the copied create info at the copied data, must be called once the stage has its final address
+			void Fixup()
+			{
+				createInfo.pName = name.c_str();
+				if (createInfo.pSpecializationInfo)
+				{
+					specializationInfo.pMapEntries = mapEntries.data();
+					specializationInfo.pData = data.data();
+					createInfo.pSpecializationInfo = &specializationInfo;
+				}
+			}
+		};
+
+		// Owns copies of all structures referenced by a graphics pipeline create info
+		struct GraphicsPipelineState
+		{
+			VkGraphicsPipelineCreateInfo createInfo;
+			std::vector<ShaderStage> stages;
+			std::vector<VkPipelineShaderStageCreateInfo> stageCreateInfos;
+			VkPipelineVertexInputStateCreateInfo vertexInputState;
+			std::vector<VkVertexInputBindingDescription> vertexBindings;
+			std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+			VkPipelineInputAssemblyStateCreateInfo inputAssemblyState;
+			VkPipelineTessellationStateCreateInfo tessellationState;
+			VkPipelineViewportStateCreateInfo viewportState;
+			std::vector<VkViewport> viewports;
+			std::vector<VkRect2D> scissors;
+			VkPipelineRasterizationStateCreateInfo rasterizationState;
+			VkPipelineMultisampleStateCreateInfo multisampleState;
+			std::vector<VkSampleMask> sampleMask;
+			VkPipelineDepthStencilStateCreateInfo depthStencilState;
+			VkPipelineColorBlendStateCreateInfo colorBlendState;
+			std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+			VkPipelineDynamicStateCreateInfo dynamicState;
+			std::vector<VkDynamicState> dynamicStates;
+
+			GraphicsPipelineState(const VkGraphicsPipelineCreateInfo& ci) : createInfo(ci)
+			{
+				stages.reserve(ci.stageCount);
+				for (uint32_t i = 0; i < ci.stageCount; i++)
+					stages.emplace_back(ci.pStages[i]);
+				for (auto& stage : stages)
+				{
+					stage.Fixup();
+					stageCreateInfos.push_back(stage.createInfo);
+				}
+				createInfo.pStages = stageCreateInfos.data();
+
+				if (ci.pVertexInputState)
+				{
+					vertexInputState = *ci.pVertexInputState;
+					vertexBindings.assign(vertexInputState.pVertexBindingDescriptions, vertexInputState.pVertexBindingDescriptions + vertexInputState.vertexBindingDescriptionCount);
+					vertexAttributes.assign(vertexInputState.pVertexAttributeDescriptions, vertexInputState.pVertexAttributeDescriptions + vertexInputState.vertexAttributeDescriptionCount);
+					vertexInputState.pVertexBindingDescriptions = vertexBindings.data();
+					vertexInputState.pVertexAttributeDescriptions = vertexAttributes.data();
+					createInfo.pVertexInputState = &vertexInputState;
+				}
+				if (ci.pInputAssemblyState)
+				{
+					inputAssemblyState = *ci.pInputAssemblyState;
+					createInfo.pInputAssemblyState = &inputAssemblyState;
+				}
+				if (ci.pTessellationState)
+				{
+					tessellationState = *ci.pTessellationState;
+					createInfo.pTessellationState = &tessellationState;
+				}
+				if (ci.pViewportState)
+				{
+					viewportState = *ci.pViewportState;
+					// Viewports and scissors may be null if they are dynamic state
+					if (viewportState.pViewports)
+					{
+						viewports.assign(viewportState.pViewports, viewportState.pViewports + viewportState.viewportCount);
+						viewportState.pViewports = viewports.data();
+					}
+					if (viewportState.pScissors)
+					{
+						scissors.assign(viewportState.pScissors, viewportState.pScissors + viewportState.scissorCount);
+						viewportState.pScissors = scissors.data();
+					}
+					createInfo.pViewportState = &viewportState;
+				}
+				if (ci.pRasterizationState)
+				{
+					rasterizationState = *ci.pRasterizationState;
+					createInfo.pRasterizationState = &rasterizationState;
+				}
+				if (ci.pMultisampleState)
+				{
+					multisampleState = *ci.pMultisampleState;
+					if (multisampleState.pSampleMask)
+					{
+						sampleMask.assign(multisampleState.pSampleMask, multisampleState.pSampleMask + (multisampleState.rasterizationSamples + 31) / 32);
+						multisampleState.pSampleMask = sampleMask.data();
+					}
+					createInfo.pMultisampleState = &multisampleState;
+				}
+				if (ci.pDepthStencilState)
+				{
+					depthStencilState = *ci.pDepthStencilState;
+					createInfo.pDepthStencilState = &depthStencilState;
+				}
+				if (ci.pColorBlendState)
+				{
+					colorBlendState = *ci.pColorBlendState;
+					blendAttachments.assign(colorBlendState.pAttachments, colorBlendState.pAttachments + colorBlendState.attachmentCount);
+					colorBlendState.pAttachments = blendAttachments.data();
+					createInfo.pColorBlendState = &colorBlendState;
+				}
+				if (ci.pDynamicState)
+				{
+					dynamicState = *ci.pDynamicState;
+					dynamicStates.assign(dynamicState.pDynamicStates, dynamicState.pDynamicStates + dynamicState.dynamicStateCount);
+					dynamicState.pDynamicStates = dynamicStates.data();
+					createInfo.pDynamicState = &dynamicState;
+				}
+			}
+		};
+
+		struct ComputePipelineState
+		{
+			VkComputePipelineCreateInfo createInfo;
+			ShaderStage stage;
+
+			ComputePipelineState(const VkComputePipelineCreateInfo& ci) : createInfo(ci), stage(ci.stage)
+			{
+				stage.Fixup();
+				createInfo.stage = stage.createInfo;
+			}
+		};
+
+		struct Request
+		{
+			std::unique_ptr<GraphicsPipelineState> graphics;
+			std::unique_ptr<ComputePipelineState> compute;
+			std::promise<VkPipeline> promise;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+		uint32_t threadCount = 0;
+
+		std::vector<std::thread> threads;
+		// One cache per worker thread, only accessed by that thread until they are merged
+		std::vector<VkPipelineCache> threadCaches;
+		std::deque<std::unique_ptr<Request>> requests;
+		// Requests that have been submitted but not finished yet
+		uint32_t pending = 0;
+		bool destroying = false;
+		std::mutex mutex;
+		std::condition_variable condition;
+
+		void Loop(uint32_t index)
+		{
+			while (true)
+			{
+				std::unique_ptr<Request> request;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait(lock, [this]
+						{
+							return !requests.empty() || destroying;
+						}
+					);
+					if (requests.empty())
+						break;
+					request = std::move(requests.front());
+					requests.pop_front();
+				}
+
+				VkPipeline pipeline = VK_NULL_HANDLE;
+				if (request->graphics)
+				{
+					VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, threadCaches[index], 1, &request->graphics->createInfo, nullptr, &pipeline));
+				}
+				else
+				{
+					VK_CHECK_RESULT(vkCreateComputePipelines(device, threadCaches[index], 1, &request->compute->createInfo, nullptr, &pipeline));
+				}
+				request->promise.set_value(pipeline);
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					pending--;
+					condition.notify_all();
+				}
+			}
+		}
+
+		// Threads are only started with the first request, so samples that don't use the builder don't pay for it
+		void Start()
+		{
+			assert(device != VK_NULL_HANDLE);
+
+			// Seed the worker caches with the current content of the application's cache, so warm starts hit on every thread
+			std::vector<uint8_t> data;
+			size_t size = 0;
+			if (pipelineCache != VK_NULL_HANDLE && vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) == VK_SUCCESS && size > 0)
+			{
+				data.resize(size);
+				if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS)
+					size = 0;
+			}
+
+			VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+			pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			pipelineCacheCreateInfo.initialDataSize = size;
+			pipelineCacheCreateInfo.pInitialData = size > 0 ? data.data() : nullptr;
+			threadCaches.resize(threadCount);
+			for (auto& cache : threadCaches)
+				VK_CHECK_RESULT(vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &cache));
+
+			for (uint32_t i = 0; i < threadCount; i++)
+				threads.push_back(std::thread(&PipelineBuilder::Loop, this, i));
+		}
+
+		std::future<VkPipeline> Enqueue(std::unique_ptr<Request> request)
+		{
+			if (threads.empty())
+				Start();
+			std::future<VkPipeline> future = request->promise.get_future();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				requests.push_back(std::move(request));
+				pending++;
+			}
+			condition.notify_one();
+			return future;
+		}
+
+	public:
+		~PipelineBuilder()
+		{
+			Destroy();
+		}
+
+		/**
+		* Set up the builder, worker threads and their caches are created with the first submitted pipeline
+		*
+		* @param device Logical device to create the pipelines on
+		* @param pipelineCache Application's pipeline cache, the worker caches are seeded from and merged into it
+		* @param threadCount (Optional) Number of worker threads, defaults to the number of hardware threads
+		*/
+		void Create(VkDevice device, VkPipelineCache pipelineCache, uint32_t threadCount = 0)
+		{
+			this->device = device;
+			this->pipelineCache = pipelineCache;
+			if (threadCount == 0)
+				threadCount = std::thread::hardware_concurrency();
+			this->threadCount = threadCount > 0 ? threadCount : 1;
+		}
+
+		/** @brief Queue a graphics pipeline for compilation, the future returns the pipeline once it has been created */
+		std::future<VkPipeline> Submit(const VkGraphicsPipelineCreateInfo& createInfo)
+		{
+			std::unique_ptr<Request> request = std::make_unique<Request>();
+			request->graphics = std::make_unique<GraphicsPipelineState>(createInfo);
+			return Enqueue(std::move(request));
+		}
+
+		/** @brief Queue a compute pipeline for compilation, the future returns the pipeline once it has been created */
+		std::future<VkPipeline> Submit(const VkComputePipelineCreateInfo& createInfo)
+		{
+			std::unique_ptr<Request> request = std::make_unique<Request>();
+			request->compute = std::make_unique<ComputePipelineState>(createInfo);
+			return Enqueue(std::move(request));
+		}
+
+		/** @brief Wait until all submitted pipelines have been created and merge the worker caches into the application's cache */
+		void Wait()
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [this]
+					{
+						return pending == 0;
+					}
+				);
+			}
+			if (pipelineCache != VK_NULL_HANDLE && !threadCaches.empty())
+				VK_CHECK_RESULT(vkMergePipelineCaches(device, pipelineCache, static_cast<uint32_t>(threadCaches.size()), threadCaches.data()));
+		}
+
+		/** @brief Finish outstanding work, merge the worker caches and stop the worker threads */
+		void Destroy()
+		{
+			if (threads.empty())
+				return;
+			Wait();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				destroying = true;
+				condition.notify_all();
+			}
+			for (auto& thread : threads)
+				thread.join();
+			threads.clear();
+			for (auto& cache : threadCaches)
+				vkDestroyPipelineCache(device, cache, nullptr);
+			threadCaches.clear();
+			destroying = false;
+		}
+	};
+}
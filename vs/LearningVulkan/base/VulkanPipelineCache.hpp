@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <fstream>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	/**
+	* Pipeline cache that is loaded from and saved to a file, so pipelines don't need to be recompiled on every start
+	*
+	* The file stores a small header with the device the data was created on (vendor, device, driver version and pipeline cache UUID)
+	* and a checksum of the cache data. Files that don't match the current device or fail validation are ignored and replaced on save.
+	*/
+	class PipelineCache
+	{
+	private:
+		static const uint32_t fileMagic = 0x43505653; // "SVPC"
+		static const uint32_t fileVersion = 1;
+
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint32_t checksum;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties properties{};
+
+		static uint32_t Crc32(const uint8_t* data, size_t size)
+		{
+			static const std::array<uint32_t, 256> table = []
+				{
+					std::array<uint32_t, 256> table;
+					for (uint32_t i = 0; i < 256; i++)
+					{
+						uint32_t c = i;
+						for (uint32_t k = 0; k < 8; k++)
+							c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+						table[i] = c;
+					}
+					return table;
+				}();
+			uint32_t crc = 0xFFFFFFFFu;
+			for (size_t i = 0; i < size; i++)
+				crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+			return crc ^ 0xFFFFFFFFu;
+		}
+
+		void FillHeader(FileHeader& header) const
+		{
+			memset(&header, 0, sizeof(header));
+			header.magic = fileMagic;
+			header.version = fileVersion;
+			header.vendorID = properties.vendorID;
+			header.deviceID = properties.deviceID;
+			header.driverVersion = properties.driverVersion;
+			memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+		}
+
+		// Reads the cache data from the file, returns an empty vector if the file is missing, corrupt or from another device / driver
+		std::vector<uint8_t> ReadFile() const
+		{
+			std::vector<uint8_t> data;
+			std::ifstream file(filename, std::ios::binary | std::ios::ate);
+			if (!file.is_open())
+				return data;
+
+			size_t fileSize = static_cast<size_t>(file.tellg());
+			FileHeader header, expected;
+			if (fileSize < sizeof(FileHeader))
+				return data;
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+			FillHeader(expected);
+			if ((header.magic != expected.magic) || (header.version != expected.version) ||
+				(header.vendorID != expected.vendorID) || (header.deviceID != expected.deviceID) || (header.driverVersion != expected.driverVersion) ||
+				(memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) != 0) ||
+				(header.dataSize != fileSize - sizeof(FileHeader)))
+			{
+				std::cout << "Pipeline cache " << filename << " doesn't match the current device or driver, ignoring it" << std::endl;
+				return data;
+			}
+
+			data.resize(static_cast<size_t>(header.dataSize));
+			file.read(reinterpret_cast<char*>(data.data()), data.size());
+			if (!file || (Crc32(data.data(), data.size()) != header.checksum) || !ValidateCacheHeader(data))
+			{
+				std::cout << "Pipeline cache " << filename << " is corrupt, ignoring it" << std::endl;
+				data.clear();
+			}
+			return data;
+		}
+
+		// Checks the header Vulkan puts in front of the implementation specific cache data (VkPipelineCacheHeaderVersionOne)
+		bool ValidateCacheHeader(const std::vector<uint8_t>& data) const
+		{
+			const size_t headerSize = 16 + VK_UUID_SIZE;
+			if (data.size() < headerSize)
+				return false;
+			uint32_t values[4];
+			memcpy(values, data.data(), sizeof(values));
+			return (values[0] >= headerSize) && (values[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE) &&
+				(values[2] == properties.vendorID) && (values[3] == properties.deviceID) &&
+				(memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+		}
+
+	public:
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		std::string filename;
+		/** @brief Size of the cache data loaded from the file (0 for a cold start) */
+		size_t loadedSize = 0;
+
+		/**
+		* Create the pipeline cache, initialized from the given file if it's valid for the device
+		*
+		* @param device Logical device to create the cache on
+		* @param properties Properties of the physical device, used to validate the file
+		* @param filename Name of the cache file
+		* @param load (Optional) If false, existing data is ignored (cold start) but the file is still written on save
+		*
+		* @return VkResult of the pipeline cache creation
+		*/
+		VkResult Create(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& filename, bool load = true)
+		{
+			this->device = device;
+			this->properties = properties;
+			this->filename = filename;
+
+			std::vector<uint8_t> data;
+			if (load)
+				data = ReadFile();
+			loadedSize = data.size();
+
+			VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
+			pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+			pipelineCacheCreateInfo.initialDataSize = data.size();
+			pipelineCacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
+			VkResult result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &cache);
+			if ((result != VK_SUCCESS) && !data.empty())
+			{
+				// Driver rejected the data, start with an empty cache
+				loadedSize = 0;
+				pipelineCacheCreateInfo.initialDataSize = 0;
+				pipelineCacheCreateInfo.pInitialData = nullptr;
+				result = vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &cache);
+			}
+			return result;
+		}
+
+		/**
+		* Write the cache data to the file
+		*
+		* The data is written to a temporary file first which then replaces the cache file,
+		* so an interrupted write never leaves a truncated cache behind
+		*
+		* @return True if the file has been written
+		*/
+		bool Save()
+		{
+			if (cache == VK_NULL_HANDLE)
+				return false;
+
+			size_t size = 0;
+			if ((vkGetPipelineCacheData(device, cache, &size, nullptr) != VK_SUCCESS) || (size == 0))
+				return false;
+			std::vector<uint8_t> data(size);
+			if (vkGetPipelineCacheData(device, cache, &size, data.data()) != VK_SUCCESS)
+				return false;
+			data.resize(size);
+
+			FileHeader header;
+			FillHeader(header);
+			header.dataSize = data.size();
+			header.checksum = Crc32(data.data(), data.size());
+
+			std::string tempFilename = filename + ".tmp";
+			{
+				std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+				if (!file.is_open())
+					return false;
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				file.write(reinterpret_cast<const char*>(data.data()), data.size());
+				file.flush();
+				if (!file)
+				{
+					file.close();
+					remove(tempFilename.c_str());
+					return false;
+				}
+			}
+#if defined(_WIN32)
+			bool replaced = MoveFileExA(tempFilename.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+			bool replaced = rename(tempFilename.c_str(), filename.c_str()) == 0;
+#endif
+			if (!replaced)
+				remove(tempFilename.c_str());
+			return replaced;
+		}
+
+		void Destroy()
+		{
+			if (cache != VK_NULL_HANDLE)
+			{
+				vkDestroyPipelineCache(device, cache, nullptr);
+				cache = VK_NULL_HANDLE;
+			}
+		}
+	};
+}
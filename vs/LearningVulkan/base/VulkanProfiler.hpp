@@ -0,0 +1,294 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <stdint.h>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanDebug.h"
+#include "VulkanQueryRing.hpp"
+
+namespace vks
+{
+	/**
+	* Measures the GPU time of named scopes (e.g. render passes) with pairs of timestamps
+	*
+	* Scopes are also emitted as debug marker regions, so BeginScope and EndScope can be used instead of vks::debugmarker::BeginRegion and EndRegion.
+	* The timestamps are written to a vks::QueryRing with one slot per command buffer (or frame in flight) and resolved when the slot is used again,
+	* so reading them never waits for the GPU. Scopes with the same name are added up per frame, nested scopes are counted in their parents as well.
+	*
+	* Usage:
+	* - Call BeginFrame at the start of a slot's command buffer (outside of a render pass)
+	* - Wrap the passes of the command buffer in BeginScope and EndScope
+	* - Call Submitted after the command buffer has been submitted, and Resolve once the slot's previous submission has finished
+	*
+	* VulkanBase does the last step for the slots of drawCmdBuffers (indexed like the command buffers), samples only need to record the scopes.
+	*/
+	class GpuProfiler
+	{
+	public:
+		/** @brief Measured times of all scopes with the same name, in milliseconds */
+		struct Timing
+		{
+			std::string name;
+			/** @brief Nesting level of the scope the first time it was recorded */
+			uint32_t depth = 0;
+			/** @brief Time of the last resolved frame */
+			double last = 0.0;
+			/** @brief Exponential moving average, for display */
+			double smoothed = 0.0;
+			/** @brief Sum and number of frames since the last ResetStats, for averages over a longer run (e.g. a benchmark) */
+			double total = 0.0;
+			uint32_t frameCount = 0;
+			// Index of the last resolve that contained the scope
+			uint64_t resolveIndex = 0;
+		};
+
+		/** @brief Maximum number of scopes per command buffer, additional scopes only emit debug markers */
+		static const uint32_t maxScopes = 32;
+
+	private:
+		struct Scope
+		{
+			uint32_t timing;
+			uint32_t beginQuery;
+			uint32_t endQuery;
+		};
+
+		struct Slot
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			/** @brief Scopes recorded into the command buffer since the last BeginFrame */
+			std::vector<Scope> recorded;
+			/** @brief Scopes of the last submission, pre-recorded command buffers may be recorded again before their results have been resolved */
+			std::vector<Scope> submitted;
+			/** @brief Indices of the scopes that are still open, innermost last */
+			std::vector<uint32_t> open;
+			uint32_t queryCount = 0;
+			uint32_t submittedQueryCount = 0;
+		};
+
+		bool supported = false;
+		double timestampPeriod = 1.0;
+		uint64_t timestampMask = ~0ull;
+		uint64_t resolveIndex = 0;
+		QueryRing queryRing;
+		std::vector<Slot> slots;
+		std::vector<Timing> timings;
+		std::vector<uint64_t> timestamps;
+
+		// Slot of a command buffer passed to BeginFrame, there are only a few slots so a linear search is fine
+		Slot* FindSlot(VkCommandBuffer commandBuffer)
+		{
+			for (auto& slot : slots)
+			{
+				if (slot.commandBuffer == commandBuffer)
+					return &slot;
+			}
+			return nullptr;
+		}
+
+		uint32_t FindTiming(const char* name, uint32_t depth)
+		{
+			for (uint32_t i = 0; i < timings.size(); i++)
+			{
+				if (timings[i].name == name)
+					return i;
+			}
+			Timing timing;
+			timing.name = name;
+			timing.depth = depth;
+			timings.push_back(timing);
+			return static_cast<uint32_t>(timings.size() - 1);
+		}
+
+	public:
+		/** @brief Weight of the last frame in the moving average */
+		double smoothing = 0.05;
+
+		/**
+		* Create the timestamp query pools
+		*
+		* @param device Logical device
+		* @param limits Limits of the physical device, timestamps must be supported by all graphics and compute queues (timestampComputeAndGraphics)
+		* @param timestampValidBits Valid bits of the timestamps of the queue family the command buffers are submitted to (0 if not supported)
+		* @param slotCount Number of command buffers (or frames in flight) that record scopes
+		*/
+		void Create(VkDevice device, const VkPhysicalDeviceLimits& limits, uint32_t timestampValidBits, uint32_t slotCount)
+		{
+			supported = limits.timestampComputeAndGraphics && (timestampValidBits > 0) && (slotCount > 0);
+			if (!supported)
+				return;
+			timestampPeriod = limits.timestampPeriod;
+			timestampMask = (timestampValidBits >= 64) ? ~0ull : ((1ull << timestampValidBits) - 1);
+			queryRing.Create(device, VK_QUERY_TYPE_TIMESTAMP, maxScopes * 2, slotCount);
+			slots.resize(slotCount);
+			for (auto& slot : slots)
+			{
+				slot.recorded.reserve(maxScopes);
+				slot.submitted.reserve(maxScopes);
+			}
+			timestamps.resize(maxScopes * 2);
+		}
+
+		void Destroy()
+		{
+			if (supported)
+				queryRing.Destroy();
+			slots.clear();
+			supported = false;
+		}
+
+		/** @brief True if the device supports timestamps on the command buffers' queue */
+		bool Supported() const
+		{
+			return supported;
+		}
+
+		/**
+		* Start recording the scopes of a slot's command buffer, must be called outside of a render pass
+		*
+		* @param commandBuffer Command buffer that will contain the scopes
+		* @param slot Slot of the command buffer, e.g. its index in drawCmdBuffers
+		*/
+		void BeginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+		{
+			if (!supported)
+				return;
+			assert(slot < slots.size());
+			// The command buffer may have been used for another slot before (e.g. after a resize)
+			for (auto& other : slots)
+			{
+				if (other.commandBuffer == commandBuffer)
+					other.commandBuffer = VK_NULL_HANDLE;
+			}
+			Slot& current = slots[slot];
+			current.commandBuffer = commandBuffer;
+			current.recorded.clear();
+			current.open.clear();
+			current.queryCount = 0;
+			queryRing.Reset(commandBuffer, slot);
+		}
+
+		/**
+		* Begin a named scope, also begins a debug marker region
+		*
+		* @param commandBuffer Command buffer passed to BeginFrame, for other command buffers only the debug marker region is emitted
+		* @param name Name of the scope, scopes with the same name are added up
+		* @param color (Optional) Color of the debug marker region
+		*/
+		void BeginScope(VkCommandBuffer commandBuffer, const char* name, glm::vec4 color = glm::vec4(1.0f))
+		{
+			vks::debugmarker::BeginRegion(commandBuffer, name, color);
+			Slot* slot = supported ? FindSlot(commandBuffer) : nullptr;
+			if (!slot)
+				return;
+			// Scopes that don't fit are still closed by EndScope, with an invalid query
+			uint32_t scopeIndex = UINT32_MAX;
+			if (slot->recorded.size() < maxScopes)
+			{
+				Scope scope;
+				scope.timing = FindTiming(name, static_cast<uint32_t>(slot->open.size()));
+				scope.beginQuery = slot->queryCount++;
+				scope.endQuery = UINT32_MAX;
+				scopeIndex = static_cast<uint32_t>(slot->recorded.size());
+				slot->recorded.push_back(scope);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryRing.Pool(static_cast<uint32_t>(slot - slots.data())), scope.beginQuery);
+			}
+			slot->open.push_back(scopeIndex);
+		}
+
+		/** @brief End the innermost scope of the command buffer, also ends the debug marker region */
+		void EndScope(VkCommandBuffer commandBuffer)
+		{
+			vks::debugmarker::EndRegion(commandBuffer);
+			Slot* slot = supported ? FindSlot(commandBuffer) : nullptr;
+			if (!slot || slot->open.empty())
+				return;
+			const uint32_t scopeIndex = slot->open.back();
+			slot->open.pop_back();
+			if (scopeIndex == UINT32_MAX)
+				return;
+			Scope& scope = slot->recorded[scopeIndex];
+			scope.endQuery = slot->queryCount++;
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryRing.Pool(static_cast<uint32_t>(slot - slots.data())), scope.endQuery);
+		}
+
+		/** @brief Mark a slot's scopes as submitted, call after its command buffer has been submitted */
+		void Submitted(uint32_t slot)
+		{
+			if (!supported || (slots[slot].commandBuffer == VK_NULL_HANDLE))
+				return;
+			slots[slot].submitted = slots[slot].recorded;
+			slots[slot].submittedQueryCount = slots[slot].queryCount;
+			queryRing.Submitted(slot);
+		}
+
+		/**
+		* Read the timestamps of a slot's last submission and update the timings, without waiting for the GPU
+		*
+		* @param slot Slot to resolve, its last submission must have finished
+		*/
+		void Resolve(uint32_t slot)
+		{
+			if (!supported)
+				return;
+			Slot& current = slots[slot];
+			if (current.submitted.empty() || !queryRing.Read(slot, timestamps.data(), current.submittedQueryCount))
+				return;
+			resolveIndex++;
+			for (auto& scope : current.submitted)
+			{
+				if (scope.endQuery == UINT32_MAX)
+					continue;
+				const uint64_t ticks = (timestamps[scope.endQuery] - timestamps[scope.beginQuery]) & timestampMask;
+				const double time = static_cast<double>(ticks) * timestampPeriod / 1000000.0;
+				Timing& timing = timings[scope.timing];
+				if (timing.resolveIndex != resolveIndex)
+				{
+					timing.resolveIndex = resolveIndex;
+					timing.last = 0.0;
+				}
+				timing.last += time;
+			}
+			for (auto& timing : timings)
+			{
+				if (timing.resolveIndex != resolveIndex)
+					continue;
+				timing.smoothed = (timing.smoothed == 0.0) ? timing.last : (timing.smoothed + (timing.last - timing.smoothed) * smoothing);
+				timing.total += timing.last;
+				timing.frameCount++;
+			}
+		}
+
+		/** @brief Timings of all scopes, in the order they have first been recorded */
+		const std::vector<Timing>& Timings() const
+		{
+			return timings;
+		}
+
+		/** @brief Average time of each scope since the last ResetStats */
+		std::vector<std::pair<std::string, double>> Averages() const
+		{
+			std::vector<std::pair<std::string, double>> averages;
+			for (auto& timing : timings)
+			{
+				if (timing.frameCount > 0)
+					averages.push_back({ timing.name, timing.total / timing.frameCount });
+			}
+			return averages;
+		}
+
+		/** @brief Restart the averages, e.g. after a benchmark's warm up phase */
+		void ResetStats()
+		{
+			for (auto& timing : timings)
+			{
+				timing.total = 0.0;
+				timing.frameCount = 0;
+			}
+		}
+	};
+}
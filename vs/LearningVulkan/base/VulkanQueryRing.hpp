@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	/**
+	* Query pools for asynchronous readback, with one pool per frame slot (frame in flight, or swap chain image for pre-recorded command buffers)
+	*
+	* A slot's queries are reset and written by the command buffer of that slot, and are read back on the CPU when the slot comes around again
+	* and its fence has been signaled, i.e. a few frames later. The results are fetched without VK_QUERY_RESULT_WAIT_BIT,
+	* so reading them never stalls the CPU on the GPU. Queries that aren't available (yet) keep the last value that has been read.
+	*
+	* Usage:
+	* - Reset the slot's queries with Reset at the start of its command buffer (outside of a render pass), then write them to Pool(slot)
+	* - Call Submitted after the command buffer has been submitted
+	* - Once the slot's previous submission has finished (e.g. after VulkanBase::PrepareFrame), call Read before submitting it again
+	*/
+	class QueryRing
+	{
+	private:
+		VkDevice device = VK_NULL_HANDLE;
+		uint32_t queryCount = 0;
+		uint32_t valuesPerQuery = 1;
+		std::vector<VkQueryPool> pools;
+		// Slots whose queries have been submitted at least once, queries that have never been reset must not be read
+		std::vector<bool> submitted;
+		// Values of all queries of a slot, each followed by its availability
+		std::vector<uint64_t> readback;
+
+	public:
+		/** @brief Number of queries that weren't available when their slot has been read */
+		uint32_t unavailableCount = 0;
+
+		/**
+		* Create the query pools
+		*
+		* @param device Logical device
+		* @param queryType Type of the queries
+		* @param queryCount Number of queries per slot
+		* @param slotCount Number of slots (frames in flight or command buffers) that write the queries
+		* @param pipelineStatistics (Optional) Counters of pipeline statistics queries, each query returns one value per counter
+		*/
+		void Create(VkDevice device, VkQueryType queryType, uint32_t queryCount, uint32_t slotCount, VkQueryPipelineStatisticFlags pipelineStatistics = 0)
+		{
+			assert((queryCount > 0) && (slotCount > 0));
+			this->device = device;
+			this->queryCount = queryCount;
+			valuesPerQuery = 1;
+			if (queryType == VK_QUERY_TYPE_PIPELINE_STATISTICS)
+			{
+				valuesPerQuery = 0;
+				for (VkQueryPipelineStatisticFlags bits = pipelineStatistics; bits != 0; bits &= bits - 1)
+				{
+					valuesPerQuery++;
+				}
+			}
+
+			VkQueryPoolCreateInfo queryPoolInfo = {};
+			queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			queryPoolInfo.queryType = queryType;
+			queryPoolInfo.queryCount = queryCount;
+			queryPoolInfo.pipelineStatistics = pipelineStatistics;
+			pools.resize(slotCount);
+			for (auto& pool : pools)
+			{
+				VK_CHECK_RESULT(vkCreateQueryPool(device, &queryPoolInfo, nullptr, &pool));
+			}
+			submitted.assign(slotCount, false);
+			readback.resize(queryCount * (valuesPerQuery + 1));
+		}
+
+		void Destroy()
+		{
+			for (auto& pool : pools)
+			{
+				vkDestroyQueryPool(device, pool, nullptr);
+			}
+			pools.clear();
+			submitted.clear();
+		}
+
+		/** @brief Query pool written by the command buffer of a slot */
+		VkQueryPool Pool(uint32_t slot) const
+		{
+			assert(slot < pools.size());
+			return pools[slot];
+		}
+
+		/** @brief Reset all queries of a slot, must be recorded outside of a render pass */
+		void Reset(VkCommandBuffer commandBuffer, uint32_t slot)
+		{
+			vkCmdResetQueryPool(commandBuffer, Pool(slot), 0, queryCount);
+		}
+
+		/** @brief Mark a slot's queries as submitted, so they're read back the next time the slot is used */
+		void Submitted(uint32_t slot)
+		{
+			assert(slot < submitted.size());
+			submitted[slot] = true;
+		}
+
+		/**
+		* Read the results of a slot's last submission without waiting
+		*
+		* @param slot Slot to read, its last submission must have finished or the results will (partially) be unavailable
+		* @param results Values of the queries (ValuesPerQuery for each), only the ones of available queries are updated
+		* @param count (Optional) Number of queries to read, starting at the first one, if the slot doesn't write all of them
+		*
+		* @return True if all queries that have been read were available
+		*/
+		bool Read(uint32_t slot, uint64_t* results, uint32_t count = UINT32_MAX)
+		{
+			assert(slot < submitted.size());
+			if (!submitted[slot])
+				return false;
+			count = (std::min)(count, queryCount);
+			if (count == 0)
+				return true;
+			const uint32_t stride = valuesPerQuery + 1;
+			VkResult result = vkGetQueryPoolResults(
+				device,
+				pools[slot],
+				0,
+				count,
+				count * stride * sizeof(uint64_t),
+				readback.data(),
+				stride * sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			// Not ready is returned if any of the queries isn't available, the others are still written
+			if (result != VK_NOT_READY)
+			{
+				VK_CHECK_RESULT(result);
+			}
+			bool available = true;
+			for (uint32_t query = 0; query < count; query++)
+			{
+				if (readback[query * stride + valuesPerQuery] == 0)
+				{
+					available = false;
+					unavailableCount++;
+					continue;
+				}
+				memcpy(&results[query * valuesPerQuery], &readback[query * stride], valuesPerQuery * sizeof(uint64_t));
+			}
+			return available;
+		}
+
+		uint32_t SlotCount() const
+		{
+			return static_cast<uint32_t>(pools.size());
+		}
+
+		uint32_t QueryCount() const
+		{
+			return queryCount;
+		}
+
+		/** @brief Number of 64 bit values returned per query, the number of counters for pipeline statistics and 1 for all other types */
+		uint32_t ValuesPerQuery() const
+		{
+			return valuesPerQuery;
+		}
+	};
+}
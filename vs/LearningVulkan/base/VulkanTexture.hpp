@@ -28,6 +28,8 @@ namespace vks
 		VkImage image;
 		VkImageLayout imageLayout;
 		VkDeviceMemory deviceMemory;
+		/** @brief Sub-allocation backing the image, deviceMemory is the block it lives in */
+		vks::MemoryAllocation allocation;
 		VkImageView view;
 		uint32_t width, height;
 		uint32_t mipLevels;
@@ -50,7 +52,14 @@ namespace vks
 			{
 				vkDestroySampler(device->logicalDevice, sampler, nullptr);
 			}
-			vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+			if (allocation)
+			{
+				allocation.Free();
+			}
+			else
+			{
+				vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+			}
 		}
 
 		ktxResult LoadKTXFile(std::string filename, ktxTexture** target)
@@ -88,7 +97,7 @@ namespace vks
 		* @param filename File to load (supports .ktx)
 		* @param format Vulkan format of the image data stored in the file
 		* @param device Vulkan device to create the texture on
-		* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+		* @param copyQueue Queue used for the layout transition of linear tiled textures, staged uploads are submitted by the device's uploader
 		* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 		* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		* @param (Optional) forceLinear Force linear tiling (not advised, defaults to false)
@@ -126,42 +135,10 @@ namespace vks
 			// limited amount of formats and features (mip maps, cubemaps, arrays, etc.)
 			VkBool32 useStaging = !forceLinear;
 
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::MemoryAllocateInfo();
 			VkMemoryRequirements memReqs;
 
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
 			if (useStaging)
 			{
-				// Create a host-visible staging buffer that contains the raw image data
-				VkBuffer stagingBuffer;
-				VkDeviceMemory stagingMemory;
-
-				VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo();
-				bufferCreateInfo.size = ktxTextureSize;
-				// This buffer is used as a transfer source for the buffer copy
-				bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-				bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-				VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-				// Get memory requirements for the staging buffer (alignment, memory type bits)
-				vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-				memAllocInfo.allocationSize = memReqs.size;
-				// Get memory type index for a host visible buffer
-				memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-				VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-				// Copy texture data into staging buffer
-				uint8_t* data;
-				VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-				memcpy(data, ktxTextureData, ktxTextureSize);
-				vkUnmapMemory(device->logicalDevice, stagingMemory);
-
 				// Setup buffer copy regions for each mip level
 				std::vector<VkBufferImageCopy> bufferCopyRegions;
 
@@ -203,13 +180,8 @@ namespace vks
 				}
 				VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-				vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-				memAllocInfo.allocationSize = memReqs.size;
-
-				memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-				VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+				VK_CHECK_RESULT(device->memoryAllocator.AllocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+				deviceMemory = allocation.memory;
 
 				VkImageSubresourceRange subresourceRange = {};
 				subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -217,39 +189,11 @@ namespace vks
 				subresourceRange.levelCount = mipLevels;
 				subresourceRange.layerCount = 1;
 
-				// Image barrier for optimal image (target)
-				// Optimal image will be used as destination for the copy
-				vks::tools::SetImageLayout(
-					copyCmd,
-					image,
-					VK_IMAGE_LAYOUT_UNDEFINED,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					subresourceRange);
-
-				// Copy mip levels from staging buffer
-				vkCmdCopyBufferToImage(
-					copyCmd,
-					stagingBuffer,
-					image,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					static_cast<uint32_t>(bufferCopyRegions.size()),
-					bufferCopyRegions.data()
-				);
-
-				// Change texture image layout to shader read after all mip levels have been copied
+				// Copy mip levels from staging buffer, the texture image is transitioned to its final layout once the copy has finished
 				this->imageLayout = imageLayout;
-				vks::tools::SetImageLayout(
-					copyCmd,
-					image,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					imageLayout,
-					subresourceRange);
+				device->uploader.UploadImage(image, subresourceRange, imageLayout, ktxTextureData, ktxTextureSize, bufferCopyRegions.data(), static_cast<uint32_t>(bufferCopyRegions.size()));
+				device->uploader.Submit();
 
-				device->FlushCommandBuffer(copyCmd, copyQueue);
-
-				// Clean up staging resources
-				vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-				vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
 			}
 			else
 			{
@@ -261,7 +205,6 @@ namespace vks
 				assert(formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
 				VkImage mappableImage;
-				VkDeviceMemory mappableMemory;
 
 				VkImageCreateInfo imageCreateInfo = vks::initializers::ImageCreateInfo();
 				imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -281,17 +224,9 @@ namespace vks
 				// Get memory requirements for this image 
 				// like size and alignment
 				vkGetImageMemoryRequirements(device->logicalDevice, mappableImage, &memReqs);
-				// Set memory allocation size to required memory size
-				memAllocInfo.allocationSize = memReqs.size;
-
-				// Get memory type that can be mapped to host memory
-				memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-				// Allocate host memory
-				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &mappableMemory));
 
-				// Bind allocated image for use
-				VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, mappableImage, mappableMemory, 0));
+				// Allocate and bind host visible memory, the allocator keeps it persistently mapped
+				VK_CHECK_RESULT(device->memoryAllocator.AllocateImage(mappableImage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &allocation, true));
 
 				// Get sub resource layout
 				// Mip map count, array layer, etc.
@@ -306,21 +241,20 @@ namespace vks
 				// Includes row pitch, size offsets, etc.
 				vkGetImageSubresourceLayout(device->logicalDevice, mappableImage, &subRes, &subResLayout);
 
-				// Map image memory
-				VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, mappableMemory, 0, memReqs.size, 0, &data));
+				// Image memory is already mapped
+				data = allocation.mapped;
 
 				// Copy image data into memory
 				memcpy(data, ktxTextureData, memReqs.size);
 
-				vkUnmapMemory(device->logicalDevice, mappableMemory);
-
 				// Linear tiled images don't need to be staged
 				// and can be directly used as textures
 				image = mappableImage;
-				deviceMemory = mappableMemory;
+				deviceMemory = allocation.memory;
 				this->imageLayout = imageLayout;
 
 				// Setup image memory barrier
+				VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 				vks::tools::SetImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout);
 
 				device->FlushCommandBuffer(copyCmd, copyQueue);
@@ -377,7 +311,7 @@ namespace vks
 		* @param height Height of the texture to create
 		* @param format Vulkan format of the image data stored in the file
 		* @param device Vulkan device to create the texture on
-		* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+		* @param copyQueue Unused, the upload is submitted by the device's uploader
 		* @param (Optional) filter Texture filtering for the sampler (defaults to VK_FILTER_LINEAR)
 		* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 		* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
@@ -401,39 +335,6 @@ namespace vks
 			height = texHeight;
 			mipLevels = 1;
 
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::MemoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo();
-			bufferCreateInfo.size = bufferSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t* data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-			memcpy(data, buffer, bufferSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
 
 			VkBufferImageCopy bufferCopyRegion = {};
 			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -464,13 +365,8 @@ namespace vks
 			}
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-
-			memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			VK_CHECK_RESULT(device->memoryAllocator.AllocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+			deviceMemory = allocation.memory;
 
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -478,39 +374,11 @@ namespace vks
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = 1;
 
-			// Image barrier for optimal image (target)
-			// Optimal image will be used as destination for the copy
-			vks::tools::SetImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy mip levels from staging buffer
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&bufferCopyRegion
-			);
-
-			// Change texture image layout to shader read after all mip levels have been copied
+			// Copy mip levels from staging buffer, the texture image is transitioned to its final layout once the copy has finished
 			this->imageLayout = imageLayout;
-			vks::tools::SetImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
+			device->uploader.UploadImage(image, subresourceRange, imageLayout, buffer, bufferSize, &bufferCopyRegion, 1);
+			device->uploader.Submit();
 
-			device->FlushCommandBuffer(copyCmd, copyQueue);
-
-			// Clean up staging resources
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
 
 			// Create sampler
 			VkSamplerCreateInfo samplerCreateInfo = {};
@@ -555,7 +423,7 @@ namespace vks
 		* @param filename File to load (supports .ktx)
 		* @param format Vulkan format of the image data stored in the file
 		* @param device Vulkan device to create the texture on
-		* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+		* @param copyQueue Unused, the upload is submitted by the device's uploader
 		* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 		* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		*
@@ -581,36 +449,6 @@ namespace vks
 			ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
 			ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::MemoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo();
-			bufferCreateInfo.size = ktxTextureSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t* data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-			memcpy(data, ktxTextureData, ktxTextureSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
 
 			// Setup buffer copy regions for each layer including all of its miplevels
 			std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -657,51 +495,19 @@ namespace vks
 
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			VK_CHECK_RESULT(device->memoryAllocator.AllocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+			deviceMemory = allocation.memory;
 
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			// Image barrier for optimal image (target)
-			// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			subresourceRange.baseMipLevel = 0;
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = layerCount;
 
-			vks::tools::SetImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy the layers and mip levels from the staging buffer to the optimal tiled image
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data());
-
-			// Change texture image layout to shader read after all faces have been copied
+			// Copy the layers and mip levels to the optimal tiled image, the texture image is transitioned to its final layout once the copy has finished
 			this->imageLayout = imageLayout;
-			vks::tools::SetImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
-
-			device->FlushCommandBuffer(copyCmd, copyQueue);
+			device->uploader.UploadImage(image, subresourceRange, imageLayout, ktxTextureData, ktxTextureSize, bufferCopyRegions.data(), static_cast<uint32_t>(bufferCopyRegions.size()));
+			device->uploader.Submit();
 
 			// Create sampler
 			VkSamplerCreateInfo samplerCreateInfo = vks::initializers::SamplerCreateInfo();
@@ -733,8 +539,6 @@ namespace vks
 
 			// Clean up staging resources
 			ktxTexture_Destroy(ktxTexture);
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
 
 			// Update descriptor image info member that can be used for setting up descriptor sets
 			UpdateDescriptor();
@@ -750,7 +554,7 @@ namespace vks
 		* @param filename File to load (supports .ktx)
 		* @param format Vulkan format of the image data stored in the file
 		* @param device Vulkan device to create the texture on
-		* @param copyQueue Queue used for the texture staging copy commands (must support transfer)
+		* @param copyQueue Unused, the upload is submitted by the device's uploader
 		* @param (Optional) imageUsageFlags Usage flags for the texture's image (defaults to VK_IMAGE_USAGE_SAMPLED_BIT)
 		* @param (Optional) imageLayout Usage layout for the texture (defaults VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		*
@@ -775,36 +579,6 @@ namespace vks
 			ktx_uint8_t* ktxTextureData = ktxTexture_GetData(ktxTexture);
 			ktx_size_t ktxTextureSize = ktxTexture_GetSize(ktxTexture);
 
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::MemoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo();
-			bufferCreateInfo.size = ktxTextureSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t* data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void**)&data));
-			memcpy(data, ktxTextureData, ktxTextureSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
 
 			// Setup buffer copy regions for each face including all of its miplevels
 			std::vector<VkBufferImageCopy> bufferCopyRegions;
@@ -855,51 +629,19 @@ namespace vks
 
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->GetMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			VK_CHECK_RESULT(device->memoryAllocator.AllocateImage(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation));
+			deviceMemory = allocation.memory;
 
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
-
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->CreateCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			// Image barrier for optimal image (target)
-			// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			subresourceRange.baseMipLevel = 0;
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = 6;
 
-			vks::tools::SetImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy the cube map faces from the staging buffer to the optimal tiled image
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data());
-
-			// Change texture image layout to shader read after all faces have been copied
+			// Copy the cube map faces to the optimal tiled image, the texture image is transitioned to its final layout once the copy has finished
 			this->imageLayout = imageLayout;
-			vks::tools::SetImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
-
-			device->FlushCommandBuffer(copyCmd, copyQueue);
+			device->uploader.UploadImage(image, subresourceRange, imageLayout, ktxTextureData, ktxTextureSize, bufferCopyRegions.data(), static_cast<uint32_t>(bufferCopyRegions.size()));
+			device->uploader.Submit();
 
 			// Create sampler
 			VkSamplerCreateInfo samplerCreateInfo = vks::initializers::SamplerCreateInfo();
@@ -931,8 +673,6 @@ namespace vks
 
 			// Clean up staging resources
 			ktxTexture_Destroy(ktxTexture);
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
 
 			// Update descriptor image info member that can be used for setting up descriptor sets
 			UpdateDescriptor();
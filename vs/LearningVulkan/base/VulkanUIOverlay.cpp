@@ -16,6 +16,9 @@ namespace vks
 		};
 #endif
 
+		// Buffers of a single frame until SetFrameCount is called
+		frames.resize(1);
+
 		// Init ImGui
 		ImGui::CreateContext();
 		// Color scheme
@@ -297,31 +300,34 @@ namespace vks
 			return false;
 		}
 
+		// Only the buffers of the current frame are written, the GPU may still read the others
+		FrameBuffers& frame = frames[frameIndex];
+
 		// Vertex buffer
-		if ((vertexBuffer.buffer == VK_NULL_HANDLE) || (vertexCount != imDrawData->TotalVtxCount)) {
-			vertexBuffer.Unmap();
-			vertexBuffer.Destroy();
-			VK_CHECK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &vertexBuffer, vertexBufferSize));
-			vertexCount = imDrawData->TotalVtxCount;
-			vertexBuffer.Unmap();
-			vertexBuffer.Map();
+		if ((frame.vertexBuffer.buffer == VK_NULL_HANDLE) || (frame.vertexCount != imDrawData->TotalVtxCount)) {
+			frame.vertexBuffer.Unmap();
+			frame.vertexBuffer.Destroy();
+			VK_CHECK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &frame.vertexBuffer, vertexBufferSize));
+			frame.vertexCount = imDrawData->TotalVtxCount;
+			frame.vertexBuffer.Unmap();
+			frame.vertexBuffer.Map();
 			updateCmdBuffers = true;
 		}
 
 		// Index buffer
 		VkDeviceSize indexSize = imDrawData->TotalIdxCount * sizeof(ImDrawIdx);
-		if ((indexBuffer.buffer == VK_NULL_HANDLE) || (indexCount < imDrawData->TotalIdxCount)) {
-			indexBuffer.Unmap();
-			indexBuffer.Destroy();
-			VK_CHECK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &indexBuffer, indexBufferSize));
-			indexCount = imDrawData->TotalIdxCount;
-			indexBuffer.Map();
+		if ((frame.indexBuffer.buffer == VK_NULL_HANDLE) || (frame.indexCount < imDrawData->TotalIdxCount)) {
+			frame.indexBuffer.Unmap();
+			frame.indexBuffer.Destroy();
+			VK_CHECK_RESULT(device->CreateBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &frame.indexBuffer, indexBufferSize));
+			frame.indexCount = imDrawData->TotalIdxCount;
+			frame.indexBuffer.Map();
 			updateCmdBuffers = true;
 		}
 
 		// Upload data
-		ImDrawVert* vtxDst = (ImDrawVert*)vertexBuffer.mapped;
-		ImDrawIdx* idxDst = (ImDrawIdx*)indexBuffer.mapped;
+		ImDrawVert* vtxDst = (ImDrawVert*)frame.vertexBuffer.mapped;
+		ImDrawIdx* idxDst = (ImDrawIdx*)frame.indexBuffer.mapped;
 
 		for (int n = 0; n < imDrawData->CmdListsCount; n++) {
 			const ImDrawList* cmd_list = imDrawData->CmdLists[n];
@@ -332,12 +338,41 @@ namespace vks
 		}
 
 		// Flush to make writes visible to GPU
-		vertexBuffer.Flush();
-		indexBuffer.Flush();
+		frame.vertexBuffer.Flush();
+		frame.indexBuffer.Flush();
 
 		return updateCmdBuffers;
 	}
 
+	// Returns true if the next call to Update() recreates the vertex or index buffer
+	bool UIOverlay::BufferUpdateRequired() const
+	{
+		ImDrawData* imDrawData = ImGui::GetDrawData();
+		if ((!imDrawData) || (imDrawData->TotalVtxCount == 0) || (imDrawData->TotalIdxCount == 0)) {
+			return false;
+		}
+		const FrameBuffers& frame = frames[frameIndex];
+		return (frame.vertexBuffer.buffer == VK_NULL_HANDLE) || (frame.vertexCount != imDrawData->TotalVtxCount) || (frame.indexBuffer.buffer == VK_NULL_HANDLE) || (frame.indexCount < imDrawData->TotalIdxCount);
+	}
+
+	// Sets the number of frames in flight, buffers of frames beyond the new count are destroyed (the device must be idle)
+	void UIOverlay::SetFrameCount(uint32_t count)
+	{
+		for (uint32_t i = count; i < frames.size(); i++) {
+			frames[i].vertexBuffer.Destroy();
+			frames[i].indexBuffer.Destroy();
+		}
+		frames.resize(count);
+		frameIndex = frameIndex % count;
+	}
+
+	// Selects the frame whose buffers are written by Update and bound by Draw, its previous submission must have finished
+	// With more than one frame in flight, the overlay has to be recorded into a command buffer of that frame
+	void UIOverlay::SetFrame(uint32_t index)
+	{
+		frameIndex = index % static_cast<uint32_t>(frames.size());
+	}
+
 	void UIOverlay::Draw(const VkCommandBuffer commandBuffer)
 	{
 		ImDrawData* imDrawData = ImGui::GetDrawData();
@@ -348,6 +383,12 @@ namespace vks
 			return;
 		}
 
+		// Nothing has been uploaded for this frame yet
+		const FrameBuffers& frame = frames[frameIndex];
+		if ((frame.vertexBuffer.buffer == VK_NULL_HANDLE) || (frame.indexBuffer.buffer == VK_NULL_HANDLE)) {
+			return;
+		}
+
 		ImGuiIO& io = ImGui::GetIO();
 
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
@@ -358,8 +399,8 @@ namespace vks
 		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
 
 		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &frame.vertexBuffer.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, frame.indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
 
 		for (int32_t i = 0; i < imDrawData->CmdListsCount; i++)
 		{
@@ -389,8 +430,10 @@ namespace vks
 	void UIOverlay::FreeResources()
 	{
 		ImGui::DestroyContext();
-		vertexBuffer.Destroy();
-		indexBuffer.Destroy();
+		for (auto& frame : frames) {
+			frame.vertexBuffer.Destroy();
+			frame.indexBuffer.Destroy();
+		}
 		vkDestroyImageView(device->logicalDevice, fontView, nullptr);
 		vkDestroyImage(device->logicalDevice, fontImage, nullptr);
 		vkFreeMemory(device->logicalDevice, fontMemory, nullptr);
@@ -32,10 +32,17 @@ namespace vks
         VkSampleCountFlagBits rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
         uint32_t subpass = 0;
 
-        vks::Buffer vertexBuffer;
-        vks::Buffer indexBuffer;
-        int32_t vertexCount = 0;
-        int32_t indexCount = 0;
+        // Vertex and index buffers are kept per frame in flight, as they're rewritten every frame
+        struct FrameBuffers
+        {
+            vks::Buffer vertexBuffer;
+            vks::Buffer indexBuffer;
+            int32_t vertexCount = 0;
+            int32_t indexCount = 0;
+        };
+        std::vector<FrameBuffers> frames;
+        // Frame whose buffers are written by Update and bound by Draw
+        uint32_t frameIndex = 0;
 
         std::vector<VkPipelineShaderStageCreateInfo> shaders;
 
@@ -67,6 +74,9 @@ namespace vks
         void PrepareResources();
 
         bool Update();
+        bool BufferUpdateRequired() const;
+        void SetFrameCount(uint32_t count);
+        void SetFrame(uint32_t index);
         void Draw(const VkCommandBuffer commandBuffer);
         void Resize(uint32_t width, uint32_t height);
 
@@ -0,0 +1,538 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <utility>
+#include <string.h>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+#include "VulkanMemoryAllocator.hpp"
+
+namespace vks
+{
+	/**
+	* Uploads data to device local buffers and images through a persistently mapped staging ring buffer
+	*
+	* Copies are recorded into the current batch instead of a one-off command buffer, and a whole batch is submitted at once.
+	* If the device has a dedicated transfer queue the copies run on it and the resources are handed over to the graphics queue family
+	* (release barriers on the transfer queue, acquire barriers on the graphics queue, chained with a semaphore).
+	* Every batch has a fence, ring space used by a batch is recycled once the fence has been signaled.
+	*
+	* Outside of BeginBatch/EndBatch, Submit flushes the batch and waits for it, so resources can be used right after loading them.
+	* Between BeginBatch and EndBatch, Submit doesn't do anything and uploads pile up until the ring runs out of space or EndBatch is called.
+	*/
+	class Uploader
+	{
+	private:
+		static const uint32_t batchCount = 4;
+
+		struct Batch
+		{
+			VkCommandBuffer transferCmd = VK_NULL_HANDLE;
+			/** @brief Acquires ownership of the uploaded resources on the graphics queue family (dedicated transfer queue only) */
+			VkCommandBuffer acquireCmd = VK_NULL_HANDLE;
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			/** @brief Ring head after the last staging range of this batch, becomes the ring tail once the batch has finished */
+			VkDeviceSize ringEnd = 0;
+			/** @brief Ring bytes taken by this batch, including alignment padding and the unused end of the ring on wrap around */
+			VkDeviceSize ringBytes = 0;
+			/** @brief Staging buffers for uploads that didn't fit into the ring */
+			std::vector<std::pair<VkBuffer, MemoryAllocation>> overflow;
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+			bool recording = false;
+			bool pending = false;
+		};
+
+		VkDevice device = VK_NULL_HANDLE;
+		MemoryAllocator* allocator = nullptr;
+		uint32_t transferFamily = 0;
+		uint32_t graphicsFamily = 0;
+		VkQueue transferQueue = VK_NULL_HANDLE;
+		VkQueue graphicsQueue = VK_NULL_HANDLE;
+		VkCommandPool transferPool = VK_NULL_HANDLE;
+		VkCommandPool graphicsPool = VK_NULL_HANDLE;
+
+		VkBuffer ringBuffer = VK_NULL_HANDLE;
+		MemoryAllocation ringAllocation;
+		VkDeviceSize ringSize = 0;
+		VkDeviceSize head = 0;
+		VkDeviceSize tail = 0;
+		VkDeviceSize used = 0;
+		VkDeviceSize copyOffsetAlignment = 16;
+
+		Batch batches[batchCount];
+		uint32_t current = 0;
+		uint32_t batchDepth = 0;
+		std::mutex mutex;
+
+		bool SeparateFamilies() const
+		{
+			return transferFamily != graphicsFamily;
+		}
+
+		static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return ((value + alignment - 1) / alignment) * alignment;
+		}
+
+		// Wait for a submitted batch and hand its ring space and overflow buffers back
+		void Retire(Batch& batch)
+		{
+			if (!batch.pending)
+				return;
+			VK_CHECK_RESULT(vkWaitForFences(device, 1, &batch.fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+			// Batches are submitted and retired in ring order, so the tail just moves up to the end of this batch
+			tail = batch.ringEnd;
+			used -= batch.ringBytes;
+			if (used == 0)
+			{
+				// Ring is empty, start over at the beginning to get the largest contiguous range
+				head = 0;
+				tail = 0;
+			}
+			for (auto& overflow : batch.overflow)
+			{
+				vkDestroyBuffer(device, overflow.first, nullptr);
+				allocator->Free(overflow.second);
+			}
+			batch.overflow.clear();
+			batch.ringBytes = 0;
+			batch.pending = false;
+		}
+
+		// Returns the batch copies are recorded to, starting it if necessary
+		Batch& Record()
+		{
+			Batch& batch = batches[current];
+			if (!batch.recording)
+			{
+				Retire(batch);
+				VK_CHECK_RESULT(vkResetFences(device, 1, &batch.fence));
+				VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::CommandBufferBeginInfo();
+				cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				VK_CHECK_RESULT(vkBeginCommandBuffer(batch.transferCmd, &cmdBufInfo));
+				batch.recording = true;
+			}
+			return batch;
+		}
+
+		// Take a range from the ring, fails if the free space doesn't have a large enough contiguous range
+		bool TryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+		{
+			if ((used > 0) && (head == tail))
+				return false;
+			VkDeviceSize start = AlignUp(head, alignment);
+			VkDeviceSize taken;
+			if (head >= tail)
+			{
+				// Free space is [head, ringSize) and [0, tail)
+				if (start + size <= ringSize)
+				{
+					taken = start + size - head;
+				}
+				else if (size <= tail)
+				{
+					// Skip the end of the ring and wrap around
+					taken = ringSize - head + size;
+					start = 0;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			else
+			{
+				// Free space is [head, tail)
+				if (start + size > tail)
+					return false;
+				taken = start + size - head;
+			}
+			head = start + size;
+			used += taken;
+			batches[current].ringBytes += taken;
+			offset = start;
+			return true;
+		}
+
+		// Stage data for the current batch, returns the buffer and offset the copy has to read from
+		void Stage(const void* data, VkDeviceSize size, VkDeviceSize alignment, VkBuffer& buffer, VkDeviceSize& offset)
+		{
+			alignment = (std::max)(alignment, copyOffsetAlignment);
+			if (size <= ringSize)
+			{
+				// Make room by submitting the current batch and waiting for the oldest ones until the range fits
+				Record();
+				bool reserved = TryReserve(size, alignment, offset);
+				for (uint32_t i = 0; !reserved && (i < batchCount); i++)
+				{
+					if (i == 0)
+					{
+						FlushBatch();
+						stats.stallCount++;
+					}
+					Retire(batches[(current + i) % batchCount]);
+					Record();
+					reserved = TryReserve(size, alignment, offset);
+				}
+				if (reserved)
+				{
+					memcpy(static_cast<uint8_t*>(ringAllocation.mapped) + offset, data, static_cast<size_t>(size));
+					buffer = ringBuffer;
+					return;
+				}
+			}
+
+			// Larger than the ring, use a separate staging buffer that's released together with the batch
+			std::pair<VkBuffer, MemoryAllocation> overflow;
+			VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size);
+			VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &overflow.first));
+			VK_CHECK_RESULT(allocator->AllocateBuffer(overflow.first, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &overflow.second, MemoryUsage::Transient));
+			memcpy(overflow.second.mapped, data, static_cast<size_t>(size));
+			Record().overflow.push_back(overflow);
+			buffer = overflow.first;
+			offset = 0;
+			stats.overflowCount++;
+		}
+
+		void FlushBatch()
+		{
+			Batch& batch = batches[current];
+			if (!batch.recording)
+				return;
+
+			if (SeparateFamilies())
+			{
+				// Release the resources on the transfer queue and acquire them on the graphics queue
+				// Both sides use the same barriers (including the image layout transitions), only the access masks differ
+				for (auto& barrier : batch.bufferBarriers)
+				{
+					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.dstAccessMask = 0;
+				}
+				for (auto& barrier : batch.imageBarriers)
+				{
+					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.dstAccessMask = 0;
+				}
+				vkCmdPipelineBarrier(batch.transferCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+					0, nullptr,
+					static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+					static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+				VK_CHECK_RESULT(vkEndCommandBuffer(batch.transferCmd));
+
+				for (auto& barrier : batch.bufferBarriers)
+				{
+					barrier.srcAccessMask = 0;
+					barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+				}
+				for (auto& barrier : batch.imageBarriers)
+				{
+					barrier.srcAccessMask = 0;
+					barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+				}
+				VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::CommandBufferBeginInfo();
+				cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				VK_CHECK_RESULT(vkBeginCommandBuffer(batch.acquireCmd, &cmdBufInfo));
+				vkCmdPipelineBarrier(batch.acquireCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+					0, nullptr,
+					static_cast<uint32_t>(batch.bufferBarriers.size()), batch.bufferBarriers.data(),
+					static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+				VK_CHECK_RESULT(vkEndCommandBuffer(batch.acquireCmd));
+
+				VkSubmitInfo submitInfo = vks::initializers::SubmitInfo();
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch.transferCmd;
+				submitInfo.signalSemaphoreCount = 1;
+				submitInfo.pSignalSemaphores = &batch.semaphore;
+				VK_CHECK_RESULT(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+				VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+				submitInfo = vks::initializers::SubmitInfo();
+				submitInfo.waitSemaphoreCount = 1;
+				submitInfo.pWaitSemaphores = &batch.semaphore;
+				submitInfo.pWaitDstStageMask = &waitStageMask;
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch.acquireCmd;
+				VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, batch.fence));
+			}
+			else
+			{
+				// Make the copies visible to everything submitted later and move the images to their final layouts
+				for (auto& barrier : batch.imageBarriers)
+				{
+					barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+					barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+				}
+				VkMemoryBarrier memoryBarrier = vks::initializers::MemoryBarrier();
+				memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+				vkCmdPipelineBarrier(batch.transferCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+					1, &memoryBarrier,
+					0, nullptr,
+					static_cast<uint32_t>(batch.imageBarriers.size()), batch.imageBarriers.data());
+				VK_CHECK_RESULT(vkEndCommandBuffer(batch.transferCmd));
+
+				VkSubmitInfo submitInfo = vks::initializers::SubmitInfo();
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch.transferCmd;
+				VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, batch.fence));
+			}
+
+			batch.bufferBarriers.clear();
+			batch.imageBarriers.clear();
+			batch.ringEnd = head;
+			batch.recording = false;
+			batch.pending = true;
+			current = (current + 1) % batchCount;
+			stats.submitCount++;
+		}
+
+		void RecordBufferCopy(VkBuffer src, VkBuffer dst, const VkBufferCopy& copyRegion)
+		{
+			Batch& batch = Record();
+			vkCmdCopyBuffer(batch.transferCmd, src, dst, 1, &copyRegion);
+			if (SeparateFamilies())
+			{
+				VkBufferMemoryBarrier bufferBarrier = vks::initializers::BufferMemoryBarrier();
+				bufferBarrier.srcQueueFamilyIndex = transferFamily;
+				bufferBarrier.dstQueueFamilyIndex = graphicsFamily;
+				bufferBarrier.buffer = dst;
+				bufferBarrier.offset = copyRegion.dstOffset;
+				bufferBarrier.size = copyRegion.size;
+				batch.bufferBarriers.push_back(bufferBarrier);
+			}
+			stats.copyCount++;
+		}
+
+		void WaitIdle()
+		{
+			for (uint32_t i = 0; i < batchCount; i++)
+			{
+				// Oldest batch first, so the ring tail moves up in order
+				Retire(batches[(current + i) % batchCount]);
+			}
+		}
+
+	public:
+		/** @brief Upload statistics since creation */
+		struct Stats
+		{
+			uint32_t submitCount = 0;
+			uint32_t copyCount = 0;
+			VkDeviceSize bytes = 0;
+			/** @brief Uploads that were larger than the ring and got their own staging buffer */
+			uint32_t overflowCount = 0;
+			/** @brief Times the ring was full and the current batch had to be submitted early */
+			uint32_t stallCount = 0;
+		} stats;
+
+		/**
+		* Create the staging ring and the per batch command buffers and synchronization objects
+		*
+		* @param device Logical device
+		* @param allocator Allocator the staging ring (and overflow staging buffers) are taken from
+		* @param properties Properties of the physical device, used for the copy offset alignment
+		* @param graphicsFamily Queue family the uploaded resources are used on
+		* @param transferFamily Queue family the copies are submitted on, may be the same as graphicsFamily
+		* @param ringSize (Optional) Size of the staging ring in bytes (defaults to 64 MiB)
+		*/
+		void Create(VkDevice device, MemoryAllocator* allocator, const VkPhysicalDeviceProperties& properties, uint32_t graphicsFamily, uint32_t transferFamily, VkDeviceSize ringSize = 64ull * 1024 * 1024)
+		{
+			this->device = device;
+			this->allocator = allocator;
+			this->graphicsFamily = graphicsFamily;
+			this->transferFamily = transferFamily;
+			this->ringSize = ringSize;
+			copyOffsetAlignment = (std::max)(static_cast<VkDeviceSize>(16), properties.limits.optimalBufferCopyOffsetAlignment);
+			vkGetDeviceQueue(device, graphicsFamily, 0, &graphicsQueue);
+			vkGetDeviceQueue(device, transferFamily, 0, &transferQueue);
+
+			VkBufferCreateInfo bufferCreateInfo = vks::initializers::BufferCreateInfo(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, ringSize);
+			VK_CHECK_RESULT(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &ringBuffer));
+			VK_CHECK_RESULT(allocator->AllocateBuffer(ringBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &ringAllocation, MemoryUsage::Dedicated));
+
+			VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::CommandPoolCreateInfo();
+			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			cmdPoolInfo.queueFamilyIndex = transferFamily;
+			VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &transferPool));
+			if (SeparateFamilies())
+			{
+				cmdPoolInfo.queueFamilyIndex = graphicsFamily;
+				VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &graphicsPool));
+			}
+
+			for (auto& batch : batches)
+			{
+				VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::CommandBufferAllocateInfo(transferPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+				VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &batch.transferCmd));
+				if (SeparateFamilies())
+				{
+					cmdBufAllocateInfo.commandPool = graphicsPool;
+					VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &cmdBufAllocateInfo, &batch.acquireCmd));
+					VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::SemaphoreCreateInfo();
+					VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &batch.semaphore));
+				}
+				VkFenceCreateInfo fenceCreateInfo = vks::initializers::FenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
+				VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &batch.fence));
+			}
+		}
+
+		/** @brief Wait for all uploads and release the Vulkan resources */
+		void Destroy()
+		{
+			if (device == VK_NULL_HANDLE)
+				return;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				FlushBatch();
+				WaitIdle();
+			}
+			for (auto& batch : batches)
+			{
+				if (batch.semaphore)
+					vkDestroySemaphore(device, batch.semaphore, nullptr);
+				vkDestroyFence(device, batch.fence, nullptr);
+				batch = Batch();
+			}
+			vkDestroyCommandPool(device, transferPool, nullptr);
+			if (graphicsPool)
+				vkDestroyCommandPool(device, graphicsPool, nullptr);
+			vkDestroyBuffer(device, ringBuffer, nullptr);
+			allocator->Free(ringAllocation);
+			device = VK_NULL_HANDLE;
+		}
+
+		/** @brief True if copies are submitted on a dedicated transfer queue */
+		bool DedicatedTransferQueue() const
+		{
+			return SeparateFamilies();
+		}
+
+		/**
+		* Stage data and record the copy to a device local buffer
+		*
+		* @param buffer Destination buffer (must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+		* @param data Data to copy, it's copied to the staging ring right away
+		* @param size Size of the data in bytes
+		* @param offset (Optional) Offset into the destination buffer
+		*/
+		void UploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize offset = 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			VkBuffer stagingBuffer;
+			VkBufferCopy copyRegion{};
+			Stage(data, size, 4, stagingBuffer, copyRegion.srcOffset);
+			copyRegion.dstOffset = offset;
+			copyRegion.size = size;
+			RecordBufferCopy(stagingBuffer, buffer, copyRegion);
+			stats.bytes += size;
+		}
+
+		/**
+		* Record a copy between two buffers
+		*
+		* @param src Source buffer, must stay valid until the batch has finished (see Submit and EndBatch)
+		* @param dst Destination buffer
+		* @param copyRegion Region to copy
+		*/
+		void CopyBuffer(VkBuffer src, VkBuffer dst, const VkBufferCopy& copyRegion)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			RecordBufferCopy(src, dst, copyRegion);
+		}
+
+		/**
+		* Stage image data and record the copy to an optimal tiled image, including the layout transitions
+		*
+		* @param image Destination image (must have been created with VK_IMAGE_USAGE_TRANSFER_DST_BIT), its current content is discarded
+		* @param subresourceRange Subresources covered by the copy regions
+		* @param imageLayout Layout the image is transitioned to after the copy
+		* @param data Image data, it's copied to the staging ring right away
+		* @param size Size of the image data in bytes
+		* @param regions Copy regions, buffer offsets are relative to data
+		* @param regionCount Number of copy regions
+		* @param (Optional) alignment Alignment of the staged data, must be a multiple of the format's texel block size (defaults to 16)
+		*/
+		void UploadImage(VkImage image, const VkImageSubresourceRange& subresourceRange, VkImageLayout imageLayout, const void* data, VkDeviceSize size, const VkBufferImageCopy* regions, uint32_t regionCount, VkDeviceSize alignment = 16)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			VkBuffer stagingBuffer;
+			VkDeviceSize stagingOffset;
+			Stage(data, size, alignment, stagingBuffer, stagingOffset);
+			Batch& batch = Record();
+
+			VkImageMemoryBarrier imageBarrier = vks::initializers::ImageMemoryBarrier();
+			imageBarrier.srcAccessMask = 0;
+			imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarrier.image = image;
+			imageBarrier.subresourceRange = subresourceRange;
+			vkCmdPipelineBarrier(batch.transferCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+			std::vector<VkBufferImageCopy> copyRegions(regions, regions + regionCount);
+			for (auto& copyRegion : copyRegions)
+			{
+				copyRegion.bufferOffset += stagingOffset;
+			}
+			vkCmdCopyBufferToImage(batch.transferCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, copyRegions.data());
+
+			// The transition to the final layout is recorded for all images of the batch at once when it's submitted
+			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarrier.newLayout = imageLayout;
+			if (SeparateFamilies())
+			{
+				imageBarrier.srcQueueFamilyIndex = transferFamily;
+				imageBarrier.dstQueueFamilyIndex = graphicsFamily;
+			}
+			batch.imageBarriers.push_back(imageBarrier);
+
+			stats.copyCount++;
+			stats.bytes += size;
+		}
+
+		/**
+		* Submit the recorded copies and wait for them, unless a batch has been started with BeginBatch
+		*
+		* @note Loaders call this after recording their uploads, so the resources are ready to use once they return
+		*/
+		void Submit()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (batchDepth == 0)
+			{
+				FlushBatch();
+				WaitIdle();
+			}
+		}
+
+		/**
+		* Start collecting uploads, loaders' calls to Submit are deferred until the matching EndBatch
+		*
+		* @note Uploaded resources must not be used before EndBatch, and sources passed to CopyBuffer must stay valid until then
+		*/
+		void BeginBatch()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batchDepth++;
+		}
+
+		/** @brief Submit everything that has been collected since BeginBatch and wait for it to finish */
+		void EndBatch()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			assert(batchDepth > 0);
+			if (--batchDepth == 0)
+			{
+				FlushBatch();
+				WaitIdle();
+			}
+		}
+	};
+}
@@ -1,2 +1,3 @@
 glslangvalidator -V textoverlay.vert -o textoverlay.vert.spv
-glslangvalidator -V textoverlay.frag -o textoverlay.frag.spv
\ No newline at end of file
+glslangvalidator -V textoverlay.frag -o textoverlay.frag.spv
+glslangvalidator -V clustercull.comp -o clustercull.comp.spv
\ No newline at end of file
@@ -0,0 +1,6 @@
+glslangvalidator -V mesh.vert -o mesh.vert.spv
+glslangvalidator -V mesh.frag -o mesh.frag.spv
+glslangvalidator -V mesh_bindless.vert -o mesh_bindless.vert.spv
+glslangvalidator -V mesh_bindless.frag -o mesh_bindless.frag.spv
+glslangvalidator -V mesh_indirect.vert -o mesh_indirect.vert.spv
+glslangvalidator -V drawcull.comp -o drawcull.comp.spv
\ No newline at end of file
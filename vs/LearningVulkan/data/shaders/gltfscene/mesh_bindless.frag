@@ -0,0 +1,35 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Image index of each material's base color texture
+layout (set = 1, binding = 0) readonly buffer Materials
+{
+	uint baseColorImage[];
+} materials;
+// All images of the scene
+layout (set = 1, binding = 1) uniform sampler2D images[];
+
+layout (location = 0) in vec3 inNormal;
+layout (location = 1) in vec3 inColor;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inViewVec;
+layout (location = 4) in vec3 inLightVec;
+layout (location = 5) flat in uint inMaterialIndex;
+
+layout (location = 0) out vec4 outFragColor;
+
+void main() 
+{
+	// The index is the same for all invocations of a draw, but may differ once draws are merged
+	uint imageIndex = materials.baseColorImage[inMaterialIndex];
+	vec4 color = texture(images[nonuniformEXT(imageIndex)], inUV) * vec4(inColor, 1.0);
+
+	vec3 N = normalize(inNormal);
+	vec3 L = normalize(inLightVec);
+	vec3 V = normalize(inViewVec);
+	vec3 R = reflect(-L, N);
+	vec3 diffuse = max(dot(N, L), 0.15) * inColor;
+	vec3 specular = pow(max(dot(R, V), 0.0), 16.0) * vec3(0.75);
+	outFragColor = vec4(diffuse * color.rgb + specular, 1.0);		
+}
\ No newline at end of file
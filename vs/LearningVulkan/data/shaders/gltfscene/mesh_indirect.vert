@@ -0,0 +1,53 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec2 inUV;
+layout (location = 3) in vec3 inColor;
+
+layout (set = 0, binding = 0) uniform UBOScene
+{
+	mat4 projection;
+	mat4 view;
+	vec4 lightPos;
+} uboScene;
+
+// Same layout as VulkanglTFModel::DrawData
+struct DrawData
+{
+	mat4 model;
+	vec4 boundingSphere;
+	uint firstIndex;
+	uint indexCount;
+	uint materialIndex;
+	uint padding;
+};
+
+// The draw index is passed as first instance of the indirect draw
+layout (set = 2, binding = 1, std430) readonly buffer Draws
+{
+	DrawData draws[ ];
+};
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 2) out vec2 outUV;
+layout (location = 3) out vec3 outViewVec;
+layout (location = 4) out vec3 outLightVec;
+// Material index of the draw
+layout (location = 5) flat out uint outMaterialIndex;
+
+void main() 
+{
+	outNormal = inNormal;
+	outColor = inColor;
+	outUV = inUV;
+	outMaterialIndex = draws[gl_InstanceIndex].materialIndex;
+	gl_Position = uboScene.projection * uboScene.view * draws[gl_InstanceIndex].model * vec4(inPos.xyz, 1.0);
+	
+	vec4 pos = uboScene.view * vec4(inPos, 1.0);
+	outNormal = mat3(uboScene.view) * inNormal;
+	vec3 lPos = mat3(uboScene.view) * uboScene.lightPos.xyz;
+	outLightVec = lPos - pos.xyz;
+	outViewVec = -pos.xyz;		
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 glslangvalidator -V phong.vert -o phong.vert.spv
 glslangvalidator -V phong.frag -o phong.frag.spv
 glslangvalidator -V starsphere.vert -o starsphere.vert.spv
-glslangvalidator -V starsphere.frag -o starsphere.frag.spv
\ No newline at end of file
+glslangvalidator -V starsphere.frag -o starsphere.frag.spv
+glslangvalidator -V phong_cached.vert -o phong_cached.vert.spv
+glslangvalidator -V starsphere_cached.vert -o starsphere_cached.vert.spv
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+layout (location = 1) in vec3 inNormal;
+layout (location = 2) in vec3 inColor;
+
+// Same layout as VulkanExampleMultiThreading::ObjectShaderData
+struct ObjectData
+{
+	mat4 mvp;
+	vec4 color;
+};
+
+// Written every frame, the object index is passed as first instance so the recorded draws never change
+layout (set = 0, binding = 0, std430) readonly buffer Objects
+{
+	ObjectData objects[ ];
+};
+
+layout (location = 0) out vec3 outNormal;
+layout (location = 1) out vec3 outColor;
+layout (location = 3) out vec3 outViewVec;
+layout (location = 4) out vec3 outLightVec;
+
+void main() 
+{
+	mat4 mvp = objects[gl_InstanceIndex].mvp;
+
+	if ( (inColor.r == 1.0) && (inColor.g == 0.0) && (inColor.b == 0.0))
+	{	
+		outColor = objects[gl_InstanceIndex].color.rgb;
+	}
+	else
+	{
+		outColor = inColor;
+	}
+	
+	gl_Position = mvp * vec4(inPos.xyz, 1.0);
+	
+	vec4 pos = mvp * vec4(inPos, 1.0);
+	outNormal = mat3(mvp) * inNormal;
+	vec3 lPos = vec3(0.0);
+	outLightVec = lPos - pos.xyz;
+	outViewVec = -pos.xyz;
+}
\ No newline at end of file
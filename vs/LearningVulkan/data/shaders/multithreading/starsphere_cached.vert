@@ -0,0 +1,24 @@
+#version 450
+
+layout (location = 0) in vec3 inPos;
+
+// Same layout as VulkanExampleMultiThreading::ObjectShaderData
+struct ObjectData
+{
+	mat4 mvp;
+	vec4 color;
+};
+
+// The sky sphere's matrix is stored after the objects, its index is passed as first instance
+layout (set = 0, binding = 0, std430) readonly buffer Objects
+{
+	ObjectData objects[ ];
+};
+
+layout (location = 0) out vec3 outUVW;
+
+void main() 
+{
+	outUVW = inPos;
+	gl_Position = objects[gl_InstanceIndex].mvp * vec4(inPos.xyz, 1.0);
+}
\ No newline at end of file